@@ -405,6 +405,14 @@ public:
    */
   virtual void onReadReady() PURE;
 
+  /**
+   * Called once per read event after all the datagrams read from the socket in that event have
+   * been handed to onData(). Paired with the preceding onReadReady() call.
+   *
+   * @param num_packets_read supplies the number of datagrams read in this event, which may be 0.
+   */
+  virtual void onReadBatchComplete(uint32_t num_packets_read) PURE;
+
   /**
    * Called when the underlying socket is ready for write.
    *
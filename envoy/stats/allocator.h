@@ -94,6 +94,16 @@ public:
   virtual void forEachSinkedGauge(SizeFn f_size, StatFn<Gauge> f_stat) const PURE;
   virtual void forEachSinkedTextReadout(SizeFn f_size, StatFn<TextReadout> f_stat) const PURE;
 
+  /**
+   * Reports the memory held by counters, gauges and text readouts, grouped by
+   * tag-extracted name. The totals are maintained as stats are allocated and
+   * freed, so this does not walk the stats. Stats marked for deletion are
+   * included until they are freed. The same locking caveats as forEachCounter
+   * apply.
+   * @param fn functor that is provided one stat family at a time.
+   */
+  virtual void forEachFamilyMemory(const StatFamilyMemoryFn& fn) const PURE;
+
   /**
    * Set the predicates to filter stats for sink.
    */
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+
+#include "envoy/common/pure.h"
+#include "envoy/stats/primitive_stats.h"
+#include "envoy/stats/stats.h"
+
+#include "absl/strings/string_view.h"
+
+namespace Envoy {
+namespace Stats {
+
+/**
+ * Tracks configured families of counters in fixed-size heavy-hitter sketches
+ * rather than allocating each counter individually. Only the busiest counters
+ * of each family, and the family total, are reported. Families may be counters
+ * created through scopes, or primitive counters such as per-host counters.
+ */
+class HeavyHitterStats {
+public:
+  virtual ~HeavyHitterStats() = default;
+
+  /**
+   * @param name the full name of the counter.
+   * @return the counter to use for the name if it belongs to a sketched family,
+   *         or nullptr if the counter should be allocated as usual. The counter
+   *         is owned by the sketch and may be shared with other names of the
+   *         family, so it must not be cached under the name.
+   */
+  virtual Counter* findCounter(StatName name) PURE;
+
+  /**
+   * Adds the latched delta of a primitive counter, such as a per-host counter,
+   * to the sketch of its family.
+   * @param name the full name of the counter.
+   * @param delta the increments since the counter was last latched.
+   * @return true if the counter belongs to a sketched family, in which case it
+   *         is reported through the sketch and not individually.
+   */
+  virtual bool addPrimitiveCounter(absl::string_view name, uint64_t delta) PURE;
+
+  /**
+   * Calls fn for each counter currently reported individually by a sketch,
+   * and for the total of each sketch. Implementations may hold a lock while
+   * calling fn, so fn must not create or destroy stats.
+   */
+  virtual void
+  forEachCounter(const std::function<void(absl::string_view name, PrimitiveCounter& counter)>& fn)
+      PURE;
+};
+
+using HeavyHitterStatsPtr = std::unique_ptr<HeavyHitterStats>;
+
+} // namespace Stats
+} // namespace Envoy
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 
 #include "envoy/stats/tag.h"
 
 #include "source/common/common/assert.h"
 #include "source/common/common/non_copyable.h"
+#include "source/common/common/thread.h"
 
 #include "absl/strings/string_view.h"
 
@@ -60,6 +63,108 @@ private:
   std::atomic<uint64_t> value_{0};
 };
 
+/**
+ * Primitive gauge whose increments and decrements can be spread over NumShards shards, each on its
+ * own cache line, with each thread always updating the same shard. Threads that update the gauge
+ * concurrently then do not bounce a shared cache line between cores, at the cost of reading the
+ * value summing the shards. Until enableSharding() is called, the gauge is updated like a
+ * PrimitiveGauge. The shards are allocated on the first update after that.
+ */
+class ShardedPrimitiveGauge : NonCopyable {
+public:
+  static constexpr uint32_t NumShards = 8;
+
+  ShardedPrimitiveGauge() = default;
+  ~ShardedPrimitiveGauge() { delete shards_.load(std::memory_order_relaxed); }
+
+  /**
+   * Spreads later updates over the shards. Must be called before the gauge is shared between
+   * threads.
+   */
+  void enableSharding() { sharded_ = true; }
+
+  uint64_t value() const {
+    const ShardBlock* shards = shards_.load(std::memory_order_acquire);
+    if (shards == nullptr) {
+      return gauge_.value();
+    }
+    int64_t value = gauge_.value();
+    for (const Shard& shard : shards->shards_) {
+      value += shard.delta_.load(std::memory_order_relaxed);
+    }
+    // Concurrent updates of different shards may be seen out of order.
+    return value > 0 ? value : 0;
+  }
+
+  void add(uint64_t amount) {
+    if (sharded_) {
+      shard().delta_.fetch_add(amount, std::memory_order_relaxed);
+    } else {
+      gauge_.add(amount);
+    }
+  }
+  void dec() { sub(1); }
+  void inc() { add(1); }
+  void set(uint64_t value) {
+    if (ShardBlock* shards = shards_.load(std::memory_order_acquire); shards != nullptr) {
+      for (Shard& shard : shards->shards_) {
+        shard.delta_.store(0, std::memory_order_relaxed);
+      }
+    }
+    gauge_.set(value);
+  }
+  void sub(uint64_t amount) {
+    if (sharded_) {
+      shard().delta_.fetch_sub(amount, std::memory_order_relaxed);
+    } else {
+      gauge_.sub(amount);
+    }
+  }
+
+  /**
+   * @return a PrimitiveGauge holding the value, for callers that export primitive gauges. Once
+   *         the gauge is sharded, the returned gauge holds the value at the time of the call.
+   */
+  PrimitiveGauge& latch() {
+    ShardBlock* shards = shards_.load(std::memory_order_acquire);
+    if (shards == nullptr) {
+      return gauge_;
+    }
+    shards->latched_.set(value());
+    return shards->latched_;
+  }
+
+private:
+  struct alignas(64) Shard {
+    // The sum of the updates of the threads of the shard, which may be negative when a thread
+    // decrements what another thread incremented.
+    std::atomic<int64_t> delta_{0};
+  };
+
+  struct ShardBlock {
+    Shard shards_[NumShards];
+    PrimitiveGauge latched_;
+  };
+
+  Shard& shard() {
+    ShardBlock* shards = shards_.load(std::memory_order_acquire);
+    if (shards == nullptr) {
+      shards = new ShardBlock();
+      ShardBlock* expected = nullptr;
+      if (!shards_.compare_exchange_strong(expected, shards, std::memory_order_acq_rel)) {
+        delete shards;
+        shards = expected;
+      }
+    }
+    return shards->shards_[Thread::threadShard(NumShards)];
+  }
+
+  // Holds the updates made before the gauge was sharded, and the value last set.
+  PrimitiveGauge gauge_;
+  std::atomic<ShardBlock*> shards_{nullptr};
+  bool sharded_{};
+};
+
 using PrimitiveGaugeReference = std::reference_wrapper<PrimitiveGauge>;
 
 class PrimitiveMetricMetadata {
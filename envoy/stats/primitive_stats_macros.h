@@ -42,10 +42,13 @@ namespace Envoy {
 // Fully-qualified for use in external callsites.
 #define GENERATE_PRIMITIVE_COUNTER_STRUCT(NAME) Envoy::Stats::PrimitiveCounter NAME##_;
 #define GENERATE_PRIMITIVE_GAUGE_STRUCT(NAME) Envoy::Stats::PrimitiveGauge NAME##_;
+#define GENERATE_SHARDED_PRIMITIVE_GAUGE_STRUCT(NAME) Envoy::Stats::ShardedPrimitiveGauge NAME##_;
 
 // Name and counter/gauge reference pair used to construct map of counters/gauges.
 #define PRIMITIVE_COUNTER_NAME_AND_REFERENCE(X) {absl::string_view(#X), std::ref(X##_)},
 #define PRIMITIVE_GAUGE_NAME_AND_REFERENCE(X) {absl::string_view(#X), std::ref(X##_)},
+#define SHARDED_PRIMITIVE_GAUGE_NAME_AND_REFERENCE(X)                                              \
+  {absl::string_view(#X), std::ref(X##_.latch())},
 
 // Ignore a counter or gauge.
 #define IGNORE_PRIMITIVE_COUNTER(X)
@@ -102,12 +102,14 @@ public:
    * Flags:
    * Used: used by all stats types to figure out whether they have been used.
    * Logic...: used by gauges to cache how they should be combined with a parent's value.
+   * Changed: used by gauges to track whether they were written since the last latchChanged().
    */
   struct Flags {
     static constexpr uint8_t Used = 0x01;
     static constexpr uint8_t LogicAccumulate = 0x02;
     static constexpr uint8_t NeverImport = 0x04;
     static constexpr uint8_t Hidden = 0x08;
+    static constexpr uint8_t Changed = 0x10;
   };
   virtual SymbolTable& symbolTable() PURE;
   virtual const SymbolTable& constSymbolTable() const PURE;
@@ -186,6 +188,14 @@ public:
    * @param import_mode the new import mode.
    */
   virtual void mergeImportMode(ImportMode import_mode) PURE;
+
+  /**
+   * Used by stats flushes that only report changed metrics. Gauges start out
+   * changed when created.
+   *
+   * @return true if the gauge was written since the previous call, clearing the indication.
+   */
+  virtual bool latchChanged() PURE;
 };
 
 using GaugeSharedPtr = RefcountPtr<Gauge>;
@@ -227,6 +237,25 @@ using SizeFn = std::function<void(std::size_t)>;
  */
 template <typename Stat> using StatFn = std::function<void(Stat&)>;
 
+/**
+ * Approximate memory held by all the stats that share a tag-extracted name.
+ */
+struct StatFamilyMemory {
+  uint64_t counters_{0};
+  uint64_t gauges_{0};
+  uint64_t text_readouts_{0};
+  uint64_t histograms_{0};
+  // Bytes held by the stat objects and their encoded names and tags. Symbol
+  // table entries are shared across families and are not included.
+  uint64_t bytes_{0};
+};
+
+/**
+ * Callback invoked for each stat family when reporting memory usage.
+ */
+using StatFamilyMemoryFn =
+    std::function<void(StatName tag_extracted_name, const StatFamilyMemory& memory)>;
+
 /**
  * Interface for stats lazy initialization.
  * To save memory and CPU consumption on blocks of stats that are never referenced throughout the
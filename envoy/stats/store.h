@@ -6,7 +6,9 @@
 
 #include "envoy/common/optref.h"
 #include "envoy/common/pure.h"
+#include "envoy/stats/heavy_hitter.h"
 #include "envoy/stats/histogram.h"
+#include "envoy/stats/primitive_stats.h"
 #include "envoy/stats/scope.h"
 #include "envoy/stats/stats.h"
 #include "envoy/stats/stats_matcher.h"
@@ -140,6 +142,36 @@ public:
   virtual void forEachSinkedTextReadout(SizeFn f_size, StatFn<TextReadout> f_stat) const PURE;
   virtual void forEachSinkedHistogram(SizeFn f_size, StatFn<ParentHistogram> f_stat) const PURE;
 
+  /**
+   * Reports the approximate memory held by stats, grouped by tag-extracted
+   * name. The per-family totals are maintained incrementally as stats are
+   * created and destroyed, so the cost is proportional to the number of
+   * families rather than the number of stats. A family holding both
+   * histograms and other stat types may be reported twice, once for each.
+   * @param fn functor that is provided one stat family at a time.
+   */
+  virtual void forEachFamilyMemory(const StatFamilyMemoryFn& fn) const PURE;
+
+  /**
+   * Iterate over the counters reported by heavy-hitter sketches: the busiest
+   * members of each sketched family, and each family total. These counters
+   * are not visited by forEachCounter or forEachSinkedCounter. Constructing
+   * each snapshot latches the underlying counter, as for per-host counters.
+   * @param fn functor that is provided one counter snapshot at a time.
+   */
+  virtual void
+  forEachHeavyHitterCounter(const std::function<void(PrimitiveCounterSnapshot&&)>& fn) PURE;
+
+  /**
+   * Adds the latched delta of a primitive counter, such as a per-host counter,
+   * to the heavy-hitter sketch of its family, if any. Counters added to a
+   * sketch are reported by forEachHeavyHitterCounter instead of individually.
+   * @param name the full name of the counter.
+   * @param delta the increments since the counter was last latched.
+   * @return true if the counter belongs to a sketched family.
+   */
+  virtual bool addHeavyHitterCounter(absl::string_view name, uint64_t delta) PURE;
+
   /**
    * Calls 'fn' for every stat. Note that in the case of overlapping scopes, the
    * implementation may call fn more than one time for each counter. Iteration
@@ -235,6 +267,13 @@ public:
    */
   virtual void setHistogramSettings(HistogramSettingsConstPtr&& histogram_settings) PURE;
 
+  /**
+   * Attach a HeavyHitterStats to this StoreRoot, so that counters in the families it
+   * configures are tracked by sketches. Counters created before this is called are
+   * not affected.
+   */
+  virtual void setHeavyHitterStats(HeavyHitterStatsPtr&& heavy_hitter_stats) PURE;
+
   /**
    * Initialize the store for threading. This will be called once after all worker threads have
    * been initialized. At this point the store can initialize itself for multi-threaded operation.
@@ -31,8 +31,12 @@ using MetadataConstSharedPtr = std::shared_ptr<const envoy::config::core::v3::Me
  * {rq_success, rq_error} have specific semantics driven by the needs of EDS load reporting. See
  * envoy.api.v2.endpoint.UpstreamLocalityStats for the definitions of success/error. These are
  * latched by LoadStatsReporter, independent of the normal stats sink flushing.
+ *
+ * rq_active is updated by every worker on every stream, and read by the least request and bounded
+ * load balancers. Its updates can be spread over shards to keep the workers from contending on its
+ * cache line. @see ShardedPrimitiveGauge.
  */
-#define ALL_HOST_STATS(COUNTER, GAUGE)                                                             \
+#define ALL_HOST_STATS(COUNTER, GAUGE, SHARDED_GAUGE)                                              \
   COUNTER(cx_connect_fail)                                                                         \
   COUNTER(cx_total)                                                                                \
   COUNTER(rq_error)                                                                                \
@@ -40,22 +44,25 @@ using MetadataConstSharedPtr = std::shared_ptr<const envoy::config::core::v3::Me
   COUNTER(rq_timeout)                                                                              \
   COUNTER(rq_total)                                                                                \
   GAUGE(cx_active)                                                                                 \
-  GAUGE(rq_active)
+  SHARDED_GAUGE(rq_active)
 
 /**
  * All per host stats defined. @see stats_macros.h
  */
 struct HostStats {
-  ALL_HOST_STATS(GENERATE_PRIMITIVE_COUNTER_STRUCT, GENERATE_PRIMITIVE_GAUGE_STRUCT);
+  ALL_HOST_STATS(GENERATE_PRIMITIVE_COUNTER_STRUCT, GENERATE_PRIMITIVE_GAUGE_STRUCT,
+                 GENERATE_SHARDED_PRIMITIVE_GAUGE_STRUCT);
 
   // Provide access to name,counter pairs.
   std::vector<std::pair<absl::string_view, Stats::PrimitiveCounterReference>> counters() {
-    return {ALL_HOST_STATS(PRIMITIVE_COUNTER_NAME_AND_REFERENCE, IGNORE_PRIMITIVE_GAUGE)};
+    return {ALL_HOST_STATS(PRIMITIVE_COUNTER_NAME_AND_REFERENCE, IGNORE_PRIMITIVE_GAUGE,
+                           IGNORE_PRIMITIVE_GAUGE)};
   }
 
   // Provide access to name,gauge pairs.
   std::vector<std::pair<absl::string_view, Stats::PrimitiveGaugeReference>> gauges() {
-    return {ALL_HOST_STATS(IGNORE_PRIMITIVE_COUNTER, PRIMITIVE_GAUGE_NAME_AND_REFERENCE)};
+    return {ALL_HOST_STATS(IGNORE_PRIMITIVE_COUNTER, PRIMITIVE_GAUGE_NAME_AND_REFERENCE,
+                           SHARDED_PRIMITIVE_GAUGE_NAME_AND_REFERENCE)};
   }
 };
 
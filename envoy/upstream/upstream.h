@@ -642,6 +642,7 @@ public:
  * upstream related), roughly based on their semantics.
  */
 #define ALL_CLUSTER_CONFIG_UPDATE_STATS(COUNTER, GAUGE, HISTOGRAM, TEXT_READOUT, STATNAME)         \
+  COUNTER(assignment_rejected)                                                                     \
   COUNTER(assignment_stale)                                                                        \
   COUNTER(assignment_timeout_received)                                                             \
   COUNTER(assignment_use_cached)                                                                   \
@@ -728,6 +729,8 @@ public:
   COUNTER(upstream_rq_pending_failure_eject)                                                       \
   COUNTER(upstream_rq_pending_overflow)                                                            \
   COUNTER(upstream_rq_pending_total)                                                               \
+  COUNTER(upstream_rq_preconnect_hit)                                                              \
+  COUNTER(upstream_rq_preconnect_miss)                                                             \
   COUNTER(upstream_rq_0rtt)                                                                        \
   COUNTER(upstream_rq_per_try_timeout)                                                             \
   COUNTER(upstream_rq_per_try_idle_timeout)                                                        \
@@ -949,6 +952,13 @@ public:
    */
   virtual float peekaheadRatio() const PURE;
 
+  /**
+   * @return OptRef<const envoy::config::cluster::v3::Cluster::PreconnectPolicy::AdaptivePreconnect>
+   * the configuration of adaptive preconnecting, if enabled for this cluster.
+   */
+  virtual OptRef<const envoy::config::cluster::v3::Cluster::PreconnectPolicy::AdaptivePreconnect>
+  adaptivePreconnect() const PURE;
+
   /**
    * @return soft limit on size of the cluster's connections read and write buffers.
    */
@@ -1195,6 +1205,12 @@ public:
   virtual const absl::optional<const envoy::config::core::v3::AlternateProtocolsCacheOptions>&
   alternateProtocolsCacheOptions() const PURE;
 
+  /**
+   * @return the number of worker threads that own the HTTP connections to each upstream host when
+   *         connections are shared across worker threads, or 0 if they are not.
+   */
+  virtual uint32_t sharedConnectionPoolOwners() const PURE;
+
   /**
    * @return the Http1 Codec Stats.
    */
@@ -85,8 +85,10 @@ AccessLogFileImpl::~AccessLogFileImpl() {
 
   // Flush any remaining data. If file was not opened for some reason, skip flushing part.
   if (file_->isOpen()) {
-    if (flush_buffer_.length() > 0) {
-      doWrite(flush_buffer_);
+    Thread::LockGuard flush_lock(flush_lock_);
+    drainWriteShards();
+    if (about_to_write_buffer_.length() > 0) {
+      doWrite(about_to_write_buffer_);
     }
     const Api::IoCallBoolResult result = file_->close();
     ASSERT(result.return_value_, fmt::format("unable to close file '{}': {}", file_->path(),
@@ -136,13 +138,13 @@ void AccessLogFileImpl::flushThreadFunc() {
     {
       Thread::LockGuard write_lock(write_lock_);
 
-      // flush_event_ can be woken up either by large enough flush_buffer or by timer.
-      // In case it was timer, flush_buffer_ can be empty.
+      // flush_event_ can be woken up either by large enough write shards or by timer.
+      // In case it was timer, the write shards can be empty.
       //
       // Note: do not stop waiting when only `do_reopen` is true. In this case, we tried to
       // reopen and failed. We don't want to retry this in a tight loop, so wait for the next
       // event (timer or flush).
-      while (flush_buffer_.length() == 0 && !flush_thread_exit_ && !reopen_file_) {
+      while (pending_bytes_.load() == 0 && !flush_thread_exit_ && !reopen_file_) {
         // CondVar::wait() does not throw, so it's safe to pass the mutex rather than the guard.
         flush_event_.wait(write_lock_);
       }
@@ -152,8 +154,6 @@ void AccessLogFileImpl::flushThreadFunc() {
       }
 
       flush_lock = std::unique_lock<Thread::BasicLockable>(flush_lock_);
-      about_to_write_buffer_.move(flush_buffer_);
-      ASSERT(flush_buffer_.length() == 0);
 
       if (reopen_file_) {
         do_reopen = true;
@@ -161,6 +161,8 @@ void AccessLogFileImpl::flushThreadFunc() {
       }
     }
 
+    drainWriteShards();
+
     if (do_reopen) {
       if (file_->isOpen()) {
         const Api::IoCallBoolResult result = file_->close();
@@ -180,44 +182,71 @@ void AccessLogFileImpl::flushThreadFunc() {
 }
 
 void AccessLogFileImpl::flush() {
-  std::unique_lock<Thread::BasicLockable> flush_buffer_lock;
-
-  {
-    Thread::LockGuard write_lock(write_lock_);
-
-    // flush_lock_ must be held while checking this or else it is
-    // possible that flushThreadFunc() has already moved data from
-    // flush_buffer_ to about_to_write_buffer_, has unlocked write_lock_,
-    // but has not yet completed doWrite(). This would allow flush() to
-    // return before the pending data has actually been written to disk.
-    flush_buffer_lock = std::unique_lock<Thread::BasicLockable>(flush_lock_);
-
-    if (flush_buffer_.length() == 0) {
-      return;
-    }
-
-    about_to_write_buffer_.move(flush_buffer_);
-    ASSERT(flush_buffer_.length() == 0);
+  // flush_lock_ must be held while draining or else it is possible that
+  // flushThreadFunc() has already moved data from the write shards to
+  // about_to_write_buffer_, but has not yet completed doWrite(). This would
+  // allow flush() to return before the pending data has actually been written
+  // to disk.
+  Thread::LockGuard flush_lock(flush_lock_);
+  drainWriteShards();
+  if (about_to_write_buffer_.length() == 0) {
+    return;
   }
 
   doWrite(about_to_write_buffer_);
 }
 
 void AccessLogFileImpl::write(absl::string_view data) {
-  Thread::LockGuard lock(write_lock_);
+  stats_.write_buffered_.inc();
+  stats_.write_total_buffered_.add(data.length());
 
-  if (flush_thread_ == nullptr) {
-    createFlushStructures();
+  uint64_t pending_bytes;
+  WriteShard& shard = writeShard();
+  if (!shard.lock_.tryLock()) {
+    // Another thread hashing to the same shard is appending.
+    stats_.write_contended_.inc();
+    shard.lock_.lock();
   }
+  shard.buffer_.add(data.data(), data.size());
+  pending_bytes = pending_bytes_.fetch_add(data.size()) + data.size();
+  shard.lock_.unlock();
 
-  stats_.write_buffered_.inc();
-  stats_.write_total_buffered_.add(data.length());
-  flush_buffer_.add(data.data(), data.size());
-  if (flush_buffer_.length() > MIN_FLUSH_SIZE) {
+  // The flush thread is started after the data has been added, so that its first loop
+  // flushes it.
+  if (!flush_thread_started_.load(std::memory_order_acquire)) {
+    Thread::LockGuard lock(write_lock_);
+    if (flush_thread_ == nullptr) {
+      createFlushStructures();
+      flush_thread_started_.store(true, std::memory_order_release);
+    }
+    return;
+  }
+
+  // Only wake the flush thread when crossing the threshold. It keeps flushing without waiting
+  // for as long as data is pending.
+  if (pending_bytes > MIN_FLUSH_SIZE && pending_bytes - data.size() <= MIN_FLUSH_SIZE) {
+    Thread::LockGuard lock(write_lock_);
     flush_event_.notifyOne();
   }
 }
 
+AccessLogFileImpl::WriteShard& AccessLogFileImpl::writeShard() {
+  // Thread ids of the workers are usually consecutive, so they map to distinct shards.
+  const uint64_t thread_id = thread_factory_.currentThreadId().getId();
+  return write_shards_[thread_id % NUM_WRITE_SHARDS];
+}
+
+void AccessLogFileImpl::drainWriteShards() {
+  for (WriteShard& shard : write_shards_) {
+    Thread::LockGuard lock(shard.lock_);
+    if (shard.buffer_.length() == 0) {
+      continue;
+    }
+    pending_bytes_.fetch_sub(shard.buffer_.length());
+    about_to_write_buffer_.move(shard.buffer_);
+  }
+}
+
 void AccessLogFileImpl::createFlushStructures() {
   flush_thread_ = thread_factory_.createThread([this]() -> void { flushThreadFunc(); },
                                                Thread::Options{"AccessLogFlush"});
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <string>
 
 #include "envoy/access_log/access_log.h"
@@ -22,6 +24,7 @@ namespace Envoy {
   COUNTER(reopen_failed)                                                                           \
   COUNTER(write_buffered)                                                                          \
   COUNTER(write_completed)                                                                         \
+  COUNTER(write_contended)                                                                         \
   COUNTER(write_failed)                                                                            \
   GAUGE(write_total_buffered, Accumulate)
 
@@ -83,19 +86,34 @@ public:
   void flush() override;
 
 private:
+  // Writes are spread over shards by thread, so that workers appending to the same file
+  // do not serialize on a single lock. Each shard keeps the order of its own writes.
+  struct WriteShard {
+    Thread::MutexBasicLockable lock_;
+    Buffer::OwnedImpl buffer_ ABSL_GUARDED_BY(lock_);
+  };
+
   void doWrite(Buffer::Instance& buffer);
   void flushThreadFunc();
   void createFlushStructures();
+  WriteShard& writeShard();
+  // Moves the data of all shards into about_to_write_buffer_, one shard after another, so writes
+  // from different shards are not kept in the order they were made. Must be called with
+  // flush_lock_.
+  void drainWriteShards();
 
   // Minimum size before the flush thread will be told to flush.
   static const uint64_t MIN_FLUSH_SIZE = 1024 * 64;
+  // Number of write shards. Threads hashing to the same shard share its lock.
+  static constexpr size_t NUM_WRITE_SHARDS = 16;
 
   Filesystem::FilePtr file_;
 
   // These locks are always acquired in the following order if multiple locks are held:
   //    1) write_lock_
   //    2) flush_lock_
-  //    3) file_lock_
+  //    3) a WriteShard lock_
+  //    4) file_lock_
   Thread::BasicLockable& file_lock_;      // This lock is used only by the flush thread when writing
                                           // to disk. This is used to make sure that file blocks do
                                           // not get interleaved by multiple processes writing to
@@ -106,23 +124,26 @@ private:
                                           // and all other data used during flushing and file
                                           // re-opening.
   Thread::MutexBasicLockable
-      write_lock_; // The lock is used when filling the flush buffer. It allows
-                   // multiple threads to write to the same file at relatively
-                   // high performance. It is always local to the process.
+      write_lock_; // The lock is used to signal the flush thread and to start it. Writers only
+                   // take it on the first write and when the buffered data crosses
+                   // MIN_FLUSH_SIZE; the data itself is appended under a WriteShard lock.
   Thread::ThreadPtr flush_thread_;
+  std::atomic<bool> flush_thread_started_{false};
   Thread::CondVar flush_event_;
   bool flush_thread_exit_ ABSL_GUARDED_BY(write_lock_){false};
   bool reopen_file_ ABSL_GUARDED_BY(write_lock_){false};
-  Buffer::OwnedImpl
-      flush_buffer_ ABSL_GUARDED_BY(write_lock_); // This buffer is used by multiple threads. It
-                                                  // gets filled and then flushed either when max
-                                                  // size is reached or when a timer fires.
+  std::array<WriteShard, NUM_WRITE_SHARDS>
+      write_shards_; // These buffers are filled by the writing threads and then flushed either
+                     // when max size is reached or when a timer fires.
+  std::atomic<uint64_t> pending_bytes_{0}; // Total size of the data in write_shards_. It is only
+                                           // changed while holding the lock of the shard whose
+                                           // buffer changes.
   // TODO(jmarantz): this should be ABSL_GUARDED_BY(flush_lock_) but the analysis cannot poke
   // through the std::make_unique assignment. I do not believe it's possible to annotate this
   // properly now due to limitations in the clang thread annotation analysis.
   Buffer::OwnedImpl about_to_write_buffer_; // This buffer is used only by the flush thread. Data
-                                            // is moved from flush_buffer_ under lock, and then
-                                            // the lock is released so that flush_buffer_ can
+                                            // is moved from write_shards_ under their locks, and
+                                            // then the locks are released so that the shards can
                                             // continue to fill. This buffer is then used for the
                                             // final write to disk.
   Event::TimerPtr flush_timer_;
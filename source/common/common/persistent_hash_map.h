@@ -0,0 +1,381 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "source/common/common/assert.h"
+
+#include "absl/container/inlined_vector.h"
+#include "absl/hash/hash.h"
+#include "absl/numeric/bits.h"
+
+namespace Envoy {
+
+/**
+ * Hash map with cheap copies, implemented as a hash array mapped trie (HAMT). Each trie node
+ * covers 5 bits of the key hash and holds up to 32 slots, each either an entry or a child node,
+ * in the compressed layout of CHAMP: entries first, then children, located by popcount over
+ * per-node bitmaps. Keys whose 64-bit hashes collide completely share a collision node at the
+ * bottom of the trie.
+ *
+ * Nodes and entries are immutable once shared. Copying a map shares its root, and inserting into
+ * or erasing from the copy only copies the nodes on the path to the changed key, so an update
+ * costs O(log32 n) time and memory while all unchanged subtrees stay shared between versions.
+ * Nodes that a map owns exclusively, e.g. while it is being built, are modified in place.
+ *
+ * The map is thread compatible: distinct copies may be used from different threads, even while
+ * they share nodes. As with absl::flat_hash_map, iteration order is unspecified and any update
+ * invalidates the map's iterators. Values can only be replaced through insert_or_assign().
+ */
+template <class Key, class Value, class Hash = absl::Hash<Key>, class KeyEqual = std::equal_to<Key>>
+class PersistentHashMap {
+  struct Entry;
+  struct Node;
+  using EntrySharedPtr = std::shared_ptr<const Entry>;
+  using NodeSharedPtr = std::shared_ptr<Node>;
+
+public:
+  using key_type = Key;
+  using mapped_type = Value;
+  using value_type = std::pair<const Key, Value>;
+  using size_type = size_t;
+
+  class const_iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = PersistentHashMap::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    const_iterator() = default;
+
+    reference operator*() const { return current()->value_; }
+    pointer operator->() const { return &current()->value_; }
+
+    const_iterator& operator++() {
+      ++stack_.back().value_index_;
+      settle();
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator it = *this;
+      ++*this;
+      return it;
+    }
+
+    bool operator==(const const_iterator& other) const { return current() == other.current(); }
+    bool operator!=(const const_iterator& other) const { return current() != other.current(); }
+
+  private:
+    friend class PersistentHashMap;
+
+    // The position within one node on the path from the root to the current entry. The entries
+    // of a node are visited before its children.
+    struct Frame {
+      const Node* node_;
+      uint32_t value_index_;
+      uint32_t child_index_;
+    };
+
+    const Entry* current() const {
+      if (stack_.empty()) {
+        return nullptr;
+      }
+      const Frame& frame = stack_.back();
+      return frame.node_->values_[frame.value_index_].get();
+    }
+
+    // Moves to the next entry, at or after the current position, in depth-first order.
+    void settle() {
+      while (!stack_.empty()) {
+        Frame& frame = stack_.back();
+        if (frame.value_index_ < frame.node_->values_.size()) {
+          return;
+        }
+        if (frame.child_index_ < frame.node_->children_.size()) {
+          const Node* child = frame.node_->children_[frame.child_index_++].get();
+          stack_.push_back({child, 0, 0});
+          continue;
+        }
+        stack_.pop_back();
+      }
+    }
+
+    absl::InlinedVector<Frame, 4> stack_;
+  };
+  using iterator = const_iterator;
+
+  PersistentHashMap() = default;
+  PersistentHashMap(std::initializer_list<value_type> values) {
+    for (const value_type& value : values) {
+      insert(value);
+    }
+  }
+
+  const_iterator begin() const {
+    const_iterator it;
+    if (root_ != nullptr) {
+      it.stack_.push_back({root_.get(), 0, 0});
+      it.settle();
+    }
+    return it;
+  }
+  const_iterator end() const { return {}; }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  const_iterator find(const Key& key) const {
+    const uint64_t hash = Hash()(key);
+    const_iterator it;
+    const Node* node = root_.get();
+    for (uint32_t shift = 0; node != nullptr; shift += BitsPerLevel) {
+      if (shift >= MaxShift) {
+        for (uint32_t i = 0; i < node->values_.size(); ++i) {
+          if (KeyEqual()(node->values_[i]->value_.first, key)) {
+            it.stack_.push_back({node, i, 0});
+            return it;
+          }
+        }
+        break;
+      }
+      const uint32_t bit = slotBit(hash, shift);
+      if ((node->value_map_ & bit) != 0) {
+        const uint32_t index = slotIndex(node->value_map_, bit);
+        const Entry& entry = *node->values_[index];
+        if (entry.hash_ == hash && KeyEqual()(entry.value_.first, key)) {
+          it.stack_.push_back({node, index, 0});
+          return it;
+        }
+        break;
+      }
+      if ((node->node_map_ & bit) == 0) {
+        break;
+      }
+      const uint32_t index = slotIndex(node->node_map_, bit);
+      it.stack_.push_back({node, static_cast<uint32_t>(node->values_.size()), index + 1});
+      node = node->children_[index].get();
+    }
+    return end();
+  }
+
+  bool contains(const Key& key) const { return find(key) != end(); }
+  size_t count(const Key& key) const { return contains(key) ? 1 : 0; }
+
+  /**
+   * Inserts a value if its key is not already present.
+   * @return the entry with the key, and whether the value was inserted.
+   */
+  std::pair<const_iterator, bool> insert(value_type value) {
+    const_iterator it = find(value.first);
+    if (it != end()) {
+      return {it, false};
+    }
+    const uint64_t hash = Hash()(value.first);
+    auto entry = std::make_shared<const Entry>(Entry{hash, std::move(value)});
+    // The entry is kept alive by the map.
+    const Key& key = entry->value_.first;
+    insertEntry(std::move(entry));
+    ++size_;
+    return {find(key), true};
+  }
+
+  /**
+   * Same as insert(value), for use by std::inserter().
+   */
+  const_iterator insert(const_iterator, value_type value) {
+    return insert(std::move(value)).first;
+  }
+
+  /**
+   * Inserts a value, replacing the value of the key if it is already present.
+   * @return the entry with the key, and whether the key was inserted rather than assigned.
+   */
+  std::pair<const_iterator, bool> insert_or_assign(const Key& key, Value value) {
+    const bool inserted = !contains(key);
+    auto entry =
+        std::make_shared<const Entry>(Entry{Hash()(key), value_type(key, std::move(value))});
+    insertEntry(std::move(entry));
+    if (inserted) {
+      ++size_;
+    }
+    return {find(key), inserted};
+  }
+
+  /**
+   * Erases a key.
+   * @return the number of entries erased, i.e. 0 or 1.
+   */
+  size_t erase(const Key& key) {
+    if (!contains(key)) {
+      return 0;
+    }
+    eraseFrom(root_, key, Hash()(key), 0);
+    if (--size_ == 0) {
+      root_.reset();
+    }
+    return 1;
+  }
+
+  void clear() {
+    root_.reset();
+    size_ = 0;
+  }
+
+private:
+  static constexpr uint32_t BitsPerLevel = 5;
+  // Keys are told apart by hash at shifts below this, and by KeyEqual in collision nodes.
+  static constexpr uint32_t MaxShift = 64;
+
+  struct Entry {
+    uint64_t hash_;
+    value_type value_;
+  };
+
+  struct Node {
+    // Which of the 32 slots of the node hold an entry, and which hold a child node. Collision
+    // nodes use neither, and hold their entries unordered.
+    uint32_t value_map_{};
+    uint32_t node_map_{};
+    std::vector<EntrySharedPtr> values_;
+    std::vector<NodeSharedPtr> children_;
+  };
+
+  static uint32_t slotBit(uint64_t hash, uint32_t shift) {
+    return 1u << ((hash >> shift) & ((1u << BitsPerLevel) - 1));
+  }
+  static uint32_t slotIndex(uint32_t map, uint32_t bit) { return absl::popcount(map & (bit - 1)); }
+
+  // Returns the node for modification, copying it first if it is shared with another map.
+  static Node& mutableNode(NodeSharedPtr& node) {
+    if (node.use_count() != 1) {
+      node = std::make_shared<Node>(*node);
+    } else {
+      // Another map may have just released the node on another thread. Order its last reads of
+      // the node before our writes.
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *node;
+  }
+
+  // Returns a node holding two entries whose hashes agree below the given shift.
+  static NodeSharedPtr makeNode(EntrySharedPtr first, EntrySharedPtr second, uint32_t shift) {
+    auto node = std::make_shared<Node>();
+    if (shift >= MaxShift) {
+      node->values_ = {std::move(first), std::move(second)};
+      return node;
+    }
+    const uint32_t first_bit = slotBit(first->hash_, shift);
+    const uint32_t second_bit = slotBit(second->hash_, shift);
+    if (first_bit == second_bit) {
+      node->node_map_ = first_bit;
+      node->children_.push_back(
+          makeNode(std::move(first), std::move(second), shift + BitsPerLevel));
+    } else {
+      node->value_map_ = first_bit | second_bit;
+      if (first_bit < second_bit) {
+        node->values_ = {std::move(first), std::move(second)};
+      } else {
+        node->values_ = {std::move(second), std::move(first)};
+      }
+    }
+    return node;
+  }
+
+  void insertEntry(EntrySharedPtr entry) {
+    if (root_ == nullptr) {
+      root_ = std::make_shared<Node>();
+    }
+    insertInto(root_, std::move(entry), 0);
+  }
+
+  // Inserts an entry below the given node, replacing the entry with the same key if any.
+  static void insertInto(NodeSharedPtr& node_ptr, EntrySharedPtr entry, uint32_t shift) {
+    Node& node = mutableNode(node_ptr);
+    if (shift >= MaxShift) {
+      for (EntrySharedPtr& value : node.values_) {
+        if (KeyEqual()(value->value_.first, entry->value_.first)) {
+          value = std::move(entry);
+          return;
+        }
+      }
+      node.values_.push_back(std::move(entry));
+      return;
+    }
+
+    const uint32_t bit = slotBit(entry->hash_, shift);
+    if ((node.value_map_ & bit) != 0) {
+      const uint32_t index = slotIndex(node.value_map_, bit);
+      EntrySharedPtr& existing = node.values_[index];
+      if (existing->hash_ == entry->hash_ &&
+          KeyEqual()(existing->value_.first, entry->value_.first)) {
+        existing = std::move(entry);
+        return;
+      }
+      // Push the existing entry and the new entry down into a new child.
+      NodeSharedPtr child = makeNode(std::move(existing), std::move(entry), shift + BitsPerLevel);
+      node.values_.erase(node.values_.begin() + index);
+      node.value_map_ &= ~bit;
+      node.node_map_ |= bit;
+      node.children_.insert(node.children_.begin() + slotIndex(node.node_map_, bit),
+                            std::move(child));
+    } else if ((node.node_map_ & bit) != 0) {
+      insertInto(node.children_[slotIndex(node.node_map_, bit)], std::move(entry),
+                 shift + BitsPerLevel);
+    } else {
+      node.value_map_ |= bit;
+      node.values_.insert(node.values_.begin() + slotIndex(node.value_map_, bit),
+                          std::move(entry));
+    }
+  }
+
+  // Erases a key that is present below the given node.
+  static void eraseFrom(NodeSharedPtr& node_ptr, const Key& key, uint64_t hash, uint32_t shift) {
+    Node& node = mutableNode(node_ptr);
+    if (shift >= MaxShift) {
+      for (auto it = node.values_.begin(); it != node.values_.end(); ++it) {
+        if (KeyEqual()((*it)->value_.first, key)) {
+          node.values_.erase(it);
+          return;
+        }
+      }
+      PANIC("erased key not found");
+    }
+
+    const uint32_t bit = slotBit(hash, shift);
+    if ((node.value_map_ & bit) != 0) {
+      node.values_.erase(node.values_.begin() + slotIndex(node.value_map_, bit));
+      node.value_map_ &= ~bit;
+      return;
+    }
+
+    ASSERT((node.node_map_ & bit) != 0);
+    const uint32_t index = slotIndex(node.node_map_, bit);
+    eraseFrom(node.children_[index], key, hash, shift + BitsPerLevel);
+
+    // Pull a child that is left with a single entry up into this node, so that lookups and
+    // later copies do not pay for the extra level.
+    const Node& child = *node.children_[index];
+    if (child.children_.empty() && child.values_.size() == 1) {
+      EntrySharedPtr value = child.values_[0];
+      node.children_.erase(node.children_.begin() + index);
+      node.node_map_ &= ~bit;
+      node.value_map_ |= bit;
+      node.values_.insert(node.values_.begin() + slotIndex(node.value_map_, bit),
+                          std::move(value));
+    }
+  }
+
+  NodeSharedPtr root_;
+  size_t size_{};
+};
+
+} // namespace Envoy
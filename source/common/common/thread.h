@@ -182,6 +182,20 @@ public:
   bool isNull() const { return BaseClass::isNull(0); }
 };
 
+/**
+ * Picks the shard that the calling thread updates in data sharded by thread, such as counters
+ * spread over several cache lines. Threads are assigned indices round robin on their first call,
+ * so up to num_shards threads that first call it one after the other use different shards.
+ * @param num_shards supplies the number of shards.
+ * @return the shard of the calling thread, less than num_shards.
+ */
+inline uint32_t threadShard(uint32_t num_shards) {
+  static std::atomic<uint32_t> next_thread_index{0};
+  thread_local const uint32_t thread_index =
+      next_thread_index.fetch_add(1, std::memory_order_relaxed);
+  return thread_index % num_shards;
+}
+
 // We use platform-specific functions to determine whether the current thread is
 // the "test thread". It is only valid to call isTestThread() on platforms where
 // these functions are available. Currently this is available only on apple and
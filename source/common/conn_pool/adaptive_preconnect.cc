@@ -0,0 +1,67 @@
+#include "source/common/conn_pool/adaptive_preconnect.h"
+
+#include <algorithm>
+
+#include "source/common/protobuf/utility.h"
+
+namespace Envoy {
+namespace ConnectionPool {
+
+AdaptivePreconnectController::AdaptivePreconnectController(
+    const envoy::config::cluster::v3::Cluster::PreconnectPolicy::AdaptivePreconnect& config,
+    MonotonicTime now)
+    : window_(std::chrono::milliseconds(PROTOBUF_GET_MS_OR_DEFAULT(config, window, 1000))),
+      bucket_width_(std::chrono::duration_cast<std::chrono::nanoseconds>(window_) / Buckets),
+      max_anticipated_streams_(
+          PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, max_anticipated_streams, 10)),
+      start_(now) {}
+
+void AdaptivePreconnectController::advance(MonotonicTime now) {
+  const uint64_t bucket = std::max<int64_t>((now - start_) / bucket_width_, 0);
+  if (bucket <= current_bucket_) {
+    return;
+  }
+  // Reset the buckets between the current one and the new one, as they are reused for the new
+  // part of the window.
+  const uint64_t expired = std::min<uint64_t>(bucket - current_bucket_, Buckets);
+  for (uint64_t i = 1; i <= expired; i++) {
+    Bucket& expired_bucket = buckets_[(current_bucket_ + i) % Buckets];
+    streams_ -= expired_bucket.streams_;
+    connections_ -= expired_bucket.connections_;
+    connect_latency_ -= expired_bucket.connect_latency_;
+    expired_bucket = {};
+  }
+  current_bucket_ = bucket;
+}
+
+void AdaptivePreconnectController::onStream(MonotonicTime now) {
+  advance(now);
+  buckets_[current_bucket_ % Buckets].streams_++;
+  streams_++;
+}
+
+void AdaptivePreconnectController::onConnected(MonotonicTime now,
+                                               std::chrono::milliseconds connect_latency) {
+  advance(now);
+  Bucket& bucket = buckets_[current_bucket_ % Buckets];
+  bucket.connections_++;
+  bucket.connect_latency_ += connect_latency;
+  connections_++;
+  connect_latency_ += connect_latency;
+  average_connect_latency_ = connect_latency_ / connections_;
+}
+
+uint32_t AdaptivePreconnectController::anticipatedStreams(MonotonicTime now) {
+  advance(now);
+  const std::chrono::milliseconds latency =
+      connections_ > 0 ? connect_latency_ / connections_ : average_connect_latency_;
+  // The number of streams arriving at the observed rate while a connection is established, rounded
+  // up.
+  const uint64_t window_ms = window_.count();
+  const uint64_t anticipated =
+      (streams_ * static_cast<uint64_t>(latency.count()) + window_ms - 1) / window_ms;
+  return std::min<uint64_t>(anticipated, max_anticipated_streams_);
+}
+
+} // namespace ConnectionPool
+} // namespace Envoy
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "envoy/common/time.h"
+#include "envoy/config/cluster/v3/cluster.pb.h"
+
+namespace Envoy {
+namespace ConnectionPool {
+
+/**
+ * Estimates how many streams are expected to arrive at a connection pool while a new connection is
+ * being established, from the rate at which streams arrived and the time it took to establish
+ * connections over a moving window. Keeping that much spare stream capacity connected or
+ * connecting lets a burst of streams be served by established connections instead of waiting for
+ * new ones.
+ *
+ * The window is divided into a fixed number of buckets, so that recording a stream or a connection
+ * is O(1) and expired samples are dropped a bucket at a time.
+ */
+class AdaptivePreconnectController {
+public:
+  AdaptivePreconnectController(
+      const envoy::config::cluster::v3::Cluster::PreconnectPolicy::AdaptivePreconnect& config,
+      MonotonicTime now);
+
+  /**
+   * Records the arrival of a stream.
+   */
+  void onStream(MonotonicTime now);
+
+  /**
+   * Records the time it took to establish a connection, including any TLS handshake.
+   */
+  void onConnected(MonotonicTime now, std::chrono::milliseconds connect_latency);
+
+  /**
+   * @return the number of streams expected to arrive while a new connection is established.
+   */
+  uint32_t anticipatedStreams(MonotonicTime now);
+
+private:
+  static constexpr uint32_t Buckets = 10;
+
+  struct Bucket {
+    uint64_t streams_{};
+    uint64_t connections_{};
+    std::chrono::milliseconds connect_latency_{};
+  };
+
+  // Drops the buckets that fell out of the window as of now.
+  void advance(MonotonicTime now);
+
+  const std::chrono::milliseconds window_;
+  const std::chrono::nanoseconds bucket_width_;
+  const uint32_t max_anticipated_streams_;
+  const MonotonicTime start_;
+  std::array<Bucket, Buckets> buckets_;
+  // The index of the bucket that now falls into, counted from start_.
+  uint64_t current_bucket_{};
+  // The sums of the buckets in the window.
+  uint64_t streams_{};
+  uint64_t connections_{};
+  std::chrono::milliseconds connect_latency_{};
+  // The average connect latency of the window when a connection was last established. Used when no
+  // connection was established in the window.
+  std::chrono::milliseconds average_connect_latency_{};
+};
+
+using AdaptivePreconnectControllerPtr = std::unique_ptr<AdaptivePreconnectController>;
+
+} // namespace ConnectionPool
+} // namespace Envoy
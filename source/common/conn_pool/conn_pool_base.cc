@@ -44,7 +44,12 @@ ConnPoolImplBase::ConnPoolImplBase(
     Upstream::ClusterConnectivityState& state)
     : state_(state), host_(host), priority_(priority), dispatcher_(dispatcher),
       socket_options_(options), transport_socket_options_(transport_socket_options),
-      upstream_ready_cb_(dispatcher_.createSchedulableCallback([this]() { onUpstreamReady(); })) {}
+      upstream_ready_cb_(dispatcher_.createSchedulableCallback([this]() { onUpstreamReady(); })),
+      adaptive_preconnect_(host_->cluster().adaptivePreconnect().has_value()
+                               ? std::make_unique<AdaptivePreconnectController>(
+                                     *host_->cluster().adaptivePreconnect(),
+                                     dispatcher_.approximateMonotonicTime())
+                               : nullptr) {}
 
 ConnPoolImplBase::~ConnPoolImplBase() {
   ASSERT(isIdleImpl());
@@ -72,7 +77,8 @@ void ConnPoolImplBase::destructAllConnections() {
 
 bool ConnPoolImplBase::shouldConnect(size_t pending_streams, size_t active_streams,
                                      int64_t connecting_and_connected_capacity,
-                                     float preconnect_ratio, bool anticipate_incoming_stream) {
+                                     float preconnect_ratio, bool anticipate_incoming_stream,
+                                     uint32_t adaptive_anticipated_streams) {
   // This is set to true any time global preconnect is being calculated.
   // ClusterManagerImpl::maybePreconnect is called directly before a stream is created, so the
   // stream must be anticipated.
@@ -88,8 +94,14 @@ bool ConnPoolImplBase::shouldConnect(size_t pending_streams, size_t active_strea
   //
   // If preconnect ratio is not set, it defaults to 1, and this simplifies to the
   // legacy value of pending_streams_.size() > connecting_stream_capacity_
+  //
+  // Adaptive preconnecting additionally wants the unused capacity to cover the streams expected to
+  // arrive while a new connection is established.
   return (pending_streams + active_streams + anticipated_streams) * preconnect_ratio >
-         connecting_and_connected_capacity + active_streams;
+             connecting_and_connected_capacity + active_streams ||
+         (adaptive_anticipated_streams > 0 &&
+          static_cast<int64_t>(pending_streams + anticipated_streams +
+                               adaptive_anticipated_streams) > connecting_and_connected_capacity);
 }
 
 bool ConnPoolImplBase::shouldCreateNewConnection(float global_preconnect_ratio) const {
@@ -125,15 +137,17 @@ bool ConnPoolImplBase::shouldCreateNewConnection(float global_preconnect_ratio)
     // Local preconnect does not need to anticipate a stream. It is called as
     // new streams are established or torn down and simply attempts to maintain
     // the correct ratio of streams and anticipated capacity.
-    bool result =
-        shouldConnect(pending_streams_.size(), num_active_streams_,
-                      connecting_and_connected_stream_capacity_, perUpstreamPreconnectRatio());
+    const uint32_t adaptive_anticipated_streams = adaptiveAnticipatedStreams();
+    bool result = shouldConnect(pending_streams_.size(), num_active_streams_,
+                                connecting_and_connected_stream_capacity_,
+                                perUpstreamPreconnectRatio(), false, adaptive_anticipated_streams);
     ENVOY_LOG(trace,
               "per-upstream shouldCreateNewConnection returns {} for pending {} active {} "
-              "connecting_and_connected_capacity {} connecting_capacity {} ratio {}",
+              "connecting_and_connected_capacity {} connecting_capacity {} ratio {} "
+              "adaptive anticipated {}",
               result, pending_streams_.size(), num_active_streams_,
               connecting_and_connected_stream_capacity_, connecting_stream_capacity_,
-              perUpstreamPreconnectRatio());
+              perUpstreamPreconnectRatio(), adaptive_anticipated_streams);
     return result;
   }
 }
@@ -142,6 +156,13 @@ float ConnPoolImplBase::perUpstreamPreconnectRatio() const {
   return host_->cluster().perUpstreamPreconnectRatio();
 }
 
+uint32_t ConnPoolImplBase::adaptiveAnticipatedStreams() const {
+  if (adaptive_preconnect_ == nullptr) {
+    return 0;
+  }
+  return adaptive_preconnect_->anticipatedStreams(dispatcher_.approximateMonotonicTime());
+}
+
 ConnPoolImplBase::ConnectionResult ConnPoolImplBase::tryCreateNewConnections() {
   ConnPoolImplBase::ConnectionResult result;
   // Somewhat arbitrarily cap the number of connections preconnected due to new
@@ -297,6 +318,16 @@ ConnectionPool::Cancellable* ConnPoolImplBase::newStreamImpl(AttachContext& cont
   ASSERT(!deferred_deleting_);
   assertCapacityCountsAreCorrect();
 
+  if (adaptive_preconnect_ != nullptr) {
+    adaptive_preconnect_->onStream(dispatcher_.approximateMonotonicTime());
+    // A stream is a hit if it does not wait for a connection to be established.
+    if (!ready_clients_.empty() || (can_send_early_data && !early_data_clients_.empty())) {
+      host_->cluster().trafficStats()->upstream_rq_preconnect_hit_.inc();
+    } else {
+      host_->cluster().trafficStats()->upstream_rq_preconnect_miss_.inc();
+    }
+  }
+
   if (!ready_clients_.empty()) {
     ActiveClient& client = *ready_clients_.front();
     ENVOY_CONN_LOG(debug, "using existing fully connected connection", client);
@@ -612,6 +643,10 @@ void ConnPoolImplBase::onConnectionEvent(ActiveClient& client, absl::string_view
     ASSERT(connecting_stream_capacity_ >= client.currentUnusedCapacity());
     connecting_stream_capacity_ -= client.currentUnusedCapacity();
     client.has_handshake_completed_ = true;
+    if (adaptive_preconnect_ != nullptr) {
+      adaptive_preconnect_->onConnected(dispatcher_.approximateMonotonicTime(),
+                                        client.conn_connect_ms_->elapsed());
+    }
     client.conn_connect_ms_->complete();
     client.conn_connect_ms_.reset();
     if (client.state() == ActiveClient::State::Connecting ||
@@ -698,8 +733,14 @@ bool ConnPoolImplBase::connectingConnectionIsExcess(const ActiveClient& client)
   // If preconnect ratio is set, it also factors in the anticipated load based on both queued
   // streams and active streams, and makes sure the connecting capacity would still be sufficient to
   // serve that even with the most recent client removed.
+  //
+  // If adaptive preconnecting is enabled, the connected capacity must also still cover the pending
+  // streams and the streams it anticipates.
   return (pending_streams_.size() + num_active_streams_) * perUpstreamPreconnectRatio() <=
-         (connecting_stream_capacity_ - client.currentUnusedCapacity() + num_active_streams_);
+             (connecting_stream_capacity_ - client.currentUnusedCapacity() + num_active_streams_) &&
+         (adaptive_preconnect_ == nullptr ||
+          static_cast<int64_t>(pending_streams_.size() + adaptiveAnticipatedStreams()) <=
+              connecting_and_connected_stream_capacity_ - client.currentUnusedCapacity());
 }
 
 void ConnPoolImplBase::onPendingStreamCancel(PendingStream& stream,
@@ -9,6 +9,7 @@
 #include "source/common/common/debug_recursion_checker.h"
 #include "source/common/common/dump_state_utils.h"
 #include "source/common/common/linked_object.h"
+#include "source/common/conn_pool/adaptive_preconnect.h"
 
 #include "absl/strings/string_view.h"
 #include "fmt/ostream.h"
@@ -210,9 +211,13 @@ public:
   //
   // If anticipate_incoming_stream is true this assumes a call to newStream is
   // pending, which is true for global preconnect.
+  //
+  // adaptive_anticipated_streams is the number of streams that adaptive preconnecting expects to
+  // arrive while a new connection is established, in addition to the pending streams.
   static bool shouldConnect(size_t pending_streams, size_t active_streams,
                             int64_t connecting_and_connected_capacity, float preconnect_ratio,
-                            bool anticipate_incoming_stream = false);
+                            bool anticipate_incoming_stream = false,
+                            uint32_t adaptive_anticipated_streams = 0);
 
   // Envoy::ConnectionPool::Instance implementation helpers
   void addIdleCallbackImpl(Instance::IdleCb cb);
@@ -347,6 +352,9 @@ protected:
 
   float perUpstreamPreconnectRatio() const;
 
+  // Returns the number of streams that adaptive preconnecting anticipates, or 0 if it is disabled.
+  uint32_t adaptiveAnticipatedStreams() const;
+
   ConnectionPool::Cancellable*
   addPendingStream(Envoy::ConnectionPool::PendingStreamPtr&& pending_stream) {
     LinkedList::moveIntoList(std::move(pending_stream), pending_streams_);
@@ -418,6 +426,9 @@ private:
 
   Event::SchedulableCallbackPtr upstream_ready_cb_;
   Common::DebugRecursionChecker recursion_checker_;
+
+  // Set if adaptive preconnecting is enabled for the cluster.
+  const AdaptivePreconnectControllerPtr adaptive_preconnect_;
 };
 
 } // namespace ConnectionPool
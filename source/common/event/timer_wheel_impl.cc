@@ -0,0 +1,256 @@
+#include "source/common/event/timer_wheel_impl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+#include "envoy/event/timer.h"
+
+#include "source/common/common/assert.h"
+#include "source/common/common/scope_tracker.h"
+
+namespace Envoy {
+namespace Event {
+
+class TimerWheelImpl::WheelTimer final : public Timer {
+public:
+  WheelTimer(TimerWheelImpl& wheel, TimerCb cb) : wheel_(wheel), cb_(std::move(cb)) {}
+  ~WheelTimer() override { disableTimer(); }
+
+  // Timer
+  void disableTimer() override {
+    if (list_ != nullptr) {
+      wheel_.remove(*this);
+    }
+    scope_ = nullptr;
+  }
+  void enableTimer(std::chrono::milliseconds ms, const ScopeTrackedObject* scope) override {
+    wheel_.add(*this, ms);
+    scope_ = scope;
+  }
+  void enableHRTimer(std::chrono::microseconds us, const ScopeTrackedObject* scope) override {
+    wheel_.add(*this, us);
+    scope_ = scope;
+  }
+  bool enabled() override { return list_ != nullptr; }
+
+private:
+  friend class TimerWheelImpl;
+
+  TimerWheelImpl& wheel_;
+  const TimerCb cb_;
+  const ScopeTrackedObject* scope_{};
+  // The list the timer is in while enabled, and its neighbours in that list.
+  TimerList* list_{};
+  WheelTimer* prev_{};
+  WheelTimer* next_{};
+  uint64_t expiry_tick_{};
+  // The level of the wheel the timer is in, Levels for the overflow list, or Levels + 1 once the
+  // timer has expired.
+  uint32_t level_{};
+};
+
+void TimerWheelImpl::TimerList::pushBack(WheelTimer& timer) {
+  timer.list_ = this;
+  timer.prev_ = tail_;
+  timer.next_ = nullptr;
+  if (tail_ != nullptr) {
+    tail_->next_ = &timer;
+  } else {
+    head_ = &timer;
+  }
+  tail_ = &timer;
+}
+
+void TimerWheelImpl::TimerList::remove(WheelTimer& timer) {
+  ASSERT(timer.list_ == this);
+  if (timer.prev_ != nullptr) {
+    timer.prev_->next_ = timer.next_;
+  } else {
+    head_ = timer.next_;
+  }
+  if (timer.next_ != nullptr) {
+    timer.next_->prev_ = timer.prev_;
+  } else {
+    tail_ = timer.prev_;
+  }
+  timer.list_ = nullptr;
+  timer.prev_ = nullptr;
+  timer.next_ = nullptr;
+}
+
+TimerWheelImpl::WheelTimer* TimerWheelImpl::TimerList::popFront() {
+  WheelTimer* timer = head_;
+  if (timer != nullptr) {
+    remove(*timer);
+  }
+  return timer;
+}
+
+TimerWheelImpl::TimerWheelImpl(Dispatcher& dispatcher, std::chrono::milliseconds tick)
+    : dispatcher_(dispatcher), tick_(tick), start_(dispatcher.timeSource().monotonicTime()),
+      timer_(dispatcher.createTimer([this]() { onTimer(); })) {
+  ASSERT(tick_.count() > 0);
+}
+
+TimerWheelImpl::~TimerWheelImpl() { ASSERT(enabled_timers_ == 0); }
+
+TimerPtr TimerWheelImpl::createTimer(TimerCb cb) {
+  return std::make_unique<WheelTimer>(*this, std::move(cb));
+}
+
+uint64_t TimerWheelImpl::nowTick() const {
+  return (dispatcher_.timeSource().monotonicTime() - start_) / tick_;
+}
+
+void TimerWheelImpl::add(WheelTimer& timer, std::chrono::nanoseconds duration) {
+  if (timer.list_ != nullptr) {
+    remove(timer);
+  }
+  const std::chrono::nanoseconds now = dispatcher_.timeSource().monotonicTime() - start_;
+  if (enabled_timers_ == 0 && !processing_) {
+    // Nothing is waiting for the ticks that have passed since the wheel emptied, so skip them.
+    current_tick_ = std::max<uint64_t>(current_tick_, now / tick_);
+  }
+  // Round up so that the timer never fires early.
+  const uint64_t expiry_tick =
+      (now + std::max(duration, std::chrono::nanoseconds::zero()) + tick_ -
+       std::chrono::nanoseconds(1)) /
+      tick_;
+  timer.expiry_tick_ = std::max(expiry_tick, current_tick_ + 1);
+  place(timer);
+  enabled_timers_++;
+  if (!processing_ && (!timer_->enabled() || timer.expiry_tick_ < scheduled_tick_)) {
+    schedule(timer.expiry_tick_);
+  }
+}
+
+void TimerWheelImpl::remove(WheelTimer& timer) {
+  timer.list_->remove(timer);
+  if (timer.level_ <= Levels) {
+    level_timers_[timer.level_]--;
+  }
+  enabled_timers_--;
+  if (enabled_timers_ == 0 && !processing_) {
+    timer_->disableTimer();
+  }
+}
+
+void TimerWheelImpl::place(WheelTimer& timer) {
+  // The level is given by the most significant slot index in which the expiry differs from the
+  // current tick. Timers that expire in the current tick, after cascading, end up in the level 0
+  // slot that is about to expire.
+  const uint64_t diff = timer.expiry_tick_ ^ current_tick_;
+  uint32_t level = 0;
+  while (level < Levels && (diff >> (SlotBits * (level + 1))) != 0) {
+    level++;
+  }
+  timer.level_ = level;
+  level_timers_[level]++;
+  if (level == Levels) {
+    overflow_.pushBack(timer);
+    return;
+  }
+  wheel_[level][(timer.expiry_tick_ >> (SlotBits * level)) & (Slots - 1)].pushBack(timer);
+}
+
+uint64_t TimerWheelImpl::nextTick() const {
+  // Every timer in a level expires within the current slot of the level above, so the lowest
+  // non-empty level has the earliest timer.
+  for (uint32_t level = 0; level < Levels; level++) {
+    if (level_timers_[level] == 0) {
+      continue;
+    }
+    const uint32_t shift = SlotBits * level;
+    const uint64_t base = (current_tick_ >> (shift + SlotBits)) << (shift + SlotBits);
+    for (uint64_t slot = ((current_tick_ >> shift) & (Slots - 1)) + 1; slot < Slots; slot++) {
+      if (!wheel_[level][slot].empty()) {
+        return base | (slot << shift);
+      }
+    }
+    IS_ENVOY_BUG("timer wheel level has timers but no pending slot");
+  }
+  if (level_timers_[Levels] > 0) {
+    const uint32_t shift = SlotBits * Levels;
+    return ((current_tick_ >> shift) + 1) << shift;
+  }
+  return 0;
+}
+
+void TimerWheelImpl::processTick(uint64_t tick) {
+  ASSERT(tick > current_tick_);
+  current_tick_ = tick;
+  if ((tick & ((uint64_t(1) << (SlotBits * Levels)) - 1)) == 0) {
+    level_timers_[Levels] = 0;
+    TimerList overflow = overflow_;
+    overflow_ = {};
+    for (WheelTimer* timer = overflow.head_; timer != nullptr;) {
+      WheelTimer* next = timer->next_;
+      timer->list_ = nullptr;
+      place(*timer);
+      timer = next;
+    }
+  }
+  // Cascade the slots that start at this tick, from the highest level down, so that timers moved
+  // into a lower level slot that also starts at this tick keep moving down.
+  for (uint32_t level = Levels - 1; level > 0; level--) {
+    const uint32_t shift = SlotBits * level;
+    if ((tick & ((uint64_t(1) << shift) - 1)) != 0) {
+      continue;
+    }
+    TimerList& slot = wheel_[level][(tick >> shift) & (Slots - 1)];
+    while (WheelTimer* timer = slot.popFront()) {
+      level_timers_[level]--;
+      place(*timer);
+    }
+  }
+  TimerList& slot = wheel_[0][tick & (Slots - 1)];
+  while (WheelTimer* timer = slot.popFront()) {
+    level_timers_[0]--;
+    timer->level_ = Levels + 1;
+    expired_.pushBack(*timer);
+  }
+  // Run the timers one at a time, so that a callback can disable or destroy a timer that has not
+  // run yet.
+  while (WheelTimer* timer = expired_.popFront()) {
+    enabled_timers_--;
+    const ScopeTrackedObject* scope = timer->scope_;
+    timer->scope_ = nullptr;
+    if (scope == nullptr) {
+      timer->cb_();
+    } else {
+      ScopeTrackerScopeState scope_state(scope, dispatcher_);
+      timer->cb_();
+    }
+  }
+}
+
+void TimerWheelImpl::onTimer() {
+  processing_ = true;
+  const uint64_t now_tick = nowTick();
+  while (true) {
+    const uint64_t tick = nextTick();
+    if (tick == 0 || tick > now_tick) {
+      current_tick_ = std::max(current_tick_, now_tick);
+      break;
+    }
+    processTick(tick);
+  }
+  processing_ = false;
+  schedule(nextTick());
+}
+
+void TimerWheelImpl::schedule(uint64_t tick) {
+  if (tick == 0) {
+    timer_->disableTimer();
+    return;
+  }
+  scheduled_tick_ = tick;
+  const std::chrono::nanoseconds delay =
+      start_ + static_cast<int64_t>(tick) * tick_ - dispatcher_.timeSource().monotonicTime();
+  timer_->enableHRTimer(std::max(std::chrono::ceil<std::chrono::microseconds>(delay),
+                                 std::chrono::microseconds::zero()));
+}
+
+} // namespace Event
+} // namespace Envoy
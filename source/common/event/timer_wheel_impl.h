@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include "envoy/common/time.h"
+#include "envoy/event/dispatcher.h"
+#include "envoy/event/timer.h"
+
+namespace Envoy {
+namespace Event {
+
+/**
+ * A hierarchical timing wheel that multiplexes many coarse grained timers onto a single dispatcher
+ * timer. Time is divided into ticks of a fixed duration, and timers are kept in 4 levels of 256
+ * slots each: level 0 holds the timers that expire within the current 256 ticks, one slot per
+ * tick, and each higher level holds timers 256 times further away, one slot per 256^level ticks.
+ * When the wheel reaches the start of a higher level slot, its timers are cascaded down to the
+ * lower levels. Enabling and disabling a timer is O(1), and all of the timers that expire in the
+ * same tick run together on a single wakeup of the dispatcher, in the order they were enabled.
+ *
+ * Timers are rounded up to the next tick, so they never fire early but may fire up to a tick late.
+ * This makes the wheel suitable for large numbers of periodic timers that tolerate some slack,
+ * such as the interval and timeout timers of active health checking.
+ *
+ * Timers created by the wheel must be destroyed before the wheel, and may only be used on the
+ * thread of the dispatcher.
+ */
+class TimerWheelImpl {
+public:
+  /**
+   * @param dispatcher supplies the dispatcher that drives the wheel.
+   * @param tick supplies the resolution of the wheel. Must be at least 1ms.
+   */
+  TimerWheelImpl(Dispatcher& dispatcher, std::chrono::milliseconds tick);
+  ~TimerWheelImpl();
+
+  /**
+   * Creates a timer that is scheduled on the wheel.
+   * @param cb supplies the callback to invoke when the timer fires.
+   */
+  TimerPtr createTimer(TimerCb cb);
+
+  /**
+   * @return the number of enabled timers.
+   */
+  uint64_t enabledTimers() const { return enabled_timers_; }
+
+private:
+  class WheelTimer;
+
+  static constexpr uint32_t SlotBits = 8;
+  static constexpr uint32_t Slots = 1 << SlotBits;
+  static constexpr uint32_t Levels = 4;
+
+  // An intrusive doubly linked list of timers, so that timers can be removed in constant time.
+  struct TimerList {
+    void pushBack(WheelTimer& timer);
+    void remove(WheelTimer& timer);
+    WheelTimer* popFront();
+    bool empty() const { return head_ == nullptr; }
+
+    WheelTimer* head_{};
+    WheelTimer* tail_{};
+  };
+
+  void add(WheelTimer& timer, std::chrono::nanoseconds duration);
+  void remove(WheelTimer& timer);
+  void place(WheelTimer& timer);
+  uint64_t nowTick() const;
+  void onTimer();
+  void processTick(uint64_t tick);
+  uint64_t nextTick() const;
+  void schedule(uint64_t tick);
+
+  Dispatcher& dispatcher_;
+  const std::chrono::nanoseconds tick_;
+  const MonotonicTime start_;
+  const TimerPtr timer_;
+  std::array<std::array<TimerList, Slots>, Levels> wheel_;
+  // Timers that expire beyond the last level. They are placed again each time the last level wraps.
+  TimerList overflow_;
+  // The number of timers in each level of the wheel, followed by the number of overflow timers.
+  std::array<uint64_t, Levels + 1> level_timers_{};
+  // Timers that expired in the tick being processed.
+  TimerList expired_;
+  uint64_t enabled_timers_{};
+  // The last tick that was processed. Every enabled timer expires after it.
+  uint64_t current_tick_{};
+  // The tick at which timer_ fires, if it is enabled.
+  uint64_t scheduled_tick_{};
+  bool processing_{};
+};
+
+using TimerWheelImplPtr = std::unique_ptr<TimerWheelImpl>;
+
+} // namespace Event
+} // namespace Envoy
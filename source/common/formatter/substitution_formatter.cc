@@ -405,14 +405,37 @@ JsonFormatterImpl::JsonFormatterImpl(const ProtobufWkt::Struct& struct_format,
                                      bool omit_empty_values, const CommandParsers& commands)
     : omit_empty_values_(omit_empty_values) {
   for (JsonFormatBuilder::FormatElement& element : JsonFormatBuilder().fromStruct(struct_format)) {
-    if (element.is_template_) {
-      parsed_elements_.emplace_back(
-          THROW_OR_RETURN_VALUE(SubstitutionFormatParser::parse(element.value_, commands),
-                                std::vector<FormatterProviderPtr>));
-    } else {
-      parsed_elements_.emplace_back(std::move(element.value_));
+    if (!element.is_template_) {
+      addRawElement(std::move(element.value_));
+      continue;
+    }
+    Formatters formatters =
+        THROW_OR_RETURN_VALUE(SubstitutionFormatParser::parse(element.value_, commands),
+                              std::vector<FormatterProviderPtr>);
+    // A template without any command, like "100%%", is parsed to a single string literal.
+    // Its output never changes, so it is serialized once here rather than for every entry.
+    const auto* literal = formatters.size() == 1
+                              ? dynamic_cast<const PlainStringFormatter*>(formatters[0].get())
+                              : nullptr;
+    if (literal != nullptr) {
+      std::string raw;
+      JsonStringSerializer(raw).addString(literal->value());
+      addRawElement(std::move(raw));
+      continue;
     }
+    parsed_elements_.emplace_back(std::move(formatters));
+  }
+}
+
+void JsonFormatterImpl::addRawElement(std::string&& raw) {
+  if (raw.empty()) {
+    return;
+  }
+  if (!parsed_elements_.empty() && absl::holds_alternative<std::string>(parsed_elements_.back())) {
+    absl::get<std::string>(parsed_elements_.back()).append(raw);
+    return;
   }
+  parsed_elements_.emplace_back(std::move(raw));
 }
 
 std::string JsonFormatterImpl::formatWithContext(const Context& context,
@@ -439,7 +462,8 @@ std::string JsonFormatterImpl::formatWithContext(const Context& context,
       stringValueToLogLine(formatters, context, info, serializer, omit_empty_values_);
     } else {
       // 3. Handle the formatter element with a single provider and value
-      //    type needs to be kept.
+      //    type needs to be kept. Providers only expose typed output as a
+      //    ProtobufWkt::Value, so this is still built per entry.
       auto value = formatters[0]->formatValueWithContext(context, info);
       Json::Utility::appendValueToString(value, log_line);
     }
@@ -32,6 +32,8 @@ class PlainStringFormatter : public FormatterProvider {
 public:
   PlainStringFormatter(absl::string_view str) { str_.set_string_value(str); }
 
+  const std::string& value() const { return str_.string_value(); }
+
   // FormatterProvider
   absl::optional<std::string> formatWithContext(const Context&,
                                                 const StreamInfo::StreamInfo&) const override {
@@ -122,6 +124,9 @@ public:
                                 const StreamInfo::StreamInfo& info) const override;
 
 private:
+  // Appends a pre-sanitized JSON piece, merging it with the previous piece if that is raw too.
+  void addRawElement(std::string&& raw);
+
   const bool omit_empty_values_;
   using ParsedFormatElement = absl::variant<std::string, Formatters>;
   std::vector<ParsedFormatElement> parsed_elements_;
@@ -248,6 +248,14 @@ std::vector<http2::adapter::Header>
 ConnectionImpl::StreamImpl::buildHeaders(const HeaderMap& headers) {
   std::vector<http2::adapter::Header> out;
   out.reserve(headers.size());
+  HeaderRepCache* cache = parent_.header_rep_cache_.get();
+  if (cache != nullptr) {
+    headers.iterate([&out, cache](const HeaderEntry& header) -> HeaderMap::Iterate {
+      out.push_back(cache->getHeader(header));
+      return HeaderMap::Iterate::Continue;
+    });
+    return out;
+  }
   headers.iterate([&out](const HeaderEntry& header) -> HeaderMap::Iterate {
     out.push_back({getRep(header.key()), getRep(header.value())});
     return HeaderMap::Iterate::Continue;
@@ -2143,6 +2151,12 @@ ClientConnectionImpl::ClientConnectionImpl(
       PROTOBUF_GET_WRAPPED_OR_DEFAULT(http2_options, max_metadata_size, 1024 * 1024);
   idle_session_requires_ping_interval_ = std::chrono::milliseconds(PROTOBUF_GET_MS_OR_DEFAULT(
       http2_options.connection_keepalive(), connection_idle_interval, 0));
+  if (Runtime::runtimeFeatureEnabled(
+          "envoy.reloadable_features.http2_upstream_header_rep_cache")) {
+    // Upstream connections are long lived and typically carry near-identical request headers, so
+    // they benefit most from reusing header storage across streams.
+    header_rep_cache_ = std::make_unique<HeaderRepCache>(MaxHeaderRepCacheBytes);
+  }
 }
 
 RequestEncoder& ClientConnectionImpl::newStream(ResponseDecoder& decoder) {
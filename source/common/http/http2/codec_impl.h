@@ -26,6 +26,7 @@
 #include "source/common/http/codec_helper.h"
 #include "source/common/http/header_map_impl.h"
 #include "source/common/http/http2/codec_stats.h"
+#include "source/common/http/http2/header_rep_cache.h"
 #include "source/common/http/http2/metadata_decoder.h"
 #include "source/common/http/http2/metadata_encoder.h"
 #include "source/common/http/http2/protocol_constraints.h"
@@ -70,6 +71,8 @@ class Http2CodecImplTestFixture;
 // differentiate between HTTP/1 and HTTP/2.
 const std::string CLIENT_MAGIC_PREFIX = "PRI * HTTP/2";
 constexpr uint64_t H2_FRAME_HEADER_SIZE = 9;
+// Upper bound on header bytes retained per upstream connection for reuse across streams.
+constexpr uint64_t MaxHeaderRepCacheBytes = 8 * 1024;
 
 class ReceivedSettingsImpl : public ReceivedSettings {
 public:
@@ -311,7 +314,7 @@ protected:
 
     StreamImpl* base() { return this; }
     void resetStreamWorker(StreamResetReason reason);
-    static std::vector<http2::adapter::Header> buildHeaders(const HeaderMap& headers);
+    std::vector<http2::adapter::Header> buildHeaders(const HeaderMap& headers);
     virtual Status onBeginHeaders() PURE;
     virtual void advanceHeadersState() PURE;
     virtual HeadersState headersState() const PURE;
@@ -711,6 +714,9 @@ protected:
   // Tracks the stream id of the current stream we're processing.
   // This should only be set while we're in the context of dispatching to nghttp2.
   absl::optional<int32_t> current_stream_id_;
+  // Optional store of header strings repeated across streams. Views into it may be held by
+  // adapter_ until frames are serialized, so it is declared before adapter_ to outlive it.
+  std::unique_ptr<HeaderRepCache> header_rep_cache_;
   std::unique_ptr<http2::adapter::Http2VisitorInterface> visitor_;
   std::unique_ptr<http2::adapter::Http2Adapter> adapter_;
 
@@ -0,0 +1,73 @@
+#include "source/common/http/http2/header_rep_cache.h"
+
+#include "source/common/http/headers.h"
+
+#include "absl/hash/hash.h"
+
+namespace Envoy {
+namespace Http {
+namespace Http2 {
+
+namespace {
+
+// Strings up to this size are stored inline by std::string and copied without an allocation.
+size_t inlineStringCapacity() {
+  static const size_t capacity = std::string().capacity();
+  return capacity;
+}
+
+http2::adapter::HeaderRep copyRep(const HeaderString& str) {
+  if (str.isReference()) {
+    return str.getStringView();
+  }
+  return std::string(str.getStringView());
+}
+
+} // namespace
+
+bool HeaderRepCache::isSensitive(absl::string_view key) {
+  return key == CustomHeaders::get().Authorization.get() ||
+         key == Headers::get().ProxyAuthorization.get() || key == Headers::get().Cookie.get() ||
+         key == Headers::get().SetCookie.get();
+}
+
+http2::adapter::Header HeaderRepCache::getHeader(const HeaderEntry& header) {
+  if (isSensitive(header.key().getStringView())) {
+    return {getRep(header.key()), copyRep(header.value())};
+  }
+  return {getRep(header.key()), getRep(header.value())};
+}
+
+http2::adapter::HeaderRep HeaderRepCache::getRep(const HeaderString& str) {
+  const absl::string_view view = str.getStringView();
+  if (str.isReference()) {
+    return view;
+  }
+  if (view.size() <= inlineStringCapacity()) {
+    return std::string(view);
+  }
+
+  const auto it = interned_.find(view);
+  if (it != interned_.end()) {
+    return absl::string_view(*it);
+  }
+
+  if (bytes_ + view.size() <= max_bytes_) {
+    const size_t hash = absl::Hash<absl::string_view>()(view);
+    if (candidates_.erase(hash) > 0) {
+      // Second sighting: promote. A hash collision only costs a few bytes of budget.
+      bytes_ += view.size();
+      return absl::string_view(*interned_.emplace(view).first);
+    }
+    if (candidates_.size() >= MaxCandidates) {
+      candidates_.clear();
+    }
+    candidates_.insert(hash);
+  }
+
+  return std::string(view);
+}
+
+} // namespace Http2
+} // namespace Http
+} // namespace Envoy
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "envoy/http/header_map.h"
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/container/node_hash_set.h"
+#include "quiche/http2/adapter/http2_protocol.h"
+
+namespace Envoy {
+namespace Http {
+namespace Http2 {
+
+/**
+ * Per-connection store of header names and values that repeat across streams on one connection.
+ *
+ * The HTTP/2 adapters may serialize a HEADERS frame after the submitting call returns, so any
+ * string_view handed to them must outlive the frame. Owned (non-reference) HeaderStrings are
+ * therefore copied into a std::string for every stream. Strings seen on a second stream are
+ * copied once into storage owned by this cache, and later streams reference that storage instead
+ * of allocating. Entries are never evicted, which keeps every view handed out valid for the life
+ * of the cache; once the byte budget is spent no new strings are admitted.
+ *
+ * Strings short enough to be copied without an allocation are not cached, as the lookups would
+ * cost more than the copy. Values of headers that carry credentials are never cached, so that
+ * they are not retained beyond the stream that sent them.
+ */
+class HeaderRepCache {
+public:
+  // Number of not-yet-interned string hashes remembered at once. When this many distinct
+  // candidates are pending, the candidate set is cleared so that unique values such as request
+  // IDs do not grow it without bound.
+  static constexpr size_t MaxCandidates = 256;
+
+  explicit HeaderRepCache(uint64_t max_bytes) : max_bytes_(max_bytes) {}
+
+  /**
+   * @return the representation of str to pass to the adapter. This is a view either into str
+   *         itself (for static references) or into the cache, or an owned copy.
+   */
+  http2::adapter::HeaderRep getRep(const HeaderString& str);
+
+  /**
+   * @return the name and value representations of header to pass to the adapter. The value is
+   *         copied rather than cached if the header carries credentials.
+   */
+  http2::adapter::Header getHeader(const HeaderEntry& header);
+
+  /**
+   * @return whether values of the header named key are never cached, like the HPACK never
+   *         indexed representation for sensitive headers.
+   */
+  static bool isSensitive(absl::string_view key);
+
+  uint64_t bytes() const { return bytes_; }
+  size_t size() const { return interned_.size(); }
+
+private:
+  const uint64_t max_bytes_;
+  uint64_t bytes_{0};
+  // node_hash_set keeps element addresses stable across rehashes.
+  absl::node_hash_set<std::string> interned_;
+  absl::flat_hash_set<size_t> candidates_;
+};
+
+} // namespace Http2
+} // namespace Http
+} // namespace Envoy
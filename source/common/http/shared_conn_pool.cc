@@ -0,0 +1,913 @@
+#include "source/common/http/shared_conn_pool.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include "envoy/event/deferred_deletable.h"
+
+#include "source/common/buffer/buffer_impl.h"
+#include "source/common/common/assert.h"
+#include "source/common/common/dump_state_utils.h"
+#include "source/common/common/hash.h"
+#include "source/common/http/codec_helper.h"
+#include "source/common/http/header_map_impl.h"
+#include "source/common/http/header_utility.h"
+#include "source/common/network/socket_impl.h"
+#include "source/common/stream_info/filter_state_impl.h"
+#include "source/common/stream_info/stream_info_impl.h"
+
+namespace Envoy {
+namespace Http {
+namespace {
+
+// Releases a shared object in the next deferred deletion of a dispatcher, so that it outlives the
+// call stack that released it.
+class DeferredRelease : public Event::DeferredDeletable {
+public:
+  explicit DeferredRelease(std::shared_ptr<void> object) : object_(std::move(object)) {}
+
+private:
+  std::shared_ptr<void> object_;
+};
+
+// The bytes of a stream counted by the codec of the owner thread.
+struct StreamBytes {
+  explicit StreamBytes(const StreamInfo::BytesMeterSharedPtr& meter) {
+    if (meter != nullptr) {
+      header_bytes_sent_ = meter->headerBytesSent();
+      header_bytes_received_ = meter->headerBytesReceived();
+      wire_bytes_sent_ = meter->wireBytesSent();
+      wire_bytes_received_ = meter->wireBytesReceived();
+    }
+  }
+
+  uint64_t header_bytes_sent_{};
+  uint64_t header_bytes_received_{};
+  uint64_t wire_bytes_sent_{};
+  uint64_t wire_bytes_received_{};
+};
+
+// What the proxy of a stream needs to know about the upstream connection of the stream once it is
+// ready.
+struct ReadyStream {
+  Upstream::HostDescriptionConstSharedPtr host_;
+  absl::optional<Protocol> protocol_;
+  Network::Address::InstanceConstSharedPtr local_address_;
+  Network::Address::InstanceConstSharedPtr remote_address_;
+  absl::optional<uint64_t> connection_id_;
+  StreamInfo::UpstreamTiming upstream_timing_;
+  uint64_t upstream_num_streams_{};
+  uint32_t buffer_limit_{};
+};
+
+MetadataMapVector copyMetadata(const MetadataMapVector& metadata_map_vector) {
+  MetadataMapVector copy;
+  copy.reserve(metadata_map_vector.size());
+  for (const MetadataMapPtr& metadata_map : metadata_map_vector) {
+    copy.push_back(std::make_unique<MetadataMap>(*metadata_map));
+  }
+  return copy;
+}
+
+} // namespace
+
+/**
+ * The stream of a worker thread that was handed off to the owner of the connections to the host,
+ * as seen by the worker thread. It forwards the calls to the encoder to the owner thread, and the
+ * decoder and stream events that the owner thread posts back to the router.
+ */
+class SharedConnPoolProxyStream : public RequestEncoder,
+                                  public Stream,
+                                  public StreamCallbackHelper,
+                                  public ConnectionPool::Cancellable,
+                                  Logger::Loggable<Logger::Id::pool> {
+public:
+  SharedConnPoolProxyStream(SharedConnPoolImpl& parent, Event::Dispatcher& dispatcher,
+                            SharedConnPoolThreadSharedPtr owner, ResponseDecoder& response_decoder,
+                            ConnectionPool::Callbacks& callbacks)
+      : parent_(&parent), dispatcher_(dispatcher), owner_(std::move(owner)),
+        response_decoder_(response_decoder), callbacks_(&callbacks),
+        bytes_meter_(std::make_shared<StreamInfo::BytesMeter>()) {}
+
+  void setOwnerStream(std::weak_ptr<SharedConnPoolOwnerStream> owner_stream) {
+    owner_stream_ = std::move(owner_stream);
+  }
+
+  // Called when the pool of the stream is destroyed, which resets the stream like the destruction
+  // of a connection pool resets the streams of its connections.
+  void onPoolDestroyed();
+
+  // Events posted by the owner thread.
+  void onPoolFailure(ConnectionPool::PoolFailureReason reason,
+                     absl::string_view transport_failure_reason,
+                     Upstream::HostDescriptionConstSharedPtr host);
+  void onPoolReady(ReadyStream&& ready);
+  void decode1xxHeaders(ResponseHeaderMapPtr&& headers);
+  void decodeHeaders(ResponseHeaderMapPtr&& headers, bool end_stream, const StreamBytes& bytes);
+  void decodeData(Buffer::Instance& data, bool end_stream, const StreamBytes& bytes);
+  void decodeTrailers(ResponseTrailerMapPtr&& trailers, const StreamBytes& bytes);
+  void decodeMetadata(MetadataMapPtr&& metadata_map);
+  void onResetStream(StreamResetReason reason, absl::string_view transport_failure_reason,
+                     const StreamBytes& bytes);
+  void onCodecEncodeComplete();
+  void onCodecLowLevelReset();
+
+  // ConnectionPool::Cancellable
+  void cancel(Envoy::ConnectionPool::CancelPolicy cancel_policy) override;
+
+  // Http::StreamEncoder
+  void encodeData(Buffer::Instance& data, bool end_stream) override;
+  Stream& getStream() override { return *this; }
+  void encodeMetadata(const MetadataMapVector& metadata_map_vector) override;
+  // Only multiplexed protocols are shared.
+  Http1StreamEncoderOptionsOptRef http1StreamEncoderOptions() override { return absl::nullopt; }
+
+  // Http::RequestEncoder
+  Status encodeHeaders(const RequestHeaderMap& headers, bool end_stream) override;
+  void encodeTrailers(const RequestTrailerMap& trailers) override;
+  void enableTcpTunneling() override;
+
+  // Http::Stream
+  void addCallbacks(StreamCallbacks& callbacks) override { addCallbacksHelper(callbacks); }
+  void removeCallbacks(StreamCallbacks& callbacks) override { removeCallbacksHelper(callbacks); }
+  CodecEventCallbacks* registerCodecEventCallbacks(CodecEventCallbacks* codec_callbacks) override {
+    std::swap(codec_callbacks, codec_callbacks_);
+    return codec_callbacks;
+  }
+  void resetStream(StreamResetReason reason) override;
+  void readDisable(bool disable) override;
+  uint32_t bufferLimit() const override { return buffer_limit_; }
+  absl::string_view responseDetails() override { return response_details_; }
+  const Network::ConnectionInfoProvider& connectionInfoProvider() override {
+    return *connection_info_provider_;
+  }
+  void setFlushTimeout(std::chrono::milliseconds timeout) override;
+  // Buffers of handed off streams are moved out of the accounts of the worker thread.
+  Buffer::BufferMemoryAccountSharedPtr account() const override { return account_; }
+  void setAccount(Buffer::BufferMemoryAccountSharedPtr account) override {
+    account_ = std::move(account);
+  }
+  const StreamInfo::BytesMeterSharedPtr& bytesMeter() override { return bytes_meter_; }
+
+private:
+  // Runs fn on the owner thread with the owner side of the stream, if it still exists.
+  template <class Fn> void postToOwner(Fn fn);
+  void updateBytes(const StreamBytes& bytes);
+  void maybeClose();
+  void close();
+
+  SharedConnPoolImpl* parent_;
+  Event::Dispatcher& dispatcher_;
+  const SharedConnPoolThreadSharedPtr owner_;
+  std::weak_ptr<SharedConnPoolOwnerStream> owner_stream_;
+  ResponseDecoder& response_decoder_;
+  // Set until the stream is ready or failed.
+  ConnectionPool::Callbacks* callbacks_;
+  CodecEventCallbacks* codec_callbacks_{};
+  std::shared_ptr<Network::ConnectionInfoSetterImpl> connection_info_provider_;
+  std::unique_ptr<StreamInfo::StreamInfoImpl> stream_info_;
+  Buffer::BufferMemoryAccountSharedPtr account_;
+  StreamInfo::BytesMeterSharedPtr bytes_meter_;
+  std::string response_details_;
+  uint32_t buffer_limit_{};
+  bool remote_end_stream_{};
+  bool closed_{};
+};
+
+/**
+ * The stream of a worker thread that was handed off to the owner of the connections to the host,
+ * as seen by the owner thread. It runs the calls to the encoder posted by the worker thread on a
+ * stream of the owner's connection pool, and posts the decoder and stream events back.
+ */
+class SharedConnPoolOwnerStream : public ResponseDecoder,
+                                  public ConnectionPool::Callbacks,
+                                  public StreamCallbacks,
+                                  public CodecEventCallbacks,
+                                  Logger::Loggable<Logger::Id::pool> {
+public:
+  SharedConnPoolOwnerStream(SharedConnPoolThreadSharedPtr thread,
+                            std::weak_ptr<SharedConnPoolProxyStream> proxy_stream)
+      : thread_(std::move(thread)), proxy_stream_(std::move(proxy_stream)) {}
+
+  void start(SharedConnPoolThread& owner, ConnectionPool::Instance& pool,
+             const ConnectionPool::Instance::StreamOptions& options);
+
+  // Calls posted by the worker thread.
+  void cancel(Envoy::ConnectionPool::CancelPolicy cancel_policy);
+  void encodeHeaders(RequestHeaderMapPtr&& headers, bool end_stream);
+  void encodeData(Buffer::Instance& data, bool end_stream);
+  void encodeTrailers(RequestTrailerMapPtr&& trailers);
+  void encodeMetadata(const MetadataMapVector& metadata_map_vector);
+  void enableTcpTunneling();
+  void readDisable(bool disable);
+  void setFlushTimeout(std::chrono::milliseconds timeout);
+  void resetStream(StreamResetReason reason);
+
+  // Called when the owner thread shuts down.
+  void onShutdown();
+
+  // Http::ConnectionPool::Callbacks
+  void onPoolFailure(ConnectionPool::PoolFailureReason reason,
+                     absl::string_view transport_failure_reason,
+                     Upstream::HostDescriptionConstSharedPtr host) override;
+  void onPoolReady(RequestEncoder& encoder, Upstream::HostDescriptionConstSharedPtr host,
+                   StreamInfo::StreamInfo& info, absl::optional<Protocol> protocol) override;
+
+  // Http::StreamDecoder
+  void decodeData(Buffer::Instance& data, bool end_stream) override;
+  void decodeMetadata(MetadataMapPtr&& metadata_map) override;
+
+  // Http::ResponseDecoder
+  void decode1xxHeaders(ResponseHeaderMapPtr&& headers) override;
+  void decodeHeaders(ResponseHeaderMapPtr&& headers, bool end_stream) override;
+  void decodeTrailers(ResponseTrailerMapPtr&& trailers) override;
+  void dumpState(std::ostream& os, int indent_level) const override {
+    const char* spaces = spacesForLevel(indent_level);
+    os << spaces << "SharedConnPoolOwnerStream " << this << DUMP_MEMBER(local_end_stream_)
+       << DUMP_MEMBER(remote_end_stream_) << DUMP_MEMBER(closed_) << "\n";
+  }
+
+  // Http::StreamCallbacks
+  void onResetStream(StreamResetReason reason,
+                     absl::string_view transport_failure_reason) override;
+  void onAboveWriteBufferHighWatermark() override;
+  void onBelowWriteBufferLowWatermark() override;
+
+  // Http::CodecEventCallbacks
+  void onCodecEncodeComplete() override;
+  void onCodecLowLevelReset() override;
+
+private:
+  // Runs fn on the worker thread with the proxy of the stream, if it still exists.
+  template <class Fn> void postToProxy(Fn fn);
+  StreamBytes bytes() const { return StreamBytes(bytes_meter_); }
+  void onLocalEndStream(bool end_stream);
+  void onRemoteEndStream(bool end_stream);
+  void close();
+
+  // The worker thread the stream was handed off by.
+  const SharedConnPoolThreadSharedPtr thread_;
+  std::weak_ptr<SharedConnPoolProxyStream> proxy_stream_;
+  // The owner thread, once started.
+  SharedConnPoolThread* owner_{};
+  ConnectionPool::Cancellable* handle_{};
+  RequestEncoder* encoder_{};
+  StreamInfo::BytesMeterSharedPtr bytes_meter_;
+  // The codec may refer to the headers and trailers until the stream completes.
+  RequestHeaderMapPtr request_headers_;
+  RequestTrailerMapPtr request_trailers_;
+  bool local_end_stream_{};
+  bool remote_end_stream_{};
+  bool closed_{};
+};
+
+template <class Fn> void SharedConnPoolProxyStream::postToOwner(Fn fn) {
+  owner_->post([owner_stream = owner_stream_, fn = std::move(fn)]() mutable {
+    if (std::shared_ptr<SharedConnPoolOwnerStream> stream = owner_stream.lock()) {
+      fn(*stream);
+    }
+  });
+}
+
+void SharedConnPoolProxyStream::onPoolDestroyed() {
+  Upstream::HostDescriptionConstSharedPtr host = parent_->host();
+  parent_ = nullptr;
+  if (closed_) {
+    return;
+  }
+  if (callbacks_ != nullptr) {
+    ConnectionPool::Callbacks* callbacks = callbacks_;
+    callbacks_ = nullptr;
+    postToOwner([](SharedConnPoolOwnerStream& stream) {
+      stream.cancel(Envoy::ConnectionPool::CancelPolicy::Default);
+    });
+    close();
+    callbacks->onPoolFailure(ConnectionPool::PoolFailureReason::LocalConnectionFailure,
+                             "shared connection pool destroyed", std::move(host));
+    return;
+  }
+  resetStream(StreamResetReason::ConnectionTermination);
+}
+
+void SharedConnPoolProxyStream::onPoolFailure(ConnectionPool::PoolFailureReason reason,
+                                              absl::string_view transport_failure_reason,
+                                              Upstream::HostDescriptionConstSharedPtr host) {
+  if (closed_) {
+    return;
+  }
+  ASSERT(callbacks_ != nullptr);
+  ConnectionPool::Callbacks* callbacks = callbacks_;
+  callbacks_ = nullptr;
+  close();
+  callbacks->onPoolFailure(reason, transport_failure_reason, std::move(host));
+}
+
+void SharedConnPoolProxyStream::onPoolReady(ReadyStream&& ready) {
+  if (closed_) {
+    return;
+  }
+  ASSERT(callbacks_ != nullptr);
+  ConnectionPool::Callbacks* callbacks = callbacks_;
+  callbacks_ = nullptr;
+  buffer_limit_ = ready.buffer_limit_;
+
+  connection_info_provider_ = std::make_shared<Network::ConnectionInfoSetterImpl>(
+      ready.local_address_, ready.remote_address_);
+  if (ready.connection_id_.has_value()) {
+    connection_info_provider_->setConnectionID(ready.connection_id_.value());
+  }
+  stream_info_ = std::make_unique<StreamInfo::StreamInfoImpl>(
+      ready.protocol_, dispatcher_.timeSource(), connection_info_provider_,
+      std::make_shared<StreamInfo::FilterStateImpl>(StreamInfo::FilterState::LifeSpan::Connection));
+  auto upstream_info = std::make_shared<StreamInfo::UpstreamInfoImpl>();
+  upstream_info->upstreamTiming() = ready.upstream_timing_;
+  upstream_info->setUpstreamNumStreams(ready.upstream_num_streams_);
+  stream_info_->setUpstreamInfo(std::move(upstream_info));
+
+  callbacks->onPoolReady(*this, ready.host_, *stream_info_, ready.protocol_);
+}
+
+void SharedConnPoolProxyStream::decode1xxHeaders(ResponseHeaderMapPtr&& headers) {
+  if (!closed_) {
+    response_decoder_.decode1xxHeaders(std::move(headers));
+  }
+}
+
+void SharedConnPoolProxyStream::decodeHeaders(ResponseHeaderMapPtr&& headers, bool end_stream,
+                                              const StreamBytes& bytes) {
+  if (closed_) {
+    return;
+  }
+  updateBytes(bytes);
+  remote_end_stream_ = end_stream;
+  response_decoder_.decodeHeaders(std::move(headers), end_stream);
+  maybeClose();
+}
+
+void SharedConnPoolProxyStream::decodeData(Buffer::Instance& data, bool end_stream,
+                                           const StreamBytes& bytes) {
+  if (closed_) {
+    return;
+  }
+  updateBytes(bytes);
+  remote_end_stream_ = end_stream;
+  response_decoder_.decodeData(data, end_stream);
+  maybeClose();
+}
+
+void SharedConnPoolProxyStream::decodeTrailers(ResponseTrailerMapPtr&& trailers,
+                                               const StreamBytes& bytes) {
+  if (closed_) {
+    return;
+  }
+  updateBytes(bytes);
+  remote_end_stream_ = true;
+  response_decoder_.decodeTrailers(std::move(trailers));
+  maybeClose();
+}
+
+void SharedConnPoolProxyStream::decodeMetadata(MetadataMapPtr&& metadata_map) {
+  if (!closed_) {
+    response_decoder_.decodeMetadata(std::move(metadata_map));
+  }
+}
+
+void SharedConnPoolProxyStream::onResetStream(StreamResetReason reason,
+                                              absl::string_view transport_failure_reason,
+                                              const StreamBytes& bytes) {
+  if (closed_) {
+    return;
+  }
+  updateBytes(bytes);
+  response_details_ = std::string(transport_failure_reason);
+  close();
+  runResetCallbacks(reason, response_details_);
+}
+
+void SharedConnPoolProxyStream::onCodecEncodeComplete() {
+  if (!closed_ && codec_callbacks_ != nullptr) {
+    codec_callbacks_->onCodecEncodeComplete();
+  }
+}
+
+void SharedConnPoolProxyStream::onCodecLowLevelReset() {
+  if (!closed_ && codec_callbacks_ != nullptr) {
+    codec_callbacks_->onCodecLowLevelReset();
+  }
+}
+
+void SharedConnPoolProxyStream::cancel(Envoy::ConnectionPool::CancelPolicy cancel_policy) {
+  ASSERT(callbacks_ != nullptr);
+  callbacks_ = nullptr;
+  postToOwner(
+      [cancel_policy](SharedConnPoolOwnerStream& stream) { stream.cancel(cancel_policy); });
+  close();
+}
+
+void SharedConnPoolProxyStream::encodeData(Buffer::Instance& data, bool end_stream) {
+  ASSERT(!local_end_stream_);
+  auto buffer = std::make_unique<Buffer::OwnedImpl>();
+  buffer->move(data);
+  postToOwner([buffer = std::move(buffer), end_stream](SharedConnPoolOwnerStream& stream) {
+    stream.encodeData(*buffer, end_stream);
+  });
+  local_end_stream_ = end_stream;
+  maybeClose();
+}
+
+void SharedConnPoolProxyStream::encodeMetadata(const MetadataMapVector& metadata_map_vector) {
+  postToOwner([metadata_map_vector = copyMetadata(metadata_map_vector)](
+                  SharedConnPoolOwnerStream& stream) {
+    stream.encodeMetadata(metadata_map_vector);
+  });
+}
+
+Status SharedConnPoolProxyStream::encodeHeaders(const RequestHeaderMap& headers,
+                                                bool end_stream) {
+  ASSERT(!local_end_stream_);
+#ifndef ENVOY_ENABLE_UHV
+  // Run the checks of the codec of the owner thread here, so that their result can be returned.
+  RETURN_IF_ERROR(HeaderUtility::checkRequiredRequestHeaders(headers));
+  RETURN_IF_ERROR(HeaderUtility::checkValidRequestHeaders(headers));
+#endif
+  postToOwner([headers = createHeaderMap<RequestHeaderMapImpl>(headers),
+               end_stream](SharedConnPoolOwnerStream& stream) mutable {
+    stream.encodeHeaders(std::move(headers), end_stream);
+  });
+  local_end_stream_ = end_stream;
+  maybeClose();
+  return okStatus();
+}
+
+void SharedConnPoolProxyStream::encodeTrailers(const RequestTrailerMap& trailers) {
+  ASSERT(!local_end_stream_);
+  postToOwner([trailers = createHeaderMap<RequestTrailerMapImpl>(trailers)](
+                  SharedConnPoolOwnerStream& stream) mutable {
+    stream.encodeTrailers(std::move(trailers));
+  });
+  local_end_stream_ = true;
+  maybeClose();
+}
+
+void SharedConnPoolProxyStream::enableTcpTunneling() {
+  postToOwner([](SharedConnPoolOwnerStream& stream) { stream.enableTcpTunneling(); });
+}
+
+void SharedConnPoolProxyStream::resetStream(StreamResetReason reason) {
+  if (closed_) {
+    return;
+  }
+  postToOwner([reason](SharedConnPoolOwnerStream& stream) { stream.resetStream(reason); });
+  close();
+  runResetCallbacks(reason, absl::string_view());
+}
+
+void SharedConnPoolProxyStream::readDisable(bool disable) {
+  postToOwner([disable](SharedConnPoolOwnerStream& stream) { stream.readDisable(disable); });
+}
+
+void SharedConnPoolProxyStream::setFlushTimeout(std::chrono::milliseconds timeout) {
+  postToOwner([timeout](SharedConnPoolOwnerStream& stream) { stream.setFlushTimeout(timeout); });
+}
+
+void SharedConnPoolProxyStream::updateBytes(const StreamBytes& bytes) {
+  bytes_meter_->addHeaderBytesSent(bytes.header_bytes_sent_ - bytes_meter_->headerBytesSent());
+  bytes_meter_->addHeaderBytesReceived(bytes.header_bytes_received_ -
+                                       bytes_meter_->headerBytesReceived());
+  bytes_meter_->addWireBytesSent(bytes.wire_bytes_sent_ - bytes_meter_->wireBytesSent());
+  bytes_meter_->addWireBytesReceived(bytes.wire_bytes_received_ -
+                                     bytes_meter_->wireBytesReceived());
+}
+
+void SharedConnPoolProxyStream::maybeClose() {
+  // The stream is complete once both directions ended.
+  if (local_end_stream_ && remote_end_stream_ && !closed_) {
+    close();
+  }
+}
+
+void SharedConnPoolProxyStream::close() {
+  closed_ = true;
+  if (parent_ != nullptr) {
+    parent_->onStreamClosed(*this);
+  }
+}
+
+template <class Fn> void SharedConnPoolOwnerStream::postToProxy(Fn fn) {
+  thread_->post([proxy_stream = proxy_stream_, fn = std::move(fn)]() mutable {
+    if (std::shared_ptr<SharedConnPoolProxyStream> stream = proxy_stream.lock()) {
+      fn(*stream);
+    }
+  });
+}
+
+void SharedConnPoolOwnerStream::start(SharedConnPoolThread& owner, ConnectionPool::Instance& pool,
+                                      const ConnectionPool::Instance::StreamOptions& options) {
+  owner_ = &owner;
+  // The callbacks may be called before newStream() returns, in which case there is no handle.
+  ConnectionPool::Cancellable* handle = pool.newStream(*this, *this, options);
+  if (handle != nullptr && !closed_ && encoder_ == nullptr) {
+    handle_ = handle;
+  }
+}
+
+void SharedConnPoolOwnerStream::cancel(Envoy::ConnectionPool::CancelPolicy cancel_policy) {
+  if (closed_) {
+    return;
+  }
+  if (handle_ != nullptr) {
+    handle_->cancel(cancel_policy);
+    handle_ = nullptr;
+    close();
+    return;
+  }
+  // The stream became ready before the worker thread learned about it.
+  resetStream(StreamResetReason::LocalReset);
+}
+
+void SharedConnPoolOwnerStream::encodeHeaders(RequestHeaderMapPtr&& headers, bool end_stream) {
+  if (closed_) {
+    return;
+  }
+  ASSERT(encoder_ != nullptr);
+  request_headers_ = std::move(headers);
+  const Status status = encoder_->encodeHeaders(*request_headers_, end_stream);
+  if (!status.ok()) {
+    ENVOY_LOG(debug, "failed to encode the headers of a shared stream: {}", status.message());
+    // Reported to the worker thread by onResetStream().
+    encoder_->getStream().resetStream(StreamResetReason::LocalReset);
+    return;
+  }
+  onLocalEndStream(end_stream);
+}
+
+void SharedConnPoolOwnerStream::encodeData(Buffer::Instance& data, bool end_stream) {
+  if (closed_) {
+    return;
+  }
+  encoder_->encodeData(data, end_stream);
+  onLocalEndStream(end_stream);
+}
+
+void SharedConnPoolOwnerStream::encodeTrailers(RequestTrailerMapPtr&& trailers) {
+  if (closed_) {
+    return;
+  }
+  request_trailers_ = std::move(trailers);
+  encoder_->encodeTrailers(*request_trailers_);
+  onLocalEndStream(true);
+}
+
+void SharedConnPoolOwnerStream::encodeMetadata(const MetadataMapVector& metadata_map_vector) {
+  if (!closed_) {
+    encoder_->encodeMetadata(metadata_map_vector);
+  }
+}
+
+void SharedConnPoolOwnerStream::enableTcpTunneling() {
+  if (!closed_) {
+    encoder_->enableTcpTunneling();
+  }
+}
+
+void SharedConnPoolOwnerStream::readDisable(bool disable) {
+  if (!closed_) {
+    encoder_->getStream().readDisable(disable);
+  }
+}
+
+void SharedConnPoolOwnerStream::setFlushTimeout(std::chrono::milliseconds timeout) {
+  if (!closed_) {
+    encoder_->getStream().setFlushTimeout(timeout);
+  }
+}
+
+void SharedConnPoolOwnerStream::resetStream(StreamResetReason reason) {
+  if (closed_) {
+    return;
+  }
+  if (handle_ != nullptr) {
+    cancel(Envoy::ConnectionPool::CancelPolicy::Default);
+    return;
+  }
+  if (encoder_ == nullptr) {
+    close();
+    return;
+  }
+  // The worker thread already knows, so the reset callbacks are not needed.
+  Stream& stream = encoder_->getStream();
+  stream.removeCallbacks(*this);
+  stream.registerCodecEventCallbacks(nullptr);
+  encoder_ = nullptr;
+  stream.resetStream(reason);
+  close();
+}
+
+void SharedConnPoolOwnerStream::onShutdown() {
+  if (closed_) {
+    return;
+  }
+  postToProxy([bytes = bytes()](SharedConnPoolProxyStream& stream) {
+    stream.onResetStream(StreamResetReason::ConnectionTermination,
+                         "shared connection pool shut down", bytes);
+  });
+  resetStream(StreamResetReason::LocalReset);
+}
+
+void SharedConnPoolOwnerStream::onPoolFailure(ConnectionPool::PoolFailureReason reason,
+                                              absl::string_view transport_failure_reason,
+                                              Upstream::HostDescriptionConstSharedPtr host) {
+  handle_ = nullptr;
+  postToProxy([reason, transport_failure_reason = std::string(transport_failure_reason),
+               host = std::move(host)](SharedConnPoolProxyStream& stream) {
+    stream.onPoolFailure(reason, transport_failure_reason, host);
+  });
+  close();
+}
+
+void SharedConnPoolOwnerStream::onPoolReady(RequestEncoder& encoder,
+                                            Upstream::HostDescriptionConstSharedPtr host,
+                                            StreamInfo::StreamInfo& info,
+                                            absl::optional<Protocol> protocol) {
+  handle_ = nullptr;
+  encoder_ = &encoder;
+  Stream& stream = encoder.getStream();
+  stream.addCallbacks(*this);
+  stream.registerCodecEventCallbacks(this);
+  bytes_meter_ = stream.bytesMeter();
+
+  ReadyStream ready;
+  ready.host_ = std::move(host);
+  ready.protocol_ = protocol;
+  ready.local_address_ = info.downstreamAddressProvider().localAddress();
+  ready.remote_address_ = info.downstreamAddressProvider().remoteAddress();
+  ready.connection_id_ = info.downstreamAddressProvider().connectionID();
+  if (info.upstreamInfo() != nullptr) {
+    ready.upstream_timing_ = info.upstreamInfo()->upstreamTiming();
+    ready.upstream_num_streams_ = info.upstreamInfo()->upstreamNumStreams();
+  }
+  ready.buffer_limit_ = stream.bufferLimit();
+  postToProxy([ready = std::move(ready)](SharedConnPoolProxyStream& stream) mutable {
+    stream.onPoolReady(std::move(ready));
+  });
+}
+
+void SharedConnPoolOwnerStream::decodeData(Buffer::Instance& data, bool end_stream) {
+  auto buffer = std::make_unique<Buffer::OwnedImpl>();
+  buffer->move(data);
+  postToProxy([buffer = std::move(buffer), end_stream,
+               bytes = bytes()](SharedConnPoolProxyStream& stream) {
+    stream.decodeData(*buffer, end_stream, bytes);
+  });
+  onRemoteEndStream(end_stream);
+}
+
+void SharedConnPoolOwnerStream::decodeMetadata(MetadataMapPtr&& metadata_map) {
+  postToProxy([metadata_map = std::move(metadata_map)](SharedConnPoolProxyStream& stream) mutable {
+    stream.decodeMetadata(std::move(metadata_map));
+  });
+}
+
+void SharedConnPoolOwnerStream::decode1xxHeaders(ResponseHeaderMapPtr&& headers) {
+  postToProxy([headers = std::move(headers)](SharedConnPoolProxyStream& stream) mutable {
+    stream.decode1xxHeaders(std::move(headers));
+  });
+}
+
+void SharedConnPoolOwnerStream::decodeHeaders(ResponseHeaderMapPtr&& headers, bool end_stream) {
+  postToProxy([headers = std::move(headers), end_stream,
+               bytes = bytes()](SharedConnPoolProxyStream& stream) mutable {
+    stream.decodeHeaders(std::move(headers), end_stream, bytes);
+  });
+  onRemoteEndStream(end_stream);
+}
+
+void SharedConnPoolOwnerStream::decodeTrailers(ResponseTrailerMapPtr&& trailers) {
+  postToProxy(
+      [trailers = std::move(trailers), bytes = bytes()](SharedConnPoolProxyStream& stream) mutable {
+        stream.decodeTrailers(std::move(trailers), bytes);
+      });
+  onRemoteEndStream(true);
+}
+
+void SharedConnPoolOwnerStream::onResetStream(StreamResetReason reason,
+                                              absl::string_view transport_failure_reason) {
+  postToProxy([reason, transport_failure_reason = std::string(transport_failure_reason),
+               bytes = bytes()](SharedConnPoolProxyStream& stream) {
+    stream.onResetStream(reason, transport_failure_reason, bytes);
+  });
+  // The codec is done with the stream.
+  encoder_ = nullptr;
+  close();
+}
+
+void SharedConnPoolOwnerStream::onAboveWriteBufferHighWatermark() {
+  postToProxy([](SharedConnPoolProxyStream& stream) { stream.runHighWatermarkCallbacks(); });
+}
+
+void SharedConnPoolOwnerStream::onBelowWriteBufferLowWatermark() {
+  postToProxy([](SharedConnPoolProxyStream& stream) { stream.runLowWatermarkCallbacks(); });
+}
+
+void SharedConnPoolOwnerStream::onCodecEncodeComplete() {
+  postToProxy([](SharedConnPoolProxyStream& stream) { stream.onCodecEncodeComplete(); });
+}
+
+void SharedConnPoolOwnerStream::onCodecLowLevelReset() {
+  postToProxy([](SharedConnPoolProxyStream& stream) { stream.onCodecLowLevelReset(); });
+}
+
+void SharedConnPoolOwnerStream::onLocalEndStream(bool end_stream) {
+  local_end_stream_ = local_end_stream_ || end_stream;
+  if (local_end_stream_ && remote_end_stream_) {
+    close();
+  }
+}
+
+void SharedConnPoolOwnerStream::onRemoteEndStream(bool end_stream) {
+  remote_end_stream_ = remote_end_stream_ || end_stream;
+  if (local_end_stream_ && remote_end_stream_) {
+    close();
+  }
+}
+
+void SharedConnPoolOwnerStream::close() {
+  if (closed_) {
+    return;
+  }
+  closed_ = true;
+  if (encoder_ != nullptr) {
+    // The stream completed, but the codec may still run callbacks before destroying it.
+    Stream& stream = encoder_->getStream();
+    stream.removeCallbacks(*this);
+    stream.registerCodecEventCallbacks(nullptr);
+    encoder_ = nullptr;
+  }
+  if (owner_ != nullptr) {
+    owner_->removeStream(*this);
+  }
+}
+
+SharedConnPoolThread::SharedConnPoolThread(Event::Dispatcher& dispatcher, PoolLookup pool_lookup)
+    : dispatcher_(dispatcher), pool_lookup_(std::move(pool_lookup)) {}
+
+bool SharedConnPoolThread::post(Event::PostCb cb) {
+  absl::ReaderMutexLock lock(&mutex_);
+  if (shutdown_) {
+    return false;
+  }
+  dispatcher_.post(std::move(cb));
+  return true;
+}
+
+bool SharedConnPoolThread::isShutdown() {
+  absl::ReaderMutexLock lock(&mutex_);
+  return shutdown_;
+}
+
+void SharedConnPoolThread::shutdown() {
+  ASSERT(dispatcher_.isThreadSafe());
+  {
+    absl::WriterMutexLock lock(&mutex_);
+    shutdown_ = true;
+  }
+  // Resetting a stream removes it from streams_.
+  std::vector<std::shared_ptr<SharedConnPoolOwnerStream>> streams;
+  streams.reserve(streams_.size());
+  for (const auto& [_, stream] : streams_) {
+    streams.push_back(stream);
+  }
+  for (const auto& stream : streams) {
+    stream->onShutdown();
+  }
+  ASSERT(streams_.empty());
+}
+
+void SharedConnPoolThread::startStream(std::shared_ptr<SharedConnPoolOwnerStream>&& stream,
+                                       const SharedConnPoolKey& key,
+                                       const ConnectionPool::Instance::StreamOptions& options) {
+  ConnectionPool::Instance* pool = isShutdown() ? nullptr : pool_lookup_(key);
+  if (pool == nullptr) {
+    stream->onPoolFailure(ConnectionPool::PoolFailureReason::LocalConnectionFailure,
+                          "no shared connection pool", key.host_);
+    return;
+  }
+  SharedConnPoolOwnerStream& started = *stream;
+  streams_.emplace(&started, std::move(stream));
+  started.start(*this, *pool, options);
+}
+
+void SharedConnPoolThread::removeStream(SharedConnPoolOwnerStream& stream) {
+  auto it = streams_.find(&stream);
+  ASSERT(it != streams_.end());
+  dispatcher_.deferredDelete(std::make_unique<DeferredRelease>(std::move(it->second)));
+  streams_.erase(it);
+}
+
+void SharedConnPoolRegistry::add(SharedConnPoolThread& thread) {
+  absl::WriterMutexLock lock(&mutex_);
+  thread.index_ = threads_.size();
+  threads_.push_back(thread.shared_from_this());
+  ++registered_;
+}
+
+void SharedConnPoolRegistry::remove(SharedConnPoolThread& thread) {
+  absl::WriterMutexLock lock(&mutex_);
+  ASSERT(thread.index_ < threads_.size() && threads_[thread.index_].get() == &thread);
+  threads_[thread.index_] = nullptr;
+  --registered_;
+}
+
+SharedConnPoolThreadSharedPtr SharedConnPoolRegistry::owner(const Upstream::HostDescription& host,
+                                                            uint32_t owners_per_host,
+                                                            const SharedConnPoolThread& thread) {
+  absl::ReaderMutexLock lock(&mutex_);
+  const uint32_t size = threads_.size();
+  if (registered_ < concurrency_ || registered_ != size || size < 2) {
+    return nullptr;
+  }
+  // The owners of the connections to a host are the threads first, first + 1, ..., first +
+  // owners_per_host - 1 modulo the number of threads, and each other thread hands its streams off
+  // to one of them.
+  const uint32_t first =
+      HashUtil::xxHash64(host.address() != nullptr ? host.address()->asStringView()
+                                                   : absl::string_view(host.hostname())) %
+      size;
+  const uint32_t owners = std::min(owners_per_host, size);
+  const uint32_t offset = (thread.index() + size - first) % size;
+  if (offset < owners) {
+    return nullptr;
+  }
+  return threads_[(first + offset % owners) % size];
+}
+
+SharedConnPoolImpl::SharedConnPoolImpl(SharedConnPoolThreadSharedPtr thread,
+                                       SharedConnPoolThreadSharedPtr owner, SharedConnPoolKey key)
+    : thread_(std::move(thread)), owner_(std::move(owner)), key_(std::move(key)) {}
+
+SharedConnPoolImpl::~SharedConnPoolImpl() {
+  // Reset the remaining streams, like the destruction of a pool resets the streams of its
+  // connections.
+  while (!streams_.empty()) {
+    std::shared_ptr<SharedConnPoolProxyStream> stream = streams_.begin()->second;
+    streams_.erase(streams_.begin());
+    stream->onPoolDestroyed();
+  }
+}
+
+void SharedConnPoolImpl::drainConnections(Envoy::ConnectionPool::DrainBehavior drain_behavior) {
+  // The connections are drained by their owner, which gets the same host updates.
+  if (drain_behavior == Envoy::ConnectionPool::DrainBehavior::DrainAndDelete) {
+    draining_for_deletion_ = true;
+    checkForIdle();
+  }
+}
+
+ConnectionPool::Cancellable* SharedConnPoolImpl::newStream(ResponseDecoder& response_decoder,
+                                                           ConnectionPool::Callbacks& callbacks,
+                                                           const StreamOptions& options) {
+  ASSERT(!draining_for_deletion_);
+  auto proxy_stream = std::make_shared<SharedConnPoolProxyStream>(
+      *this, thread_->dispatcher(), owner_, response_decoder, callbacks);
+  auto owner_stream = std::make_shared<SharedConnPoolOwnerStream>(thread_, proxy_stream);
+  proxy_stream->setOwnerStream(owner_stream);
+
+  const bool posted = owner_->post([owner = owner_, owner_stream = std::move(owner_stream),
+                                    key = key_, options]() mutable {
+    owner->startStream(std::move(owner_stream), key, options);
+  });
+  if (!posted) {
+    callbacks.onPoolFailure(ConnectionPool::PoolFailureReason::LocalConnectionFailure,
+                            "shared connection pool shut down", key_.host_);
+    return nullptr;
+  }
+
+  ENVOY_LOG(debug, "handed off a stream of cluster {} to worker thread {}", key_.cluster_name_,
+            owner_->index());
+  SharedConnPoolProxyStream& handle = *proxy_stream;
+  streams_.emplace(&handle, std::move(proxy_stream));
+  return &handle;
+}
+
+void SharedConnPoolImpl::onStreamClosed(SharedConnPoolProxyStream& stream) {
+  auto it = streams_.find(&stream);
+  ASSERT(it != streams_.end());
+  thread_->dispatcher().deferredDelete(std::make_unique<DeferredRelease>(std::move(it->second)));
+  streams_.erase(it);
+  checkForIdle();
+}
+
+void SharedConnPoolImpl::checkForIdle() {
+  if (!streams_.empty()) {
+    return;
+  }
+  for (const IdleCb& cb : idle_callbacks_) {
+    cb();
+  }
+  // Clear callbacks, so they are not executed again.
+  idle_callbacks_.clear();
+}
+
+} // namespace Http
+} // namespace Envoy
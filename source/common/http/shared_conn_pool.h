@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/event/dispatcher.h"
+#include "envoy/http/codec.h"
+#include "envoy/http/conn_pool.h"
+#include "envoy/upstream/upstream.h"
+
+#include "source/common/common/logger.h"
+#include "source/common/common/thread.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace Envoy {
+namespace Http {
+
+class SharedConnPoolOwnerStream;
+class SharedConnPoolProxyStream;
+
+/**
+ * Identifies the connection pool a handed off stream runs on in the worker thread that owns the
+ * connections to the host.
+ */
+struct SharedConnPoolKey {
+  std::string cluster_name_;
+  Upstream::HostConstSharedPtr host_;
+  Upstream::ResourcePriority priority_;
+  absl::optional<Protocol> downstream_protocol_;
+};
+
+/**
+ * The part of a worker thread that takes part in sharing upstream connections across worker
+ * threads. As the owner of the connections to some hosts, it runs the streams that the other
+ * worker threads hand off to it on its own connection pools. As a proxy, it receives the events of
+ * the streams it handed off to other worker threads.
+ */
+class SharedConnPoolThread : public std::enable_shared_from_this<SharedConnPoolThread>,
+                             Logger::Loggable<Logger::Id::pool> {
+public:
+  // Returns the connection pool of the thread to run a handed off stream on, or nullptr if there
+  // is none, for example because the cluster was removed.
+  using PoolLookup = std::function<ConnectionPool::Instance*(const SharedConnPoolKey& key)>;
+
+  SharedConnPoolThread(Event::Dispatcher& dispatcher, PoolLookup pool_lookup);
+
+  /**
+   * Runs a callback on the thread. May be called from any thread.
+   * @return false if the thread was shut down, in which case the callback is not run.
+   */
+  bool post(Event::PostCb cb);
+
+  /**
+   * Stops running posted callbacks and resets the streams handed off to the thread. Must be called
+   * on the thread, before its connection pools are destroyed.
+   */
+  void shutdown();
+
+  /**
+   * @return the index of the thread in its SharedConnPoolRegistry.
+   */
+  uint32_t index() const { return index_; }
+
+  Event::Dispatcher& dispatcher() { return dispatcher_; }
+
+private:
+  friend class SharedConnPoolImpl;
+  friend class SharedConnPoolOwnerStream;
+  friend class SharedConnPoolRegistry;
+
+  bool isShutdown();
+  void startStream(std::shared_ptr<SharedConnPoolOwnerStream>&& stream,
+                   const SharedConnPoolKey& key,
+                   const ConnectionPool::Instance::StreamOptions& options);
+  void removeStream(SharedConnPoolOwnerStream& stream);
+
+  Event::Dispatcher& dispatcher_;
+  const PoolLookup pool_lookup_;
+  uint32_t index_{};
+  absl::Mutex mutex_;
+  bool shutdown_ ABSL_GUARDED_BY(mutex_){};
+  // The streams handed off to the thread.
+  absl::flat_hash_map<const SharedConnPoolOwnerStream*, std::shared_ptr<SharedConnPoolOwnerStream>>
+      streams_;
+};
+
+using SharedConnPoolThreadSharedPtr = std::shared_ptr<SharedConnPoolThread>;
+
+/**
+ * The SharedConnPoolThreads of all worker threads, to find the worker thread that owns the
+ * connections to a host. Thread safe.
+ */
+class SharedConnPoolRegistry {
+public:
+  /**
+   * @param concurrency supplies the number of worker threads. Connections are only shared once
+   *        all of them registered.
+   */
+  explicit SharedConnPoolRegistry(uint32_t concurrency) : concurrency_(concurrency) {}
+
+  /**
+   * Registers the SharedConnPoolThread of a worker thread, and sets its index.
+   */
+  void add(SharedConnPoolThread& thread);
+
+  /**
+   * Unregisters the SharedConnPoolThread of a worker thread. Connections are no longer shared
+   * afterwards.
+   */
+  void remove(SharedConnPoolThread& thread);
+
+  /**
+   * @param host supplies the upstream host.
+   * @param owners_per_host supplies the number of worker threads that own connections to the host.
+   * @param thread supplies the SharedConnPoolThread of the calling worker thread.
+   * @return the thread to hand off the streams of the calling worker thread to host to, or nullptr
+   *         if the calling worker thread should use its own connections.
+   */
+  SharedConnPoolThreadSharedPtr owner(const Upstream::HostDescription& host,
+                                      uint32_t owners_per_host, const SharedConnPoolThread& thread);
+
+private:
+  const uint32_t concurrency_;
+  absl::Mutex mutex_;
+  std::vector<SharedConnPoolThreadSharedPtr> threads_ ABSL_GUARDED_BY(mutex_);
+  uint32_t registered_ ABSL_GUARDED_BY(mutex_){};
+};
+
+using SharedConnPoolRegistrySharedPtr = std::shared_ptr<SharedConnPoolRegistry>;
+
+/**
+ * A connection pool of a worker thread that hands its streams off to the worker thread that owns
+ * the connections to the host. Headers, data and other stream events are moved between the
+ * threads by posting to their dispatchers.
+ */
+class SharedConnPoolImpl : public ConnectionPool::Instance, Logger::Loggable<Logger::Id::pool> {
+public:
+  SharedConnPoolImpl(SharedConnPoolThreadSharedPtr thread, SharedConnPoolThreadSharedPtr owner,
+                     SharedConnPoolKey key);
+  ~SharedConnPoolImpl() override;
+
+  // Envoy::ConnectionPool::Instance
+  void addIdleCallback(IdleCb cb) override { idle_callbacks_.push_back(cb); }
+  bool isIdle() const override { return streams_.empty(); }
+  void drainConnections(Envoy::ConnectionPool::DrainBehavior drain_behavior) override;
+  Upstream::HostDescriptionConstSharedPtr host() const override { return key_.host_; }
+  // Connections are preconnected by the owner of the connections.
+  bool maybePreconnect(float) override { return false; }
+
+  // Http::ConnectionPool::Instance
+  bool hasActiveConnections() const override { return !streams_.empty(); }
+  ConnectionPool::Cancellable* newStream(ResponseDecoder& response_decoder,
+                                         ConnectionPool::Callbacks& callbacks,
+                                         const StreamOptions& options) override;
+  absl::string_view protocolDescription() const override { return "shared"; }
+
+  void onStreamClosed(SharedConnPoolProxyStream& stream);
+
+private:
+  void checkForIdle();
+
+  const SharedConnPoolThreadSharedPtr thread_;
+  const SharedConnPoolThreadSharedPtr owner_;
+  const SharedConnPoolKey key_;
+  absl::flat_hash_map<const SharedConnPoolProxyStream*, std::shared_ptr<SharedConnPoolProxyStream>>
+      streams_;
+  std::list<IdleCb> idle_callbacks_;
+  bool draining_for_deletion_{};
+};
+
+} // namespace Http
+} // namespace Envoy
@@ -104,9 +104,11 @@ void UdpListenerImpl::onSocketEvent(short flags) {
 void UdpListenerImpl::handleReadCallback() {
   ENVOY_UDP_LOG(trace, "handleReadCallback");
   cb_.onReadReady();
+  packets_read_in_batch_ = 0;
   const Api::IoErrorPtr result = Utility::readPacketsFromSocket(
       socket_->ioHandle(), *socket_->connectionInfoProvider().localAddress(), *this, time_source_,
       config_.prefer_gro_, /*allow_mmsg=*/true, packets_dropped_);
+  cb_.onReadBatchComplete(packets_read_in_batch_);
   if (result == nullptr) {
     // No error. The number of reads was limited by read rate. There are more packets to read.
     // Register to read more in the next event loop.
@@ -129,6 +131,7 @@ void UdpListenerImpl::processPacket(Address::InstanceConstSharedPtr local_addres
   // UDP listeners are always configured with the socket option that allows pulling the local
   // address. This should never be null.
   ASSERT(local_address != nullptr);
+  ++packets_read_in_batch_;
   UdpRecvData recvData{{std::move(local_address), std::move(peer_address)},
                        std::move(buffer),
                        receive_time,
@@ -63,6 +63,8 @@ protected:
 
   UdpListenerCallbacks& cb_;
   uint32_t packets_dropped_{0};
+  // The number of datagrams handed to cb_ in the current read event.
+  uint32_t packets_read_in_batch_{0};
 
 private:
   void onSocketEvent(short flags);
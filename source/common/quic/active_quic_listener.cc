@@ -167,9 +167,10 @@ void ActiveQuicListener::onDataWorker(Network::UdpRecvData&& data) {
     }
   }
 
-  if (quic_dispatcher_->HasChlosBuffered()) {
+  if (!in_read_batch_ && quic_dispatcher_->HasChlosBuffered()) {
     // If there are any buffered CHLOs, activate a read event for the next event loop to process
-    // them.
+    // them. Packets read on this worker are covered once per batch by onReadBatchComplete(); this
+    // handles packets posted from other workers.
     udp_listener_->activateRead();
   }
 }
@@ -198,8 +199,19 @@ void ActiveQuicListener::onReadReady() {
   }
 
   quic_dispatcher_->ProcessBufferedChlos(kNumSessionsToCreatePerLoop);
+  in_read_batch_ = true;
+}
+
+void ActiveQuicListener::onReadBatchComplete(uint32_t num_packets_read) {
+  ActiveUdpListenerBase::onReadBatchComplete(num_packets_read);
+  if (!in_read_batch_) {
+    // onReadReady() bailed out early, so no packets were dispatched.
+    return;
+  }
+  in_read_batch_ = false;
 
-  // If there were more buffered than the limit, schedule again for the next event loop.
+  // If there were more buffered than the limit, or the batch buffered new CHLOs, schedule again
+  // for the next event loop.
   if (quic_dispatcher_->HasChlosBuffered()) {
     udp_listener_->activateRead();
   }
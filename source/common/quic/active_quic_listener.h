@@ -53,6 +53,7 @@ public:
 
   // Network::UdpListenerCallbacks
   void onReadReady() override;
+  void onReadBatchComplete(uint32_t num_packets_read) override;
   void onWriteReady(const Network::Socket& socket) override;
   void onReceiveError(Api::IoError::IoErrorCode /*error_code*/) override {
     // No-op. Quic can't do anything upon listener error.
@@ -99,6 +100,9 @@ private:
   const QuicConnectionIdWorkerSelector select_connection_id_worker_;
   // Latches envoy.reloadable_features.quic_reject_all at the beginning of each event loop.
   bool reject_all_{false};
+  // True between onReadReady() and onReadBatchComplete(), while packets read from the socket are
+  // being dispatched. Follow-up work such as buffered CHLO processing is scheduled once per batch.
+  bool in_read_batch_{false};
   // During hot restart, an optional handler for packets that weren't for existing connections.
   OptRef<Network::NonDispatchedUdpPacketHandler> non_dispatched_udp_packet_handler_;
   Network::IoHandle::UdpSaveCmsgConfig udp_save_cmsg_config_;
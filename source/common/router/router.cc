@@ -822,10 +822,14 @@ Http::FilterHeadersStatus Filter::continueDecodeHeaders(
       const auto& policy_ref = *shadow_policy;
       if (FilterUtility::shouldShadow(policy_ref, config_->runtime_, callbacks_->streamId())) {
         active_shadow_policies_.push_back(std::cref(policy_ref));
-        shadow_headers_ = Http::createHeaderMap<Http::RequestHeaderMapImpl>(*downstream_headers_);
       }
     }
   }
+  if (!active_shadow_policies_.empty()) {
+    // Snapshot the headers once before the upstream request mutates them. Every shadow policy is
+    // served from this snapshot; see takeShadowHeaders().
+    shadow_headers_ = Http::createHeaderMap<Http::RequestHeaderMapImpl>(*downstream_headers_);
+  }
 
   ENVOY_STREAM_LOG(debug, "router decoding headers:\n{}", *callbacks_, headers);
 
@@ -849,14 +853,14 @@ Http::FilterHeadersStatus Filter::continueDecodeHeaders(
   upstream_requests_.front()->acceptHeadersFromRouter(end_stream);
   if (streaming_shadows_) {
     // start the shadow streams.
-    for (const auto& shadow_policy_wrapper : active_shadow_policies_) {
-      const auto& shadow_policy = shadow_policy_wrapper.get();
+    for (size_t i = 0; i < active_shadow_policies_.size(); ++i) {
+      const auto& shadow_policy = active_shadow_policies_[i].get();
       const absl::optional<absl::string_view> shadow_cluster_name =
           getShadowCluster(shadow_policy, *downstream_headers_);
       if (!shadow_cluster_name.has_value()) {
         continue;
       }
-      auto shadow_headers = Http::createHeaderMap<Http::RequestHeaderMapImpl>(*shadow_headers_);
+      auto shadow_headers = takeShadowHeaders(i + 1 == active_shadow_policies_.size());
       const auto options =
           Http::AsyncClient::RequestOptions()
               .setTimeout(timeout_.global_timeout_)
@@ -875,8 +879,7 @@ Http::FilterHeadersStatus Filter::continueDecodeHeaders(
       if (end_stream) {
         // This is a header-only request, and can be dispatched immediately to the shadow
         // without waiting.
-        Http::RequestMessagePtr request(new Http::RequestMessageImpl(
-            Http::createHeaderMap<Http::RequestHeaderMapImpl>(*shadow_headers_)));
+        Http::RequestMessagePtr request(new Http::RequestMessageImpl(std::move(shadow_headers)));
         config_->shadowWriter().shadow(std::string(shadow_cluster_name.value()), std::move(request),
                                        options);
       } else {
@@ -1042,7 +1045,7 @@ Http::FilterDataStatus Filter::decodeData(Buffer::Instance& data, bool end_strea
 Http::FilterTrailersStatus Filter::decodeTrailers(Http::RequestTrailerMap& trailers) {
   ENVOY_STREAM_LOG(debug, "router decoding trailers:\n{}", *callbacks_, trailers);
 
-  if (shadow_headers_) {
+  if (shadow_headers_ != nullptr || !shadow_streams_.empty()) {
     shadow_trailers_ = Http::createHeaderMap<Http::RequestTrailerMapImpl>(trailers);
   }
 
@@ -1056,11 +1059,11 @@ Http::FilterTrailersStatus Filter::decodeTrailers(Http::RequestTrailerMap& trail
   if (!upstream_requests_.empty()) {
     upstream_requests_.front()->acceptTrailersFromRouter(trailers);
   }
+  size_t remaining_shadow_streams = shadow_streams_.size();
   for (auto* shadow_stream : shadow_streams_) {
     shadow_stream->removeDestructorCallback();
     shadow_stream->removeWatermarkCallbacks();
-    shadow_stream->captureAndSendTrailers(
-        Http::createHeaderMap<Http::RequestTrailerMapImpl>(*shadow_trailers_));
+    shadow_stream->captureAndSendTrailers(takeShadowTrailers(--remaining_shadow_streams == 0));
   }
   shadow_streams_.clear();
 
@@ -1120,9 +1123,26 @@ absl::optional<absl::string_view> Filter::getShadowCluster(const ShadowPolicy& p
   }
 }
 
+Http::RequestHeaderMapPtr Filter::takeShadowHeaders(bool last_use) {
+  ASSERT(shadow_headers_ != nullptr);
+  if (last_use) {
+    return std::move(shadow_headers_);
+  }
+  return Http::createHeaderMap<Http::RequestHeaderMapImpl>(*shadow_headers_);
+}
+
+Http::RequestTrailerMapPtr Filter::takeShadowTrailers(bool last_use) {
+  ASSERT(shadow_trailers_ != nullptr);
+  if (last_use) {
+    return std::move(shadow_trailers_);
+  }
+  return Http::createHeaderMap<Http::RequestTrailerMapImpl>(*shadow_trailers_);
+}
+
 void Filter::maybeDoShadowing() {
-  for (const auto& shadow_policy_wrapper : active_shadow_policies_) {
-    const auto& shadow_policy = shadow_policy_wrapper.get();
+  for (size_t i = 0; i < active_shadow_policies_.size(); ++i) {
+    const auto& shadow_policy = active_shadow_policies_[i].get();
+    const bool last_use = i + 1 == active_shadow_policies_.size();
 
     const absl::optional<absl::string_view> shadow_cluster_name =
         getShadowCluster(shadow_policy, *downstream_headers_);
@@ -1132,13 +1152,12 @@ void Filter::maybeDoShadowing() {
       continue;
     }
 
-    Http::RequestMessagePtr request(new Http::RequestMessageImpl(
-        Http::createHeaderMap<Http::RequestHeaderMapImpl>(*shadow_headers_)));
+    Http::RequestMessagePtr request(new Http::RequestMessageImpl(takeShadowHeaders(last_use)));
     if (callbacks_->decodingBuffer()) {
       request->body().add(*callbacks_->decodingBuffer());
     }
     if (shadow_trailers_) {
-      request->trailers(Http::createHeaderMap<Http::RequestTrailerMapImpl>(*shadow_trailers_));
+      request->trailers(takeShadowTrailers(last_use));
     }
     const auto options =
         Http::AsyncClient::RequestOptions()
@@ -553,6 +553,10 @@ private:
                                                      const Http::HeaderMap& headers) const;
 
   void maybeDoShadowing();
+  // Returns the shadow header (trailer) snapshot for one shadow request. The last user takes
+  // ownership of the snapshot; earlier users receive a copy.
+  Http::RequestHeaderMapPtr takeShadowHeaders(bool last_use);
+  Http::RequestTrailerMapPtr takeShadowTrailers(bool last_use);
   bool maybeRetryReset(Http::StreamResetReason reset_reason, UpstreamRequest& upstream_request,
                        TimeoutRetry is_timeout_retry);
   uint32_t numRequestsAwaitingHeaders();
@@ -626,8 +630,8 @@ private:
   MetadataMatchCriteriaConstPtr metadata_match_;
   std::function<void(Http::ResponseHeaderMap&)> modify_headers_;
   std::vector<std::reference_wrapper<const ShadowPolicy>> active_shadow_policies_{};
-  std::unique_ptr<Http::RequestHeaderMap> shadow_headers_;
-  std::unique_ptr<Http::RequestTrailerMap> shadow_trailers_;
+  Http::RequestHeaderMapPtr shadow_headers_;
+  Http::RequestTrailerMapPtr shadow_trailers_;
   // The stream lifetime configured by request header.
   absl::optional<std::chrono::milliseconds> dynamic_max_stream_duration_;
   // list of cookies to add to upstream headers
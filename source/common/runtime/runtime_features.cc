@@ -146,6 +146,11 @@ FALSE_RUNTIME_GUARD(envoy_reloadable_features_reresolve_null_addresses);
 FALSE_RUNTIME_GUARD(envoy_reloadable_features_reresolve_if_no_connections);
 // TODO(adisuissa): flip to true after this is out of alpha mode.
 FALSE_RUNTIME_GUARD(envoy_restart_features_xds_failover_support);
+// Prepares EDS updates on a pool of threads. Flip to true once it has soaked. Addresses are still
+// resolved on the main thread, so that updates with invalid addresses are rejected as without it.
+// An update that fails to apply once prepared has already been accepted, so it is counted in
+// assignment_rejected instead.
+FALSE_RUNTIME_GUARD(envoy_restart_features_eds_prepare_updates_off_main_thread);
 // TODO(fredyw): evaluate and either make this a config knob or remove.
 FALSE_RUNTIME_GUARD(envoy_reloadable_features_dns_cache_set_ip_version_to_remove);
 // TODO(alyssawilk): evaluate and make this a config knob or remove.
@@ -178,6 +183,19 @@ FALSE_RUNTIME_GUARD(envoy_reloadable_features_quic_disable_client_early_data);
 
 FALSE_RUNTIME_GUARD(envoy_reloadable_features_ext_proc_graceful_grpc_close);
 
+// Reuses storage for header strings repeated across streams on upstream HTTP/2 connections.
+// Flip to true after prod testing.
+FALSE_RUNTIME_GUARD(envoy_reloadable_features_http2_upstream_header_rep_cache);
+
+// Applies host set changes to existing EDF schedulers as deltas rather than rebuilding them. This
+// changes the sequence of hosts picked after an update. Flip to true after prod testing.
+FALSE_RUNTIME_GUARD(envoy_reloadable_features_edf_lb_incremental_refresh);
+
+// Spreads the updates of each host's rq_active gauge over per-thread shards. Each host that serves
+// requests then allocates 512 bytes of shards, which only pays off for the least request and
+// bounded load balancers on hosts that many workers use concurrently.
+FALSE_RUNTIME_GUARD(envoy_reloadable_features_shard_host_rq_active);
+
 // Block of non-boolean flags. Use of int flags is deprecated. Do not add more.
 ABSL_FLAG(uint64_t, re2_max_program_size_error_level, 100, ""); // NOLINT
 ABSL_FLAG(uint64_t, re2_max_program_size_warn_level,            // NOLINT
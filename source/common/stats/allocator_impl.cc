@@ -59,6 +59,12 @@ void AllocatorImpl::debugPrint() {
 }
 #endif
 
+// Approximate memory held by a stat allocated as StatType, for per-family
+// memory accounting. The backing store of a TextReadout's value is not included.
+template <class StatType> uint64_t statMemoryBytes(const Metric& stat) {
+  return sizeof(StatType) + FamilyMemoryTracker::nameBytes(stat);
+}
+
 // Counter, Gauge and TextReadout inherit from RefcountInterface and
 // Metric. MetricImpl takes care of most of the Metric API, but we need to cover
 // symbolTable() here, which we don't store directly, but get it via the alloc,
@@ -146,6 +152,8 @@ public:
     const size_t count = alloc_.counters_.erase(statName());
     ASSERT(count == 1);
     alloc_.sinked_counters_.erase(this);
+    alloc_.family_memory_.remove(tagExtractedStatName(), FamilyMemoryTracker::Type::Counter,
+                                 statMemoryBytes<CounterImpl>(*this));
   }
 
   // Stats::Counter
@@ -171,6 +179,7 @@ public:
   GaugeImpl(StatName name, AllocatorImpl& alloc, StatName tag_extracted_name,
             const StatNameTagVector& stat_name_tags, ImportMode import_mode)
       : StatsSharedImpl(name, alloc, tag_extracted_name, stat_name_tags) {
+    flags_ |= Flags::Changed;
     switch (import_mode) {
     case ImportMode::Accumulate:
       flags_ |= Flags::LogicAccumulate;
@@ -195,23 +204,30 @@ public:
     const size_t count = alloc_.gauges_.erase(statName());
     ASSERT(count == 1);
     alloc_.sinked_gauges_.erase(this);
+    alloc_.family_memory_.remove(tagExtractedStatName(), FamilyMemoryTracker::Type::Gauge,
+                                 statMemoryBytes<GaugeImpl>(*this));
   }
 
   // Stats::Gauge
   void add(uint64_t amount) override {
     child_value_ += amount;
-    flags_ |= Flags::Used;
+    flags_ |= Flags::Used | Flags::Changed;
   }
   void dec() override { sub(1); }
   void inc() override { add(1); }
   void set(uint64_t value) override {
     child_value_ = value;
-    flags_ |= Flags::Used;
+    flags_ |= Flags::Used | Flags::Changed;
   }
   void sub(uint64_t amount) override {
     ASSERT(child_value_ >= amount);
     ASSERT(used() || amount == 0);
     child_value_ -= amount;
+    // Most gauges are written many times per flush interval, so avoid the
+    // read-modify-write when the flag is already set.
+    if (!(flags_.load(std::memory_order_relaxed) & Flags::Changed)) {
+      flags_ |= Flags::Changed;
+    }
   }
   uint64_t value() const override { return child_value_ + parent_value_; }
 
@@ -260,7 +276,16 @@ public:
     }
   }
 
-  void setParentValue(uint64_t value) override { parent_value_ = value; }
+  void setParentValue(uint64_t value) override {
+    parent_value_ = value;
+    flags_ |= Flags::Changed;
+  }
+  bool latchChanged() override {
+    if (!(flags_.load(std::memory_order_relaxed) & Flags::Changed)) {
+      return false;
+    }
+    return flags_.fetch_and(static_cast<uint16_t>(~Flags::Changed)) & Flags::Changed;
+  }
 
 private:
   std::atomic<uint64_t> parent_value_{0};
@@ -277,6 +302,8 @@ public:
     const size_t count = alloc_.text_readouts_.erase(statName());
     ASSERT(count == 1);
     alloc_.sinked_text_readouts_.erase(this);
+    alloc_.family_memory_.remove(tagExtractedStatName(), FamilyMemoryTracker::Type::TextReadout,
+                                 statMemoryBytes<TextReadoutImpl>(*this));
   }
 
   // Stats::TextReadout
@@ -307,6 +334,8 @@ CounterSharedPtr AllocatorImpl::makeCounter(StatName name, StatName tag_extracte
   }
   auto counter = CounterSharedPtr(makeCounterInternal(name, tag_extracted_name, stat_name_tags));
   counters_.insert(counter.get());
+  family_memory_.add(tag_extracted_name, FamilyMemoryTracker::Type::Counter,
+                     statMemoryBytes<CounterImpl>(*counter));
   // Add counter to sinked_counters_ if it matches the sink predicate.
   if (sink_predicates_ != nullptr && sink_predicates_->includeCounter(*counter)) {
     auto val = sinked_counters_.insert(counter.get());
@@ -328,6 +357,8 @@ GaugeSharedPtr AllocatorImpl::makeGauge(StatName name, StatName tag_extracted_na
   auto gauge =
       GaugeSharedPtr(new GaugeImpl(name, *this, tag_extracted_name, stat_name_tags, import_mode));
   gauges_.insert(gauge.get());
+  family_memory_.add(tag_extracted_name, FamilyMemoryTracker::Type::Gauge,
+                     statMemoryBytes<GaugeImpl>(*gauge));
   // Add gauge to sinked_gauges_ if it matches the sink predicate.
   if (sink_predicates_ != nullptr && sink_predicates_->includeGauge(*gauge)) {
     auto val = sinked_gauges_.insert(gauge.get());
@@ -348,6 +379,8 @@ TextReadoutSharedPtr AllocatorImpl::makeTextReadout(StatName name, StatName tag_
   auto text_readout =
       TextReadoutSharedPtr(new TextReadoutImpl(name, *this, tag_extracted_name, stat_name_tags));
   text_readouts_.insert(text_readout.get());
+  family_memory_.add(tag_extracted_name, FamilyMemoryTracker::Type::TextReadout,
+                     statMemoryBytes<TextReadoutImpl>(*text_readout));
   // Add text_readout to sinked_text_readouts_ if it matches the sink predicate.
   if (sink_predicates_ != nullptr && sink_predicates_->includeTextReadout(*text_readout)) {
     auto val = sinked_text_readouts_.insert(text_readout.get());
@@ -439,6 +472,11 @@ void AllocatorImpl::forEachSinkedTextReadout(SizeFn f_size, StatFn<TextReadout>
   }
 }
 
+void AllocatorImpl::forEachFamilyMemory(const StatFamilyMemoryFn& fn) const {
+  Thread::LockGuard lock(mutex_);
+  family_memory_.forEach(fn);
+}
+
 void AllocatorImpl::setSinkPredicates(std::unique_ptr<SinkPredicates>&& sink_predicates) {
   Thread::LockGuard lock(mutex_);
   ASSERT(sink_predicates_ == nullptr);
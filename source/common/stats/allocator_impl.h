@@ -8,6 +8,7 @@
 #include "envoy/stats/stats.h"
 
 #include "source/common/common/thread_synchronizer.h"
+#include "source/common/stats/family_memory.h"
 #include "source/common/stats/metric_impl.h"
 
 #include "absl/container/flat_hash_set.h"
@@ -20,7 +21,8 @@ class AllocatorImpl : public Allocator {
 public:
   static const char DecrementToZeroSyncPoint[];
 
-  AllocatorImpl(SymbolTable& symbol_table) : symbol_table_(symbol_table) {}
+  AllocatorImpl(SymbolTable& symbol_table)
+      : symbol_table_(symbol_table), family_memory_(symbol_table) {}
   ~AllocatorImpl() override;
 
   // Allocator
@@ -44,6 +46,8 @@ public:
   void forEachSinkedGauge(SizeFn f_size, StatFn<Gauge> f_stat) const override;
   void forEachSinkedTextReadout(SizeFn f_size, StatFn<TextReadout> f_stat) const override;
 
+  void forEachFamilyMemory(const StatFamilyMemoryFn& fn) const override;
+
   void setSinkPredicates(std::unique_ptr<SinkPredicates>&& sink_predicates) override;
 #ifndef ENVOY_CONFIG_COVERAGE
   void debugPrint();
@@ -96,6 +100,11 @@ private:
 
   Thread::ThreadSynchronizer sync_;
 
+  // Per-family memory totals. This must be declared before the deleted_*
+  // vectors below, as the stats they retain are removed from it when they are
+  // destroyed along with the allocator.
+  FamilyMemoryTracker family_memory_ ABSL_GUARDED_BY(mutex_);
+
   // Retain storage for deleted stats; these are no longer in maps because
   // the matcher-pattern was established after they were created. Since the
   // stats are held by reference in code that expects them to be there, we
@@ -0,0 +1,79 @@
+#include "source/common/stats/family_memory.h"
+
+#include "source/common/common/assert.h"
+
+namespace Envoy {
+namespace Stats {
+
+FamilyMemoryTracker::~FamilyMemoryTracker() { clear(); }
+
+uint64_t& FamilyMemoryTracker::countFor(StatFamilyMemory& memory, Type type) {
+  switch (type) {
+  case Type::Counter:
+    return memory.counters_;
+  case Type::Gauge:
+    return memory.gauges_;
+  case Type::TextReadout:
+    return memory.text_readouts_;
+  case Type::Histogram:
+    return memory.histograms_;
+  }
+  PANIC_DUE_TO_CORRUPT_ENUM;
+}
+
+void FamilyMemoryTracker::add(StatName tag_extracted_name, Type type, uint64_t bytes) {
+  auto iter = families_.find(tag_extracted_name);
+  if (iter == families_.end()) {
+    iter = families_.emplace(StatNameStorage(tag_extracted_name, symbol_table_), StatFamilyMemory())
+               .first;
+  }
+  ++countFor(iter->second, type);
+  iter->second.bytes_ += bytes;
+}
+
+void FamilyMemoryTracker::remove(StatName tag_extracted_name, Type type, uint64_t bytes) {
+  auto iter = families_.find(tag_extracted_name);
+  if (iter == families_.end()) {
+    IS_ENVOY_BUG("removing a stat from an untracked family");
+    return;
+  }
+  StatFamilyMemory& memory = iter->second;
+  uint64_t& count = countFor(memory, type);
+  ASSERT(count >= 1 && memory.bytes_ >= bytes);
+  --count;
+  memory.bytes_ -= bytes;
+  if (memory.counters_ == 0 && memory.gauges_ == 0 && memory.text_readouts_ == 0 &&
+      memory.histograms_ == 0) {
+    // The key must release its symbols before it is destroyed; see
+    // StatNameStorageSet::free().
+    auto node = families_.extract(iter);
+    node.key().free(symbol_table_);
+  }
+}
+
+void FamilyMemoryTracker::forEach(const StatFamilyMemoryFn& fn) const {
+  for (const auto& [name, memory] : families_) {
+    fn(name.statName(), memory);
+  }
+}
+
+void FamilyMemoryTracker::clear() {
+  while (!families_.empty()) {
+    auto node = families_.extract(families_.begin());
+    node.key().free(symbol_table_);
+  }
+}
+
+uint64_t FamilyMemoryTracker::nameBytes(const Metric& metric) {
+  // MetricHelper packs the name, the tag-extracted name and every tag name and
+  // value into a single StatNameList, prefixed by a one-byte element count.
+  uint64_t bytes = 1 + metric.statName().size() + metric.tagExtractedStatName().size();
+  metric.iterateTagStatNames([&bytes](StatName name, StatName value) -> bool {
+    bytes += name.size() + value.size();
+    return true;
+  });
+  return bytes;
+}
+
+} // namespace Stats
+} // namespace Envoy
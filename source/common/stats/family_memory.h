@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+
+#include "envoy/stats/stats.h"
+
+#include "source/common/stats/symbol_table.h"
+
+#include "absl/container/flat_hash_map.h"
+
+namespace Envoy {
+namespace Stats {
+
+/**
+ * Keeps running per-family memory totals, keyed by tag-extracted name, so that
+ * memory usage can be reported without walking every stat. Callers record each
+ * stat as it is created and destroyed.
+ *
+ * This class is not thread-safe; it is expected to be guarded by the lock that
+ * protects the stat container it shadows.
+ */
+class FamilyMemoryTracker {
+public:
+  enum class Type { Counter, Gauge, TextReadout, Histogram };
+
+  explicit FamilyMemoryTracker(SymbolTable& symbol_table) : symbol_table_(symbol_table) {}
+  ~FamilyMemoryTracker();
+
+  /**
+   * Records a newly created stat.
+   *
+   * @param tag_extracted_name the tag-extracted name of the stat.
+   * @param type the type of the stat.
+   * @param bytes the memory held by the stat.
+   */
+  void add(StatName tag_extracted_name, Type type, uint64_t bytes);
+
+  /**
+   * Records the destruction of a stat previously passed to add(). The family is
+   * dropped once its last stat is removed.
+   *
+   * @param tag_extracted_name the tag-extracted name of the stat.
+   * @param type the type of the stat.
+   * @param bytes the memory held by the stat, as passed to add().
+   */
+  void remove(StatName tag_extracted_name, Type type, uint64_t bytes);
+
+  /**
+   * Calls fn for each family, in no particular order.
+   */
+  void forEach(const StatFamilyMemoryFn& fn) const;
+
+  /**
+   * Drops all families.
+   */
+  void clear();
+
+  /**
+   * @return the number of families being tracked.
+   */
+  size_t size() const { return families_.size(); }
+
+  /**
+   * @return the bytes held by the encoded names and tags of a stat, as
+   *         stored by MetricHelper.
+   */
+  static uint64_t nameBytes(const Metric& metric);
+
+private:
+  static uint64_t& countFor(StatFamilyMemory& memory, Type type);
+
+  using FamilyMap = absl::flat_hash_map<StatNameStorage, StatFamilyMemory,
+                                        HeterogeneousStatNameHash, HeterogeneousStatNameEqual>;
+
+  SymbolTable& symbol_table_;
+  FamilyMap families_;
+};
+
+} // namespace Stats
+} // namespace Envoy
@@ -0,0 +1,218 @@
+#include "source/common/stats/heavy_hitter_impl.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "source/common/common/assert.h"
+#include "source/common/common/hash.h"
+#include "source/common/common/lock_guard.h"
+#include "source/common/protobuf/utility.h"
+
+namespace Envoy {
+namespace Stats {
+
+namespace {
+
+constexpr uint32_t DefaultTopK = 32;
+constexpr uint32_t DefaultCountMinWidth = 512;
+
+} // namespace
+
+HeavyHitterSketch::HeavyHitterSketch(absl::string_view name, uint32_t top_k, uint32_t width,
+                                     SymbolTable& symbol_table)
+    : name_(name), stat_name_(name, symbol_table),
+      bucket_slots_(std::make_unique<std::atomic<uint32_t>[]>(width)), slots_(top_k) {
+  ASSERT(top_k > 0 && width > 0);
+  buckets_.reserve(width);
+  for (uint32_t i = 0; i < width; ++i) {
+    buckets_.push_back(std::make_unique<HeavyHitterCounterImpl>(*this, i, symbol_table));
+  }
+}
+
+HeavyHitterSketch::~HeavyHitterSketch() = default;
+
+uint32_t HeavyHitterSketch::bucket(const std::string& name) const {
+  return HashUtil::xxHash64(name) % buckets_.size();
+}
+
+Counter& HeavyHitterSketch::counter(const std::string& name) {
+  const uint32_t index = bucket(name);
+  if (bucket_slots_[index].load(std::memory_order_acquire) == 0 &&
+      buckets_[index]->count().value() >= admission_threshold_.load(std::memory_order_relaxed)) {
+    Thread::LockGuard lock(mutex_);
+    admit(name, index, 0);
+  }
+  return *buckets_[index];
+}
+
+void HeavyHitterSketch::add(const std::string& name, uint64_t amount) {
+  if (amount == 0) {
+    return;
+  }
+  total_.add(amount);
+
+  Thread::LockGuard lock(mutex_);
+  auto it = slot_index_.find(name);
+  if (it != slot_index_.end()) {
+    slots_[it->second].counter_.add(amount);
+    return;
+  }
+  // A member whose bucket is owned by another member is only counted in the
+  // bucket, and cannot be admitted until that member is evicted.
+  const uint32_t index = bucket(name);
+  buckets_[index]->count().add(amount);
+  if (buckets_[index]->count().value() >= admission_threshold_.load(std::memory_order_relaxed)) {
+    admit(name, index, amount);
+  }
+}
+
+void HeavyHitterSketch::addToBucket(uint32_t bucket, uint64_t amount) {
+  if (amount == 0) {
+    return;
+  }
+  total_.add(amount);
+
+  // An eviction racing with this increment may credit it to the slot's new
+  // owner, or to the bucket after the slot was admitted. Either way the total
+  // stays exact and only the split between members is off.
+  const uint32_t slot = bucket_slots_[bucket].load(std::memory_order_acquire);
+  if (slot != 0) {
+    slots_[slot - 1].counter_.add(amount);
+    return;
+  }
+  buckets_[bucket]->count().add(amount);
+}
+
+uint64_t HeavyHitterSketch::bucketValue(uint32_t bucket) const {
+  const uint32_t slot = bucket_slots_[bucket].load(std::memory_order_acquire);
+  if (slot != 0) {
+    return slots_[slot - 1].counter_.value();
+  }
+  return buckets_[bucket]->count().value();
+}
+
+void HeavyHitterSketch::admit(const std::string& name, uint32_t bucket, uint64_t amount) {
+  // Another thread may have admitted a member of this bucket while we waited
+  // for the lock.
+  if (bucket_slots_[bucket].load(std::memory_order_relaxed) != 0) {
+    return;
+  }
+  const uint64_t estimate = buckets_[bucket]->count().value();
+
+  // Prefer a free slot, and otherwise the smallest one.
+  uint32_t min_index = 0;
+  for (uint32_t i = 1; i < slots_.size() && !slots_[min_index].name_.empty(); ++i) {
+    if (slots_[i].name_.empty() ||
+        slots_[i].counter_.value() < slots_[min_index].counter_.value()) {
+      min_index = i;
+    }
+  }
+
+  Slot& slot = slots_[min_index];
+  // The threshold is only refreshed on admission, so the slots may have grown since.
+  if (!slot.name_.empty() && estimate <= slot.counter_.value()) {
+    updateAdmissionThreshold();
+    return;
+  }
+  if (!slot.name_.empty()) {
+    // Fold the increments the evicted member received while holding the slot
+    // back into its bucket, keeping the bucket an upper bound, and free its name.
+    const uint64_t count = slot.counter_.value();
+    if (count > slot.base_) {
+      buckets_[slot.bucket_]->count().add(count - slot.base_);
+    }
+    bucket_slots_[slot.bucket_].store(0, std::memory_order_release);
+    slot_index_.erase(slot.name_);
+  }
+
+  slot.name_ = name;
+  slot.bucket_ = bucket;
+  slot.base_ = estimate;
+  slot_index_[slot.name_] = min_index;
+
+  // The new member starts from its bucket's count, but only this increment is
+  // reported as a delta on the next latch.
+  slot.counter_.reset();
+  slot.counter_.add(estimate - amount);
+  slot.counter_.latch();
+  slot.counter_.add(amount);
+  bucket_slots_[bucket].store(min_index + 1, std::memory_order_release);
+  updateAdmissionThreshold();
+}
+
+void HeavyHitterSketch::updateAdmissionThreshold() {
+  uint64_t threshold = std::numeric_limits<uint64_t>::max();
+  for (const Slot& slot : slots_) {
+    if (slot.name_.empty()) {
+      threshold = 0;
+      break;
+    }
+    threshold = std::min(threshold, slot.counter_.value() + 1);
+  }
+  admission_threshold_.store(threshold, std::memory_order_relaxed);
+}
+
+void HeavyHitterSketch::forEachCounter(
+    const std::function<void(absl::string_view, PrimitiveCounter&)>& fn) {
+  Thread::LockGuard lock(mutex_);
+  for (Slot& slot : slots_) {
+    if (!slot.name_.empty()) {
+      fn(slot.name_, slot.counter_);
+    }
+  }
+  fn(name_, total_);
+}
+
+HeavyHitterStatsImpl::HeavyHitterStatsImpl(const envoy::config::metrics::v3::StatsConfig& config,
+                                           SymbolTable& symbol_table,
+                                           Server::Configuration::CommonFactoryContext& context)
+    : symbol_table_(symbol_table) {
+  for (const auto& heavy_hitter : config.heavy_hitter_stats()) {
+    configs_.emplace_back(
+        Matchers::StringMatcherImpl(heavy_hitter.match(), context),
+        std::make_unique<HeavyHitterSketch>(
+            heavy_hitter.name(), PROTOBUF_GET_WRAPPED_OR_DEFAULT(heavy_hitter, top_k, DefaultTopK),
+            PROTOBUF_GET_WRAPPED_OR_DEFAULT(heavy_hitter, count_min_width, DefaultCountMinWidth),
+            symbol_table_));
+  }
+}
+
+HeavyHitterSketch* HeavyHitterStatsImpl::findSketch(absl::string_view name) const {
+  for (const auto& config : configs_) {
+    if (config.first.match(name)) {
+      return config.second.get();
+    }
+  }
+  return nullptr;
+}
+
+Counter* HeavyHitterStatsImpl::findCounter(StatName name) {
+  if (configs_.empty()) {
+    return nullptr;
+  }
+  const std::string name_str = symbol_table_.toString(name);
+  HeavyHitterSketch* sketch = findSketch(name_str);
+  return sketch != nullptr ? &sketch->counter(name_str) : nullptr;
+}
+
+bool HeavyHitterStatsImpl::addPrimitiveCounter(absl::string_view name, uint64_t delta) {
+  if (configs_.empty()) {
+    return false;
+  }
+  HeavyHitterSketch* sketch = findSketch(name);
+  if (sketch == nullptr) {
+    return false;
+  }
+  sketch->add(std::string(name), delta);
+  return true;
+}
+
+void HeavyHitterStatsImpl::forEachCounter(
+    const std::function<void(absl::string_view name, PrimitiveCounter& counter)>& fn) {
+  for (const auto& config : configs_) {
+    config.second->forEachCounter(fn);
+  }
+}
+
+} // namespace Stats
+} // namespace Envoy
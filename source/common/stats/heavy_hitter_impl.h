@@ -0,0 +1,178 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/config/metrics/v3/stats.pb.h"
+#include "envoy/stats/heavy_hitter.h"
+#include "envoy/stats/primitive_stats.h"
+#include "envoy/stats/stats.h"
+
+#include "source/common/common/matchers.h"
+#include "source/common/common/non_copyable.h"
+#include "source/common/common/thread.h"
+#include "source/common/stats/symbol_table.h"
+
+#include "absl/container/flat_hash_map.h"
+
+namespace Envoy {
+namespace Stats {
+
+class HeavyHitterCounterImpl;
+
+/**
+ * Fixed-size summary of a family of counters. The members of the family are
+ * hashed into width buckets, each with its own counter handle, and these
+ * buckets form a one-row Count-Min sketch: a bucket's count is an upper bound
+ * on the count of every member hashed into it. The busiest members are kept in
+ * a Space-Saving summary of top_k slots. A member holding a slot owns its
+ * bucket, so increments through the bucket's handle touch only the slot.
+ *
+ * Only members holding a slot have their name kept. A member is admitted,
+ * evicting the smallest slot, when its name is seen, i.e. when it is looked up
+ * or a primitive counter is added, and its bucket's count exceeds that slot's
+ * count. The evicted slot's increments are folded back into its bucket, so the
+ * bucket remains an upper bound. The memory used is independent of the number
+ * of members.
+ */
+class HeavyHitterSketch : NonCopyable {
+public:
+  HeavyHitterSketch(absl::string_view name, uint32_t top_k, uint32_t width,
+                    SymbolTable& symbol_table);
+  ~HeavyHitterSketch();
+
+  /**
+   * @param name the full name of the member.
+   * @return the handle of the member's bucket, after admitting the member if it
+   *         qualifies.
+   */
+  Counter& counter(const std::string& name);
+
+  /**
+   * Adds to the count of a member that has no handle, such as a per-host counter.
+   * @param name the full name of the member.
+   * @param amount the amount to add.
+   */
+  void add(const std::string& name, uint64_t amount);
+
+  /**
+   * Calls fn for each member holding a slot, and then for the total of all
+   * members, under the sketch lock.
+   */
+  void forEachCounter(const std::function<void(absl::string_view, PrimitiveCounter&)>& fn);
+
+  /**
+   * @return the exact total of all members.
+   */
+  uint64_t total() const { return total_.value(); }
+
+  // Used by the bucket handles.
+  void addToBucket(uint32_t bucket, uint64_t amount);
+  uint64_t bucketValue(uint32_t bucket) const;
+  StatName statName() const { return stat_name_.statName(); }
+
+private:
+  struct Slot {
+    PrimitiveCounter counter_;
+    // The following are guarded by HeavyHitterSketch::mutex_.
+    std::string name_;
+    uint32_t bucket_{0};
+    // The part of the count that is already reflected in the bucket.
+    uint64_t base_{0};
+  };
+
+  uint32_t bucket(const std::string& name) const;
+  // Admits a member whose name has been seen, if its bucket is free and busy enough.
+  void admit(const std::string& name, uint32_t bucket, uint64_t amount)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void updateAdmissionThreshold() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const std::string name_;
+  StatNameManagedStorage stat_name_;
+  PrimitiveCounter total_;
+  std::vector<std::unique_ptr<HeavyHitterCounterImpl>> buckets_;
+  // The slot owning each bucket, as the slot index plus one, or 0 if none.
+  std::unique_ptr<std::atomic<uint32_t>[]> bucket_slots_;
+  std::vector<Slot> slots_;
+  absl::flat_hash_map<std::string, uint32_t> slot_index_ ABSL_GUARDED_BY(mutex_);
+  // The count a bucket must reach for its member to be admitted: 0 while a
+  // slot is free, and one more than the smallest slot count otherwise, as of
+  // the last admission. Lookups of members below it skip the lock.
+  std::atomic<uint64_t> admission_threshold_{0};
+  Thread::MutexBasicLockable mutex_;
+};
+
+using HeavyHitterSketchPtr = std::unique_ptr<HeavyHitterSketch>;
+
+/**
+ * Counter handle for one bucket of a sketched family. It is shared by every
+ * member hashed into the bucket, and is named after the family. Handles are
+ * hidden, as they are reported through the sketch instead.
+ */
+class HeavyHitterCounterImpl : public Counter {
+public:
+  HeavyHitterCounterImpl(HeavyHitterSketch& sketch, uint32_t bucket, SymbolTable& symbol_table)
+      : sketch_(sketch), bucket_(bucket), symbol_table_(symbol_table) {}
+
+  // The count of the members of the bucket that do not hold a slot.
+  PrimitiveCounter& count() { return count_; }
+
+  // Counter
+  void add(uint64_t amount) override { sketch_.addToBucket(bucket_, amount); }
+  void inc() override { add(1); }
+  uint64_t latch() override { return 0; }
+  void reset() override {}
+  uint64_t value() const override { return sketch_.bucketValue(bucket_); }
+
+  // Metric
+  std::string name() const override { return symbol_table_.toString(statName()); }
+  StatName statName() const override { return sketch_.statName(); }
+  TagVector tags() const override { return {}; }
+  std::string tagExtractedName() const override { return name(); }
+  StatName tagExtractedStatName() const override { return statName(); }
+  void iterateTagStatNames(const TagStatNameIterFn&) const override {}
+  bool used() const override { return value() > 0; }
+  bool hidden() const override { return true; }
+  SymbolTable& symbolTable() override { return symbol_table_; }
+  const SymbolTable& constSymbolTable() const override { return symbol_table_; }
+
+  // RefcountInterface
+  void incRefCount() override { refcount_helper_.incRefCount(); }
+  bool decRefCount() override { return refcount_helper_.decRefCount(); }
+  uint32_t use_count() const override { return refcount_helper_.use_count(); }
+
+private:
+  RefcountHelper refcount_helper_;
+  HeavyHitterSketch& sketch_;
+  const uint32_t bucket_;
+  SymbolTable& symbol_table_;
+  PrimitiveCounter count_;
+};
+
+class HeavyHitterStatsImpl : public HeavyHitterStats {
+public:
+  HeavyHitterStatsImpl(const envoy::config::metrics::v3::StatsConfig& config,
+                       SymbolTable& symbol_table,
+                       Server::Configuration::CommonFactoryContext& context);
+
+  // HeavyHitterStats
+  Counter* findCounter(StatName name) override;
+  bool addPrimitiveCounter(absl::string_view name, uint64_t delta) override;
+  void forEachCounter(
+      const std::function<void(absl::string_view name, PrimitiveCounter& counter)>& fn) override;
+
+private:
+  using Config = std::pair<Matchers::StringMatcherImpl, HeavyHitterSketchPtr>;
+
+  // Returns the sketch of the family of a name, or nullptr if none.
+  HeavyHitterSketch* findSketch(absl::string_view name) const;
+
+  SymbolTable& symbol_table_;
+  std::vector<Config> configs_;
+};
+
+} // namespace Stats
+} // namespace Envoy
@@ -203,6 +203,13 @@ public:
     }
   }
 
+  void forEachFamilyMemory(const StatFamilyMemoryFn& fn) const override {
+    alloc_.forEachFamilyMemory(fn);
+  }
+
+  void forEachHeavyHitterCounter(const std::function<void(PrimitiveCounterSnapshot&&)>&) override {}
+  bool addHeavyHitterCounter(absl::string_view, uint64_t) override { return false; }
+
   void forEachSinkedCounter(SizeFn f_size, StatFn<Counter> f_stat) const override {
     forEachCounter(f_size, f_stat);
   }
@@ -59,6 +59,7 @@ TagProducerImpl::TagProducerImpl(const envoy::config::metrics::v3::StatsConfig&
       fixed_tags_.push_back(Tag{name, tag_specifier.fixed_value()});
     }
   }
+  compileRegexSet();
 }
 
 absl::Status TagProducerImpl::addExtractorsMatching(absl::string_view name) {
@@ -103,19 +104,81 @@ void TagProducerImpl::addExtractor(TagExtractorPtr extractor) {
   }
 }
 
+void TagProducerImpl::compileRegexSet() {
+  std::vector<ExtractorEntry*> entries;
+  for (ExtractorEntry& entry : tag_extractors_without_prefix_) {
+    entries.push_back(&entry);
+  }
+  for (auto& [prefix, prefix_entries] : tag_extractor_prefix_map_) {
+    for (ExtractorEntry& entry : prefix_entries) {
+      entries.push_back(&entry);
+    }
+  }
+
+  auto regex_set = std::make_unique<re2::RE2::Set>(re2::RE2::DefaultOptions, re2::RE2::UNANCHORED);
+  for (ExtractorEntry* entry : entries) {
+    // Only RE2 extractors can be screened by the set; the others are always tried.
+    const auto* re2_extractor = dynamic_cast<const TagExtractorRe2Impl*>(entry->extractor_.get());
+    if (re2_extractor == nullptr) {
+      continue;
+    }
+    const int index = regex_set->Add(re2_extractor->pattern(), nullptr);
+    if (index >= 0) {
+      entry->regex_set_index_ = index;
+      regex_set_size_ = index + 1;
+    }
+  }
+  if (regex_set_size_ == 0) {
+    return;
+  }
+  if (!regex_set->Compile()) {
+    // Leave every extractor to its own regex.
+    for (ExtractorEntry* entry : entries) {
+      entry->regex_set_index_ = NoRegexSetIndex;
+    }
+    regex_set_size_ = 0;
+    return;
+  }
+  regex_set_ = std::move(regex_set);
+}
+
+TagProducerImpl::RegexSetMatches TagProducerImpl::matchRegexSet(absl::string_view stat_name) const {
+  RegexSetMatches matches(regex_set_size_, false);
+  if (regex_set_ == nullptr) {
+    return matches;
+  }
+  std::vector<int> matched_indexes;
+  re2::RE2::Set::ErrorInfo error_info;
+  if (regex_set_->Match(stat_name, &matched_indexes, &error_info)) {
+    for (const int index : matched_indexes) {
+      matches[index] = true;
+    }
+  } else if (error_info.kind != re2::RE2::Set::kNoError) {
+    // The DFA ran out of memory; fall back to trying every extractor.
+    ENVOY_LOG_EVERY_POW_2_MISC(warn, "Unable to match stat name against tag extractor regexes");
+    matches.assign(regex_set_size_, true);
+  }
+  return matches;
+}
+
 void TagProducerImpl::forEachExtractorMatching(
     absl::string_view stat_name, std::function<void(const TagExtractorPtr&)> f) const {
-  IntervalSetImpl<size_t> remove_characters;
-  for (const TagExtractorPtr& tag_extractor : tag_extractors_without_prefix_) {
-    f(tag_extractor);
+  const RegexSetMatches matches = matchRegexSet(stat_name);
+  const auto visit = [&matches, &f](const ExtractorEntry& entry) {
+    if (entry.regex_set_index_ == NoRegexSetIndex || matches[entry.regex_set_index_]) {
+      f(entry.extractor_);
+    }
+  };
+  for (const ExtractorEntry& entry : tag_extractors_without_prefix_) {
+    visit(entry);
   }
   const absl::string_view::size_type dot = stat_name.find('.');
   if (dot != std::string::npos) {
     const absl::string_view token = absl::string_view(stat_name.data(), dot);
     const auto iter = tag_extractor_prefix_map_.find(token);
     if (iter != tag_extractor_prefix_map_.end()) {
-      for (const TagExtractorPtr& tag_extractor : iter->second) {
-        f(tag_extractor);
+      for (const ExtractorEntry& entry : iter->second) {
+        visit(entry);
       }
     }
   }
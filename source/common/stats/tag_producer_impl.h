@@ -16,8 +16,10 @@
 #include "source/common/protobuf/protobuf.h"
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
 #include "absl/container/node_hash_set.h"
 #include "absl/strings/string_view.h"
+#include "re2/set.h"
 
 namespace Envoy {
 namespace Stats {
@@ -57,6 +59,19 @@ private:
 
   friend class DefaultTagRegexTester;
 
+  // Index of an extractor whose regex is not part of regex_set_, and so is always tried.
+  static constexpr int NoRegexSetIndex = -1;
+
+  struct ExtractorEntry {
+    explicit ExtractorEntry(TagExtractorPtr extractor) : extractor_(std::move(extractor)) {}
+
+    TagExtractorPtr extractor_;
+    int regex_set_index_{NoRegexSetIndex};
+  };
+
+  // Whether each regex in regex_set_ matches a stat name, indexed by regex_set_index_.
+  using RegexSetMatches = absl::InlinedVector<bool, 32>;
+
   /**
    * Adds a TagExtractor to the collection of tags, tracking prefixes to help make
    * produceTags run efficiently by trying only extractors that have a chance to match.
@@ -87,6 +102,20 @@ private:
    */
   absl::Status addDefaultExtractors(const envoy::config::metrics::v3::StatsConfig& config);
 
+  /**
+   * Compiles the regexes of all RE2 extractors into a single RE2::Set. A stat name is then
+   * scanned once to find every regex that matches it, and the other RE2 extractors are skipped
+   * rather than each running its own regex on the name. Called once all extractors are added.
+   */
+  void compileRegexSet();
+
+  /**
+   * @param stat_name the stat name.
+   * @return which regexes in regex_set_ match stat_name. If the set cannot be matched, all
+   *         regexes are reported as matching so that every extractor is still tried.
+   */
+  RegexSetMatches matchRegexSet(absl::string_view stat_name) const;
+
   /**
    * Iterates over every tag extractor that might possibly match stat_name, calling
    * callback f for each one. This is broken out this way to reduce code redundancy
@@ -95,7 +124,7 @@ private:
    *   1. Finding the first '.' separated token in stat_name.
    *   2. Collecting the TagExtractors whose regexes have that same prefix "^prefix\\."
    *   3. Collecting also the TagExtractors whose regexes don't start with any prefix.
-   * In the future, we may also do substring searches in some cases.
+   *   4. Dropping the RE2 extractors whose regex regex_set_ found not to match stat_name.
    * See DefaultTagRegexTester::produceTagsReverse in test/common/stats/stats_impl_test.cc.
    *
    * @param stat_name const std::string& the stat name.
@@ -104,12 +133,16 @@ private:
   void forEachExtractorMatching(absl::string_view stat_name,
                                 std::function<void(const TagExtractorPtr&)> f) const;
 
-  std::vector<TagExtractorPtr> tag_extractors_without_prefix_;
+  std::vector<ExtractorEntry> tag_extractors_without_prefix_;
 
   // Maps a prefix word extracted out of a regex to a vector of TagExtractors. Note that
   // the storage for the prefix string is owned by the TagExtractor, which, depending on
   // implementation, may need make a copy of the prefix.
-  absl::flat_hash_map<absl::string_view, std::vector<TagExtractorPtr>> tag_extractor_prefix_map_;
+  absl::flat_hash_map<absl::string_view, std::vector<ExtractorEntry>> tag_extractor_prefix_map_;
+
+  // All RE2 extractor regexes, or nullptr if there are none.
+  std::unique_ptr<re2::RE2::Set> regex_set_;
+  int regex_set_size_{0};
 
   // Keep track of which names have extractors. If an extractor is added and there's
   // already one for that name, we set a bit in the extractor so we can decide whether
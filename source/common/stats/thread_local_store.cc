@@ -33,7 +33,8 @@ ThreadLocalStoreImpl::ThreadLocalStoreImpl(Allocator& alloc)
       histogram_settings_(std::make_unique<HistogramSettingsImpl>()),
       null_counter_(alloc.symbolTable()), null_gauge_(alloc.symbolTable()),
       null_histogram_(alloc.symbolTable()), null_text_readout_(alloc.symbolTable()),
-      well_known_tags_(alloc.symbolTable().makeSet("well_known_tags")) {
+      well_known_tags_(alloc.symbolTable().makeSet("well_known_tags")),
+      histogram_memory_(alloc.symbolTable()) {
   for (const auto& desc : Config::TagNames::get().descriptorVec()) {
     well_known_tags_->rememberBuiltin(desc.name_);
   }
@@ -227,6 +228,7 @@ void ThreadLocalStoreImpl::shutdownThreading() {
   }
   histogram_set_.clear();
   sinked_histograms_.clear();
+  histogram_memory_.clear();
 }
 
 void ThreadLocalStoreImpl::mergeHistograms(PostMergeCb merge_complete_cb) {
@@ -486,7 +488,8 @@ StatType& ThreadLocalStoreImpl::ScopeImpl::safeMakeStat(
     StatNameHashMap<RefcountPtr<StatType>>& central_cache_map,
     StatsMatcher::FastResult fast_reject_result, StatNameStorageSet& central_rejected_stats,
     MakeStatFn<StatType> make_stat, StatRefMap<StatType>* tls_cache,
-    StatNameHashSet* tls_rejected_stats, StatType& null_stat) {
+    StatNameHashSet* tls_rejected_stats, StatType& null_stat,
+    FindUncachedStatFn<StatType> find_uncached_stat) {
 
   if (tls_rejected_stats != nullptr &&
       tls_rejected_stats->find(full_stat_name) != tls_rejected_stats->end()) {
@@ -512,6 +515,11 @@ StatType& ThreadLocalStoreImpl::ScopeImpl::safeMakeStat(
                                                central_rejected_stats, tls_rejected_stats)) {
     return null_stat;
   } else {
+    StatType* uncached_stat =
+        find_uncached_stat != nullptr ? find_uncached_stat(full_stat_name) : nullptr;
+    if (uncached_stat != nullptr) {
+      return *uncached_stat;
+    }
     StatNameTagHelper tag_helper(parent_, name_no_tags, stat_name_tags);
 
     RefcountPtr<StatType> stat = make_stat(
@@ -564,7 +572,14 @@ Counter& ThreadLocalStoreImpl::ScopeImpl::counterFromStatNameWithTags(
          const StatNameTagVector& tags) -> CounterSharedPtr {
         return allocator.makeCounter(name, tag_extracted_name, tags);
       },
-      tls_cache, tls_rejected_stats, parent_.null_counter_);
+      tls_cache, tls_rejected_stats, parent_.null_counter_,
+      [this](StatName name) -> Counter* {
+        // Counters in sketched families are not allocated or cached
+        // individually; they share the handles owned by the sketch.
+        return parent_.heavy_hitter_stats_ != nullptr
+                   ? parent_.heavy_hitter_stats_->findCounter(name)
+                   : nullptr;
+      });
 }
 
 void ThreadLocalStoreImpl::deliverHistogramToSinks(const Histogram& histogram, uint64_t value) {
@@ -687,6 +702,9 @@ Histogram& ThreadLocalStoreImpl::ScopeImpl::histogramFromStatNameWithTags(
                                        *buckets, parent_.next_histogram_id_++);
         if (!parent_.shutting_down_) {
           parent_.histogram_set_.insert(stat.get());
+          parent_.histogram_memory_.add(stat->tagExtractedStatName(),
+                                        FamilyMemoryTracker::Type::Histogram,
+                                        ParentHistogramImpl::memoryBytes(*stat));
           if (parent_.sink_predicates_.has_value() &&
               parent_.sink_predicates_->includeHistogram(*stat)) {
             parent_.sinked_histograms_.insert(stat.get());
@@ -821,13 +839,22 @@ ThreadLocalHistogramImpl::~ThreadLocalHistogramImpl() {
 void ThreadLocalHistogramImpl::recordValue(uint64_t value) {
   ASSERT(std::this_thread::get_id() == created_thread_id_);
   hist_insert_intscale(histograms_[current_active_], value, 0, 1);
-  used_ = true;
+  has_samples_[current_active_] = true;
+  // used_ is only read on the main thread while merging, which is ordered after this by the
+  // beginMerge() post, so there is no need for a sequentially consistent store.
+  used_.store(true, std::memory_order_relaxed);
 }
 
-void ThreadLocalHistogramImpl::merge(histogram_t* target) {
-  histogram_t** other_histogram = &histograms_[otherHistogramIndex()];
+bool ThreadLocalHistogramImpl::merge(histogram_t* target) {
+  const uint64_t other_index = otherHistogramIndex();
+  if (!has_samples_[other_index]) {
+    return false;
+  }
+  histogram_t** other_histogram = &histograms_[other_index];
   hist_accumulate(target, other_histogram, 1);
   hist_clear(*other_histogram);
+  has_samples_[other_index] = false;
+  return true;
 }
 
 ParentHistogramImpl::ParentHistogramImpl(StatName name, Histogram::Unit unit,
@@ -889,6 +916,8 @@ bool ThreadLocalStoreImpl::decHistogramRefCount(ParentHistogramImpl& hist,
       const size_t count = histogram_set_.erase(hist.statName());
       ASSERT(shutting_down_ || count == 1);
       sinked_histograms_.erase(&hist);
+      histogram_memory_.remove(hist.tagExtractedStatName(), FamilyMemoryTracker::Type::Histogram,
+                               ParentHistogramImpl::memoryBytes(hist));
     }
     return true;
   }
@@ -915,19 +944,29 @@ bool ParentHistogramImpl::hidden() const { return false; }
 void ParentHistogramImpl::merge() {
   Thread::ReleasableLockGuard lock(merge_lock_);
   if (merged_ || usedLockHeld()) {
-    hist_clear(interval_histogram_);
+    if (!interval_empty_) {
+      hist_clear(interval_histogram_);
+    }
     // Here we could copy all the pointers to TLS histograms in the tls_histogram_ list,
     // then release the lock before we do the actual merge. However it is not a big deal
     // because the tls_histogram merge is not that expensive as it is a single histogram
     // merge and adding TLS histograms is rare.
+    bool has_samples = false;
     for (const TlsHistogramSharedPtr& tls_histogram : tls_histograms_) {
-      tls_histogram->merge(interval_histogram_);
+      has_samples |= tls_histogram->merge(interval_histogram_);
     }
     // Since TLS merge is done, we can release the lock here.
     lock.release();
-    hist_accumulate(cumulative_histogram_, &interval_histogram_, 1);
-    cumulative_statistics_.refresh(cumulative_histogram_);
-    interval_statistics_.refresh(interval_histogram_);
+    // Most histograms are idle in most intervals. Computing quantiles and buckets is the
+    // expensive part of a merge, so skip it when the result would not change.
+    if (has_samples) {
+      hist_accumulate(cumulative_histogram_, &interval_histogram_, 1);
+      cumulative_statistics_.refresh(cumulative_histogram_);
+    }
+    if (has_samples || !interval_empty_) {
+      interval_statistics_.refresh(interval_histogram_);
+    }
+    interval_empty_ = !has_samples;
     merged_ = true;
   }
 }
@@ -1014,6 +1053,43 @@ void ThreadLocalStoreImpl::forEachHistogram(SizeFn f_size, StatFn<ParentHistogra
   }
 }
 
+void ThreadLocalStoreImpl::forEachFamilyMemory(const StatFamilyMemoryFn& fn) const {
+  alloc_.forEachFamilyMemory(fn);
+  Thread::LockGuard lock(hist_mutex_);
+  histogram_memory_.forEach(fn);
+}
+
+void ThreadLocalStoreImpl::forEachHeavyHitterCounter(
+    const std::function<void(PrimitiveCounterSnapshot&&)>& fn) {
+  if (heavy_hitter_stats_ == nullptr) {
+    return;
+  }
+  // Tags are extracted once per reported counter, and are kept only while the
+  // counter is reported.
+  Thread::LockGuard lock(heavy_hitter_tags_lock_);
+  HeavyHitterTagMap reported_tags;
+  heavy_hitter_stats_->forEachCounter(
+      [this, &fn, &reported_tags](absl::string_view name, PrimitiveCounter& counter) {
+        HeavyHitterTags& tags = reported_tags[std::string(name)];
+        auto it = heavy_hitter_tags_.find(name);
+        if (it != heavy_hitter_tags_.end()) {
+          tags = std::move(it->second);
+        } else {
+          tags.first = tag_producer_->produceTags(name, tags.second);
+        }
+        PrimitiveCounterSnapshot metric(counter);
+        metric.setTagExtractedName(std::string(tags.first));
+        metric.setName(std::string(name));
+        metric.setTags(tags.second);
+        fn(std::move(metric));
+      });
+  heavy_hitter_tags_ = std::move(reported_tags);
+}
+
+bool ThreadLocalStoreImpl::addHeavyHitterCounter(absl::string_view name, uint64_t delta) {
+  return heavy_hitter_stats_ != nullptr && heavy_hitter_stats_->addPrimitiveCounter(name, delta);
+}
+
 void ThreadLocalStoreImpl::forEachScope(std::function<void(std::size_t)> f_size,
                                         StatFn<const Scope> f_scope) const {
   std::vector<ScopeSharedPtr> scopes;
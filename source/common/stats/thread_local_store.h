@@ -13,6 +13,7 @@
 #include "source/common/common/hash.h"
 #include "source/common/common/thread_synchronizer.h"
 #include "source/common/stats/allocator_impl.h"
+#include "source/common/stats/family_memory.h"
 #include "source/common/stats/histogram_impl.h"
 #include "source/common/stats/null_counter.h"
 #include "source/common/stats/null_gauge.h"
@@ -37,7 +38,11 @@ public:
                            const StatNameTagVector& stat_name_tags, SymbolTable& symbol_table);
   ~ThreadLocalHistogramImpl() override;
 
-  void merge(histogram_t* target);
+  /**
+   * Merges the samples collected before the last beginMerge() into target.
+   * @return true if there were any samples to merge.
+   */
+  bool merge(histogram_t* target);
 
   /**
    * Called in the beginning of merge process. Swaps the histogram used for collection so that we do
@@ -68,6 +73,10 @@ private:
   uint64_t current_active_{0};
   histogram_t* histograms_[2];
   std::atomic<bool> used_;
+  // Whether each of histograms_ has recorded samples since it was last merged. The active entry
+  // is only written by the owning thread, and the other is only accessed while merging, after
+  // beginMerge() has been posted to the owning thread.
+  bool has_samples_[2]{false, false};
   std::thread::id created_thread_id_;
   SymbolTable& symbol_table_;
 };
@@ -96,7 +105,8 @@ public:
    * This method is called during the main stats flush process for each of the histograms. It
    * iterates through the TLS histograms and collects the histogram data of all of them
    * in to "interval_histogram". Then the collected "interval_histogram" is merged to a
-   * "cumulative_histogram".
+   * "cumulative_histogram". TLS histograms that recorded no samples are skipped, and the
+   * cumulative statistics are only recomputed when there were new samples.
    */
   void merge() override;
 
@@ -127,6 +137,14 @@ public:
   void setShuttingDown(bool shutting_down) { shutting_down_ = shutting_down; }
   bool shuttingDown() const { return shutting_down_; }
 
+  /**
+   * @return the approximate memory held by a parent histogram and its names,
+   *         excluding the circllhist buckets and the per-thread histograms.
+   */
+  static uint64_t memoryBytes(const ParentHistogramImpl& histogram) {
+    return sizeof(ParentHistogramImpl) + FamilyMemoryTracker::nameBytes(histogram);
+  }
+
 private:
   bool usedLockHeld() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(merge_lock_);
   static std::vector<Stats::ParentHistogram::Bucket>
@@ -141,6 +159,8 @@ private:
   mutable Thread::MutexBasicLockable merge_lock_;
   std::list<TlsHistogramSharedPtr> tls_histograms_ ABSL_GUARDED_BY(merge_lock_);
   bool merged_{false};
+  // True if no samples were merged into interval_histogram_ on the last merge.
+  bool interval_empty_{true};
   std::atomic<bool> shutting_down_{false};
   std::atomic<uint32_t> ref_count_{0};
   const uint64_t id_; // Index into TlsCache::histogram_cache_.
@@ -183,6 +203,10 @@ public:
   void forEachTextReadout(SizeFn f_size, StatFn<TextReadout> f_stat) const override;
   void forEachHistogram(SizeFn f_size, StatFn<ParentHistogram> f_stat) const override;
   void forEachScope(SizeFn f_size, StatFn<const Scope> f_stat) const override;
+  void forEachFamilyMemory(const StatFamilyMemoryFn& fn) const override;
+  void forEachHeavyHitterCounter(
+      const std::function<void(PrimitiveCounterSnapshot&&)>& fn) override;
+  bool addHeavyHitterCounter(absl::string_view name, uint64_t delta) override;
 
   // Stats::StoreRoot
   void addSink(Sink& sink) override { timer_sinks_.push_back(sink); }
@@ -191,6 +215,9 @@ public:
   }
   void setStatsMatcher(StatsMatcherPtr&& stats_matcher) override;
   void setHistogramSettings(HistogramSettingsConstPtr&& histogram_settings) override;
+  void setHeavyHitterStats(HeavyHitterStatsPtr&& heavy_hitter_stats) override {
+    heavy_hitter_stats_ = std::move(heavy_hitter_stats);
+  }
   void initializeThreading(Event::Dispatcher& main_thread_dispatcher,
                            ThreadLocal::Instance& tls) override;
   void shutdownThreading() override;
@@ -371,6 +398,8 @@ private:
     using MakeStatFn = std::function<RefcountPtr<StatType>(
         Allocator&, StatName name, StatName tag_extracted_name, const StatNameTagVector& tags)>;
 
+    template <class StatType> using FindUncachedStatFn = std::function<StatType*(StatName name)>;
+
     /**
      * Makes a stat either by looking it up in the central cache,
      * generating it from the parent allocator, or as a last
@@ -383,6 +412,8 @@ private:
      * @param make_stat a function to generate the stat object, called if it's not in cache.
      * @param tls_ref possibly null reference to a cache entry for this stat, which will be
      *     used if non-empty, or filled in if empty (and non-null).
+     * @param find_uncached_stat optional function called before make_stat, returning a stat
+     *     that is owned elsewhere and is not cached, or nullptr to make the stat as usual.
      */
     template <class StatType>
     StatType& safeMakeStat(StatName full_stat_name, StatName name_no_tags,
@@ -391,7 +422,8 @@ private:
                            StatsMatcher::FastResult fast_reject_result,
                            StatNameStorageSet& central_rejected_stats,
                            MakeStatFn<StatType> make_stat, StatRefMap<StatType>* tls_cache,
-                           StatNameHashSet* tls_rejected_stats, StatType& null_stat);
+                           StatNameHashSet* tls_rejected_stats, StatType& null_stat,
+                           FindUncachedStatFn<StatType> find_uncached_stat = nullptr);
 
     template <class StatType>
     using StatTypeOptConstRef = absl::optional<std::reference_wrapper<const StatType>>;
@@ -537,6 +569,12 @@ private:
   TagProducerPtr tag_producer_;
   StatsMatcherPtr stats_matcher_;
   HistogramSettingsConstPtr histogram_settings_;
+  HeavyHitterStatsPtr heavy_hitter_stats_;
+  // The tag-extracted name and tags of each counter last reported by the heavy-hitter sketches.
+  using HeavyHitterTags = std::pair<std::string, TagVector>;
+  using HeavyHitterTagMap = absl::flat_hash_map<std::string, HeavyHitterTags>;
+  Thread::MutexBasicLockable heavy_hitter_tags_lock_;
+  HeavyHitterTagMap heavy_hitter_tags_ ABSL_GUARDED_BY(heavy_hitter_tags_lock_);
   std::atomic<bool> threading_ever_initialized_{};
   std::atomic<bool> shutting_down_{};
   std::atomic<bool> merge_in_progress_{};
@@ -556,6 +594,10 @@ private:
   mutable Thread::MutexBasicLockable hist_mutex_;
   StatSet<ParentHistogramImpl> histogram_set_ ABSL_GUARDED_BY(hist_mutex_);
   StatSet<ParentHistogramImpl> sinked_histograms_ ABSL_GUARDED_BY(hist_mutex_);
+  // Per-family memory totals for the histograms in histogram_set_, retained
+  // until the histograms are freed. Counters, gauges and text readouts are
+  // tracked by the allocator.
+  FamilyMemoryTracker histogram_memory_ ABSL_GUARDED_BY(hist_mutex_);
 
   // Retain storage for deleted stats; these are no longer in maps because the
   // matcher-pattern was established after they were created. Since the stats
@@ -23,6 +23,7 @@
 #include "source/common/common/assert.h"
 #include "source/common/common/enum_to_int.h"
 #include "source/common/common/fmt.h"
+#include "source/common/common/thread.h"
 #include "source/common/common/utility.h"
 #include "source/common/config/custom_config_validators_impl.h"
 #include "source/common/config/null_grpc_mux_impl.h"
@@ -349,6 +350,8 @@ ClusterManagerImpl::ClusterManagerImpl(
           std::make_shared<SharedPool::ObjectSharedPool<
               const envoy::config::cluster::v3::Cluster::CommonLbConfig, MessageUtil, MessageUtil>>(
               main_thread_dispatcher)),
+      shared_conn_pool_registry_(
+          std::make_shared<Http::SharedConnPoolRegistry>(server.options().concurrency())),
       shutdown_(false) {
   if (admin.has_value()) {
     config_tracker_entry_ = admin->getConfigTracker().add(
@@ -1893,7 +1896,21 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ThreadLocalClusterManagerImpl
     ClusterManagerImpl& parent, Event::Dispatcher& dispatcher,
     const absl::optional<LocalClusterParams>& local_cluster_params)
     : parent_(parent), thread_local_dispatcher_(dispatcher), cdm_(dispatcher.name(), *this),
-      local_stats_(generateStats(*parent.stats_.rootScope(), dispatcher.name())) {
+      local_stats_(generateStats(*parent.stats_.rootScope(), dispatcher.name())),
+      shared_conn_pool_registry_(parent.shared_conn_pool_registry_) {
+  if (!Thread::MainThread::isMainOrTestThread()) {
+    shared_conn_pool_thread_ = std::make_shared<Http::SharedConnPoolThread>(
+        dispatcher,
+        [this](const Http::SharedConnPoolKey& key) -> Http::ConnectionPool::Instance* {
+          auto it = thread_local_clusters_.find(key.cluster_name_);
+          ClusterEntry* entry = it != thread_local_clusters_.end()
+                                    ? it->second.get()
+                                    : initializeClusterInlineIfExists(key.cluster_name_);
+          return entry != nullptr ? entry->sharedConnPool(key) : nullptr;
+        });
+    shared_conn_pool_registry_->add(*shared_conn_pool_thread_);
+  }
+
   // If local cluster is defined then we need to initialize it first.
   if (local_cluster_params.has_value()) {
     const auto& local_cluster_name = local_cluster_params->info_->name();
@@ -1911,6 +1928,11 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::~ThreadLocalClusterManagerImp
   // the local cluster. This is because non-local clusters with a zone aware load balancer have a
   // member update callback registered with the local cluster.
   ENVOY_LOG(debug, "shutting down thread local cluster manager");
+  if (shared_conn_pool_thread_ != nullptr) {
+    // Reset the streams handed off to this thread while their connection pools still exist.
+    shared_conn_pool_registry_->remove(*shared_conn_pool_thread_);
+    shared_conn_pool_thread_->shutdown();
+  }
   destroying_ = true;
   host_http_conn_pool_map_.clear();
   host_tcp_conn_pool_map_.clear();
@@ -2099,10 +2121,26 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::~ClusterEntry()
   drainConnPools();
 }
 
+Http::ConnectionPool::Instance*
+ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::sharedConnPool(
+    const Http::SharedConnPoolKey& key) {
+  // Hosts removed since the stream was handed off have had their pools drained already.
+  const HostMapConstSharedPtr host_map = priority_set_.crossPriorityHostMap();
+  if (host_map == nullptr || key.host_->address() == nullptr) {
+    return nullptr;
+  }
+  auto it = host_map->find(key.host_->address()->asString());
+  if (it == host_map->end() || it->second != key.host_) {
+    return nullptr;
+  }
+  return httpConnPoolImpl(key.host_, key.priority_, key.downstream_protocol_, nullptr, false);
+}
+
 Http::ConnectionPool::Instance*
 ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::httpConnPoolImpl(
     HostConstSharedPtr host, ResourcePriority priority,
-    absl::optional<Http::Protocol> downstream_protocol, LoadBalancerContext* context) {
+    absl::optional<Http::Protocol> downstream_protocol, LoadBalancerContext* context,
+    bool allow_shared) {
   if (!host) {
     return nullptr;
   }
@@ -2147,18 +2185,40 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::httpConnPoolImp
     context->downstreamConnection()->hashKey(hash_key);
   }
 
+  // Streams that only need the plain connections to the host may be handed off to the worker
+  // thread that owns them.
+  Http::SharedConnPoolThreadSharedPtr shared_conn_pool_owner;
+  const uint32_t shared_conn_pool_owners = cluster_info_->sharedConnectionPoolOwners();
+  if (allow_shared && shared_conn_pool_owners > 0 && parent_.shared_conn_pool_thread_ != nullptr &&
+      upstream_options->empty() && !have_transport_socket_options &&
+      !cluster_info_->connectionPoolPerDownstreamConnection()) {
+    shared_conn_pool_owner = parent_.shared_conn_pool_registry_->owner(
+        *host, shared_conn_pool_owners, *parent_.shared_conn_pool_thread_);
+    if (shared_conn_pool_owner != nullptr) {
+      // Keep the pools that hand streams off apart from the pools of the thread's own streams.
+      hash_key.push_back(uint8_t(0xff));
+    }
+  }
+
   ConnPoolsContainer& container = *parent_.getHttpConnPoolsContainer(host, true);
 
   // Note: to simplify this, we assume that the factory is only called in the scope of this
   // function. Otherwise, we'd need to capture a few of these variables by value.
   ConnPoolsContainer::ConnPools::PoolOptRef pool =
       container.pools_->getPool(priority, hash_key, [&]() {
-        auto pool = parent_.parent_.factory_.allocateConnPool(
-            parent_.thread_local_dispatcher_, host, priority, upstream_protocols,
-            alternate_protocol_options, !upstream_options->empty() ? upstream_options : nullptr,
-            have_transport_socket_options ? context->upstreamTransportSocketOptions() : nullptr,
-            parent_.parent_.time_source_, parent_.cluster_manager_state_, quic_info_,
-            parent_.getNetworkObserverRegistry());
+        Http::ConnectionPool::InstancePtr pool;
+        if (shared_conn_pool_owner != nullptr) {
+          pool = std::make_unique<Http::SharedConnPoolImpl>(
+              parent_.shared_conn_pool_thread_, shared_conn_pool_owner,
+              Http::SharedConnPoolKey{cluster_info_->name(), host, priority, downstream_protocol});
+        } else {
+          pool = parent_.parent_.factory_.allocateConnPool(
+              parent_.thread_local_dispatcher_, host, priority, upstream_protocols,
+              alternate_protocol_options, !upstream_options->empty() ? upstream_options : nullptr,
+              have_transport_socket_options ? context->upstreamTransportSocketOptions() : nullptr,
+              parent_.parent_.time_source_, parent_.cluster_manager_state_, quic_info_,
+              parent_.getNetworkObserverRegistry());
+        }
 
         pool->addIdleCallback([&parent = parent_, host, priority, hash_key]() {
           parent.httpConnPoolIsIdle(host, priority, hash_key);
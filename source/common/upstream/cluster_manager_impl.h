@@ -32,6 +32,7 @@
 #include "source/common/http/async_client_impl.h"
 #include "source/common/http/http_server_properties_cache_impl.h"
 #include "source/common/http/http_server_properties_cache_manager_impl.h"
+#include "source/common/http/shared_conn_pool.h"
 #include "source/common/quic/envoy_quic_network_observer_registry_factory.h"
 #include "source/common/quic/quic_stat_names.h"
 #include "source/common/tcp/async_tcp_client_impl.h"
@@ -628,11 +629,16 @@ private:
         drop_category_ = drop_category;
       }
 
+      // Returns the connection pool to run a stream handed off by another worker thread on.
+      Http::ConnectionPool::Instance* sharedConnPool(const Http::SharedConnPoolKey& key);
+
     private:
+      // If allow_shared is true, the returned pool may hand the streams off to another worker
+      // thread that owns the connections to the host.
       Http::ConnectionPool::Instance*
       httpConnPoolImpl(HostConstSharedPtr host, ResourcePriority priority,
                        absl::optional<Http::Protocol> downstream_protocol,
-                       LoadBalancerContext* context);
+                       LoadBalancerContext* context, bool allow_shared = true);
 
       Tcp::ConnectionPool::Instance* tcpConnPoolImpl(HostConstSharedPtr host,
                                                      ResourcePriority priority,
@@ -751,6 +757,10 @@ private:
     ClusterDiscoveryManager cdm_;
     ThreadLocalClusterManagerStats local_stats_;
 
+    // Set on worker threads, to share upstream connections with the other worker threads.
+    const Http::SharedConnPoolRegistrySharedPtr shared_conn_pool_registry_;
+    Http::SharedConnPoolThreadSharedPtr shared_conn_pool_thread_;
+
   private:
     static ThreadLocalClusterManagerStats generateStats(Stats::Scope& scope,
                                                         const std::string& thread_name);
@@ -955,6 +965,7 @@ private:
       common_lb_config_pool_;
 
   ClusterSet primary_clusters_;
+  const Http::SharedConnPoolRegistrySharedPtr shared_conn_pool_registry_;
 
   bool initialized_{};
   bool ads_mux_initialized_{};
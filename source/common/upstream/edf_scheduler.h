@@ -7,6 +7,8 @@
 
 #include "source/common/common/assert.h"
 
+#include "absl/container/flat_hash_map.h"
+
 namespace Envoy {
 namespace Upstream {
 
@@ -34,7 +36,7 @@ public:
     std::shared_ptr<C> ret = popEntry();
     if (ret) {
       prepick_list_.push_back(ret);
-      add(calculate_weight(*ret), ret);
+      push(calculate_weight(*ret), ret);
     }
     return ret;
   }
@@ -44,28 +46,46 @@ public:
       // In this case the entry was added back during peekAgain so don't re-add.
       std::shared_ptr<C> ret = prepick_list_.front().lock();
       prepick_list_.pop_front();
-      if (ret) {
+      if (ret && !isRemoved(ret)) {
         return ret;
       }
     }
     std::shared_ptr<C> ret = popEntry();
     if (ret) {
-      add(calculate_weight(*ret), ret);
+      push(calculate_weight(*ret), ret);
     }
     return ret;
   }
 
   void add(double weight, std::shared_ptr<C> entry) override {
-    ASSERT(weight > 0);
-    const double deadline = current_time_ + 1.0 / weight;
-    EDF_TRACE("Insertion {} in queue with deadline {} and weight {}.",
-              static_cast<const void*>(entry.get()), deadline, weight);
-    queue_.push({deadline, order_offset_++, entry});
-    ASSERT(queue_.top().deadline_ >= current_time_);
+    // Re-adding an entry whose removal is still pending cancels the removal,
+    // keeping its queued deadline, so that each entry is queued at most once.
+    if (!removed_.empty() && removed_.erase(entry.get()) > 0) {
+      EDF_TRACE("Cancelled removal of {}.", static_cast<const void*>(entry.get()));
+      return;
+    }
+    push(weight, std::move(entry));
   }
 
   bool empty() const override { return queue_.empty(); }
 
+  /**
+   * Removes an entry that was added to the scheduler, without rebuilding the
+   * queue. The entry is dropped lazily when it next reaches the front of the
+   * queue, so removal takes O(1) time and each pick that drops an entry takes
+   * O(log n) time. This allows membership changes to be applied as deltas
+   * rather than by creating a new scheduler.
+   * @param entry supplies the entry to remove; it must currently be in the scheduler.
+   */
+  void remove(const std::shared_ptr<C>& entry) {
+    removed_.insert_or_assign(entry.get(), entry);
+    // Removals of entries that expired before being popped are never consumed.
+    // Purge them once they outnumber the queued entries, to bound the memory.
+    if (removed_.size() > queue_.size()) {
+      absl::erase_if(removed_, [](const auto& removed) { return removed.second.expired(); });
+    }
+  }
+
   // Creates an EdfScheduler with the given weights and their corresponding
   // entries, and emulating a number of initial picks to be performed. Note that
   // the internal state of the scheduler will be very similar to creating an empty
@@ -188,6 +208,21 @@ private:
         queue_.pop();
         continue;
       }
+      if (!removed_.empty()) {
+        auto it = removed_.find(ret.get());
+        if (it != removed_.end()) {
+          // The removal may be stale, left by an expired entry whose address
+          // has since been reused, so only drop the entry if it is the one
+          // that was removed.
+          const bool is_removed = it->second.lock() == ret;
+          removed_.erase(it);
+          if (is_removed) {
+            EDF_TRACE("Entry has been removed, repick.");
+            queue_.pop();
+            continue;
+          }
+        }
+      }
       ASSERT(edf_entry.deadline_ >= current_time_);
       current_time_ = edf_entry.deadline_;
       EDF_TRACE("Picked {}, current_time_={}.", static_cast<const void*>(ret.get()), current_time_);
@@ -196,12 +231,29 @@ private:
     }
   }
 
+  void push(double weight, std::shared_ptr<C> entry) {
+    ASSERT(weight > 0);
+    const double deadline = current_time_ + 1.0 / weight;
+    EDF_TRACE("Insertion {} in queue with deadline {} and weight {}.",
+              static_cast<const void*>(entry.get()), deadline, weight);
+    queue_.push({deadline, order_offset_++, entry});
+    ASSERT(queue_.top().deadline_ >= current_time_);
+  }
+
+  bool isRemoved(const std::shared_ptr<C>& entry) const {
+    if (removed_.empty()) {
+      return false;
+    }
+    auto it = removed_.find(entry.get());
+    return it != removed_.end() && it->second.lock() == entry;
+  }
+
   struct EdfEntry {
     double deadline_;
     // Tie breaker for entries with the same deadline. This is used to provide FIFO behavior.
     uint64_t order_offset_;
-    // We only hold a weak pointer, since we don't support a remove operator. This allows entries to
-    // be lazily unloaded from the queue.
+    // We only hold a weak pointer, so that entries are lazily unloaded from the queue once they are
+    // destroyed, as well as when they are removed via remove().
     std::weak_ptr<C> entry_;
 
     // Flip < direction to make this a min queue.
@@ -226,6 +278,8 @@ private:
   // Min priority queue for EDF.
   std::priority_queue<EdfEntry> queue_;
   std::list<std::weak_ptr<C>> prepick_list_;
+  // Entries removed via remove() that are still queued, keyed by address.
+  absl::flat_hash_map<const C*, std::weak_ptr<C>> removed_;
 };
 
 #undef EDF_DEBUG
@@ -185,7 +185,8 @@ void HostUtility::forEachHostMetric(
       const std::string cluster_name =
           Stats::Utility::sanitizeStatsName(cluster_info->observabilityName());
 
-      const Stats::TagVector& fixed_tags = cluster_info->statsScope().store().fixedTags();
+      Stats::Store& store = cluster_info->statsScope().store();
+      const Stats::TagVector& fixed_tags = store.fixedTags();
 
       for (auto& host_set : cluster_ref.get().prioritySet().hostSetsPerPriority()) {
         for (auto& host : host_set->hosts()) {
@@ -220,6 +221,10 @@ void HostUtility::forEachHostMetric(
             Stats::PrimitiveCounterSnapshot metric(primitive.get());
             set_metric_metadata(metric_name, metric);
 
+            // Counters of heavy-hitter families are reported through their sketch.
+            if (store.addHeavyHitterCounter(metric.name(), metric.delta())) {
+              continue;
+            }
             counter_cb(std::move(metric));
           }
 
@@ -1,6 +1,8 @@
 #include "source/common/upstream/outlier_detection_impl.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -15,6 +17,7 @@
 #include "source/common/common/assert.h"
 #include "source/common/common/enum_to_int.h"
 #include "source/common/common/fmt.h"
+#include "source/common/common/thread.h"
 #include "source/common/common/utility.h"
 #include "source/common/http/codes.h"
 #include "source/common/protobuf/utility.h"
@@ -65,8 +68,52 @@ void DetectorHostMonitorImpl::updateCurrentSuccessRateBucket() {
   local_origin_sr_monitor_.updateCurrentSuccessRateBucket();
 }
 
+double DetectorHostMonitorImpl::successRate(SuccessRateMonitorType type) const {
+  if (batched_block_ == nullptr) {
+    return getSRMonitor(type).getSuccessRate();
+  }
+  const uint32_t slot = batchedSlot();
+  std::shared_ptr<DetectorImpl> detector = detector_.lock();
+  if (slot == BatchedResultCounters::InvalidSlot || !detector) {
+    return -1;
+  }
+  return detector->batchedResultCounters()->successRate(type, slot);
+}
+
+void DetectorHostMonitorImpl::setBatchedSlot(BatchedResultCounters::BlockSharedPtr block,
+                                             uint32_t slot) {
+  batched_block_ = std::move(block);
+  batched_slot_.store(slot, std::memory_order_relaxed);
+}
+
+void DetectorHostMonitorImpl::incTotalReqCounter(SuccessRateMonitorType type) {
+  if (batched_block_ == nullptr) {
+    getSRMonitor(type).incTotalReqCounter();
+    return;
+  }
+  const uint32_t slot = batchedSlot();
+  if (slot != BatchedResultCounters::InvalidSlot) {
+    BatchedResultCounters::threadCounters(*batched_block_, slot)
+        .total_request_counter_[enumToInt(type)]
+        .fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void DetectorHostMonitorImpl::incSuccessReqCounter(SuccessRateMonitorType type) {
+  if (batched_block_ == nullptr) {
+    getSRMonitor(type).incSuccessReqCounter();
+    return;
+  }
+  const uint32_t slot = batchedSlot();
+  if (slot != BatchedResultCounters::InvalidSlot) {
+    BatchedResultCounters::threadCounters(*batched_block_, slot)
+        .success_request_counter_[enumToInt(type)]
+        .fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
 void DetectorHostMonitorImpl::putHttpResponseCode(uint64_t response_code) {
-  external_origin_sr_monitor_.incTotalReqCounter();
+  incTotalReqCounter(SuccessRateMonitorType::ExternalOrigin);
   if (Http::CodeUtility::is5xx(response_code)) {
     std::shared_ptr<DetectorImpl> detector = detector_.lock();
     if (!detector) {
@@ -88,7 +135,7 @@ void DetectorHostMonitorImpl::putHttpResponseCode(uint64_t response_code) {
       detector->onConsecutive5xx(host_.lock());
     }
   } else {
-    external_origin_sr_monitor_.incSuccessReqCounter();
+    incSuccessReqCounter(SuccessRateMonitorType::ExternalOrigin);
     consecutive_5xx_ = 0;
     consecutive_gateway_failure_ = 0;
   }
@@ -185,7 +232,7 @@ void DetectorHostMonitorImpl::localOriginFailure() {
     // It's possible for the cluster/detector to go away while we still have a host in use.
     return;
   }
-  local_origin_sr_monitor_.incTotalReqCounter();
+  incTotalReqCounter(SuccessRateMonitorType::LocalOrigin);
   if (++consecutive_local_origin_failure_ ==
       detector->runtime().snapshot().getInteger(
           ConsecutiveLocalOriginFailureRuntime,
@@ -201,8 +248,8 @@ void DetectorHostMonitorImpl::localOriginNoFailure() {
     return;
   }
 
-  local_origin_sr_monitor_.incTotalReqCounter();
-  local_origin_sr_monitor_.incSuccessReqCounter();
+  incTotalReqCounter(SuccessRateMonitorType::LocalOrigin);
+  incSuccessReqCounter(SuccessRateMonitorType::LocalOrigin);
 
   resetConsecutiveLocalOriginFailure();
 }
@@ -261,7 +308,8 @@ DetectorConfig::DetectorConfig(const envoy::config::cluster::v3::OutlierDetectio
       max_ejection_time_jitter_ms_(static_cast<uint64_t>(PROTOBUF_GET_MS_OR_DEFAULT(
           config, max_ejection_time_jitter, DEFAULT_MAX_EJECTION_TIME_JITTER_MS))),
       successful_active_health_check_uneject_host_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(
-          config, successful_active_health_check_uneject_host, true)) {}
+          config, successful_active_health_check_uneject_host, true)),
+      batched_evaluation_(config.batched_evaluation()) {}
 
 DetectorImpl::DetectorImpl(const Cluster& cluster,
                            const envoy::config::cluster::v3::OutlierDetection& config,
@@ -275,6 +323,9 @@ DetectorImpl::DetectorImpl(const Cluster& cluster,
   // Insert success rate initial numbers for each type of SR detector
   external_origin_sr_num_ = {-1, -1};
   local_origin_sr_num_ = {-1, -1};
+  if (config_.batchedEvaluation()) {
+    batched_results_ = std::make_unique<BatchedResultCounters>();
+  }
 }
 
 DetectorImpl::~DetectorImpl() {
@@ -336,6 +387,11 @@ void DetectorImpl::initialize(Cluster& cluster) {
             ejections_active_helper_.dec();
           }
 
+          if (batched_results_ != nullptr) {
+            DetectorHostMonitorImpl* monitor = host_monitors_[host];
+            batched_results_->removeHost(monitor->batchedSlot());
+            monitor->releaseBatchedSlot();
+          }
           host_monitors_.erase(host);
         }
         return absl::OkStatus();
@@ -347,6 +403,10 @@ void DetectorImpl::initialize(Cluster& cluster) {
 void DetectorImpl::addHostMonitor(HostSharedPtr host) {
   ASSERT(host_monitors_.count(host) == 0);
   DetectorHostMonitorImpl* monitor = new DetectorHostMonitorImpl(shared_from_this(), host);
+  if (batched_results_ != nullptr) {
+    const uint32_t slot = batched_results_->addHost(host);
+    monitor->setBatchedSlot(batched_results_->block(slot), slot);
+  }
   host_monitors_[host] = monitor;
   host->setOutlierDetector(DetectorHostMonitorPtr{monitor});
 }
@@ -667,6 +727,14 @@ void DetectorImpl::processSuccessRateEjections(
     return;
   }
 
+  if (batched_results_ != nullptr) {
+    processBatchedSuccessRateEjections(monitor_type, success_rate_minimum_hosts,
+                                       success_rate_request_volume,
+                                       failure_percentage_minimum_hosts,
+                                       failure_percentage_request_volume);
+    return;
+  }
+
   // reserve upper bound of vector size to avoid reallocation.
   valid_success_rate_hosts.reserve(host_monitors_.size());
   valid_failure_percentage_hosts.reserve(host_monitors_.size());
@@ -744,11 +812,106 @@ void DetectorImpl::processSuccessRateEjections(
   }
 }
 
+void DetectorImpl::processBatchedSuccessRateEjections(
+    DetectorHostMonitor::SuccessRateMonitorType monitor_type, uint64_t success_rate_minimum_hosts,
+    uint64_t success_rate_request_volume, uint64_t failure_percentage_minimum_hosts,
+    uint64_t failure_percentage_request_volume) {
+  BatchedResultCounters& results = *batched_results_;
+  const uint32_t slots = results.slots();
+  std::vector<uint8_t>& eligible = results.eligible();
+  const std::vector<uint64_t>& success = results.success(monitor_type);
+  // The totals are replaced by the request volumes of the eligible hosts, zero for the others.
+  std::vector<uint64_t>& volume = results.total(monitor_type);
+  std::vector<double>& success_rate = results.successRates(monitor_type);
+
+  // As with the per-host accumulators, hosts without requests have no success rate.
+  success_rate_request_volume = std::max<uint64_t>(success_rate_request_volume, 1);
+  failure_percentage_request_volume = std::max<uint64_t>(failure_percentage_request_volume, 1);
+  const uint64_t minimum_request_volume =
+      std::min(success_rate_request_volume, failure_percentage_request_volume);
+
+  // The loops over all the slots below have no branches and only access the per-slot arrays
+  // sequentially, so that the compiler can vectorize them. The success rate of a slot is only
+  // used where its volume meets one of the request volumes.
+  uint64_t success_rate_hosts = 0;
+  uint64_t failure_percentage_hosts = 0;
+  double success_rate_sum = 0;
+  for (uint32_t i = 0; i < slots; i++) {
+    volume[i] *= eligible[i];
+    // Counts flushed while a worker was counting a request can have the success counted in a
+    // different interval than the total.
+    const double rate =
+        std::min(success[i], volume[i]) * 100.0 / std::max<uint64_t>(volume[i], 1);
+    success_rate[i] = volume[i] >= minimum_request_volume ? rate : -1;
+    const bool valid_success_rate = volume[i] >= success_rate_request_volume;
+    success_rate_hosts += valid_success_rate;
+    failure_percentage_hosts += volume[i] >= failure_percentage_request_volume;
+    success_rate_sum += valid_success_rate ? rate : 0;
+  }
+
+  const auto eject = [&](uint32_t slot, envoy::data::cluster::v3::OutlierEjectionType type) {
+    const HostSharedPtr& host = results.host(slot);
+    updateDetectedEjectionStats(type);
+    ejectHost(host, type);
+    // As with the per-host accumulators, a host ejected for success rate is still evaluated for
+    // failure percentage in this pass, since its volume is kept, but not for the other monitor
+    // type.
+    eligible[slot] = !host->healthFlagGet(Host::HealthFlag::FAILED_OUTLIER_CHECK);
+  };
+
+  if (success_rate_hosts > 0 && success_rate_hosts >= success_rate_minimum_hosts) {
+    // The same statistics as successRateEjectionThreshold().
+    const double mean = success_rate_sum / success_rate_hosts;
+    double variance = 0;
+    for (uint32_t i = 0; i < slots; i++) {
+      const double diff = success_rate[i] - mean;
+      variance += volume[i] >= success_rate_request_volume ? diff * diff : 0;
+    }
+    variance /= success_rate_hosts;
+    const double success_rate_stdev_factor =
+        runtime_.snapshot().getInteger(SuccessRateStdevFactorRuntime,
+                                       config_.successRateStdevFactor()) /
+        1000.0;
+    getSRNums(monitor_type) = {mean, mean - (success_rate_stdev_factor * std::sqrt(variance))};
+    const double success_rate_ejection_threshold = getSRNums(monitor_type).ejection_threshold_;
+    const envoy::data::cluster::v3::OutlierEjectionType type =
+        (monitor_type == DetectorHostMonitor::SuccessRateMonitorType::ExternalOrigin)
+            ? envoy::data::cluster::v3::SUCCESS_RATE
+            : envoy::data::cluster::v3::SUCCESS_RATE_LOCAL_ORIGIN;
+    for (uint32_t i = 0; i < slots; i++) {
+      if (volume[i] >= success_rate_request_volume &&
+          success_rate[i] < success_rate_ejection_threshold) {
+        stats_.ejections_success_rate_.inc(); // Deprecated.
+        eject(i, type);
+      }
+    }
+  }
+
+  if (failure_percentage_hosts > 0 &&
+      failure_percentage_hosts >= failure_percentage_minimum_hosts) {
+    const double failure_percentage_threshold = runtime_.snapshot().getInteger(
+        FailurePercentageThresholdRuntime, config_.failurePercentageThreshold());
+    const envoy::data::cluster::v3::OutlierEjectionType type =
+        (monitor_type == DetectorHostMonitor::SuccessRateMonitorType::ExternalOrigin)
+            ? envoy::data::cluster::v3::FAILURE_PERCENTAGE
+            : envoy::data::cluster::v3::FAILURE_PERCENTAGE_LOCAL_ORIGIN;
+    for (uint32_t i = 0; i < slots; i++) {
+      if (volume[i] >= failure_percentage_request_volume &&
+          (100.0 - success_rate[i]) >= failure_percentage_threshold) {
+        eject(i, type);
+      }
+    }
+  }
+}
+
 void DetectorImpl::onIntervalTimer() {
   MonotonicTime now = time_source_.monotonicTime();
 
-  for (auto host : host_monitors_) {
+  for (const auto& host : host_monitors_) {
     checkHostForUneject(host.first, host.second, now);
+    if (batched_results_ != nullptr) {
+      continue;
+    }
 
     // Need to update the writer bucket to keep the data valid.
     host.second->updateCurrentSuccessRateBucket();
@@ -757,12 +920,16 @@ void DetectorImpl::onIntervalTimer() {
     host.second->successRate(DetectorHostMonitor::SuccessRateMonitorType::LocalOrigin, -1);
     host.second->successRate(DetectorHostMonitor::SuccessRateMonitorType::ExternalOrigin, -1);
   }
+  if (batched_results_ != nullptr) {
+    // The batched equivalent of the above, for all the hosts at once.
+    batched_results_->flush();
+  }
 
   processSuccessRateEjections(DetectorHostMonitor::SuccessRateMonitorType::ExternalOrigin);
   processSuccessRateEjections(DetectorHostMonitor::SuccessRateMonitorType::LocalOrigin);
 
   // Decrement time backoff for all hosts which have not been ejected.
-  for (auto host : host_monitors_) {
+  for (const auto& host : host_monitors_) {
     if (!host.first->healthFlagGet(Host::HealthFlag::FAILED_OUTLIER_CHECK)) {
       auto& monitor = host.second;
       // Node is healthy and was not ejected since the last check.
@@ -886,6 +1053,77 @@ absl::optional<std::pair<double, uint64_t>> SuccessRateAccumulator::getSuccessRa
   return {{success_rate, backup_success_rate_bucket_->total_request_counter_}};
 }
 
+BatchedResultCounters::SlotCounters& BatchedResultCounters::threadCounters(Block& block,
+                                                                           uint32_t slot) {
+  return block.shards_[Thread::threadShard(NumShards)].slots_[slot % SlotsPerBlock];
+}
+
+uint32_t BatchedResultCounters::addHost(HostSharedPtr host) {
+  uint32_t slot;
+  if (!free_slots_.empty()) {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+  } else {
+    slot = next_slot_++;
+    if (slot == hosts_.size()) {
+      blocks_.push_back(std::make_shared<Block>());
+      const size_t slots = blocks_.size() * SlotsPerBlock;
+      hosts_.resize(slots);
+      eligible_.resize(slots);
+      for (size_t type = 0; type < success_.size(); type++) {
+        success_[type].resize(slots);
+        total_[type].resize(slots);
+        success_rate_[type].resize(slots, -1);
+      }
+    }
+  }
+  hosts_[slot] = std::move(host);
+  return slot;
+}
+
+void BatchedResultCounters::removeHost(uint32_t slot) {
+  ASSERT(hosts_[slot] != nullptr);
+  hosts_[slot] = nullptr;
+  eligible_[slot] = 0;
+  for (size_t type = 0; type < success_rate_.size(); type++) {
+    success_rate_[type][slot] = -1;
+  }
+  released_slots_.push_back(slot);
+}
+
+void BatchedResultCounters::flush() {
+  for (size_t type = 0; type < success_.size(); type++) {
+    std::fill(success_[type].begin(), success_[type].end(), 0);
+    std::fill(total_[type].begin(), total_[type].end(), 0);
+    std::fill(success_rate_[type].begin(), success_rate_[type].end(), -1);
+  }
+  for (size_t block = 0; block < blocks_.size(); block++) {
+    const size_t first_slot = block * SlotsPerBlock;
+    for (Shard& shard : blocks_[block]->shards_) {
+      for (uint32_t i = 0; i < SlotsPerBlock; i++) {
+        SlotCounters& counters = shard.slots_[i];
+        for (size_t type = 0; type < success_.size(); type++) {
+          success_[type][first_slot + i] +=
+              counters.success_request_counter_[type].exchange(0, std::memory_order_relaxed);
+          total_[type][first_slot + i] +=
+              counters.total_request_counter_[type].exchange(0, std::memory_order_relaxed);
+        }
+      }
+    }
+  }
+  for (size_t slot = 0; slot < hosts_.size(); slot++) {
+    eligible_[slot] = hosts_[slot] != nullptr &&
+                      !hosts_[slot]->healthFlagGet(Host::HealthFlag::FAILED_OUTLIER_CHECK);
+  }
+  // The counts of the slots released since the last flush were discarded above, so the slots can
+  // be reused from now on. This is best effort: the slot is released with a relaxed store, so a
+  // worker that read the slot of a removed host before it saw the release may still count a few
+  // results in it, and those are then counted for the next host of the slot. Outlier detection
+  // is statistical, so this is accepted rather than synchronizing the workers with the removal.
+  free_slots_.insert(free_slots_.end(), released_slots_.begin(), released_slots_.end());
+  released_slots_.clear();
+}
+
 } // namespace Outlier
 } // namespace Upstream
 } // namespace Envoy
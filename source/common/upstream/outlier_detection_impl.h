@@ -1,8 +1,10 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <limits>
 #include <list>
 #include <memory>
 #include <string>
@@ -114,6 +116,94 @@ private:
   double success_rate_{-1};
 };
 
+/**
+ * The request counts of the hosts of a cluster when batched evaluation is enabled, used instead of
+ * the per-host success rate accumulators. Each host is assigned a slot. Workers count the results
+ * of a host in its slot in one of NumShards shards. Each thread always counts in the same shard,
+ * picked round robin among all the threads that count, so that workers mostly update different
+ * cache lines. Once per interval the main thread flushes the shards into per-slot arrays, which
+ * the detector evaluates in a few passes.
+ */
+class BatchedResultCounters {
+public:
+  static constexpr uint32_t NumShards = 8;
+  static constexpr uint32_t SlotsPerBlock = 256;
+  static constexpr uint32_t InvalidSlot = std::numeric_limits<uint32_t>::max();
+
+  struct SlotCounters {
+    // Indexed by DetectorHostMonitor::SuccessRateMonitorType.
+    std::array<std::atomic<uint32_t>, 2> success_request_counter_{};
+    std::array<std::atomic<uint32_t>, 2> total_request_counter_{};
+  };
+
+  struct alignas(64) Shard {
+    std::array<SlotCounters, SlotsPerBlock> slots_;
+  };
+
+  // The counters of SlotsPerBlock consecutive slots. Blocks are never moved, and are shared with
+  // the host monitors of their slots so that workers can count without holding the detector.
+  struct Block {
+    std::array<Shard, NumShards> shards_;
+  };
+  using BlockSharedPtr = std::shared_ptr<Block>;
+
+  /**
+   * May be called on any thread.
+   * @return the counters of the slot at index slot % SlotsPerBlock of the block in the shard of
+   *         the calling thread.
+   */
+  static SlotCounters& threadCounters(Block& block, uint32_t slot);
+
+  /**
+   * Assigns a slot to a host.
+   * @return the slot.
+   */
+  uint32_t addHost(HostSharedPtr host);
+
+  /**
+   * Releases the slot of a removed host. The slot is only reused after the next flush, which
+   * discards the counts of the removed host.
+   */
+  void removeHost(uint32_t slot);
+
+  /**
+   * Moves the counts of all the shards into the per-slot arrays, and resets the success rates.
+   * Slots of hosts that are ejected or were removed are marked as not eligible.
+   */
+  void flush();
+
+  const BlockSharedPtr& block(uint32_t slot) const { return blocks_[slot / SlotsPerBlock]; }
+  uint32_t slots() const { return hosts_.size(); }
+  const HostSharedPtr& host(uint32_t slot) const { return hosts_[slot]; }
+  std::vector<uint8_t>& eligible() { return eligible_; }
+  const std::vector<uint64_t>& success(DetectorHostMonitor::SuccessRateMonitorType type) const {
+    return success_[static_cast<size_t>(type)];
+  }
+  std::vector<uint64_t>& total(DetectorHostMonitor::SuccessRateMonitorType type) {
+    return total_[static_cast<size_t>(type)];
+  }
+  std::vector<double>& successRates(DetectorHostMonitor::SuccessRateMonitorType type) {
+    return success_rate_[static_cast<size_t>(type)];
+  }
+  double successRate(DetectorHostMonitor::SuccessRateMonitorType type, uint32_t slot) const {
+    return success_rate_[static_cast<size_t>(type)][slot];
+  }
+
+private:
+  std::vector<BlockSharedPtr> blocks_;
+  // The per-slot arrays, sized to the slots of all the blocks. Indexed by
+  // DetectorHostMonitor::SuccessRateMonitorType, then by slot where there is a type.
+  std::vector<HostSharedPtr> hosts_;
+  std::vector<uint8_t> eligible_;
+  std::array<std::vector<uint64_t>, 2> success_;
+  std::array<std::vector<uint64_t>, 2> total_;
+  std::array<std::vector<double>, 2> success_rate_;
+  uint32_t next_slot_{};
+  std::vector<uint32_t> free_slots_;
+  // Slots released since the last flush.
+  std::vector<uint32_t> released_slots_;
+};
+
 class DetectorImpl;
 
 /**
@@ -154,9 +244,7 @@ public:
         const_cast<const DetectorHostMonitorImpl*>(this)->getSRMonitor(type));
   }
 
-  double successRate(SuccessRateMonitorType type) const override {
-    return getSRMonitor(type).getSuccessRate();
-  }
+  double successRate(SuccessRateMonitorType type) const override;
   void updateCurrentSuccessRateBucket();
   void successRate(SuccessRateMonitorType type, double new_success_rate) {
     getSRMonitor(type).setSuccessRate(new_success_rate);
@@ -172,6 +260,14 @@ public:
   void setJitter(const std::chrono::milliseconds jitter) { jitter_ = jitter; }
   std::chrono::milliseconds getJitter() const { return jitter_; }
 
+  // handlers for the slot of the host in the batched result counters of the detector. The slot is
+  // set before the host is used, and released when the host is removed from the cluster.
+  void setBatchedSlot(BatchedResultCounters::BlockSharedPtr block, uint32_t slot);
+  void releaseBatchedSlot() {
+    batched_slot_.store(BatchedResultCounters::InvalidSlot, std::memory_order_relaxed);
+  }
+  uint32_t batchedSlot() const { return batched_slot_.load(std::memory_order_relaxed); }
+
 private:
   std::weak_ptr<DetectorImpl> detector_;
   std::weak_ptr<Host> host_;
@@ -201,6 +297,13 @@ private:
   SuccessRateMonitor external_origin_sr_monitor_;
   SuccessRateMonitor local_origin_sr_monitor_;
 
+  // The block of the slot of the host when batched evaluation is enabled, in which case the
+  // success rate monitors are not used. Null otherwise.
+  BatchedResultCounters::BlockSharedPtr batched_block_;
+  std::atomic<uint32_t> batched_slot_{BatchedResultCounters::InvalidSlot};
+
+  void incTotalReqCounter(SuccessRateMonitorType type);
+  void incSuccessReqCounter(SuccessRateMonitorType type);
   void putResultNoLocalExternalSplit(Result result, absl::optional<uint64_t> code);
   void putResultWithLocalExternalSplit(Result result, absl::optional<uint64_t> code);
   std::function<void(DetectorHostMonitorImpl*, Result, absl::optional<uint64_t> code)>
@@ -317,6 +420,7 @@ public:
   bool successfulActiveHealthCheckUnejectHost() const {
     return successful_active_health_check_uneject_host_;
   }
+  bool batchedEvaluation() const { return batched_evaluation_; }
 
 private:
   const uint64_t interval_ms_;
@@ -343,6 +447,7 @@ private:
   const uint64_t max_ejection_time_ms_;
   const uint64_t max_ejection_time_jitter_ms_;
   const bool successful_active_health_check_uneject_host_;
+  const bool batched_evaluation_;
 
   static constexpr uint64_t DEFAULT_INTERVAL_MS = 10000;
   static constexpr uint64_t DEFAULT_BASE_EJECTION_TIME_MS = 30000;
@@ -420,6 +525,9 @@ public:
     return host_monitors_;
   }
 
+  // The batched result counters of the hosts, or null if batched evaluation is disabled.
+  const BatchedResultCounters* batchedResultCounters() const { return batched_results_.get(); }
+
 private:
   DetectorImpl(const Cluster& cluster, const envoy::config::cluster::v3::OutlierDetection& config,
                Event::Dispatcher& dispatcher, Runtime::Loader& runtime, TimeSource& time_source,
@@ -441,6 +549,11 @@ private:
   void updateEnforcedEjectionStats(envoy::data::cluster::v3::OutlierEjectionType type);
   void updateDetectedEjectionStats(envoy::data::cluster::v3::OutlierEjectionType type);
   void processSuccessRateEjections(DetectorHostMonitor::SuccessRateMonitorType monitor_type);
+  void processBatchedSuccessRateEjections(DetectorHostMonitor::SuccessRateMonitorType monitor_type,
+                                          uint64_t success_rate_minimum_hosts,
+                                          uint64_t success_rate_request_volume,
+                                          uint64_t failure_percentage_minimum_hosts,
+                                          uint64_t failure_percentage_request_volume);
 
   // The helper to double write value and gauge. The gauge could be null value since because any
   // stat might be deactivated.
@@ -471,6 +584,7 @@ private:
   EventLoggerSharedPtr event_logger_;
   Common::CallbackHandlePtr member_update_cb_;
   Random::RandomGenerator& random_generator_;
+  std::unique_ptr<BatchedResultCounters> batched_results_;
 
   // EjectionPair for external and local origin events.
   // When external/local origin events are not split, external_origin_sr_num_ are used for
@@ -464,6 +464,9 @@ HostDescriptionImplBase::HostDescriptionImplBase(
     creation_status = absl::InvalidArgumentError(
         fmt::format("Invalid host configuration: non-zero port for non-IP address"));
   }
+  if (Runtime::runtimeFeatureEnabled("envoy.reloadable_features.shard_host_rq_active")) {
+    stats_.rq_active_.enableSharding();
+  }
 }
 
 HostDescription::SharedConstAddressVector HostDescriptionImplBase::makeAddressListOrNull(
@@ -1235,6 +1238,12 @@ ClusterInfoImpl::ClusterInfoImpl(
                                          config.lrs_report_endpoint_metrics().begin(),
                                          config.lrs_report_endpoint_metrics().end())
                                    : nullptr),
+      adaptive_preconnect_(
+          config.preconnect_policy().has_adaptive_preconnect()
+              ? std::make_unique<
+                    envoy::config::cluster::v3::Cluster::PreconnectPolicy::AdaptivePreconnect>(
+                    config.preconnect_policy().adaptive_preconnect())
+              : nullptr),
       per_connection_buffer_limit_bytes_(
           PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, per_connection_buffer_limit_bytes, 1024 * 1024)),
       max_response_headers_count_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(
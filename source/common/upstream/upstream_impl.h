@@ -897,6 +897,13 @@ public:
 
   float perUpstreamPreconnectRatio() const override { return per_upstream_preconnect_ratio_; }
   float peekaheadRatio() const override { return peekahead_ratio_; }
+  OptRef<const envoy::config::cluster::v3::Cluster::PreconnectPolicy::AdaptivePreconnect>
+  adaptivePreconnect() const override {
+    if (adaptive_preconnect_ == nullptr) {
+      return absl::nullopt;
+    }
+    return *adaptive_preconnect_;
+  }
   uint32_t perConnectionBufferLimitBytes() const override {
     return per_connection_buffer_limit_bytes_;
   }
@@ -1013,6 +1020,10 @@ public:
     return http_protocol_options_->alternate_protocol_cache_options_;
   }
 
+  uint32_t sharedConnectionPoolOwners() const override {
+    return http_protocol_options_->shared_connection_pool_owners_;
+  }
+
   const std::string& edsServiceName() const override {
     return eds_service_name_ != nullptr ? *eds_service_name_ : EMPTY_STRING;
   }
@@ -1155,6 +1166,8 @@ private:
   std::unique_ptr<envoy::config::cluster::v3::UpstreamConnectionOptions::HappyEyeballsConfig>
       happy_eyeballs_config_;
   const std::unique_ptr<Envoy::Orca::LrsReportMetricNames> lrs_report_metric_names_;
+  const std::unique_ptr<envoy::config::cluster::v3::Cluster::PreconnectPolicy::AdaptivePreconnect>
+      adaptive_preconnect_;
 
   // Keep small values like bools and enums at the end of the class to reduce
   // overhead via alignment
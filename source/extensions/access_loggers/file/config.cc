@@ -13,6 +13,7 @@
 #include "source/common/formatter/substitution_formatter.h"
 #include "source/common/protobuf/protobuf.h"
 #include "source/extensions/access_loggers/common/file_access_log_impl.h"
+#include "source/extensions/access_loggers/file/proto_formatter.h"
 
 namespace Envoy {
 namespace Extensions {
@@ -61,6 +62,10 @@ AccessLog::InstanceSharedPtr FileAccessLogFactory::createAccessLogInstance(
                                   fal_config.log_format(), context, std::move(command_parsers)),
                               Formatter::FormatterPtr);
     break;
+  case envoy::extensions::access_loggers::file::v3::FileAccessLog::AccessLogFormatCase::
+      kProtoFormat:
+    formatter = std::make_unique<ProtoFormatter>(fal_config.proto_format());
+    break;
   case envoy::extensions::access_loggers::file::v3::FileAccessLog::AccessLogFormatCase::
       ACCESS_LOG_FORMAT_NOT_SET:
     formatter = THROW_OR_RETURN_VALUE(
@@ -0,0 +1,78 @@
+#include "source/extensions/access_loggers/file/proto_formatter.h"
+
+#include <algorithm>
+
+#include "source/common/protobuf/protobuf.h"
+
+#include "absl/strings/str_cat.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace AccessLoggers {
+namespace File {
+
+namespace {
+// A varint32 never takes more than five bytes.
+constexpr size_t MaxVarint32Size = 5;
+} // namespace
+
+ProtoFormatter::ProtoFormatter(const ProtoFormatConfig& config)
+    : entry_builder_(config.additional_request_headers_to_log(),
+                     config.additional_response_headers_to_log(),
+                     config.additional_response_trailers_to_log(), commonConfig(config)) {}
+
+envoy::extensions::access_loggers::grpc::v3::CommonGrpcAccessLogConfig
+ProtoFormatter::commonConfig(const ProtoFormatConfig& config) {
+  envoy::extensions::access_loggers::grpc::v3::CommonGrpcAccessLogConfig common_config;
+  *common_config.mutable_filter_state_objects_to_log() = config.filter_state_objects_to_log();
+  *common_config.mutable_custom_tags() = config.custom_tags();
+  return common_config;
+}
+
+std::string
+ProtoFormatter::formatWithContext(const ::Envoy::Formatter::HttpFormatterContext& context,
+                                  const StreamInfo::StreamInfo& stream_info) const {
+  envoy::data::accesslog::v3::HTTPAccessLogEntry log_entry;
+  entry_builder_.build(context, stream_info, log_entry);
+
+  std::string output;
+  {
+    // The coded stream must be destroyed before the string is returned so that it is trimmed to
+    // the bytes actually written.
+    Protobuf::io::StringOutputStream stream(&output);
+    Protobuf::io::CodedOutputStream coded_stream(&stream);
+    coded_stream.WriteVarint32(static_cast<uint32_t>(log_entry.ByteSizeLong()));
+    log_entry.SerializeWithCachedSizes(&coded_stream);
+  }
+  return output;
+}
+
+absl::Status ProtoFormatter::decode(absl::string_view data, const EntryCallback& cb) {
+  const auto* bytes = reinterpret_cast<const uint8_t*>(data.data());
+  size_t offset = 0;
+  envoy::data::accesslog::v3::HTTPAccessLogEntry log_entry;
+  while (offset < data.size()) {
+    // Only hand the length prefix to the coded stream so that files larger than 2GB are fine.
+    Protobuf::io::CodedInputStream length_stream(
+        bytes + offset, static_cast<int>(std::min(MaxVarint32Size, data.size() - offset)));
+    uint32_t length;
+    if (!length_stream.ReadVarint32(&length)) {
+      return absl::InvalidArgumentError(absl::StrCat("truncated length at offset ", offset));
+    }
+    const size_t start = offset + length_stream.CurrentPosition();
+    if (length > data.size() - start) {
+      return absl::InvalidArgumentError(absl::StrCat("truncated entry at offset ", offset));
+    }
+    if (!log_entry.ParseFromArray(bytes + start, static_cast<int>(length))) {
+      return absl::InvalidArgumentError(absl::StrCat("malformed entry at offset ", offset));
+    }
+    cb(log_entry);
+    offset = start + length;
+  }
+  return absl::OkStatus();
+}
+
+} // namespace File
+} // namespace AccessLoggers
+} // namespace Extensions
+} // namespace Envoy
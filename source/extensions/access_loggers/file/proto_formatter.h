@@ -0,0 +1,52 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include "envoy/data/accesslog/v3/accesslog.pb.h"
+#include "envoy/extensions/access_loggers/file/v3/file.pb.h"
+#include "envoy/formatter/substitution_formatter_base.h"
+
+#include "source/extensions/access_loggers/grpc/http_access_log_entry.h"
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace AccessLoggers {
+namespace File {
+
+using ProtoFormatConfig = envoy::extensions::access_loggers::file::v3::FileAccessLog::ProtoFormat;
+
+/**
+ * Formatter that renders each entry as a varint length followed by a binary HTTPAccessLogEntry.
+ * The output is not text, but the file access log writes it like any other formatted line.
+ */
+class ProtoFormatter : public ::Envoy::Formatter::Formatter {
+public:
+  explicit ProtoFormatter(const ProtoFormatConfig& config);
+
+  // ::Envoy::Formatter::Formatter
+  std::string formatWithContext(const ::Envoy::Formatter::HttpFormatterContext& context,
+                                const StreamInfo::StreamInfo& stream_info) const override;
+
+  using EntryCallback = std::function<void(const envoy::data::accesslog::v3::HTTPAccessLogEntry&)>;
+
+  /**
+   * Decode the output of the formatter, calling cb for every entry in order.
+   * @return an error if the data ends in the middle of an entry or an entry cannot be parsed.
+   */
+  static absl::Status decode(absl::string_view data, const EntryCallback& cb);
+
+private:
+  static envoy::extensions::access_loggers::grpc::v3::CommonGrpcAccessLogConfig
+  commonConfig(const ProtoFormatConfig& config);
+
+  const GrpcCommon::HttpAccessLogEntryBuilder entry_builder_;
+};
+
+} // namespace File
+} // namespace AccessLoggers
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+
+#include "envoy/data/accesslog/v3/accesslog.pb.h"
+#include "envoy/extensions/access_loggers/grpc/v3/als.pb.h"
+#include "envoy/formatter/http_formatter_context.h"
+#include "envoy/http/header_map.h"
+#include "envoy/stream_info/stream_info.h"
+
+#include "source/common/protobuf/protobuf.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace AccessLoggers {
+namespace GrpcCommon {
+
+/**
+ * Builds the HTTPAccessLogEntry for a request. Shared by the loggers that emit the
+ * envoy.data.accesslog.v3 schema, so that every sink records the same fields.
+ */
+class HttpAccessLogEntryBuilder {
+public:
+  HttpAccessLogEntryBuilder(
+      const Protobuf::RepeatedPtrField<std::string>& request_headers_to_log,
+      const Protobuf::RepeatedPtrField<std::string>& response_headers_to_log,
+      const Protobuf::RepeatedPtrField<std::string>& response_trailers_to_log,
+      const envoy::extensions::access_loggers::grpc::v3::CommonGrpcAccessLogConfig& common_config);
+
+  /**
+   * Populate log_entry from the request and response of a stream.
+   */
+  void build(const Formatter::HttpFormatterContext& context,
+             const StreamInfo::StreamInfo& stream_info,
+             envoy::data::accesslog::v3::HTTPAccessLogEntry& log_entry) const;
+
+private:
+  // Only filter_state_objects_to_log and custom_tags are used by the common properties.
+  const envoy::extensions::access_loggers::grpc::v3::CommonGrpcAccessLogConfig common_config_;
+  std::vector<Http::LowerCaseString> request_headers_to_log_;
+  std::vector<Http::LowerCaseString> response_headers_to_log_;
+  std::vector<Http::LowerCaseString> response_trailers_to_log_;
+};
+
+} // namespace GrpcCommon
+} // namespace AccessLoggers
+} // namespace Extensions
+} // namespace Envoy
@@ -13,6 +13,7 @@
 #include "source/common/grpc/typed_async_client.h"
 #include "source/extensions/access_loggers/common/access_log_base.h"
 #include "source/extensions/access_loggers/grpc/grpc_access_log_impl.h"
+#include "source/extensions/access_loggers/grpc/http_access_log_entry.h"
 
 namespace Envoy {
 namespace Extensions {
@@ -50,9 +51,7 @@ private:
   const HttpGrpcAccessLogConfigConstSharedPtr config_;
   const ThreadLocal::SlotPtr tls_slot_;
   const GrpcCommon::GrpcAccessLoggerCacheSharedPtr access_logger_cache_;
-  std::vector<Http::LowerCaseString> request_headers_to_log_;
-  std::vector<Http::LowerCaseString> response_headers_to_log_;
-  std::vector<Http::LowerCaseString> response_trailers_to_log_;
+  const GrpcCommon::HttpAccessLogEntryBuilder entry_builder_;
   std::vector<std::string> filter_states_to_log_;
 };
 
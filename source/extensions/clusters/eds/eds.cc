@@ -1,9 +1,12 @@
 #include "source/extensions/clusters/eds/eds.h"
 
+#include <algorithm>
+
 #include "envoy/common/exception.h"
 #include "envoy/config/cluster/v3/cluster.pb.h"
 #include "envoy/config/core/v3/config_source.pb.h"
 #include "envoy/service/discovery/v3/discovery.pb.h"
+#include "envoy/singleton/manager.h"
 
 #include "source/common/common/assert.h"
 #include "source/common/common/utility.h"
@@ -14,6 +17,26 @@
 namespace Envoy {
 namespace Upstream {
 
+SINGLETON_MANAGER_REGISTRATION(eds_update_pipeline);
+
+namespace {
+
+// Each update is prepared by a single thread, so a few threads keep up with many clusters.
+constexpr uint32_t MaxUpdatePipelineThreads = 4;
+
+EdsUpdatePipelineSharedPtr
+getUpdatePipeline(Server::Configuration::ServerFactoryContext& server_context) {
+  return server_context.singletonManager().getTyped<EdsUpdatePipeline>(
+      SINGLETON_MANAGER_REGISTERED_NAME(eds_update_pipeline), [&server_context] {
+        return std::make_shared<EdsUpdatePipeline>(
+            server_context.api().threadFactory(),
+            std::clamp<uint32_t>(server_context.options().concurrency(), 1,
+                                 MaxUpdatePipelineThreads));
+      });
+}
+
+} // namespace
+
 absl::StatusOr<std::unique_ptr<EdsClusterImpl>>
 EdsClusterImpl::create(const envoy::config::cluster::v3::Cluster& cluster,
                        ClusterFactoryContext& cluster_context) {
@@ -34,9 +57,13 @@ EdsClusterImpl::EdsClusterImpl(const envoy::config::cluster::v3::Cluster& cluste
       eds_resources_cache_(
           Runtime::runtimeFeatureEnabled("envoy.restart_features.use_eds_cache_for_ads")
               ? cluster_context.clusterManager().edsResourcesCache()
-              : absl::nullopt) {
-  Event::Dispatcher& dispatcher = cluster_context.serverFactoryContext().mainThreadDispatcher();
-  assignment_timeout_ = dispatcher.createTimer([this]() -> void { onAssignmentTimeout(); });
+              : absl::nullopt),
+      dispatcher_(cluster_context.serverFactoryContext().mainThreadDispatcher()) {
+  assignment_timeout_ = dispatcher_.createTimer([this]() -> void { onAssignmentTimeout(); });
+  if (Runtime::runtimeFeatureEnabled(
+          "envoy.restart_features.eds_prepare_updates_off_main_thread")) {
+    update_pipeline_ = getUpdatePipeline(cluster_context.serverFactoryContext());
+  }
   const auto& eds_config = cluster.eds_cluster_config().eds_config();
   if (Config::SubscriptionFactory::isPathBasedConfigSource(
           eds_config.config_source_specifier_case())) {
@@ -65,7 +92,13 @@ void EdsClusterImpl::BatchUpdateHelper::batchUpdate(PrioritySet::HostUpdateCb& h
   absl::flat_hash_set<std::string> all_new_hosts;
   PriorityStateManager priority_state_manager(parent_, parent_.local_info_, &host_update_cb,
                                               parent_.random_);
-  for (const auto& locality_lb_endpoint : cluster_load_assignment_.endpoints()) {
+  // Get the map of all the latest existing hosts, which is used to filter out the existing
+  // hosts in the process of updating cluster memberships.
+  all_hosts_ = parent_.prioritySet().crossPriorityHostMap();
+  ASSERT(all_hosts_ != nullptr);
+
+  for (int i = 0; i < cluster_load_assignment_.endpoints_size(); i++) {
+    const auto& locality_lb_endpoint = cluster_load_assignment_.endpoints(i);
     THROW_IF_NOT_OK(parent_.validateEndpointsForZoneAwareRouting(locality_lb_endpoint));
 
     priority_state_manager.initializePriorityFor(locality_lb_endpoint);
@@ -85,9 +118,10 @@ void EdsClusterImpl::BatchUpdateHelper::batchUpdate(PrioritySet::HostUpdateCb& h
                                 all_new_hosts);
       }
     } else {
-      for (const auto& lb_endpoint : locality_lb_endpoint.lb_endpoints()) {
-        updateLocalityEndpoints(lb_endpoint, locality_lb_endpoint, priority_state_manager,
-                                all_new_hosts);
+      for (int j = 0; j < locality_lb_endpoint.lb_endpoints_size(); j++) {
+        updateLocalityEndpoints(locality_lb_endpoint.lb_endpoints(j), locality_lb_endpoint,
+                                priority_state_manager, all_new_hosts,
+                                prepared_ != nullptr ? &prepared_->endpoint(i, j) : nullptr);
       }
     }
   }
@@ -95,11 +129,6 @@ void EdsClusterImpl::BatchUpdateHelper::batchUpdate(PrioritySet::HostUpdateCb& h
   // Track whether we rebuilt any LB structures.
   bool cluster_rebuilt = false;
 
-  // Get the map of all the latest existing hosts, which is used to filter out the existing
-  // hosts in the process of updating cluster memberships.
-  HostMapConstSharedPtr all_hosts = parent_.prioritySet().crossPriorityHostMap();
-  ASSERT(all_hosts != nullptr);
-
   const uint32_t overprovisioning_factor = PROTOBUF_GET_WRAPPED_OR_DEFAULT(
       cluster_load_assignment_.policy(), overprovisioning_factor, kDefaultOverProvisioningFactor);
   const bool weighted_priority_health =
@@ -117,14 +146,14 @@ void EdsClusterImpl::BatchUpdateHelper::batchUpdate(PrioritySet::HostUpdateCb& h
       cluster_rebuilt |= parent_.updateHostsPerLocality(
           i, weighted_priority_health, overprovisioning_factor, *priority_state[i].first,
           parent_.locality_weights_map_[i], priority_state[i].second, priority_state_manager,
-          *all_hosts, all_new_hosts);
+          *all_hosts_, all_new_hosts);
     } else {
       // If the new update contains a priority with no hosts, call the update function with an empty
       // set of hosts.
       cluster_rebuilt |=
           parent_.updateHostsPerLocality(i, weighted_priority_health, overprovisioning_factor, {},
                                          parent_.locality_weights_map_[i], empty_locality_map,
-                                         priority_state_manager, *all_hosts, all_new_hosts);
+                                         priority_state_manager, *all_hosts_, all_new_hosts);
     }
   }
 
@@ -137,7 +166,7 @@ void EdsClusterImpl::BatchUpdateHelper::batchUpdate(PrioritySet::HostUpdateCb& h
     }
     cluster_rebuilt |= parent_.updateHostsPerLocality(
         i, weighted_priority_health, overprovisioning_factor, {}, parent_.locality_weights_map_[i],
-        empty_locality_map, priority_state_manager, *all_hosts, all_new_hosts);
+        empty_locality_map, priority_state_manager, *all_hosts_, all_new_hosts);
   }
 
   if (!cluster_rebuilt) {
@@ -152,7 +181,35 @@ void EdsClusterImpl::BatchUpdateHelper::batchUpdate(PrioritySet::HostUpdateCb& h
 void EdsClusterImpl::BatchUpdateHelper::updateLocalityEndpoints(
     const envoy::config::endpoint::v3::LbEndpoint& lb_endpoint,
     const envoy::config::endpoint::v3::LocalityLbEndpoints& locality_lb_endpoint,
-    PriorityStateManager& priority_state_manager, absl::flat_hash_set<std::string>& all_new_hosts) {
+    PriorityStateManager& priority_state_manager, absl::flat_hash_set<std::string>& all_new_hosts,
+    const PreparedEdsEndpoint* prepared_endpoint) {
+  if (prepared_endpoint != nullptr) {
+    // The addresses were resolved off the main thread.
+    if (all_new_hosts.contains(prepared_endpoint->address_string_)) {
+      return;
+    }
+    // An existing host that matched the endpoint when the update was prepared is kept as it is,
+    // unless it is no longer the host of its address, e.g. because it was removed after failing
+    // active health checking in the meantime.
+    const HostSharedPtr& existing_host = prepared_endpoint->existing_host_;
+    const auto current_host =
+        existing_host != nullptr ? all_hosts_->find(prepared_endpoint->address_string_)
+                                 : all_hosts_->end();
+    // Whether active health checking is disabled is only read on the main thread, where it is
+    // set.
+    if (current_host != all_hosts_->end() && current_host->second == existing_host &&
+        !existing_host->disableActiveHealthCheck()) {
+      priority_state_manager.registerHostForPriority(existing_host, locality_lb_endpoint);
+    } else {
+      priority_state_manager.registerHostForPriority(
+          lb_endpoint.endpoint().hostname(), prepared_endpoint->address_,
+          prepared_endpoint->address_list_, locality_lb_endpoint, lb_endpoint,
+          parent_.time_source_);
+    }
+    all_new_hosts.emplace(prepared_endpoint->address_string_);
+    return;
+  }
+
   const auto address =
       THROW_OR_RETURN_VALUE(parent_.resolveProtoAddress(lb_endpoint.endpoint().address()),
                             const Network::Address::InstanceConstSharedPtr);
@@ -209,7 +266,9 @@ EdsClusterImpl::onConfigUpdate(const std::vector<Config::DecodedResourceRef>& re
   // Validate that each locality doesn't have both LEDS and endpoints defined.
   // TODO(adisuissa): This is only needed for the API v3 support. In future major versions
   // the oneof definition will take care of it.
+  bool uses_leds = false;
   for (const auto& locality : cluster_load_assignment.endpoints()) {
+    uses_leds |= locality.has_leds_cluster_locality_config();
     if (locality.has_leds_cluster_locality_config() && locality.lb_endpoints_size() > 0) {
       return absl::InvalidArgumentError(fmt::format(
           "A ClusterLoadAssignment for cluster {} cannot include both LEDS (resource: {}) and a "
@@ -244,6 +303,26 @@ EdsClusterImpl::onConfigUpdate(const std::vector<Config::DecodedResourceRef>& re
     return status;
   }
 
+  if (update_pipeline_ != nullptr && !uses_leds) {
+    // Errors found while preparing the update could no longer reject it, so the endpoints are
+    // validated and their addresses resolved here, and only matching them against the existing
+    // hosts is left to the pipeline.
+    for (const auto& locality : cluster_load_assignment.endpoints()) {
+      RETURN_IF_NOT_OK(validateEndpointsForZoneAwareRouting(locality));
+    }
+    absl::StatusOr<PreparedEdsUpdatePtr> prepared =
+        PreparedEdsUpdate::resolve(cluster_load_assignment);
+    RETURN_IF_NOT_OK_REF(prepared.status());
+    prepareUpdate(std::make_unique<envoy::config::endpoint::v3::ClusterLoadAssignment>(
+                      std::move(cluster_load_assignment)),
+                  std::move(prepared.value()));
+    if (using_cached_resource_) {
+      eds_resources_cache_->removeCallback(edsServiceName(), this);
+      using_cached_resource_ = false;
+    }
+    return absl::OkStatus();
+  }
+
   // Pause LEDS messages until the EDS config is finished processing.
   Config::ScopedResume maybe_resume_leds;
   if (transport_factory_context_->clusterManager().adsMux()) {
@@ -261,8 +340,77 @@ EdsClusterImpl::onConfigUpdate(const std::vector<Config::DecodedResourceRef>& re
   return absl::OkStatus();
 }
 
+void EdsClusterImpl::prepareUpdate(
+    std::unique_ptr<envoy::config::endpoint::v3::ClusterLoadAssignment> cluster_load_assignment,
+    PreparedEdsUpdatePtr prepared_update) {
+  // Only one update is prepared at a time. An assignment that arrives in the meantime waits for it
+  // and replaces any other waiting assignment, so that every prepared update is applied and the
+  // cluster converges on the latest assignment however fast they arrive.
+  if (preparing_update_) {
+    pending_assignment_ = std::move(cluster_load_assignment);
+    pending_prepared_ = std::move(prepared_update);
+    return;
+  }
+  preparing_update_ = true;
+
+  // An update applied directly in the meantime supersedes this one.
+  const uint64_t generation = update_generation_;
+  std::shared_ptr<const envoy::config::endpoint::v3::ClusterLoadAssignment> assignment =
+      std::move(cluster_load_assignment);
+  std::shared_ptr<PreparedEdsUpdate> prepared = std::move(prepared_update);
+  HostMapConstSharedPtr existing_hosts = prioritySet().crossPriorityHostMap();
+  update_pipeline_->post([this, generation, assignment, prepared, existing_hosts,
+                          &dispatcher = dispatcher_,
+                          still_alive = std::weak_ptr<bool>(still_alive_)]() mutable {
+    prepared->matchExistingHosts(*assignment, *existing_hosts);
+    // The snapshot of the hosts is released on the main thread, as it may hold the last reference
+    // to a removed host.
+    dispatcher.post([this, generation, assignment = std::move(assignment),
+                     existing_hosts = std::move(existing_hosts), prepared = std::move(prepared),
+                     still_alive = std::move(still_alive)]() {
+      if (still_alive.expired()) {
+        return;
+      }
+      preparing_update_ = false;
+      // Applying the update clears the waiting assignment, which is newer than it.
+      auto pending_assignment = std::move(pending_assignment_);
+      auto pending_prepared = std::move(pending_prepared_);
+      if (generation == update_generation_) {
+        onUpdatePrepared(*assignment, *prepared);
+      }
+      if (pending_assignment != nullptr) {
+        prepareUpdate(std::move(pending_assignment), std::move(pending_prepared));
+      }
+    });
+  });
+}
+
+void EdsClusterImpl::onUpdatePrepared(
+    const envoy::config::endpoint::v3::ClusterLoadAssignment& cluster_load_assignment,
+    const PreparedEdsUpdate& prepared) {
+  ENVOY_LOG(debug, "EDS update for cluster {} prepared, {} unchanged hosts", edsServiceName(),
+            prepared.existingHosts());
+  TRY_ASSERT_MAIN_THREAD { update(cluster_load_assignment, &prepared); }
+  END_TRY
+  CATCH(EnvoyException & e, {
+    // The update was already accepted by the subscription, so it is counted as rejected instead.
+    // The errors that the subscription rejects updates for are found before accepting the update,
+    // so this is not expected to happen.
+    ENVOY_LOG(warn, "Rejected EDS update for cluster {}: {}", edsServiceName(), e.what());
+    info_->configUpdateStats().assignment_rejected_.inc();
+    // As for a rejected update, do not block the initialization of the cluster on it.
+    onPreInitComplete();
+  });
+}
+
 void EdsClusterImpl::update(
-    const envoy::config::endpoint::v3::ClusterLoadAssignment& cluster_load_assignment) {
+    const envoy::config::endpoint::v3::ClusterLoadAssignment& cluster_load_assignment,
+    const PreparedEdsUpdate* prepared) {
+  // Supersede any update that is still being prepared or waiting to be.
+  update_generation_++;
+  pending_assignment_.reset();
+  pending_prepared_.reset();
+
   // Compare the current set of LEDS localities (localities using LEDS) to the one received in the
   // update. A LEDS locality can either be added, removed, or kept. If it is added we add a
   // subscription to it, and if it is removed we delete the subscription.
@@ -319,7 +467,8 @@ void EdsClusterImpl::update(
     return;
   }
 
-  BatchUpdateHelper helper(*this, *used_load_assignment);
+  BatchUpdateHelper helper(*this, *used_load_assignment,
+                           cla_leds_configs.empty() ? prepared : nullptr);
   priority_set_.batchHostUpdate(helper);
 }
 
@@ -20,6 +20,7 @@
 #include "source/common/config/subscription_base.h"
 #include "source/common/upstream/cluster_factory_impl.h"
 #include "source/common/upstream/upstream_impl.h"
+#include "source/extensions/clusters/eds/eds_update_pipeline.h"
 #include "source/extensions/clusters/eds/leds.h"
 
 namespace Envoy {
@@ -69,8 +70,20 @@ private:
     return !name.empty() ? name : info_->name();
   }
 
-  // Updates the internal data structures with a given cluster load assignment.
-  void update(const envoy::config::endpoint::v3::ClusterLoadAssignment& cluster_load_assignment);
+  // Updates the internal data structures with a given cluster load assignment, optionally prepared
+  // off the main thread by the update pipeline.
+  void update(const envoy::config::endpoint::v3::ClusterLoadAssignment& cluster_load_assignment,
+              const PreparedEdsUpdate* prepared = nullptr);
+  // Prepares the cluster load assignment, whose addresses were already resolved, on the update
+  // pipeline, and updates the cluster with it once it is prepared, unless another update was
+  // applied in the meantime. If an update is already being prepared, the assignment is prepared
+  // after it.
+  void prepareUpdate(
+      std::unique_ptr<envoy::config::endpoint::v3::ClusterLoadAssignment> cluster_load_assignment,
+      PreparedEdsUpdatePtr prepared);
+  void onUpdatePrepared(
+      const envoy::config::endpoint::v3::ClusterLoadAssignment& cluster_load_assignment,
+      const PreparedEdsUpdate& prepared);
 
   // EdsResourceRemovalCallback
   void onCachedResourceRemoved(absl::string_view resource_name) override;
@@ -87,8 +100,9 @@ private:
   public:
     BatchUpdateHelper(
         EdsClusterImpl& parent,
-        const envoy::config::endpoint::v3::ClusterLoadAssignment& cluster_load_assignment)
-        : parent_(parent), cluster_load_assignment_(cluster_load_assignment) {}
+        const envoy::config::endpoint::v3::ClusterLoadAssignment& cluster_load_assignment,
+        const PreparedEdsUpdate* prepared = nullptr)
+        : parent_(parent), cluster_load_assignment_(cluster_load_assignment), prepared_(prepared) {}
 
     // Upstream::PrioritySet::BatchUpdateCb
     void batchUpdate(PrioritySet::HostUpdateCb& host_update_cb) override;
@@ -98,10 +112,13 @@ private:
         const envoy::config::endpoint::v3::LbEndpoint& lb_endpoint,
         const envoy::config::endpoint::v3::LocalityLbEndpoints& locality_lb_endpoint,
         PriorityStateManager& priority_state_manager,
-        absl::flat_hash_set<std::string>& all_new_hosts);
+        absl::flat_hash_set<std::string>& all_new_hosts,
+        const PreparedEdsEndpoint* prepared_endpoint = nullptr);
 
     EdsClusterImpl& parent_;
     const envoy::config::endpoint::v3::ClusterLoadAssignment& cluster_load_assignment_;
+    const PreparedEdsUpdate* prepared_;
+    HostMapConstSharedPtr all_hosts_;
   };
 
   Config::SubscriptionPtr subscription_;
@@ -127,6 +144,20 @@ private:
 
   // Tracks whether a cached resource is used as the current EDS resource.
   bool using_cached_resource_{false};
+
+  // Prepares updates off the main thread, if enabled.
+  EdsUpdatePipelineSharedPtr update_pipeline_;
+  Event::Dispatcher& dispatcher_;
+  // Incremented on every update, so that an update that finishes preparing after a later update
+  // is dropped.
+  uint64_t update_generation_{};
+  // Whether an update is being prepared on the pipeline.
+  bool preparing_update_{};
+  // The latest assignment received while an update was being prepared, to be prepared next.
+  std::unique_ptr<envoy::config::endpoint::v3::ClusterLoadAssignment> pending_assignment_;
+  PreparedEdsUpdatePtr pending_prepared_;
+  // Lets the updates prepared on the pipeline detect that the cluster was destroyed.
+  const std::shared_ptr<bool> still_alive_{std::make_shared<bool>(true)};
 };
 
 using EdsClusterImplSharedPtr = std::shared_ptr<EdsClusterImpl>;
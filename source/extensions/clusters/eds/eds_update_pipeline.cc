@@ -0,0 +1,174 @@
+#include "source/extensions/clusters/eds/eds_update_pipeline.h"
+
+#include "envoy/common/exception.h"
+#include "envoy/upstream/locality.h"
+
+#include "source/common/common/assert.h"
+#include "source/common/common/thread.h"
+#include "source/common/network/resolver_impl.h"
+#include "source/common/protobuf/utility.h"
+
+namespace Envoy {
+namespace Upstream {
+namespace {
+
+absl::StatusOr<Network::Address::InstanceConstSharedPtr>
+resolveAddress(const envoy::config::core::v3::Address& address) {
+  absl::Status resolve_status;
+  TRY_NEEDS_AUDIT {
+    auto address_or_error = Network::Address::resolveProtoAddress(address);
+    if (address_or_error.status().ok()) {
+      return address_or_error.value();
+    }
+    resolve_status = address_or_error.status();
+  }
+  END_TRY
+  CATCH(EnvoyException & e, { resolve_status = absl::InvalidArgumentError(e.what()); });
+  // Matches ClusterImplBase::resolveProtoAddress() for EDS clusters.
+  return absl::InvalidArgumentError(
+      fmt::format("{}. Consider setting resolver_name or setting cluster type "
+                  "to 'STRICT_DNS' or 'LOGICAL_DNS'",
+                  resolve_status.message()));
+}
+
+bool sameMetadata(const MetadataConstSharedPtr& existing, bool has_metadata,
+                  const envoy::config::core::v3::Metadata& metadata) {
+  if (existing == nullptr || !has_metadata) {
+    return existing == nullptr && !has_metadata;
+  }
+  return Protobuf::util::MessageDifferencer::Equivalent(*existing, metadata);
+}
+
+// Whether the host that would be created for the endpoint has the same attributes as the existing
+// host, so that applying the endpoint to the existing host would not change it.
+bool matchesExistingHost(const Host& host,
+                         const envoy::config::endpoint::v3::LocalityLbEndpoints& locality,
+                         const envoy::config::endpoint::v3::LbEndpoint& lb_endpoint) {
+  const auto& endpoint = lb_endpoint.endpoint();
+  // Endpoints with a health check config or additional addresses are left to the main thread, as
+  // the existing host does not keep enough of their configuration to compare it. Whether active
+  // health checking is disabled on the host is checked on the main thread, where it is set.
+  if (endpoint.has_health_check_config() || !endpoint.additional_addresses().empty() ||
+      host.addressListOrNull() != nullptr || *host.healthCheckAddress() != *host.address() ||
+      !host.hostnameForHealthChecks().empty()) {
+    return false;
+  }
+  return host.priority() == locality.priority() && host.hostname() == endpoint.hostname() &&
+         host.weight() == std::max(1U, lb_endpoint.load_balancing_weight().value()) &&
+         host.edsHealthStatus() == lb_endpoint.health_status() &&
+         LocalityEqualTo()(host.locality(), locality.locality()) &&
+         sameMetadata(host.metadata(), lb_endpoint.has_metadata(), lb_endpoint.metadata()) &&
+         sameMetadata(host.localityMetadata(), locality.has_metadata(), locality.metadata());
+}
+
+} // namespace
+
+absl::StatusOr<PreparedEdsUpdatePtr> PreparedEdsUpdate::resolve(
+    const envoy::config::endpoint::v3::ClusterLoadAssignment& cluster_load_assignment) {
+  auto prepared = std::make_unique<PreparedEdsUpdate>();
+  prepared->localities_.resize(cluster_load_assignment.endpoints_size());
+  for (int i = 0; i < cluster_load_assignment.endpoints_size(); i++) {
+    const auto& locality = cluster_load_assignment.endpoints(i);
+    auto& endpoints = prepared->localities_[i];
+    endpoints.resize(locality.lb_endpoints_size());
+    for (int j = 0; j < locality.lb_endpoints_size(); j++) {
+      const auto& endpoint = locality.lb_endpoints(j).endpoint();
+      PreparedEdsEndpoint& prepared_endpoint = endpoints[j];
+
+      auto address_or_error = resolveAddress(endpoint.address());
+      RETURN_IF_NOT_OK_REF(address_or_error.status());
+      prepared_endpoint.address_ = std::move(address_or_error.value());
+      if (!endpoint.additional_addresses().empty()) {
+        prepared_endpoint.address_list_.push_back(prepared_endpoint.address_);
+        for (const auto& additional_address : endpoint.additional_addresses()) {
+          auto additional_or_error = resolveAddress(additional_address.address());
+          RETURN_IF_NOT_OK_REF(additional_or_error.status());
+          // All addresses must by IP addresses.
+          if (!additional_or_error.value()->ip()) {
+            return absl::InvalidArgumentError("additional_addresses must be IP addresses.");
+          }
+          prepared_endpoint.address_list_.push_back(std::move(additional_or_error.value()));
+        }
+        if (!prepared_endpoint.address_->ip()) {
+          return absl::InvalidArgumentError("additional_addresses must be IP addresses.");
+        }
+      }
+
+      // The same checks as when the host is created, see resolveHealthCheckAddress().
+      const auto& health_check_config = endpoint.health_check_config();
+      if (health_check_config.has_address()) {
+        RETURN_IF_NOT_OK_REF(resolveAddress(health_check_config.address()).status());
+      }
+      if (health_check_config.port_value() != 0 &&
+          prepared_endpoint.address_->type() != Network::Address::Type::Ip) {
+        return absl::InvalidArgumentError(
+            "Invalid host configuration: non-zero port for non-IP address");
+      }
+    }
+  }
+  return prepared;
+}
+
+void PreparedEdsUpdate::matchExistingHosts(
+    const envoy::config::endpoint::v3::ClusterLoadAssignment& cluster_load_assignment,
+    const HostMap& existing_hosts) {
+  ASSERT(static_cast<int>(localities_.size()) == cluster_load_assignment.endpoints_size());
+  for (int i = 0; i < cluster_load_assignment.endpoints_size(); i++) {
+    const auto& locality = cluster_load_assignment.endpoints(i);
+    for (int j = 0; j < locality.lb_endpoints_size(); j++) {
+      const auto& lb_endpoint = locality.lb_endpoints(j);
+      PreparedEdsEndpoint& prepared_endpoint = localities_[i][j];
+      prepared_endpoint.address_string_ = prepared_endpoint.address_->asString();
+
+      const auto existing_host = existing_hosts.find(prepared_endpoint.address_string_);
+      if (existing_host != existing_hosts.end() &&
+          matchesExistingHost(*existing_host->second, locality, lb_endpoint)) {
+        prepared_endpoint.existing_host_ = existing_host->second;
+        existing_hosts_++;
+      }
+    }
+  }
+}
+
+EdsUpdatePipeline::EdsUpdatePipeline(Thread::ThreadFactory& thread_factory, uint32_t threads) {
+  ASSERT(threads > 0);
+  for (uint32_t i = 0; i < threads; i++) {
+    threads_.push_back(thread_factory.createThread([this]() -> void { threadRoutine(); },
+                                                   Thread::Options{"EdsUpdate"}));
+  }
+}
+
+EdsUpdatePipeline::~EdsUpdatePipeline() {
+  {
+    absl::MutexLock lock(&mutex_);
+    shutdown_ = true;
+    jobs_.clear();
+  }
+  for (auto& thread : threads_) {
+    thread->join();
+  }
+}
+
+void EdsUpdatePipeline::post(std::function<void()> job) {
+  absl::MutexLock lock(&mutex_);
+  jobs_.push_back(std::move(job));
+}
+
+void EdsUpdatePipeline::threadRoutine() {
+  while (true) {
+    std::function<void()> job;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(this, &EdsUpdatePipeline::hasJobOrShutdown));
+      if (shutdown_) {
+        return;
+      }
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+    job();
+  }
+}
+
+} // namespace Upstream
+} // namespace Envoy
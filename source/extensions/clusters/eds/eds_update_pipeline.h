@@ -0,0 +1,115 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/config/endpoint/v3/endpoint.pb.h"
+#include "envoy/network/address.h"
+#include "envoy/singleton/instance.h"
+#include "envoy/thread/thread.h"
+#include "envoy/upstream/upstream.h"
+
+#include "source/common/common/logger.h"
+
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+
+namespace Envoy {
+namespace Upstream {
+
+/**
+ * An endpoint of a ClusterLoadAssignment as prepared off the main thread.
+ */
+struct PreparedEdsEndpoint {
+  Network::Address::InstanceConstSharedPtr address_;
+  // The address followed by the additional addresses, or empty if there are none.
+  std::vector<Network::Address::InstanceConstSharedPtr> address_list_;
+  std::string address_string_;
+  // An existing host that matches every attribute of the endpoint, and can be kept as it is
+  // instead of creating a new host for the endpoint. Null if there is none.
+  HostSharedPtr existing_host_;
+};
+
+/**
+ * An EDS update prepared in two steps. The addresses of the endpoints are resolved on the main
+ * thread before the update is accepted, so that an update with an invalid address is rejected as
+ * it would be without preparing it. The endpoints are then matched against a snapshot of the
+ * existing hosts off the main thread. The endpoints that match an existing host exactly do not
+ * need a new host to be created and diffed against the existing one when the update is applied on
+ * the main thread.
+ */
+class PreparedEdsUpdate {
+public:
+  /**
+   * Resolves the addresses of the endpoints of an assignment, including their health check
+   * addresses, which are otherwise only resolved when the hosts are created.
+   * @param cluster_load_assignment supplies the assignment to prepare.
+   * @return the update to match against the existing hosts, or an error if an address of an
+   *         endpoint is invalid.
+   */
+  static absl::StatusOr<std::unique_ptr<PreparedEdsUpdate>>
+  resolve(const envoy::config::endpoint::v3::ClusterLoadAssignment& cluster_load_assignment);
+
+  /**
+   * Matches the resolved endpoints against the existing hosts. May be called on any thread.
+   * @param cluster_load_assignment supplies the assignment that was resolved.
+   * @param existing_hosts supplies a snapshot of the hosts of the cluster.
+   */
+  void matchExistingHosts(
+      const envoy::config::endpoint::v3::ClusterLoadAssignment& cluster_load_assignment,
+      const HostMap& existing_hosts);
+
+  /**
+   * @return the prepared endpoint for the lb_endpoint at endpoint_index of the locality at
+   *         locality_index of the assignment.
+   */
+  const PreparedEdsEndpoint& endpoint(int locality_index, int endpoint_index) const {
+    return localities_[locality_index][endpoint_index];
+  }
+
+  /**
+   * @return the number of endpoints that matched an existing host.
+   */
+  uint64_t existingHosts() const { return existing_hosts_; }
+
+private:
+  std::vector<std::vector<PreparedEdsEndpoint>> localities_;
+  uint64_t existing_hosts_{};
+};
+
+using PreparedEdsUpdatePtr = std::unique_ptr<PreparedEdsUpdate>;
+
+/**
+ * A pool of threads that EDS clusters prepare their updates on, so that large updates do not stall
+ * the main thread. Shared by all EDS clusters through the singleton manager.
+ */
+class EdsUpdatePipeline : public Singleton::Instance, Logger::Loggable<Logger::Id::upstream> {
+public:
+  EdsUpdatePipeline(Thread::ThreadFactory& thread_factory, uint32_t threads);
+  ~EdsUpdatePipeline() override;
+
+  /**
+   * Runs a job on one of the threads of the pipeline. Jobs that did not start running when the
+   * pipeline is destroyed are dropped.
+   */
+  void post(std::function<void()> job);
+
+private:
+  void threadRoutine();
+  bool hasJobOrShutdown() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return shutdown_ || !jobs_.empty();
+  }
+
+  mutable absl::Mutex mutex_;
+  std::deque<std::function<void()>> jobs_ ABSL_GUARDED_BY(mutex_);
+  bool shutdown_ ABSL_GUARDED_BY(mutex_){};
+  std::vector<Thread::ThreadPtr> threads_;
+};
+
+using EdsUpdatePipelineSharedPtr = std::shared_ptr<EdsUpdatePipeline>;
+
+} // namespace Upstream
+} // namespace Envoy
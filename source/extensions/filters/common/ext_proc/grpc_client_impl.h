@@ -103,7 +103,8 @@ ProcessorStreamImpl<RequestType, ResponseType>::create(
   auto stream = std::unique_ptr<ProcessorStreamImpl<RequestType, ResponseType>>(
       new ProcessorStreamImpl<RequestType, ResponseType>(callbacks, service_method));
 
-  if (stream->grpcSidestreamFlowControl()) {
+  // Callers that handle the watermarks of the stream themselves set their own callbacks.
+  if (stream->grpcSidestreamFlowControl() && options.sidestream_watermark_callbacks == nullptr) {
     options.setSidestreamWatermarkCallbacks(&sidestream_watermark_callbacks);
   }
 
@@ -67,6 +67,16 @@ absl::Status verifyFilterConfig(
                                       "be set to none-default at the same time.");
   }
 
+  if (config.multiplexed_processor_streams() > 0 && config.has_http_service()) {
+    return absl::InvalidArgumentError(
+        "multiplexed_processor_streams can only be used with grpc_service");
+  }
+
+  if (config.multiplexed_processor_streams() > 0 && config.grpc_service().has_retry_policy()) {
+    return absl::InvalidArgumentError(
+        "multiplexed_processor_streams can not be used with a grpc_service retry_policy");
+  }
+
   return verifyProcessingModeConfig(config);
 }
 
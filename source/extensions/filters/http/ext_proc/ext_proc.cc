@@ -238,7 +238,8 @@ FilterConfig::FilterConfig(const ExternalProcessor& config,
           createOnProcessingResponseCb(config, context, stats_prefix)),
       thread_local_stream_manager_slot_(context.threadLocal().allocateSlot()),
       remote_close_timeout_(context.runtime().snapshot().getInteger(
-          RemoteCloseTimeout, DefaultRemoteCloseTimeoutMilliseconds)) {
+          RemoteCloseTimeout, DefaultRemoteCloseTimeoutMilliseconds)),
+      multiplexed_processor_streams_(config.multiplexed_processor_streams()) {
 
   if (config.disable_clear_route_cache()) {
     route_cache_action_ = ExternalProcessor::RETAIN;
@@ -419,8 +420,24 @@ Filter::StreamOpenState Filter::openStream() {
                        .setRemoteCloseTimeout(config_->remoteCloseTimeout());
 
     ExternalProcessorClient* grpc_client = dynamic_cast<ExternalProcessorClient*>(client_.get());
-    ExternalProcessorStreamPtr stream_object =
-        grpc_client->start(*this, config_with_hash_key_, options, watermark_callbacks_);
+    ExternalProcessorStreamPtr stream_object;
+    // A shared stream cannot be retried on behalf of one HTTP stream, so a per-route gRPC service
+    // with a retry policy gets a dedicated stream.
+    if (config_->multiplexedProcessorStreams() > 0 && !grpc_service_.has_retry_policy()) {
+      stream_object = config_->threadLocalStreamManager()
+                          .multiplexedStreamPool(config_->multiplexedProcessorStreams(),
+                                                 config_->stats())
+                          .attach(*grpc_client, *this, config_with_hash_key_,
+                                  config_->remoteCloseTimeout(), decoder_callbacks_->activeSpan(),
+                                  decoder_callbacks_->dispatcher().timeSource());
+      if (stream_object == nullptr) {
+        // No shared stream could be started. Treat it like a failure to start a dedicated one.
+        onGrpcError(Grpc::Status::Unavailable, "failed to start a multiplexed processor stream");
+      }
+    } else {
+      stream_object =
+          grpc_client->start(*this, config_with_hash_key_, options, watermark_callbacks_);
+    }
 
     if (processing_complete_) {
       // Stream failed while starting and either onGrpcError or onGrpcClose was already called
@@ -1112,6 +1129,13 @@ void Filter::logStreamInfo() {
   if (stream_ != nullptr && grpc_service_.has_envoy_grpc()) {
     // Envoy gRPC service
     logStreamInfoBase(&stream_->streamInfo());
+    const auto* multiplexed = dynamic_cast<const MultiplexedProcessorStream*>(stream_);
+    if (multiplexed != nullptr && logging_info_ != nullptr) {
+      // The byte meters of a shared stream count the messages of every HTTP stream multiplexed
+      // over it, so log the bytes of this HTTP stream's own messages instead.
+      logging_info_->setBytesSent(multiplexed->bytesSent());
+      logging_info_->setBytesReceived(multiplexed->bytesReceived());
+    }
   }
 }
 
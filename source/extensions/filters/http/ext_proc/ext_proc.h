@@ -26,6 +26,7 @@
 #include "source/extensions/filters/http/common/pass_through_filter.h"
 #include "source/extensions/filters/http/ext_proc/client_impl.h"
 #include "source/extensions/filters/http/ext_proc/matching_utils.h"
+#include "source/extensions/filters/http/ext_proc/multiplexed_stream.h"
 #include "source/extensions/filters/http/ext_proc/on_processing_response.h"
 #include "source/extensions/filters/http/ext_proc/processor_state.h"
 
@@ -50,7 +51,10 @@ namespace ExternalProcessing {
   COUNTER(clear_route_cache_disabled)                                                              \
   COUNTER(clear_route_cache_upstream_ignored)                                                      \
   COUNTER(send_immediate_resp_upstream_ignored)                                                    \
-  COUNTER(http_not_ok_resp_received)
+  COUNTER(http_not_ok_resp_received)                                                               \
+  COUNTER(multiplexed_streams_started)                                                             \
+  COUNTER(multiplexed_msgs_dropped)                                                                \
+  COUNTER(multiplexed_send_buffer_overflows)
 
 struct ExtProcFilterStats {
   ALL_EXT_PROC_FILTER_STATS(GENERATE_COUNTER_STRUCT)
@@ -196,9 +200,24 @@ public:
     it->second->deferredClose(dispatcher);
   }
 
+  // Return the pool of processor streams shared by the HTTP streams of this worker, creating it on
+  // first use.
+  MultiplexedStreamPool& multiplexedStreamPool(uint32_t max_streams,
+                                               const ExtProcFilterStats& stats) {
+    if (multiplexed_stream_pool_ == nullptr) {
+      multiplexed_stream_pool_ = std::make_unique<MultiplexedStreamPool>(
+          max_streams, stats.multiplexed_streams_started_, stats.multiplexed_msgs_dropped_,
+          stats.multiplexed_send_buffer_overflows_);
+    }
+    return *multiplexed_stream_pool_;
+  }
+
 private:
   // Map of DeferredDeletableStreamPtrs with ExternalProcessorStream pointer as key.
   absl::flat_hash_map<ExternalProcessorStream*, DeferredDeletableStreamPtr> stream_manager_;
+  // Declared after stream_manager_ so that the shared streams are closed before the per HTTP
+  // stream handles that reference them are destroyed.
+  MultiplexedStreamPoolPtr multiplexed_stream_pool_;
 };
 
 class FilterConfig {
@@ -285,6 +304,8 @@ public:
 
   std::chrono::milliseconds remoteCloseTimeout() const { return remote_close_timeout_; }
 
+  uint32_t multiplexedProcessorStreams() const { return multiplexed_processor_streams_; }
+
   std::unique_ptr<OnProcessingResponse> createOnProcessingResponse() const;
 
 private:
@@ -335,6 +356,8 @@ private:
 
   ThreadLocal::SlotPtr thread_local_stream_manager_slot_;
   const std::chrono::milliseconds remote_close_timeout_;
+  // Zero when every HTTP stream opens its own gRPC stream to the processor.
+  const uint32_t multiplexed_processor_streams_;
 };
 
 using FilterConfigSharedPtr = std::shared_ptr<FilterConfig>;
@@ -0,0 +1,247 @@
+#include "source/extensions/filters/http/ext_proc/multiplexed_stream.h"
+
+#include <algorithm>
+
+#include "source/common/grpc/codec.h"
+#include "source/common/tracing/common_values.h"
+#include "source/common/tracing/tracer_impl.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace ExternalProcessing {
+
+SharedProcessorStream::SharedProcessorStream(
+    MultiplexedStreamPool& parent, const Grpc::GrpcServiceConfigWithHashKey& config_with_hash_key)
+    : parent_(&parent), config_with_hash_key_(config_with_hash_key) {}
+
+SharedProcessorStream::~SharedProcessorStream() { closeGrpcStream(); }
+
+void SharedProcessorStream::closeGrpcStream() {
+  if (stream_ != nullptr && !close_called_) {
+    close_called_ = true;
+    stream_->close();
+  }
+}
+
+bool SharedProcessorStream::start(ExternalProcessorClient& client,
+                                  std::chrono::milliseconds remote_close_timeout) {
+  // The shared stream outlives every HTTP stream that uses it, so it has no parent stream, span
+  // or retry buffer. It watches its own watermarks to bound its send buffer.
+  auto options = Http::AsyncClient::StreamOptions()
+                     .setSampled(absl::nullopt)
+                     .setRemoteCloseTimeout(remote_close_timeout)
+                     .setSidestreamWatermarkCallbacks(this);
+  stream_ = client.start(*this, config_with_hash_key_, options, watermark_callbacks_);
+  if (stream_ == nullptr) {
+    closed_ = true;
+    return false;
+  }
+  return !closed_;
+}
+
+void SharedProcessorStream::attach(uint64_t stream_id, ExternalProcessorCallbacks& callbacks,
+                                   MultiplexedProcessorStream& stream) {
+  ASSERT(!closed_);
+  attached_[stream_id] = {&callbacks, &stream};
+}
+
+void SharedProcessorStream::detach(uint64_t stream_id) { attached_.erase(stream_id); }
+
+void SharedProcessorStream::send(ProcessingRequest&& request) {
+  if (closed_) {
+    ENVOY_LOG(debug, "Dropping message for multiplexed stream {}: shared stream is closed",
+              request.multiplexed_stream_id());
+    return;
+  }
+  // The shared stream is never half-closed on behalf of a single HTTP stream.
+  stream_->send(std::move(request), false);
+}
+
+void SharedProcessorStream::onSendBufferOverflow(uint64_t stream_id) {
+  ENVOY_LOG(debug, "Dropping messages of multiplexed stream {}: shared stream send buffer is full",
+            stream_id);
+  if (parent_ != nullptr) {
+    parent_->onSendBufferOverflow();
+  }
+}
+
+void SharedProcessorStream::orphan() {
+  parent_ = nullptr;
+  closed_ = true;
+  closeGrpcStream();
+}
+
+void SharedProcessorStream::onReceiveMessage(std::unique_ptr<ProcessingResponse>&& response) {
+  auto it = attached_.find(response->multiplexed_stream_id());
+  if (it == attached_.end()) {
+    // The HTTP stream has finished or timed out before the processor answered.
+    ENVOY_LOG(debug, "Ignoring message for unknown multiplexed stream {}",
+              response->multiplexed_stream_id());
+    if (parent_ != nullptr) {
+      parent_->onUnknownStreamMessage();
+    }
+    return;
+  }
+  it->second.stream_->onReceiveMessage(*response);
+  it->second.callbacks_->onReceiveMessage(std::move(response));
+}
+
+void SharedProcessorStream::onGrpcError(Grpc::Status::GrpcStatus error,
+                                        const std::string& message) {
+  ENVOY_LOG(debug, "Shared processor stream failed with status {}: {}", error, message);
+  // Keep this object alive while the attached streams react; they may release the last handle.
+  auto self = shared_from_this();
+  for (const auto& [stream_id, attached] : onClosed(error)) {
+    attached.callbacks_->logStreamInfo();
+    attached.callbacks_->onGrpcError(error, message);
+  }
+}
+
+void SharedProcessorStream::onGrpcClose() {
+  ENVOY_LOG(debug, "Shared processor stream closed by the processor");
+  auto self = shared_from_this();
+  for (const auto& [stream_id, attached] : onClosed(Grpc::Status::WellKnownGrpcStatus::Ok)) {
+    attached.callbacks_->logStreamInfo();
+    attached.callbacks_->onGrpcClose();
+  }
+}
+
+SharedProcessorStream::AttachedStreamMap
+SharedProcessorStream::onClosed(Grpc::Status::GrpcStatus status) {
+  closed_ = true;
+  if (parent_ != nullptr) {
+    parent_->onSharedStreamClosed(*this);
+  }
+  AttachedStreamMap attached = std::move(attached_);
+  attached_.clear();
+  for (const auto& [stream_id, stream] : attached) {
+    stream.stream_->onSharedStreamClosed(status);
+  }
+  return attached;
+}
+
+void MultiplexedProcessorStream::send(ProcessingRequest&& request, bool) {
+  if (detached_) {
+    return;
+  }
+  if (shared_->aboveHighWatermark()) {
+    // Stop sending the messages of this HTTP stream rather than buffer them without bound. The
+    // filter's message timeout then applies as if the processor did not answer.
+    span_->setTag(Tracing::Tags::get().Error, Tracing::Tags::get().True);
+    span_->setTag(Tracing::Tags::get().ErrorReason, "send buffer overflow");
+    shared_->onSendBufferOverflow(stream_id_);
+    detach();
+    return;
+  }
+  request.set_multiplexed_stream_id(stream_id_);
+  bytes_sent_ += Grpc::GRPC_FRAME_HEADER_SIZE + request.ByteSizeLong();
+  shared_->send(std::move(request));
+}
+
+void MultiplexedProcessorStream::onReceiveMessage(const ProcessingResponse& response) {
+  bytes_received_ += Grpc::GRPC_FRAME_HEADER_SIZE + response.ByteSizeLong();
+}
+
+void MultiplexedProcessorStream::onSharedStreamClosed(Grpc::Status::GrpcStatus status) {
+  span_->setTag(Tracing::Tags::get().GrpcStatusCode, std::to_string(status));
+  if (status != Grpc::Status::WellKnownGrpcStatus::Ok) {
+    span_->setTag(Tracing::Tags::get().Error, Tracing::Tags::get().True);
+  }
+}
+
+bool MultiplexedProcessorStream::detach() {
+  if (detached_) {
+    return false;
+  }
+  detached_ = true;
+  span_->finishSpan();
+  shared_->detach(stream_id_);
+  return true;
+}
+
+MultiplexedStreamPool::~MultiplexedStreamPool() {
+  for (auto& stream : streams_) {
+    stream->orphan();
+  }
+}
+
+ExternalProcessorStreamPtr
+MultiplexedStreamPool::attach(ExternalProcessorClient& client,
+                              ExternalProcessorCallbacks& callbacks,
+                              const Grpc::GrpcServiceConfigWithHashKey& config_with_hash_key,
+                              std::chrono::milliseconds remote_close_timeout,
+                              Tracing::Span& parent_span, TimeSource& time_source) {
+  SharedProcessorStreamSharedPtr shared =
+      pickOrStart(client, config_with_hash_key, remote_close_timeout);
+  if (shared == nullptr) {
+    return nullptr;
+  }
+  const uint64_t stream_id = next_stream_id_++;
+  // The gRPC stream is not traced as part of any one request, so each HTTP stream traces its
+  // use of the shared stream in its own span.
+  Tracing::SpanPtr span = parent_span.spawnChild(
+      Tracing::EgressConfig::get(),
+      "async envoy.service.ext_proc.v3.ExternalProcessor.Process multiplexed",
+      time_source.systemTime());
+  const auto& grpc_service = config_with_hash_key.config();
+  if (grpc_service.has_envoy_grpc()) {
+    span->setTag(Tracing::Tags::get().UpstreamCluster, grpc_service.envoy_grpc().cluster_name());
+  }
+  span->setTag(Tracing::Tags::get().Component, Tracing::Tags::get().Proxy);
+  auto stream = std::make_unique<MultiplexedProcessorStream>(shared, stream_id, std::move(span));
+  shared->attach(stream_id, callbacks, *stream);
+  return stream;
+}
+
+SharedProcessorStreamSharedPtr
+MultiplexedStreamPool::pickOrStart(ExternalProcessorClient& client,
+                                   const Grpc::GrpcServiceConfigWithHashKey& config_with_hash_key,
+                                   std::chrono::milliseconds remote_close_timeout) {
+  SharedProcessorStreamSharedPtr least_loaded;
+  uint32_t matching = 0;
+  for (const auto& stream : streams_) {
+    if (!(stream->configWithHashKey() == config_with_hash_key)) {
+      continue;
+    }
+    ++matching;
+    if (stream->aboveHighWatermark()) {
+      continue;
+    }
+    if (least_loaded == nullptr || stream->attachedStreams() < least_loaded->attachedStreams()) {
+      least_loaded = stream;
+    }
+  }
+  // Grow the pool until it is full, unless an existing stream is idle.
+  if (least_loaded != nullptr &&
+      (matching >= max_streams_ || least_loaded->attachedStreams() == 0)) {
+    return least_loaded;
+  }
+  if (matching >= max_streams_) {
+    ENVOY_LOG(debug, "Every shared processor stream is above its high watermark");
+    return nullptr;
+  }
+
+  auto stream = std::make_shared<SharedProcessorStream>(*this, config_with_hash_key);
+  if (!stream->start(client, remote_close_timeout)) {
+    ENVOY_LOG(debug, "Failed to start shared processor stream");
+    // Fall back to an existing stream, if any.
+    return least_loaded;
+  }
+  shared_streams_started_.inc();
+  streams_.push_back(stream);
+  return stream;
+}
+
+void MultiplexedStreamPool::onSharedStreamClosed(SharedProcessorStream& stream) {
+  streams_.erase(std::remove_if(streams_.begin(), streams_.end(),
+                                [&stream](const SharedProcessorStreamSharedPtr& candidate) {
+                                  return candidate.get() == &stream;
+                                }),
+                 streams_.end());
+}
+
+} // namespace ExternalProcessing
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/common/time.h"
+#include "envoy/grpc/async_client_manager.h"
+#include "envoy/service/ext_proc/v3/external_processor.pb.h"
+#include "envoy/stats/stats.h"
+#include "envoy/tracing/tracer.h"
+
+#include "source/common/common/logger.h"
+#include "source/common/http/sidestream_watermark.h"
+#include "source/extensions/filters/http/ext_proc/client_impl.h"
+
+#include "absl/container/flat_hash_map.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace ExternalProcessing {
+
+class MultiplexedStreamPool;
+class MultiplexedProcessorStream;
+
+/**
+ * A long-lived gRPC stream to the external processor that carries the messages of many HTTP
+ * streams. Every ProcessingRequest is tagged with the multiplexed_stream_id of the HTTP stream
+ * that sent it, and every ProcessingResponse is routed back by the same id. Each HTTP stream is
+ * pinned to one shared stream, so gRPC ordering gives per HTTP stream message ordering.
+ *
+ * The stream is above its high watermark while the gRPC stream's send buffer is over the buffer
+ * limit of the processor cluster. No HTTP stream is attached to it and no message is sent on it
+ * until it drains, so that its send buffer stays bounded.
+ */
+class SharedProcessorStream : public ExternalProcessorCallbacks,
+                              public Http::SidestreamWatermarkCallbacks,
+                              public std::enable_shared_from_this<SharedProcessorStream>,
+                              public Logger::Loggable<Logger::Id::ext_proc> {
+public:
+  SharedProcessorStream(MultiplexedStreamPool& parent,
+                        const Grpc::GrpcServiceConfigWithHashKey& config_with_hash_key);
+  ~SharedProcessorStream() override;
+
+  // Start the underlying gRPC stream. Returns false if the stream could not be started.
+  bool start(ExternalProcessorClient& client, std::chrono::milliseconds remote_close_timeout);
+
+  void attach(uint64_t stream_id, ExternalProcessorCallbacks& callbacks,
+              MultiplexedProcessorStream& stream);
+  void detach(uint64_t stream_id);
+  void send(ProcessingRequest&& request);
+  // Called when an HTTP stream stops sending because this stream is above its high watermark.
+  void onSendBufferOverflow(uint64_t stream_id);
+  // Called when the owning pool is destroyed before this stream. Closes the gRPC stream.
+  void orphan();
+
+  const Grpc::GrpcServiceConfigWithHashKey& configWithHashKey() const {
+    return config_with_hash_key_;
+  }
+  size_t attachedStreams() const { return attached_.size(); }
+  bool closed() const { return closed_; }
+  bool aboveHighWatermark() const { return high_watermark_count_ > 0; }
+  const StreamInfo::StreamInfo& streamInfo() const { return stream_->streamInfo(); }
+  StreamInfo::StreamInfo& streamInfo() { return stream_->streamInfo(); }
+
+  // ExternalProcessorCallbacks
+  void onReceiveMessage(std::unique_ptr<ProcessingResponse>&& response) override;
+  void onGrpcError(Grpc::Status::GrpcStatus error, const std::string& message) override;
+  void onGrpcClose() override;
+  void logStreamInfo() override {}
+  void onComplete(ProcessingResponse&) override {}
+  void onError() override {}
+
+  // Http::SidestreamWatermarkCallbacks
+  void onSidestreamAboveHighWatermark() override { ++high_watermark_count_; }
+  void onSidestreamBelowLowWatermark() override {
+    if (high_watermark_count_ > 0) {
+      --high_watermark_count_;
+    }
+  }
+  void addDownstreamWatermarkCallbacks(Http::DownstreamWatermarkCallbacks&) override {}
+  void removeDownstreamWatermarkCallbacks(Http::DownstreamWatermarkCallbacks&) override {}
+
+private:
+  struct AttachedStream {
+    ExternalProcessorCallbacks* callbacks_;
+    MultiplexedProcessorStream* stream_;
+  };
+  using AttachedStreamMap = absl::flat_hash_map<uint64_t, AttachedStream>;
+
+  // Mark the stream closed, remove it from the pool and detach every HTTP stream. Returns the
+  // streams that were attached so that the caller can notify them.
+  AttachedStreamMap onClosed(Grpc::Status::GrpcStatus status);
+  // Close the gRPC stream at most once. Closing after a remote close is a no-op.
+  void closeGrpcStream();
+
+  // Null once the owning pool has been destroyed.
+  MultiplexedStreamPool* parent_;
+  const Grpc::GrpcServiceConfigWithHashKey config_with_hash_key_;
+  // Not used: the stream handles its own watermarks rather than pushing back on one HTTP stream.
+  Http::StreamFilterSidestreamWatermarkCallbacks watermark_callbacks_;
+  // Kept after the gRPC stream closes so that attached HTTP streams can still read its stream info.
+  ExternalProcessorStreamPtr stream_;
+  // No more messages are sent once closed, either remotely or because the pool went away.
+  bool closed_{false};
+  bool close_called_{false};
+  // The stream and the connection report their watermarks separately.
+  uint32_t high_watermark_count_{0};
+  AttachedStreamMap attached_;
+};
+
+using SharedProcessorStreamSharedPtr = std::shared_ptr<SharedProcessorStream>;
+
+/**
+ * The view of a shared processor stream that is handed to a single HTTP stream. It is used by the
+ * filter exactly like a dedicated ExternalProcessorStream, but closing it only detaches the HTTP
+ * stream; the shared gRPC stream stays open for other HTTP streams.
+ *
+ * The stream info of the shared stream covers every HTTP stream multiplexed over it, so the view
+ * counts the bytes of its own messages, and traces them in its own span.
+ */
+class MultiplexedProcessorStream : public ExternalProcessorStream {
+public:
+  MultiplexedProcessorStream(SharedProcessorStreamSharedPtr shared, uint64_t stream_id,
+                             Tracing::SpanPtr span)
+      : shared_(std::move(shared)), stream_id_(stream_id), span_(std::move(span)) {}
+  ~MultiplexedProcessorStream() override { detach(); }
+
+  uint64_t streamId() const { return stream_id_; }
+  // The size of the gRPC messages sent and received for this HTTP stream, including their gRPC
+  // frame headers.
+  uint64_t bytesSent() const { return bytes_sent_; }
+  uint64_t bytesReceived() const { return bytes_received_; }
+
+  // Called by the shared stream for every response routed to this HTTP stream.
+  void onReceiveMessage(const ProcessingResponse& response);
+  // Called by the shared stream when it closes while this HTTP stream is attached.
+  void onSharedStreamClosed(Grpc::Status::GrpcStatus status);
+
+  // ExternalProcessorStream
+  void send(ProcessingRequest&& request, bool end_stream) override;
+  bool close() override { return detach(); }
+  bool halfCloseAndDeleteOnRemoteClose() override { return detach(); }
+  const StreamInfo::StreamInfo& streamInfo() const override { return shared_->streamInfo(); }
+  StreamInfo::StreamInfo& streamInfo() override { return shared_->streamInfo(); }
+  void notifyFilterDestroy() override { detach(); }
+
+private:
+  bool detach();
+
+  const SharedProcessorStreamSharedPtr shared_;
+  const uint64_t stream_id_;
+  // Finished when the HTTP stream detaches.
+  const Tracing::SpanPtr span_;
+  uint64_t bytes_sent_{0};
+  uint64_t bytes_received_{0};
+  bool detached_{false};
+};
+
+/**
+ * Per worker pool of shared processor streams for one filter config. HTTP streams are spread over
+ * at most max_streams shared streams per gRPC service, preferring the least loaded one that is
+ * below its high watermark.
+ */
+class MultiplexedStreamPool : public Logger::Loggable<Logger::Id::ext_proc> {
+public:
+  MultiplexedStreamPool(uint32_t max_streams, Stats::Counter& shared_streams_started,
+                        Stats::Counter& unknown_stream_msgs, Stats::Counter& send_buffer_overflows)
+      : max_streams_(max_streams), shared_streams_started_(shared_streams_started),
+        unknown_stream_msgs_(unknown_stream_msgs), send_buffer_overflows_(send_buffer_overflows) {}
+
+  // Attach a new HTTP stream to a shared processor stream, starting one if needed. The messages of
+  // the HTTP stream are traced in a child of parent_span. Returns nullptr if no shared stream
+  // could be started, or if every shared stream is full and above its high watermark.
+  ExternalProcessorStreamPtr attach(ExternalProcessorClient& client,
+                                    ExternalProcessorCallbacks& callbacks,
+                                    const Grpc::GrpcServiceConfigWithHashKey& config_with_hash_key,
+                                    std::chrono::milliseconds remote_close_timeout,
+                                    Tracing::Span& parent_span, TimeSource& time_source);
+
+  ~MultiplexedStreamPool();
+
+  // Called by a shared stream once its gRPC stream has closed.
+  void onSharedStreamClosed(SharedProcessorStream& stream);
+  void onUnknownStreamMessage() { unknown_stream_msgs_.inc(); }
+  void onSendBufferOverflow() { send_buffer_overflows_.inc(); }
+
+  size_t size() const { return streams_.size(); }
+
+private:
+  SharedProcessorStreamSharedPtr
+  pickOrStart(ExternalProcessorClient& client,
+              const Grpc::GrpcServiceConfigWithHashKey& config_with_hash_key,
+              std::chrono::milliseconds remote_close_timeout);
+
+  const uint32_t max_streams_;
+  Stats::Counter& shared_streams_started_;
+  Stats::Counter& unknown_stream_msgs_;
+  Stats::Counter& send_buffer_overflows_;
+  std::vector<SharedProcessorStreamSharedPtr> streams_;
+  // Zero is reserved for requests that are not multiplexed.
+  uint64_t next_stream_id_{1};
+};
+
+using MultiplexedStreamPoolPtr = std::unique_ptr<MultiplexedStreamPool>;
+
+} // namespace ExternalProcessing
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
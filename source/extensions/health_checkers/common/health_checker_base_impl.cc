@@ -37,6 +37,11 @@ HealthCheckerImplBase::HealthCheckerImplBase(const Cluster& cluster,
           PROTOBUF_GET_MS_OR_DEFAULT(config, unhealthy_edge_interval, unhealthy_interval_.count())),
       healthy_edge_interval_(
           PROTOBUF_GET_MS_OR_DEFAULT(config, healthy_edge_interval, interval_.count())),
+      timer_wheel_(config.has_timer_wheel_tick()
+                       ? std::make_unique<Event::TimerWheelImpl>(
+                             dispatcher, std::chrono::milliseconds(
+                                             PROTOBUF_GET_MS_REQUIRED(config, timer_wheel_tick)))
+                       : nullptr),
       transport_socket_options_(initTransportSocketOptions(config)),
       transport_socket_match_metadata_(initTransportSocketMatchMetadata(config)),
       member_update_cb_{cluster_.prioritySet().addMemberUpdateCb(
@@ -171,6 +176,13 @@ void HealthCheckerImplBase::addHosts(const HostVector& hosts) {
   }
 }
 
+Event::TimerPtr HealthCheckerImplBase::createTimer(Event::TimerCb cb) {
+  if (timer_wheel_ != nullptr) {
+    return timer_wheel_->createTimer(std::move(cb));
+  }
+  return dispatcher_.createTimer(std::move(cb));
+}
+
 void HealthCheckerImplBase::onClusterMemberUpdate(const HostVector& hosts_added,
                                                   const HostVector& hosts_removed) {
   addHosts(hosts_added);
@@ -240,8 +252,8 @@ void HealthCheckerImplBase::start() {
 HealthCheckerImplBase::ActiveHealthCheckSession::ActiveHealthCheckSession(
     HealthCheckerImplBase& parent, HostSharedPtr host)
     : host_(host), parent_(parent),
-      interval_timer_(parent.dispatcher_.createTimer([this]() -> void { onIntervalBase(); })),
-      timeout_timer_(parent.dispatcher_.createTimer([this]() -> void { onTimeoutBase(); })),
+      interval_timer_(parent.createTimer([this]() -> void { onIntervalBase(); })),
+      timeout_timer_(parent.createTimer([this]() -> void { onTimeoutBase(); })),
       time_source_(parent.dispatcher_.timeSource()) {
 
   if (!host->healthFlagGet(Host::HealthFlag::FAILED_ACTIVE_HC)) {
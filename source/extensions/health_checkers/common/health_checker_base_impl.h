@@ -13,6 +13,7 @@
 
 #include "source/common/common/logger.h"
 #include "source/common/common/matchers.h"
+#include "source/common/event/timer_wheel_impl.h"
 #include "source/common/network/transport_socket_options_impl.h"
 
 namespace Envoy {
@@ -130,6 +131,7 @@ private:
   };
 
   void addHosts(const HostVector& hosts);
+  Event::TimerPtr createTimer(Event::TimerCb cb);
   void decHealthy();
   void decDegraded();
   HealthCheckerStats generateStats(Stats::Scope& scope);
@@ -158,6 +160,8 @@ private:
   const std::chrono::milliseconds unhealthy_interval_;
   const std::chrono::milliseconds unhealthy_edge_interval_;
   const std::chrono::milliseconds healthy_edge_interval_;
+  // Schedules the timers of the sessions if timer_wheel_tick is configured.
+  const Event::TimerWheelImplPtr timer_wheel_;
   absl::node_hash_map<HostSharedPtr, ActiveHealthCheckSessionPtr> active_sessions_;
   const std::shared_ptr<const Network::TransportSocketOptionsImpl> transport_socket_options_;
   const MetadataConstSharedPtr transport_socket_match_metadata_;
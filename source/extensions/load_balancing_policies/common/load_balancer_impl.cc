@@ -19,6 +19,7 @@
 #include "source/common/runtime/runtime_features.h"
 
 #include "absl/container/fixed_array.h"
+#include "absl/container/flat_hash_set.h"
 
 namespace Envoy {
 namespace Upstream {
@@ -888,8 +889,9 @@ EdfLoadBalancerBase::EdfLoadBalancerBase(
                                          : 0.1) {
   // We fully recompute the schedulers for a given host set here on membership change, which is
   // consistent with what other LB implementations do (e.g. thread aware).
-  // The downside of a full recompute is that time complexity is O(n * log n),
-  // so we will need to do better at delta tracking to scale (see
+  // The downside of a full recompute is that time complexity is O(n * log n), so when the
+  // envoy.reloadable_features.edf_lb_incremental_refresh runtime feature is enabled, small
+  // membership changes are applied to the existing schedulers as deltas instead (see
   // https://github.com/envoyproxy/envoy/issues/2874).
   priority_update_cb_ = priority_set.addPriorityUpdateCb(
       [this](uint32_t priority, const HostVector&, const HostVector&) {
@@ -935,9 +937,56 @@ void EdfLoadBalancerBase::recalculateHostsInSlowStart(const HostVector& hosts) {
   }
 }
 
+bool EdfLoadBalancerBase::updateScheduler(Scheduler& scheduler, const HostVector& hosts) {
+  if (scheduler.edf_ == nullptr) {
+    return false;
+  }
+  absl::flat_hash_set<const Host*> current_hosts;
+  current_hosts.reserve(hosts.size());
+  for (const auto& host : hosts) {
+    current_hosts.insert(host.get());
+  }
+  absl::flat_hash_set<const Host*> previous_hosts;
+  previous_hosts.reserve(scheduler.hosts_.size());
+  HostVector hosts_removed;
+  for (const auto& host : scheduler.hosts_) {
+    previous_hosts.insert(host.get());
+    if (!current_hosts.contains(host.get())) {
+      hosts_removed.push_back(host);
+    }
+  }
+  HostVector hosts_added;
+  for (const auto& host : hosts) {
+    if (!previous_hosts.contains(host.get())) {
+      hosts_added.push_back(host);
+    }
+  }
+
+  // Removed hosts stay queued until they are next picked, so rebuild the scheduler instead when
+  // a large part of the host set changes. This bounds the queue to twice the size of the host set.
+  if ((hosts_added.size() + hosts_removed.size()) * 2 > hosts.size()) {
+    return false;
+  }
+  for (const auto& host : hosts_removed) {
+    scheduler.edf_->remove(host);
+  }
+  // New hosts are scheduled as if added just now, i.e. at the current deadline plus their
+  // inverse weight, which keeps them from being picked ahead of hosts already queued.
+  for (const auto& host : hosts_added) {
+    scheduler.edf_->add(hostWeight(*host), host);
+  }
+  scheduler.hosts_ = hosts;
+  return true;
+}
+
 void EdfLoadBalancerBase::refresh(uint32_t priority) {
-  const auto add_hosts_source = [this](HostsSource source, const HostVector& hosts) {
-    // Nuke existing scheduler if it exists.
+  const bool incremental_refresh =
+      Runtime::runtimeFeatureEnabled("envoy.reloadable_features.edf_lb_incremental_refresh");
+  const auto add_hosts_source = [this, incremental_refresh](HostsSource source,
+                                                            const HostVector& hosts) {
+    // Take the existing scheduler, if any, so that it may be updated in place, and otherwise nuke
+    // it.
+    Scheduler previous_scheduler = std::move(scheduler_[source]);
     auto& scheduler = scheduler_[source] = Scheduler{};
     refreshHostSource(source);
     if (isSlowStartEnabled()) {
@@ -960,6 +1009,14 @@ void EdfLoadBalancerBase::refresh(uint32_t priority) {
       return;
     }
 
+    if (incremental_refresh) {
+      if (updateScheduler(previous_scheduler, hosts)) {
+        scheduler = std::move(previous_scheduler);
+        return;
+      }
+      scheduler.hosts_ = hosts;
+    }
+
     // Populate the scheduler with the host list with a randomized starting point.
     // TODO(mattklein123): We must build the EDF schedule even if all of the hosts are currently
     // weighted 1. This is because currently we don't refresh host sets if only weights change.
@@ -474,12 +474,19 @@ protected:
     // host weights of 2 or more hosts differ. When not present, the
     // implementation of chooseHostOnce falls back to unweightedHostPick.
     std::unique_ptr<EdfScheduler<Host>> edf_;
+    // The hosts the edf_ was last built or updated with. Only tracked when incremental refresh is
+    // enabled, to compute the delta to apply on the next refresh.
+    HostVector hosts_;
   };
 
   void initialize();
 
   virtual void refresh(uint32_t priority);
 
+  // Applies the hosts added to and removed from a scheduler since its last refresh to its edf_ in
+  // place. Returns false if the scheduler should be rebuilt instead.
+  bool updateScheduler(Scheduler& scheduler, const HostVector& hosts);
+
   bool isSlowStartEnabled() const;
   bool noHostsAreInSlowStart() const;
 
@@ -115,6 +115,7 @@ absl::Status ThreadAwareLoadBalancerBase::refresh() {
       std::make_shared<HealthyLoad>(per_priority_load_.healthy_priority_load_);
   auto degraded_per_priority_load =
       std::make_shared<DegradedLoad>(per_priority_load_.degraded_priority_load_);
+  built_lbs_.resize(priority_set_.hostSetsPerPriority().size());
 
   for (const auto& host_set : priority_set_.hostSetsPerPriority()) {
     const uint32_t priority = host_set->priority();
@@ -132,8 +133,25 @@ absl::Status ThreadAwareLoadBalancerBase::refresh() {
                                            normalized_host_weights, min_normalized_weight,
                                            max_normalized_weight, locality_weighted_balancing_);
     RETURN_IF_NOT_OK(status);
-    per_priority_state->current_lb_ = createLoadBalancer(
-        std::move(normalized_host_weights), min_normalized_weight, max_normalized_weight);
+
+    std::vector<MetadataConstSharedPtr> host_metadata;
+    host_metadata.reserve(normalized_host_weights.size());
+    for (const auto& host_weight : normalized_host_weights) {
+      host_metadata.push_back(host_weight.first->metadata());
+    }
+    BuiltLoadBalancer& built_lb = built_lbs_[priority];
+    if (built_lb.lb_ == nullptr || built_lb.normalized_host_weights_ != normalized_host_weights ||
+        built_lb.host_metadata_ != host_metadata ||
+        built_lb.min_normalized_weight_ != min_normalized_weight ||
+        built_lb.max_normalized_weight_ != max_normalized_weight) {
+      built_lb.lb_ = createLoadBalancer(priority, normalized_host_weights, min_normalized_weight,
+                                        max_normalized_weight);
+      built_lb.normalized_host_weights_ = std::move(normalized_host_weights);
+      built_lb.host_metadata_ = std::move(host_metadata);
+      built_lb.min_normalized_weight_ = min_normalized_weight;
+      built_lb.max_normalized_weight_ = max_normalized_weight;
+    }
+    per_priority_state->current_lb_ = built_lb.lb_;
   }
 
   {
@@ -209,14 +227,14 @@ double ThreadAwareLoadBalancerBase::BoundedLoadHashingLoadBalancer::hostOverload
   const uint32_t slots =
       std::max(static_cast<uint32_t>(std::ceil(total_slots * weight)), static_cast<uint32_t>(1));
 
-  if (host.stats().rq_active_.value() > slots) {
+  if (host_active > slots) {
     ENVOY_LOG_MISC(
         debug,
         "ThreadAwareLoadBalancerBase::BoundedLoadHashingLoadBalancer::chooseHost: "
         "host {} overloaded; overall_active {}, host_weight {}, host_active {} > slots {}",
         host.address()->asString(), overall_active, weight, host_active, slots);
   }
-  return static_cast<double>(host.stats().rq_active_.value()) / slots;
+  return static_cast<double>(host_active) / slots;
 }
 
 HostSelectionResponse
@@ -163,14 +163,35 @@ private:
     std::shared_ptr<DegradedLoad> degraded_per_priority_load_ ABSL_GUARDED_BY(mutex_);
   };
 
+  // The inputs that a priority's load balancer was last built from.
+  struct BuiltLoadBalancer {
+    NormalizedHostWeightVector normalized_host_weights_;
+    // Hash keys may be derived from host metadata, which is updated in place.
+    std::vector<MetadataConstSharedPtr> host_metadata_;
+    double min_normalized_weight_{};
+    double max_normalized_weight_{};
+    HashingLoadBalancerSharedPtr lb_;
+  };
+
+  /**
+   * Creates the hashing load balancer for a priority. Implementations may keep state across
+   * calls for the same priority, e.g. to update their previous load balancer incrementally.
+   * @param priority supplies the priority the load balancer is for.
+   * @param normalized_host_weights supplies the hosts and their normalized weights.
+   * @param min_normalized_weight supplies the smallest normalized weight.
+   * @param max_normalized_weight supplies the largest normalized weight.
+   */
   virtual HashingLoadBalancerSharedPtr
-  createLoadBalancer(const NormalizedHostWeightVector& normalized_host_weights,
+  createLoadBalancer(uint32_t priority, const NormalizedHostWeightVector& normalized_host_weights,
                      double min_normalized_weight, double max_normalized_weight) PURE;
   absl::Status refresh();
 
   std::shared_ptr<LoadBalancerFactoryImpl> factory_;
   const bool locality_weighted_balancing_{};
   Common::CallbackHandlePtr priority_update_cb_;
+  // Indexed by priority. A priority update refreshes every priority, so the load balancers of
+  // priorities whose hosts, weights and metadata did not change are reused rather than rebuilt.
+  std::vector<BuiltLoadBalancer> built_lbs_;
 };
 
 } // namespace Upstream
@@ -26,11 +26,10 @@ double LeastRequestLoadBalancer::hostWeight(const Host& host) const {
 
   // If the value of active requests is the max value, adding +1 will overflow
   // it and cause a divide by zero. This won't happen in normal cases but stops
-  // failing fuzz tests
+  // failing fuzz tests. The gauge may be sharded, so it is only read once.
+  const uint64_t active_rq = host.stats().rq_active_.value();
   const uint64_t active_request_value =
-      host.stats().rq_active_.value() != std::numeric_limits<uint64_t>::max()
-          ? host.stats().rq_active_.value() + 1
-          : host.stats().rq_active_.value();
+      active_rq != std::numeric_limits<uint64_t>::max() ? active_rq + 1 : active_rq;
 
   if (active_request_bias_ == 1.0) {
     host_weight = static_cast<double>(host.weight()) / active_request_value;
@@ -74,6 +73,8 @@ HostConstSharedPtr LeastRequestLoadBalancer::unweightedHostPick(const HostVector
 
 HostSharedPtr LeastRequestLoadBalancer::unweightedHostPickFullScan(const HostVector& hosts_to_use) {
   HostSharedPtr candidate_host = nullptr;
+  // Reading rq_active sums its shards when it is sharded, so the value of the candidate is kept.
+  uint64_t candidate_active_rq = 0;
 
   size_t num_hosts_known_tied_for_least = 0;
 
@@ -86,16 +87,17 @@ HostSharedPtr LeastRequestLoadBalancer::unweightedHostPickFullScan(const HostVec
       // Make a first choice to start the comparisons.
       num_hosts_known_tied_for_least = 1;
       candidate_host = sampled_host;
+      candidate_active_rq = sampled_host->stats().rq_active_.value();
       continue;
     }
 
-    const auto candidate_active_rq = candidate_host->stats().rq_active_.value();
-    const auto sampled_active_rq = sampled_host->stats().rq_active_.value();
+    const uint64_t sampled_active_rq = sampled_host->stats().rq_active_.value();
 
     if (sampled_active_rq < candidate_active_rq) {
       // Reset the count of known tied hosts.
       num_hosts_known_tied_for_least = 1;
       candidate_host = sampled_host;
+      candidate_active_rq = sampled_active_rq;
     } else if (sampled_active_rq == candidate_active_rq) {
       ++num_hosts_known_tied_for_least;
 
@@ -118,6 +120,7 @@ HostSharedPtr LeastRequestLoadBalancer::unweightedHostPickFullScan(const HostVec
 
 HostSharedPtr LeastRequestLoadBalancer::unweightedHostPickNChoices(const HostVector& hosts_to_use) {
   HostSharedPtr candidate_host = nullptr;
+  uint64_t candidate_active_rq = 0;
 
   for (uint32_t choice_idx = 0; choice_idx < choice_count_; ++choice_idx) {
     const int rand_idx = random_.random() % hosts_to_use.size();
@@ -126,14 +129,15 @@ HostSharedPtr LeastRequestLoadBalancer::unweightedHostPickNChoices(const HostVec
     if (candidate_host == nullptr) {
       // Make a first choice to start the comparisons.
       candidate_host = sampled_host;
+      candidate_active_rq = sampled_host->stats().rq_active_.value();
       continue;
     }
 
-    const auto candidate_active_rq = candidate_host->stats().rq_active_.value();
-    const auto sampled_active_rq = sampled_host->stats().rq_active_.value();
+    const uint64_t sampled_active_rq = sampled_host->stats().rq_active_.value();
 
     if (sampled_active_rq < candidate_active_rq) {
       candidate_host = sampled_host;
+      candidate_active_rq = sampled_active_rq;
     }
   }
 
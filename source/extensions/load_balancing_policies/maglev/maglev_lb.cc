@@ -38,19 +38,22 @@ public:
   static MaglevTableSharedPtr
   createMaglevTable(const NormalizedHostWeightVector& normalized_host_weights,
                     double max_normalized_weight, uint64_t table_size,
-                    bool use_hostname_for_hashing, MaglevLoadBalancerStats& stats) {
+                    bool use_hostname_for_hashing, MaglevLoadBalancerStats& stats,
+                    const MaglevTable* previous) {
 
     MaglevTableSharedPtr maglev_table;
     if (shouldUseCompactTable(normalized_host_weights.size(), table_size)) {
       maglev_table =
           std::make_shared<CompactMaglevTable>(normalized_host_weights, max_normalized_weight,
-                                               table_size, use_hostname_for_hashing, stats);
+                                               table_size, use_hostname_for_hashing, stats,
+                                               previous);
       ENVOY_LOG(debug, "creating compact maglev table given table size {} and number of hosts {}",
                 table_size, normalized_host_weights.size());
     } else {
       maglev_table =
           std::make_shared<OriginalMaglevTable>(normalized_host_weights, max_normalized_weight,
-                                                table_size, use_hostname_for_hashing, stats);
+                                                table_size, use_hostname_for_hashing, stats,
+                                                previous);
       ENVOY_LOG(debug, "creating original maglev table given table size {} and number of hosts {}",
                 table_size, normalized_host_weights.size());
     }
@@ -70,12 +73,25 @@ LegacyMaglevLbConfig::LegacyMaglevLbConfig(const ClusterProto& cluster) {
 TypedMaglevLbConfig::TypedMaglevLbConfig(const MaglevLbProto& lb_config) : lb_config_(lb_config) {}
 
 ThreadAwareLoadBalancerBase::HashingLoadBalancerSharedPtr
-MaglevLoadBalancer::createLoadBalancer(const NormalizedHostWeightVector& normalized_host_weights,
+MaglevLoadBalancer::createLoadBalancer(uint32_t priority,
+                                       const NormalizedHostWeightVector& normalized_host_weights,
                                        double /* min_normalized_weight */,
                                        double max_normalized_weight) {
-  HashingLoadBalancerSharedPtr maglev_lb =
-      MaglevFactory::createMaglevTable(normalized_host_weights, max_normalized_weight, table_size_,
-                                       use_hostname_for_hashing_, stats_);
+  // The table is always built from scratch, rather than by updating the previous table, so that
+  // hosts are assigned the same entries by every Envoy given the same hosts and weights. The
+  // previous table is only used to count the entries changed by the build.
+  if (tables_.size() <= priority) {
+    tables_.resize(priority + 1);
+  }
+  const MonotonicTime build_start = time_source_.monotonicTime();
+  MaglevTableSharedPtr maglev_lb = MaglevFactory::createMaglevTable(
+      normalized_host_weights, max_normalized_weight, table_size_, use_hostname_for_hashing_,
+      stats_, tables_[priority].get());
+  stats_.build_time_us_.recordValue(std::chrono::duration_cast<std::chrono::microseconds>(
+                                        time_source_.monotonicTime() - build_start)
+                                        .count());
+  stats_.entries_changed_.add(maglev_lb->entriesChanged());
+  tables_[priority] = maglev_lb;
 
   if (hash_balance_factor_ == 0) {
     return maglev_lb;
@@ -87,10 +103,13 @@ MaglevLoadBalancer::createLoadBalancer(const NormalizedHostWeightVector& normali
 
 void MaglevTable::constructMaglevTableInternal(
     const NormalizedHostWeightVector& normalized_host_weights, double max_normalized_weight,
-    bool use_hostname_for_hashing) {
+    bool use_hostname_for_hashing, const MaglevTable* previous) {
   // We can't do anything sensible with no hosts.
   if (normalized_host_weights.empty()) {
     ENVOY_LOG(debug, "maglev: normalized hosts weights is empty, skipping building table");
+    if (previous != nullptr) {
+      entries_changed_ = countEntriesChanged(*previous);
+    }
     return;
   }
 
@@ -122,7 +141,7 @@ void MaglevTable::constructMaglevTableInternal(
                                      weight);
   }
 
-  constructImplementationInternals(table_build_entries, max_normalized_weight);
+  constructImplementationInternals(table_build_entries, max_normalized_weight, previous);
 
   // Update Stats
   uint64_t min_entries_per_host = table_size_;
@@ -140,10 +159,18 @@ void MaglevTable::constructMaglevTableInternal(
 }
 
 void OriginalMaglevTable::constructImplementationInternals(
-    std::vector<TableBuildEntry>& table_build_entries, double max_normalized_weight) {
+    std::vector<TableBuildEntry>& table_build_entries, double max_normalized_weight,
+    const MaglevTable* previous) {
   // Size internal representation for maglev table correctly.
   table_.resize(table_size_);
 
+  // Entries are compared with the previous table as they are filled when it has the same
+  // representation.
+  const auto* previous_table = dynamic_cast<const OriginalMaglevTable*>(previous);
+  if (previous_table != nullptr && previous_table->table_.empty()) {
+    previous_table = nullptr;
+  }
+
   // Iterate through the table build entries as many times as it takes to fill up the table.
   uint64_t table_index = 0;
   for (uint32_t iteration = 1; table_index < table_size_; ++iteration) {
@@ -157,31 +184,39 @@ void OriginalMaglevTable::constructImplementationInternals(
         continue;
       }
       entry.target_weight_ += max_normalized_weight;
-      uint64_t c = permutation(entry);
-      while (table_[c] != nullptr) {
-        entry.next_++;
-        c = permutation(entry);
+      while (table_[entry.permutation_] != nullptr) {
+        entry.advance(table_size_);
       }
 
-      table_[c] = entry.host_;
-      entry.next_++;
+      table_[entry.permutation_] = entry.host_;
+      if (previous_table != nullptr && previous_table->table_[entry.permutation_] != entry.host_) {
+        entries_changed_++;
+      }
+      entry.advance(table_size_);
       entry.count_++;
       table_index++;
     }
   }
+
+  if (previous != nullptr && previous_table == nullptr) {
+    entries_changed_ = countEntriesChanged(*previous);
+  }
 }
+
 CompactMaglevTable::CompactMaglevTable(const NormalizedHostWeightVector& normalized_host_weights,
                                        double max_normalized_weight, uint64_t table_size,
                                        bool use_hostname_for_hashing,
-                                       MaglevLoadBalancerStats& stats)
+                                       MaglevLoadBalancerStats& stats,
+                                       const MaglevTable* previous)
     : MaglevTable(table_size, stats),
       table_(absl::bit_width(normalized_host_weights.size()), table_size) {
   constructMaglevTableInternal(normalized_host_weights, max_normalized_weight,
-                               use_hostname_for_hashing);
+                               use_hostname_for_hashing, previous);
 }
 
 void CompactMaglevTable::constructImplementationInternals(
-    std::vector<TableBuildEntry>& table_build_entries, double max_normalized_weight) {
+    std::vector<TableBuildEntry>& table_build_entries, double max_normalized_weight,
+    const MaglevTable* previous) {
   // Populate the host table. Index into table_build_entries[i] will align with
   // the host here.
   host_table_.reserve(table_build_entries.size());
@@ -194,6 +229,13 @@ void CompactMaglevTable::constructImplementationInternals(
   // BitArray used as the maglev table.
   std::vector<bool> occupied(table_size_, false);
 
+  // Entries are compared with the previous table as they are filled when it has the same
+  // representation. Host indices differ between tables, so the hosts they index are compared.
+  const auto* previous_table = dynamic_cast<const CompactMaglevTable*>(previous);
+  if (previous_table != nullptr && previous_table->host_table_.empty()) {
+    previous_table = nullptr;
+  }
+
   // Iterate through the table build entries as many times as it takes to fill up the table.
   uint64_t table_index = 0;
   for (uint32_t iteration = 1; table_index < table_size_; ++iteration) {
@@ -207,23 +249,29 @@ void CompactMaglevTable::constructImplementationInternals(
         continue;
       }
       entry.target_weight_ += max_normalized_weight;
-      // As we're using the compact implementation, our table size is limited to
-      // 32-bit, hence static_cast here should be safe.
-      uint32_t c = static_cast<uint32_t>(permutation(entry));
-      while (occupied[c]) {
-        entry.next_++;
-        c = static_cast<uint32_t>(permutation(entry));
+      while (occupied[entry.permutation_]) {
+        entry.advance(table_size_);
       }
 
-      // Record the index of the given host.
+      // Record the index of the given host. As we're using the compact implementation, our table
+      // size is limited to 32-bit, hence static_cast here should be safe.
+      const uint32_t c = static_cast<uint32_t>(entry.permutation_);
       table_.set(c, i);
       occupied[c] = true;
+      if (previous_table != nullptr &&
+          previous_table->host_table_[previous_table->table_.get(c)] != entry.host_) {
+        entries_changed_++;
+      }
 
-      entry.next_++;
+      entry.advance(table_size_);
       entry.count_++;
       table_index++;
     }
   }
+
+  if (previous != nullptr && previous_table == nullptr) {
+    entries_changed_ = countEntriesChanged(*previous);
+  }
 }
 
 void OriginalMaglevTable::logMaglevTable(bool use_hostname_for_hashing) const {
@@ -282,20 +330,29 @@ HostSelectionResponse CompactMaglevTable::chooseHost(uint64_t hash, uint32_t att
   return {host_table_[index]};
 }
 
-uint64_t MaglevTable::permutation(const TableBuildEntry& entry) {
-  return (entry.offset_ + (entry.skip_ * entry.next_)) % table_size_;
+uint64_t MaglevTable::countEntriesChanged(const MaglevTable& previous) const {
+  ASSERT(table_size_ == previous.table_size_);
+  uint64_t entries_changed = 0;
+  for (uint64_t i = 0; i < table_size_; ++i) {
+    if (hostAt(i) != previous.hostAt(i)) {
+      ++entries_changed;
+    }
+  }
+  return entries_changed;
 }
 
 MaglevLoadBalancer::MaglevLoadBalancer(
     const PrioritySet& priority_set, ClusterLbStats& stats, Stats::Scope& scope,
     Runtime::Loader& runtime, Random::RandomGenerator& random,
     OptRef<const envoy::config::cluster::v3::Cluster::MaglevLbConfig> config,
-    const envoy::config::cluster::v3::Cluster::CommonLbConfig& common_config)
+    const envoy::config::cluster::v3::Cluster::CommonLbConfig& common_config,
+    TimeSource& time_source)
     : ThreadAwareLoadBalancerBase(priority_set, stats, runtime, random,
                                   PROTOBUF_PERCENT_TO_ROUNDED_INTEGER_OR_DEFAULT(
                                       common_config, healthy_panic_threshold, 100, 50),
                                   common_config.has_locality_weighted_lb_config()),
       scope_(scope.createScope("maglev_lb.")), stats_(generateStats(*scope_)),
+      time_source_(time_source),
       table_size_(config ? PROTOBUF_GET_WRAPPED_OR_DEFAULT(config.ref(), table_size,
                                                            MaglevTable::DefaultTableSize)
                          : MaglevTable::DefaultTableSize),
@@ -315,10 +372,12 @@ MaglevLoadBalancer::MaglevLoadBalancer(
 MaglevLoadBalancer::MaglevLoadBalancer(
     const PrioritySet& priority_set, ClusterLbStats& stats, Stats::Scope& scope,
     Runtime::Loader& runtime, Random::RandomGenerator& random, uint32_t healthy_panic_threshold,
-    const envoy::extensions::load_balancing_policies::maglev::v3::Maglev& config)
+    const envoy::extensions::load_balancing_policies::maglev::v3::Maglev& config,
+    TimeSource& time_source)
     : ThreadAwareLoadBalancerBase(priority_set, stats, runtime, random, healthy_panic_threshold,
                                   config.has_locality_weighted_lb_config()),
       scope_(scope.createScope("maglev_lb.")), stats_(generateStats(*scope_)),
+      time_source_(time_source),
       table_size_(
           PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, table_size, MaglevTable::DefaultTableSize)),
       use_hostname_for_hashing_(
@@ -335,7 +394,8 @@ MaglevLoadBalancer::MaglevLoadBalancer(
 }
 
 MaglevLoadBalancerStats MaglevLoadBalancer::generateStats(Stats::Scope& scope) {
-  return {ALL_MAGLEV_LOAD_BALANCER_STATS(POOL_GAUGE(scope))};
+  return {ALL_MAGLEV_LOAD_BALANCER_STATS(POOL_COUNTER(scope), POOL_GAUGE(scope),
+                                         POOL_HISTOGRAM(scope))};
 }
 
 } // namespace Upstream
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "envoy/common/pure.h"
+#include "envoy/common/time.h"
 #include "envoy/common/random_generator.h"
 #include "envoy/config/cluster/v3/cluster.pb.h"
 #include "envoy/extensions/load_balancing_policies/maglev/v3/maglev.pb.h"
@@ -50,15 +51,18 @@ public:
 /**
  * All Maglev load balancer stats. @see stats_macros.h
  */
-#define ALL_MAGLEV_LOAD_BALANCER_STATS(GAUGE)                                                      \
+#define ALL_MAGLEV_LOAD_BALANCER_STATS(COUNTER, GAUGE, HISTOGRAM)                                  \
+  COUNTER(entries_changed)                                                                         \
   GAUGE(max_entries_per_host, Accumulate)                                                          \
-  GAUGE(min_entries_per_host, Accumulate)
+  GAUGE(min_entries_per_host, Accumulate)                                                          \
+  HISTOGRAM(build_time_us, Microseconds)
 
 /**
  * Struct definition for all Maglev load balancer stats. @see stats_macros.h
  */
 struct MaglevLoadBalancerStats {
-  ALL_MAGLEV_LOAD_BALANCER_STATS(GENERATE_GAUGE_STRUCT)
+  ALL_MAGLEV_LOAD_BALANCER_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT,
+                                 GENERATE_HISTOGRAM_STRUCT)
 };
 
 class MaglevTable;
@@ -80,30 +84,53 @@ public:
   static constexpr uint64_t DefaultTableSize = 65537;
   static constexpr uint64_t MaxNumberOfHostsForCompactMaglev = (static_cast<uint64_t>(1) << 32) - 1;
 
+  /**
+   * @return the number of table entries assigned to a different host than in the previous table
+   *         the table was built after, or 0 if it was built without one.
+   */
+  uint64_t entriesChanged() const { return entries_changed_; }
+
 protected:
   struct TableBuildEntry {
     TableBuildEntry(const HostConstSharedPtr& host, uint64_t offset, uint64_t skip, double weight)
-        : host_(host), offset_(offset), skip_(skip), weight_(weight) {}
+        : host_(host), skip_(skip), weight_(weight), permutation_(offset) {}
+
+    // Advances to the next entry of the host's permutation of the table. This is equivalent to
+    // computing (offset + skip * next) % table_size for the next value of next, without the
+    // multiplication and division.
+    void advance(uint64_t table_size) {
+      permutation_ += skip_;
+      if (permutation_ >= table_size) {
+        permutation_ -= table_size;
+      }
+    }
 
     HostConstSharedPtr host_;
-    const uint64_t offset_;
     const uint64_t skip_;
     const double weight_;
     double target_weight_{};
-    uint64_t next_{};
+    // The current entry of the host's permutation of the table.
+    uint64_t permutation_;
     uint64_t count_{};
   };
 
-  uint64_t permutation(const TableBuildEntry& entry);
-
   /**
    * Template method for constructing the Maglev table.
    */
   void constructMaglevTableInternal(const NormalizedHostWeightVector& normalized_host_weights,
-                                    double max_normalized_weight, bool use_hostname_for_hashing);
+                                    double max_normalized_weight, bool use_hostname_for_hashing,
+                                    const MaglevTable* previous);
+
+  /**
+   * Counts the entries assigned to a different host than in the given table by looking up every
+   * entry of both. Only used when the previous table has a different representation, since
+   * otherwise the entries are compared while the table is filled.
+   */
+  uint64_t countEntriesChanged(const MaglevTable& previous) const;
 
   const uint64_t table_size_;
   MaglevLoadBalancerStats& stats_;
+  uint64_t entries_changed_{};
 
 private:
   /**
@@ -111,12 +138,18 @@ private:
    * Maglev Table.
    */
   virtual void constructImplementationInternals(std::vector<TableBuildEntry>& table_build_entries,
-                                                double max_normalized_weight) PURE;
+                                                double max_normalized_weight,
+                                                const MaglevTable* previous) PURE;
 
   /**
    * Log each entry of the maglev table (useful for debugging).
    */
   virtual void logMaglevTable(bool use_hostname_for_hashing) const PURE;
+
+  /**
+   * @return the host assigned to the given table entry, or nullptr if the table is empty.
+   */
+  virtual const Host* hostAt(uint64_t index) const PURE;
 };
 
 /**
@@ -127,10 +160,11 @@ class OriginalMaglevTable : public MaglevTable {
 public:
   OriginalMaglevTable(const NormalizedHostWeightVector& normalized_host_weights,
                       double max_normalized_weight, uint64_t table_size,
-                      bool use_hostname_for_hashing, MaglevLoadBalancerStats& stats)
+                      bool use_hostname_for_hashing, MaglevLoadBalancerStats& stats,
+                      const MaglevTable* previous = nullptr)
       : MaglevTable(table_size, stats) {
     constructMaglevTableInternal(normalized_host_weights, max_normalized_weight,
-                                 use_hostname_for_hashing);
+                                 use_hostname_for_hashing, previous);
   }
   ~OriginalMaglevTable() override = default;
 
@@ -139,9 +173,14 @@ public:
 
 private:
   void constructImplementationInternals(std::vector<TableBuildEntry>& table_build_entries,
-                                        double max_normalized_weight) override;
+                                        double max_normalized_weight,
+                                        const MaglevTable* previous) override;
 
   void logMaglevTable(bool use_hostname_for_hashing) const override;
+  const Host* hostAt(uint64_t index) const override {
+    return table_.empty() ? nullptr : table_[index].get();
+  }
+
   std::vector<HostConstSharedPtr> table_;
 };
 
@@ -155,7 +194,8 @@ class CompactMaglevTable : public MaglevTable {
 public:
   CompactMaglevTable(const NormalizedHostWeightVector& normalized_host_weights,
                      double max_normalized_weight, uint64_t table_size,
-                     bool use_hostname_for_hashing, MaglevLoadBalancerStats& stats);
+                     bool use_hostname_for_hashing, MaglevLoadBalancerStats& stats,
+                     const MaglevTable* previous = nullptr);
   ~CompactMaglevTable() override = default;
 
   // ThreadAwareLoadBalancerBase::HashingLoadBalancer
@@ -163,8 +203,12 @@ public:
 
 private:
   void constructImplementationInternals(std::vector<TableBuildEntry>& table_build_entries,
-                                        double max_normalized_weight) override;
+                                        double max_normalized_weight,
+                                        const MaglevTable* previous) override;
   void logMaglevTable(bool use_hostname_for_hashing) const override;
+  const Host* hostAt(uint64_t index) const override {
+    return host_table_.empty() ? nullptr : host_table_[table_.get(index)].get();
+  }
 
   // Leverage a BitArray to more compactly fit represent the MaglevTable.
   // The BitArray will index into the host_table_ which will provide the given
@@ -181,12 +225,14 @@ public:
   MaglevLoadBalancer(const PrioritySet& priority_set, ClusterLbStats& stats, Stats::Scope& scope,
                      Runtime::Loader& runtime, Random::RandomGenerator& random,
                      OptRef<const envoy::config::cluster::v3::Cluster::MaglevLbConfig> config,
-                     const envoy::config::cluster::v3::Cluster::CommonLbConfig& common_config);
+                     const envoy::config::cluster::v3::Cluster::CommonLbConfig& common_config,
+                     TimeSource& time_source);
 
   MaglevLoadBalancer(const PrioritySet& priority_set, ClusterLbStats& stats, Stats::Scope& scope,
                      Runtime::Loader& runtime, Random::RandomGenerator& random,
                      uint32_t healthy_panic_threshold,
-                     const envoy::extensions::load_balancing_policies::maglev::v3::Maglev& config);
+                     const envoy::extensions::load_balancing_policies::maglev::v3::Maglev& config,
+                     TimeSource& time_source);
 
   const MaglevLoadBalancerStats& stats() const { return stats_; }
   uint64_t tableSize() const { return table_size_; }
@@ -194,12 +240,15 @@ public:
 private:
   // ThreadAwareLoadBalancerBase
   HashingLoadBalancerSharedPtr
-  createLoadBalancer(const NormalizedHostWeightVector& normalized_host_weights,
+  createLoadBalancer(uint32_t priority, const NormalizedHostWeightVector& normalized_host_weights,
                      double /* min_normalized_weight */, double max_normalized_weight) override;
   static MaglevLoadBalancerStats generateStats(Stats::Scope& scope);
 
   Stats::ScopeSharedPtr scope_;
   MaglevLoadBalancerStats stats_;
+  TimeSource& time_source_;
+  // The current table of each priority, to count the entries that change on the next build.
+  std::vector<MaglevTableSharedPtr> tables_;
   const uint64_t table_size_;
   const bool use_hostname_for_hashing_;
   const uint32_t hash_balance_factor_;
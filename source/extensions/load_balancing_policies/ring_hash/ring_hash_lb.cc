@@ -9,6 +9,7 @@
 
 #include "source/common/common/assert.h"
 
+#include "absl/container/flat_hash_set.h"
 #include "absl/container/inlined_vector.h"
 #include "absl/strings/string_view.h"
 
@@ -28,12 +29,14 @@ RingHashLoadBalancer::RingHashLoadBalancer(
     const PrioritySet& priority_set, ClusterLbStats& stats, Stats::Scope& scope,
     Runtime::Loader& runtime, Random::RandomGenerator& random,
     OptRef<const envoy::config::cluster::v3::Cluster::RingHashLbConfig> config,
-    const envoy::config::cluster::v3::Cluster::CommonLbConfig& common_config)
+    const envoy::config::cluster::v3::Cluster::CommonLbConfig& common_config,
+    TimeSource& time_source)
     : ThreadAwareLoadBalancerBase(priority_set, stats, runtime, random,
                                   PROTOBUF_PERCENT_TO_ROUNDED_INTEGER_OR_DEFAULT(
                                       common_config, healthy_panic_threshold, 100, 50),
                                   common_config.has_locality_weighted_lb_config()),
       scope_(scope.createScope("ring_hash_lb.")), stats_(generateStats(*scope_)),
+      time_source_(time_source),
       min_ring_size_(config.has_value() ? PROTOBUF_GET_WRAPPED_OR_DEFAULT(
                                               config.ref(), minimum_ring_size, DefaultMinRingSize)
                                         : DefaultMinRingSize),
@@ -60,10 +63,12 @@ RingHashLoadBalancer::RingHashLoadBalancer(
 RingHashLoadBalancer::RingHashLoadBalancer(
     const PrioritySet& priority_set, ClusterLbStats& stats, Stats::Scope& scope,
     Runtime::Loader& runtime, Random::RandomGenerator& random, uint32_t healthy_panic_threshold,
-    const envoy::extensions::load_balancing_policies::ring_hash::v3::RingHash& config)
+    const envoy::extensions::load_balancing_policies::ring_hash::v3::RingHash& config,
+    TimeSource& time_source)
     : ThreadAwareLoadBalancerBase(priority_set, stats, runtime, random, healthy_panic_threshold,
                                   config.has_locality_weighted_lb_config()),
       scope_(scope.createScope("ring_hash_lb.")), stats_(generateStats(*scope_)),
+      time_source_(time_source),
       min_ring_size_(
           PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, minimum_ring_size, DefaultMinRingSize)),
       max_ring_size_(
@@ -86,7 +91,35 @@ RingHashLoadBalancer::RingHashLoadBalancer(
 }
 
 RingHashLoadBalancerStats RingHashLoadBalancer::generateStats(Stats::Scope& scope) {
-  return {ALL_RING_HASH_LOAD_BALANCER_STATS(POOL_GAUGE(scope))};
+  return {ALL_RING_HASH_LOAD_BALANCER_STATS(POOL_COUNTER(scope), POOL_GAUGE(scope),
+                                            POOL_HISTOGRAM(scope))};
+}
+
+ThreadAwareLoadBalancerBase::HashingLoadBalancerSharedPtr
+RingHashLoadBalancer::createLoadBalancer(uint32_t priority,
+                                         const NormalizedHostWeightVector& normalized_host_weights,
+                                         double min_normalized_weight,
+                                         double /* max_normalized_weight */) {
+  if (rings_.size() <= priority) {
+    rings_.resize(priority + 1);
+  }
+  const MonotonicTime build_start = time_source_.monotonicTime();
+  RingConstSharedPtr ring = std::make_shared<Ring>(
+      normalized_host_weights, min_normalized_weight, min_ring_size_, max_ring_size_,
+      hash_function_, use_hostname_for_hashing_, rings_[priority].get(), stats_);
+  stats_.build_time_us_.recordValue(std::chrono::duration_cast<std::chrono::microseconds>(
+                                        time_source_.monotonicTime() - build_start)
+                                        .count());
+  rings_[priority] = ring;
+
+  // The ring is immutable once built, but HashingLoadBalancerSharedPtr is not const-qualified.
+  HashingLoadBalancerSharedPtr ring_hash_lb = std::const_pointer_cast<Ring>(ring);
+  if (hash_balance_factor_ == 0) {
+    return ring_hash_lb;
+  }
+
+  return std::make_shared<BoundedLoadHashingLoadBalancer>(ring_hash_lb, normalized_host_weights,
+                                                          hash_balance_factor_);
 }
 
 HostSelectionResponse RingHashLoadBalancer::Ring::chooseHost(uint64_t h, uint32_t attempt) const {
@@ -142,12 +175,16 @@ using HashFunction = envoy::config::cluster::v3::Cluster::RingHashLbConfig::Hash
 RingHashLoadBalancer::Ring::Ring(const NormalizedHostWeightVector& normalized_host_weights,
                                  double min_normalized_weight, uint64_t min_ring_size,
                                  uint64_t max_ring_size, HashFunction hash_function,
-                                 bool use_hostname_for_hashing, RingHashLoadBalancerStats& stats)
+                                 bool use_hostname_for_hashing, const Ring* previous_ring,
+                                 RingHashLoadBalancerStats& stats)
     : stats_(stats) {
   ENVOY_LOG(trace, "ring hash: building ring");
 
   // We can't do anything sensible with no hosts.
   if (normalized_host_weights.empty()) {
+    if (previous_ring != nullptr) {
+      stats_.hashes_changed_.add(previous_ring->ring_.size());
+    }
     return;
   }
 
@@ -164,8 +201,8 @@ RingHashLoadBalancer::Ring::Ring(const NormalizedHostWeightVector& normalized_ho
   const uint64_t ring_size = std::ceil(scale);
   ring_.reserve(ring_size);
 
-  // Populate the hash ring by walking through the (host, weight) pairs in
-  // normalized_host_weights, and generating (scale * weight) hashes for each host. Since these
+  // Count the hashes of each host by walking through the (host, weight) pairs in
+  // normalized_host_weights, and allotting (scale * weight) hashes to each host. Since these
   // aren't necessarily whole numbers, we maintain running sums -- current_hashes and
   // target_hashes -- which allows us to populate the ring in a mostly stable way.
   //
@@ -181,50 +218,130 @@ RingHashLoadBalancer::Ring::Ring(const NormalizedHostWeightVector& normalized_ho
   // For stats reporting, keep track of the minimum and maximum actual number of hashes per host.
   // Users should hopefully pay attention to these numbers and alert if min_hashes_per_host is too
   // low, since that implies an inaccurate request distribution.
-
-  absl::InlinedVector<char, 196> hash_key_buffer;
   double current_hashes = 0.0;
   double target_hashes = 0.0;
   uint64_t min_hashes_per_host = ring_size;
   uint64_t max_hashes_per_host = 0;
+  host_hashes_.reserve(normalized_host_weights.size());
   for (const auto& entry : normalized_host_weights) {
     const auto& host = entry.first;
     const absl::string_view key_to_hash = hashKey(host, use_hostname_for_hashing);
     ASSERT(!key_to_hash.empty());
 
-    hash_key_buffer.assign(key_to_hash.begin(), key_to_hash.end());
-    hash_key_buffer.emplace_back('_');
-    auto offset_start = hash_key_buffer.end();
-
     // As noted above: maintain current_hashes and target_hashes as running sums across the entire
-    // host set. `i` is needed only to construct the hash key, and tally min/max hashes per host.
+    // host set.
     target_hashes += scale * entry.second;
-    uint64_t i = 0;
+    uint64_t hashes = 0;
     while (current_hashes < target_hashes) {
-      const std::string i_str = absl::StrCat("", i);
-      hash_key_buffer.insert(offset_start, i_str.begin(), i_str.end());
-
-      absl::string_view hash_key(static_cast<char*>(hash_key_buffer.data()),
-                                 hash_key_buffer.size());
-
-      const uint64_t hash =
-          (hash_function == HashFunction::Cluster_RingHashLbConfig_HashFunction_MURMUR_HASH_2)
-              ? MurmurHash::murmurHash2(hash_key, MurmurHash::STD_HASH_SEED)
-              : HashUtil::xxHash64(hash_key);
-
-      ENVOY_LOG(trace, "ring hash: hash_key={} hash={}", hash_key, hash);
-      ring_.push_back({hash, host});
-      ++i;
+      ++hashes;
       ++current_hashes;
-      hash_key_buffer.erase(offset_start, hash_key_buffer.end());
     }
-    min_hashes_per_host = std::min(i, min_hashes_per_host);
-    max_hashes_per_host = std::max(i, max_hashes_per_host);
+    host_hashes_.emplace(host.get(), HostHashes{std::string(key_to_hash), hashes});
+    min_hashes_per_host = std::min(hashes, min_hashes_per_host);
+    max_hashes_per_host = std::max(hashes, max_hashes_per_host);
   }
 
-  std::sort(ring_.begin(), ring_.end(), [](const RingEntry& lhs, const RingEntry& rhs) -> bool {
+  // The i-th hash of a host is the hash of "<key>_<i>", so it does not depend on the other hosts.
+  absl::InlinedVector<char, 196> hash_key_buffer;
+  const auto hash_host = [&hash_key_buffer, hash_function](absl::string_view key_to_hash,
+                                                          uint64_t i) {
+    hash_key_buffer.assign(key_to_hash.begin(), key_to_hash.end());
+    hash_key_buffer.emplace_back('_');
+    const std::string i_str = absl::StrCat("", i);
+    hash_key_buffer.insert(hash_key_buffer.end(), i_str.begin(), i_str.end());
+
+    absl::string_view hash_key(static_cast<char*>(hash_key_buffer.data()),
+                               hash_key_buffer.size());
+
+    const uint64_t hash =
+        (hash_function == HashFunction::Cluster_RingHashLbConfig_HashFunction_MURMUR_HASH_2)
+            ? MurmurHash::murmurHash2(hash_key, MurmurHash::STD_HASH_SEED)
+            : HashUtil::xxHash64(hash_key);
+
+    ENVOY_LOG(trace, "ring hash: hash_key={} hash={}", hash_key, hash);
+    return hash;
+  };
+
+  // The number of hashes a host had on the previous ring, or zero if the host is new or its hash
+  // key changed. Count the hashes added and removed relative to the previous ring.
+  const auto previous_hashes = [previous_ring](const Host* host, const HostHashes& host_hashes) {
+    if (previous_ring == nullptr) {
+      return uint64_t(0);
+    }
+    const auto it = previous_ring->host_hashes_.find(host);
+    if (it == previous_ring->host_hashes_.end() || it->second.key_ != host_hashes.key_) {
+      return uint64_t(0);
+    }
+    return it->second.hashes_;
+  };
+  uint64_t hashes_added = 0;
+  uint64_t hashes_removed = 0;
+  if (previous_ring != nullptr) {
+    for (const auto& [host, host_hashes] : host_hashes_) {
+      const uint64_t kept = std::min(previous_hashes(host, host_hashes), host_hashes.hashes_);
+      hashes_added += host_hashes.hashes_ - kept;
+    }
+    for (const auto& [host, host_hashes] : previous_ring->host_hashes_) {
+      const auto it = host_hashes_.find(host);
+      const uint64_t kept = it == host_hashes_.end()
+                                ? 0
+                                : std::min(previous_hashes(host, it->second), it->second.hashes_);
+      hashes_removed += host_hashes.hashes_ - kept;
+    }
+    stats_.hashes_changed_.add(hashes_added + hashes_removed);
+  }
+
+  const auto compare_hashes = [](const RingEntry& lhs, const RingEntry& rhs) -> bool {
     return lhs.hash_ < rhs.hash_;
-  });
+  };
+
+  // Only carry over the previous ring if most of it is kept; otherwise hashing the whole ring is
+  // cheaper than filtering and merging it.
+  if (previous_ring != nullptr && (hashes_added + hashes_removed) * 2 <= ring_size) {
+    // Hash and sort the added hashes, and note the removed hashes of the hosts that lost some.
+    std::vector<RingEntry> added_entries;
+    added_entries.reserve(hashes_added);
+    absl::flat_hash_set<std::pair<const Host*, uint64_t>> removed_hashes;
+    for (const auto& entry : normalized_host_weights) {
+      const HostHashes& host_hashes = host_hashes_.at(entry.first.get());
+      const uint64_t previous = previous_hashes(entry.first.get(), host_hashes);
+      for (uint64_t i = previous; i < host_hashes.hashes_; ++i) {
+        added_entries.push_back({hash_host(host_hashes.key_, i), entry.first});
+      }
+      for (uint64_t i = host_hashes.hashes_; i < previous; ++i) {
+        removed_hashes.emplace(entry.first.get(), hash_host(host_hashes.key_, i));
+      }
+    }
+    std::sort(added_entries.begin(), added_entries.end(), compare_hashes);
+
+    // Merge the added hashes with the hashes kept from the previous ring, which is sorted.
+    auto added = added_entries.begin();
+    for (const RingEntry& previous_entry : previous_ring->ring_) {
+      const Host* host = previous_entry.host_.get();
+      const auto it = host_hashes_.find(host);
+      if (it == host_hashes_.end() || previous_hashes(host, it->second) == 0 ||
+          (!removed_hashes.empty() && removed_hashes.contains({host, previous_entry.hash_}))) {
+        continue;
+      }
+      while (added != added_entries.end() && added->hash_ < previous_entry.hash_) {
+        ring_.push_back(std::move(*added++));
+      }
+      ring_.push_back(previous_entry);
+    }
+    ring_.insert(ring_.end(), std::make_move_iterator(added),
+                 std::make_move_iterator(added_entries.end()));
+  } else {
+    // Populate the hash ring by walking through the (host, weight) pairs in
+    // normalized_host_weights, and generating the hashes of each host.
+    for (const auto& entry : normalized_host_weights) {
+      const HostHashes& host_hashes = host_hashes_.at(entry.first.get());
+      for (uint64_t i = 0; i < host_hashes.hashes_; ++i) {
+        ring_.push_back({hash_host(host_hashes.key_, i), entry.first});
+      }
+    }
+
+    std::sort(ring_.begin(), ring_.end(), compare_hashes);
+  }
   if (ENVOY_LOG_CHECK_LEVEL(trace)) {
     for (const auto& entry : ring_) {
       const absl::string_view key_to_hash = hashKey(entry.host_, use_hostname_for_hashing);
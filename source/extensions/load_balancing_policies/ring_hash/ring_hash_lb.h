@@ -2,6 +2,7 @@
 
 #include <vector>
 
+#include "envoy/common/time.h"
 #include "envoy/config/cluster/v3/cluster.pb.h"
 #include "envoy/extensions/load_balancing_policies/ring_hash/v3/ring_hash.pb.h"
 #include "envoy/extensions/load_balancing_policies/ring_hash/v3/ring_hash.pb.validate.h"
@@ -13,6 +14,8 @@
 #include "source/common/common/logger.h"
 #include "source/extensions/load_balancing_policies/common/thread_aware_lb_impl.h"
 
+#include "absl/container/flat_hash_map.h"
+
 namespace Envoy {
 namespace Upstream {
 
@@ -51,16 +54,19 @@ public:
 /**
  * All ring hash load balancer stats. @see stats_macros.h
  */
-#define ALL_RING_HASH_LOAD_BALANCER_STATS(GAUGE)                                                   \
+#define ALL_RING_HASH_LOAD_BALANCER_STATS(COUNTER, GAUGE, HISTOGRAM)                               \
+  COUNTER(hashes_changed)                                                                          \
   GAUGE(max_hashes_per_host, Accumulate)                                                           \
   GAUGE(min_hashes_per_host, Accumulate)                                                           \
-  GAUGE(size, Accumulate)
+  GAUGE(size, Accumulate)                                                                          \
+  HISTOGRAM(build_time_us, Microseconds)
 
 /**
  * Struct definition for all ring hash load balancer stats. @see stats_macros.h
  */
 struct RingHashLoadBalancerStats {
-  ALL_RING_HASH_LOAD_BALANCER_STATS(GENERATE_GAUGE_STRUCT)
+  ALL_RING_HASH_LOAD_BALANCER_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT,
+                                    GENERATE_HISTOGRAM_STRUCT)
 };
 
 /**
@@ -77,12 +83,14 @@ public:
   RingHashLoadBalancer(const PrioritySet& priority_set, ClusterLbStats& stats, Stats::Scope& scope,
                        Runtime::Loader& runtime, Random::RandomGenerator& random,
                        OptRef<const envoy::config::cluster::v3::Cluster::RingHashLbConfig> config,
-                       const envoy::config::cluster::v3::Cluster::CommonLbConfig& common_config);
+                       const envoy::config::cluster::v3::Cluster::CommonLbConfig& common_config,
+                       TimeSource& time_source);
 
   RingHashLoadBalancer(
       const PrioritySet& priority_set, ClusterLbStats& stats, Stats::Scope& scope,
       Runtime::Loader& runtime, Random::RandomGenerator& random, uint32_t healthy_panic_threshold,
-      const envoy::extensions::load_balancing_policies::ring_hash::v3::RingHash& config);
+      const envoy::extensions::load_balancing_policies::ring_hash::v3::RingHash& config,
+      TimeSource& time_source);
 
   const RingHashLoadBalancerStats& stats() const { return stats_; }
 
@@ -94,15 +102,29 @@ private:
     HostConstSharedPtr host_;
   };
 
+  // The hash key and the number of hashes of a host on the ring.
+  struct HostHashes {
+    std::string key_;
+    uint64_t hashes_;
+  };
+
   struct Ring : public HashingLoadBalancer {
+    /**
+     * Builds the ring. If a previous ring is given, the hashes of the hosts that remain on the
+     * ring are carried over from it, and only the hashes that were added or removed are computed.
+     * The resulting ring is the same as the one built from scratch.
+     */
     Ring(const NormalizedHostWeightVector& normalized_host_weights, double min_normalized_weight,
          uint64_t min_ring_size, uint64_t max_ring_size, HashFunction hash_function,
-         bool use_hostname_for_hashing, RingHashLoadBalancerStats& stats);
+         bool use_hostname_for_hashing, const Ring* previous_ring,
+         RingHashLoadBalancerStats& stats);
 
     // ThreadAwareLoadBalancerBase::HashingLoadBalancer
     HostSelectionResponse chooseHost(uint64_t hash, uint32_t attempt) const override;
 
     std::vector<RingEntry> ring_;
+    // Used to update the ring incrementally on the next build.
+    absl::flat_hash_map<const Host*, HostHashes> host_hashes_;
 
     RingHashLoadBalancerStats& stats_;
   };
@@ -110,23 +132,16 @@ private:
 
   // ThreadAwareLoadBalancerBase
   HashingLoadBalancerSharedPtr
-  createLoadBalancer(const NormalizedHostWeightVector& normalized_host_weights,
-                     double min_normalized_weight, double /* max_normalized_weight */) override {
-    HashingLoadBalancerSharedPtr ring_hash_lb =
-        std::make_shared<Ring>(normalized_host_weights, min_normalized_weight, min_ring_size_,
-                               max_ring_size_, hash_function_, use_hostname_for_hashing_, stats_);
-    if (hash_balance_factor_ == 0) {
-      return ring_hash_lb;
-    }
-
-    return std::make_shared<BoundedLoadHashingLoadBalancer>(
-        ring_hash_lb, std::move(normalized_host_weights), hash_balance_factor_);
-  }
+  createLoadBalancer(uint32_t priority, const NormalizedHostWeightVector& normalized_host_weights,
+                     double min_normalized_weight, double /* max_normalized_weight */) override;
 
   static RingHashLoadBalancerStats generateStats(Stats::Scope& scope);
 
   Stats::ScopeSharedPtr scope_;
   RingHashLoadBalancerStats stats_;
+  TimeSource& time_source_;
+  // The current ring of each priority, which the next ring of the priority is built from.
+  std::vector<RingConstSharedPtr> rings_;
 
   static const uint64_t DefaultMinRingSize = 1024;
   static const uint64_t DefaultMaxRingSize = 1024 * 1024 * 8;
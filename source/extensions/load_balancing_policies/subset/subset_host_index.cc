@@ -0,0 +1,420 @@
+#include "source/extensions/load_balancing_policies/subset/subset_host_index.h"
+
+#include <algorithm>
+
+#include "source/common/common/assert.h"
+#include "source/common/upstream/upstream_impl.h"
+
+namespace Envoy {
+namespace Upstream {
+
+size_t HostSlotSet::size() const {
+  size_t size = 0;
+  for (const Word& word : words_) {
+    size += absl::popcount(word.bits_);
+  }
+  return size;
+}
+
+HostSlotSet::Words::const_iterator HostSlotSet::lowerBound(Words::const_iterator begin,
+                                                           Words::const_iterator end,
+                                                           uint32_t index) {
+  return std::lower_bound(begin, end, index,
+                          [](const Word& word, uint32_t index) { return word.index_ < index; });
+}
+
+bool HostSlotSet::contains(uint32_t slot) const {
+  const auto it = lowerBound(words_.begin(), words_.end(), slot / 64);
+  return it != words_.end() && it->index_ == slot / 64 && (it->bits_ >> (slot % 64)) & 1;
+}
+
+void HostSlotSet::insert(uint32_t slot) {
+  const uint64_t bit = uint64_t(1) << (slot % 64);
+  const auto it = lowerBound(words_.begin(), words_.end(), slot / 64);
+  if (it == words_.end() || it->index_ != slot / 64) {
+    words_.insert(it, {slot / 64, bit});
+  } else {
+    words_[it - words_.begin()].bits_ |= bit;
+  }
+}
+
+void HostSlotSet::erase(uint32_t slot) {
+  const auto it = lowerBound(words_.begin(), words_.end(), slot / 64);
+  if (it == words_.end() || it->index_ != slot / 64) {
+    return;
+  }
+  Word& word = words_[it - words_.begin()];
+  word.bits_ &= ~(uint64_t(1) << (slot % 64));
+  if (word.bits_ == 0) {
+    words_.erase(it);
+  }
+}
+
+HostSlotSet HostSlotSet::intersection(const std::vector<const HostSlotSet*>& sets) {
+  ASSERT(!sets.empty());
+  // Walk the words of the smallest set, looking each of them up in the other sets. The lookups
+  // only move forward, so each set is searched from where the previous lookup stopped.
+  const HostSlotSet* smallest = *std::min_element(
+      sets.begin(), sets.end(), [](const HostSlotSet* a, const HostSlotSet* b) {
+        return a->words_.size() < b->words_.size();
+      });
+  std::vector<Words::const_iterator> cursors;
+  cursors.reserve(sets.size());
+  for (const HostSlotSet* set : sets) {
+    cursors.push_back(set->words_.begin());
+  }
+
+  HostSlotSet result;
+  for (const Word& word : smallest->words_) {
+    uint64_t bits = word.bits_;
+    for (size_t i = 0; i < sets.size() && bits != 0; ++i) {
+      if (sets[i] == smallest) {
+        continue;
+      }
+      cursors[i] = lowerBound(cursors[i], sets[i]->words_.end(), word.index_);
+      if (cursors[i] == sets[i]->words_.end() || cursors[i]->index_ != word.index_) {
+        bits = 0;
+      } else {
+        bits &= cursors[i]->bits_;
+      }
+    }
+    if (bits != 0) {
+      result.words_.push_back({word.index_, bits});
+    }
+  }
+  return result;
+}
+
+HostSlotSet HostSlotSet::difference(const HostSlotSet& a, const HostSlotSet& b) {
+  HostSlotSet result;
+  auto cursor = b.words_.begin();
+  for (const Word& word : a.words_) {
+    cursor = lowerBound(cursor, b.words_.end(), word.index_);
+    uint64_t bits = word.bits_;
+    if (cursor != b.words_.end() && cursor->index_ == word.index_) {
+      bits &= ~cursor->bits_;
+    }
+    if (bits != 0) {
+      result.words_.push_back({word.index_, bits});
+    }
+  }
+  return result;
+}
+
+SubsetHostIndex::SubsetHostIndex() {
+  // Reserve the ids of the pairs that do not come from host metadata.
+  kvs_.resize(DefaultSubsetKvId + 1);
+}
+
+SubsetHostIndex::KvId SubsetHostIndex::kvId(const std::string& key,
+                                            const ProtobufWkt::Value& value) {
+  auto key_it = kv_ids_.try_emplace(key).first;
+  auto [value_it, inserted] = key_it->second.try_emplace(HashedValue(value), 0);
+  if (!inserted) {
+    return value_it->second;
+  }
+
+  if (free_kv_ids_.empty()) {
+    value_it->second = kvs_.size();
+    kvs_.emplace_back();
+  } else {
+    value_it->second = free_kv_ids_.back();
+    free_kv_ids_.pop_back();
+  }
+  Kv& kv = kvs_[value_it->second];
+  kv.key_ = &key_it->first;
+  kv.value_ = &value_it->first;
+  ASSERT(kv.hosts_ == 0);
+  return value_it->second;
+}
+
+SubsetHostIndex::PriorityIndex& SubsetHostIndex::priorityIndex(uint32_t priority) {
+  while (priorities_.size() <= priority) {
+    priorities_.push_back(std::make_unique<PriorityIndex>(*this));
+  }
+  return *priorities_[priority];
+}
+
+void SubsetHostIndex::releaseUnused() {
+  for (auto& priority : priorities_) {
+    priority->releaseRemoved();
+  }
+
+  for (KvId kv_id = DefaultSubsetKvId + 1; kv_id < kvs_.size(); ++kv_id) {
+    Kv& kv = kvs_[kv_id];
+    if (kv.key_ == nullptr || kv.hosts_ != 0) {
+      continue;
+    }
+    auto key_it = kv_ids_.find(*kv.key_);
+    ASSERT(key_it != kv_ids_.end());
+    key_it->second.erase(*kv.value_);
+    if (key_it->second.empty()) {
+      kv_ids_.erase(key_it);
+    }
+    kv = Kv();
+    free_kv_ids_.push_back(kv_id);
+  }
+}
+
+SubsetHostIndex::PriorityIndex::Membership
+SubsetHostIndex::PriorityIndex::Slot::membership() const {
+  Membership membership;
+  for (uint32_t list = 0; list < NumHostLists; ++list) {
+    membership[list] = positions_[list] == npos ? 0 : 1;
+    membership[NumHostLists + list] = locality_positions_[list].first;
+  }
+  return membership;
+}
+
+void SubsetHostIndex::PriorityIndex::touch(const KvIds& kv_ids) {
+  for (const KvId kv_id : kv_ids) {
+    if (touched_by_kv_.size() <= kv_id) {
+      touched_by_kv_.resize(kv_id + 1);
+    }
+    touched_by_kv_[kv_id] = generation_;
+  }
+}
+
+void SubsetHostIndex::PriorityIndex::index(uint32_t slot, KvIds kv_ids) {
+  for (const KvId kv_id : kv_ids) {
+    if (hosts_by_kv_.size() <= kv_id) {
+      hosts_by_kv_.resize(kv_id + 1);
+    }
+    hosts_by_kv_[kv_id].insert(slot);
+    parent_.kvs_[kv_id].hosts_++;
+  }
+  touch(kv_ids);
+  slots_[slot].kv_ids_ = std::move(kv_ids);
+}
+
+void SubsetHostIndex::PriorityIndex::unindex(uint32_t slot) {
+  const KvIds& kv_ids = slots_[slot].kv_ids_;
+  for (const KvId kv_id : kv_ids) {
+    hosts_by_kv_[kv_id].erase(slot);
+    ASSERT(parent_.kvs_[kv_id].hosts_ > 0);
+    parent_.kvs_[kv_id].hosts_--;
+  }
+  touch(kv_ids);
+}
+
+void SubsetHostIndex::PriorityIndex::updateList(HostList list, const HostVector& hosts) {
+  std::vector<uint32_t>& list_slots = list_slots_[list];
+  list_slots.clear();
+  for (const HostSharedPtr& host : hosts) {
+    // Hosts that are not in the hosts of the host set are not in any subset.
+    const auto it = slot_by_host_.find(host.get());
+    if (it != slot_by_host_.end()) {
+      slots_[it->second].positions_[list] = list_slots.size();
+      list_slots.push_back(it->second);
+    }
+  }
+}
+
+void SubsetHostIndex::PriorityIndex::updateLocalities(HostList list,
+                                                      const HostsPerLocality& hosts_per_locality) {
+  std::vector<std::vector<uint32_t>>& locality_slots = locality_slots_[list];
+  if (locality_slots.size() != hosts_per_locality.get().size() ||
+      has_local_locality_[list] != hosts_per_locality.hasLocalLocality()) {
+    all_touched_ = true;
+  }
+  locality_slots.resize(hosts_per_locality.get().size());
+  has_local_locality_[list] = hosts_per_locality.hasLocalLocality();
+
+  for (uint32_t locality = 0; locality < locality_slots.size(); ++locality) {
+    locality_slots[locality].clear();
+    for (const HostSharedPtr& host : hosts_per_locality.get()[locality]) {
+      const auto it = slot_by_host_.find(host.get());
+      if (it != slot_by_host_.end()) {
+        slots_[it->second].locality_positions_[list] = {locality,
+                                                        locality_slots[locality].size()};
+        locality_slots[locality].push_back(it->second);
+      }
+    }
+  }
+}
+
+void SubsetHostIndex::PriorityIndex::update(const HostSet& host_set, const KvIdsCb& kv_ids_cb) {
+  const uint64_t generation = ++generation_;
+  all_touched_ = false;
+
+  // Find the slots of the hosts, allocating one for each new host.
+  std::vector<uint32_t> added_slots;
+  std::vector<uint32_t>& all_slots = list_slots_[AllHosts];
+  all_slots.clear();
+  for (const HostSharedPtr& host : host_set.hosts()) {
+    auto [it, inserted] = slot_by_host_.try_emplace(host.get(), 0);
+    if (inserted) {
+      if (free_slots_.empty()) {
+        it->second = slots_.size();
+        slots_.emplace_back();
+      } else {
+        it->second = free_slots_.back();
+        free_slots_.pop_back();
+      }
+      slots_[it->second].host_ = host;
+      added_slots.push_back(it->second);
+    }
+    Slot& slot = slots_[it->second];
+    slot.generation_ = generation;
+    slot.positions_.fill(npos);
+    slot.locality_positions_.fill({npos, npos});
+    slot.positions_[AllHosts] = all_slots.size();
+    all_slots.push_back(it->second);
+  }
+
+  // Hosts that were not seen are gone. Their slots are released once no subset refers to them.
+  absl::erase_if(slot_by_host_, [this, generation](const auto& entry) {
+    if (slots_[entry.second].generation_ == generation) {
+      return false;
+    }
+    unindex(entry.second);
+    removed_slots_.push_back(entry.second);
+    return true;
+  });
+
+  updateList(HealthyHosts, host_set.healthyHosts());
+  updateList(DegradedHosts, host_set.degradedHosts());
+  updateList(ExcludedHosts, host_set.excludedHosts());
+  updateLocalities(AllHosts, host_set.hostsPerLocality());
+  updateLocalities(HealthyHosts, host_set.healthyHostsPerLocality());
+  updateLocalities(DegradedHosts, host_set.degradedHostsPerLocality());
+  updateLocalities(ExcludedHosts, host_set.excludedHostsPerLocality());
+
+  if (locality_weights_ != host_set.localityWeights() ||
+      overprovisioning_factor_ != host_set.overprovisioningFactor() ||
+      weighted_priority_health_ != host_set.weightedPriorityHealth()) {
+    locality_weights_ = host_set.localityWeights();
+    overprovisioning_factor_ = host_set.overprovisioningFactor();
+    weighted_priority_health_ = host_set.weightedPriorityHealth();
+    all_touched_ = true;
+  }
+
+  // Re-index the hosts that are new or whose metadata changed, and touch the pairs of those whose
+  // health, locality or weight changed.
+  std::sort(added_slots.begin(), added_slots.end());
+  for (const uint32_t slot_index : all_slots) {
+    Slot& slot = slots_[slot_index];
+    const bool added = std::binary_search(added_slots.begin(), added_slots.end(), slot_index);
+    MetadataConstSharedPtr metadata = slot.host_->metadata();
+    const Membership membership = slot.membership();
+    const uint32_t weight = slot.host_->weight();
+    if (added || metadata != slot.metadata_) {
+      if (!added) {
+        unindex(slot_index);
+      }
+      slot.metadata_ = std::move(metadata);
+      index(slot_index, kv_ids_cb(*slot.host_));
+    } else if (membership != slot.membership_ || weight != slot.weight_) {
+      touch(slot.kv_ids_);
+    }
+    slot.membership_ = membership;
+    slot.weight_ = weight;
+  }
+}
+
+bool SubsetHostIndex::PriorityIndex::touched(const KvIds& kv_ids) const {
+  if (all_touched_) {
+    return true;
+  }
+  // A host that joined, left or changed in a subset carries all of its pairs, so a subset with
+  // any pair that was not touched is unchanged.
+  for (const KvId kv_id : kv_ids) {
+    if (kv_id >= touched_by_kv_.size() || touched_by_kv_[kv_id] != generation_) {
+      return false;
+    }
+  }
+  return true;
+}
+
+HostSlotSet SubsetHostIndex::PriorityIndex::hosts(const KvIds& kv_ids) const {
+  std::vector<const HostSlotSet*> sets;
+  sets.reserve(kv_ids.size());
+  for (const KvId kv_id : kv_ids) {
+    if (kv_id >= hosts_by_kv_.size()) {
+      return {};
+    }
+    sets.push_back(&hosts_by_kv_[kv_id]);
+  }
+  return HostSlotSet::intersection(sets);
+}
+
+HostVector SubsetHostIndex::PriorityIndex::filterList(HostList list, const HostSlotSet& slots,
+                                                      bool sparse) const {
+  HostVector hosts;
+  if (sparse) {
+    // Sort the few hosts in the set by their position in the list.
+    std::vector<std::pair<uint32_t, uint32_t>> positions;
+    slots.forEach([this, list, &positions](uint32_t slot) {
+      if (slots_[slot].positions_[list] != npos) {
+        positions.emplace_back(slots_[slot].positions_[list], slot);
+      }
+    });
+    std::sort(positions.begin(), positions.end());
+    hosts.reserve(positions.size());
+    for (const auto& position : positions) {
+      hosts.push_back(slots_[position.second].host_);
+    }
+  } else {
+    for (const uint32_t slot : list_slots_[list]) {
+      if (slots.contains(slot)) {
+        hosts.push_back(slots_[slot].host_);
+      }
+    }
+  }
+  return hosts;
+}
+
+HostsPerLocalityConstSharedPtr
+SubsetHostIndex::PriorityIndex::filterLocalities(HostList list, const HostSlotSet& slots,
+                                                 bool sparse) const {
+  const std::vector<std::vector<uint32_t>>& locality_slots = locality_slots_[list];
+  std::vector<HostVector> hosts_per_locality(locality_slots.size());
+  if (sparse) {
+    std::vector<std::pair<LocalityPosition, uint32_t>> positions;
+    slots.forEach([this, list, &positions](uint32_t slot) {
+      if (slots_[slot].locality_positions_[list].first != npos) {
+        positions.emplace_back(slots_[slot].locality_positions_[list], slot);
+      }
+    });
+    std::sort(positions.begin(), positions.end());
+    for (const auto& position : positions) {
+      hosts_per_locality[position.first.first].push_back(slots_[position.second].host_);
+    }
+  } else {
+    for (uint32_t locality = 0; locality < locality_slots.size(); ++locality) {
+      for (const uint32_t slot : locality_slots[locality]) {
+        if (slots.contains(slot)) {
+          hosts_per_locality[locality].push_back(slots_[slot].host_);
+        }
+      }
+    }
+  }
+  return std::make_shared<HostsPerLocalityImpl>(std::move(hosts_per_locality),
+                                                has_local_locality_[list]);
+}
+
+PrioritySet::UpdateHostsParams
+SubsetHostIndex::PriorityIndex::hostLists(const HostSlotSet& slots) const {
+  // Sorting the hosts of a small subset is cheaper than walking the lists of the whole host set.
+  const bool sparse = slots.size() * 8 < list_slots_[AllHosts].size();
+  return HostSetImpl::updateHostsParams(
+      std::make_shared<HostVector>(filterList(AllHosts, slots, sparse)),
+      filterLocalities(AllHosts, slots, sparse),
+      std::make_shared<HealthyHostVector>(filterList(HealthyHosts, slots, sparse)),
+      filterLocalities(HealthyHosts, slots, sparse),
+      std::make_shared<DegradedHostVector>(filterList(DegradedHosts, slots, sparse)),
+      filterLocalities(DegradedHosts, slots, sparse),
+      std::make_shared<ExcludedHostVector>(filterList(ExcludedHosts, slots, sparse)),
+      filterLocalities(ExcludedHosts, slots, sparse));
+}
+
+void SubsetHostIndex::PriorityIndex::releaseRemoved() {
+  for (const uint32_t slot : removed_slots_) {
+    slots_[slot] = Slot();
+    free_slots_.push_back(slot);
+  }
+  removed_slots_.clear();
+}
+
+} // namespace Upstream
+} // namespace Envoy
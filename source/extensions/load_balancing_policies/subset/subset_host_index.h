@@ -0,0 +1,225 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/upstream/upstream.h"
+
+#include "source/common/protobuf/protobuf.h"
+#include "source/common/protobuf/utility.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/numeric/bits.h"
+
+namespace Envoy {
+namespace Upstream {
+
+/**
+ * Set of host slots (see SubsetHostIndex), stored as the non-zero 64 bit words of a bitmap,
+ * sorted by word index. A set of a few hosts takes a few words regardless of the number of slots,
+ * while a dense set takes about twice the space of a plain bitmap.
+ */
+class HostSlotSet {
+public:
+  bool empty() const { return words_.empty(); }
+  size_t size() const;
+  bool contains(uint32_t slot) const;
+  void insert(uint32_t slot);
+  void erase(uint32_t slot);
+
+  /**
+   * Calls fn for each slot in the set, in ascending order.
+   */
+  template <class Fn> void forEach(Fn fn) const {
+    for (const Word& word : words_) {
+      for (uint64_t bits = word.bits_; bits != 0; bits &= bits - 1) {
+        fn(word.index_ * 64 + absl::countr_zero(bits));
+      }
+    }
+  }
+
+  /**
+   * @return the slots that are in all of the given sets. sets must not be empty.
+   */
+  static HostSlotSet intersection(const std::vector<const HostSlotSet*>& sets);
+
+  /**
+   * @return the slots that are in a but not in b.
+   */
+  static HostSlotSet difference(const HostSlotSet& a, const HostSlotSet& b);
+
+  bool operator==(const HostSlotSet& other) const { return words_ == other.words_; }
+
+private:
+  struct Word {
+    bool operator==(const Word& other) const {
+      return index_ == other.index_ && bits_ == other.bits_;
+    }
+
+    uint32_t index_;
+    uint64_t bits_;
+  };
+  using Words = std::vector<Word>;
+
+  static Words::const_iterator lowerBound(Words::const_iterator begin, Words::const_iterator end,
+                                          uint32_t index);
+
+  Words words_;
+};
+
+/**
+ * Index of the hosts of a subset load balancer by their subset metadata.
+ *
+ * Each (key, value) pair of subset metadata is given an id, and in each priority each host is
+ * given a slot that stays the same for as long as the host is in the host set. Every pair maps
+ * to the set of slots of the hosts that carry it, so that the hosts of a subset are the
+ * intersection of the sets of its pairs. The index is updated incrementally: only the hosts that
+ * were added or removed, or whose metadata changed, are re-indexed, and the pairs of the hosts
+ * that changed in any way are marked as touched, so that subsets none of whose pairs were touched
+ * can skip the update altogether.
+ */
+class SubsetHostIndex {
+public:
+  using KvId = uint32_t;
+  using KvIds = std::vector<KvId>;
+  // Called for each host that was added or whose metadata changed, to get the sorted ids of the
+  // pairs it carries.
+  using KvIdsCb = std::function<KvIds(const Host& host)>;
+
+  // A pair every host carries, and a pair the hosts of the default subset carry.
+  static constexpr KvId AnyHostKvId = 0;
+  static constexpr KvId DefaultSubsetKvId = 1;
+
+  class PriorityIndex {
+  public:
+    PriorityIndex(SubsetHostIndex& parent) : parent_(parent) {}
+
+    /**
+     * Reconciles the index with the current hosts of host_set.
+     */
+    void update(const HostSet& host_set, const KvIdsCb& kv_ids_cb);
+
+    /**
+     * @return true if the hosts of the subset formed by kv_ids may have changed in the last
+     *         update.
+     */
+    bool touched(const KvIds& kv_ids) const;
+
+    /**
+     * @return the slots of the hosts that carry all of kv_ids.
+     */
+    HostSlotSet hosts(const KvIds& kv_ids) const;
+
+    /**
+     * @return the host in a slot. Slots of hosts removed in the last update remain valid until
+     *         SubsetHostIndex::releaseUnused() is called.
+     */
+    const HostSharedPtr& host(uint32_t slot) const { return slots_[slot].host_; }
+
+    /**
+     * @return the position of the host in a slot in the hosts of the host set.
+     */
+    uint32_t position(uint32_t slot) const { return slots_[slot].positions_[AllHosts]; }
+
+    /**
+     * @return the host lists of the hosts in slots, in the order of the lists of the host set.
+     */
+    PrioritySet::UpdateHostsParams hostLists(const HostSlotSet& slots) const;
+
+  private:
+    friend class SubsetHostIndex;
+
+    enum HostList { AllHosts, HealthyHosts, DegradedHosts, ExcludedHosts, NumHostLists };
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    using LocalityPosition = std::pair<uint32_t, uint32_t>;
+    // The lists and localities a host is in, to find the hosts whose health or locality changed.
+    using Membership = std::array<uint32_t, 2 * NumHostLists>;
+
+    struct Slot {
+      Membership membership() const;
+
+      HostSharedPtr host_;
+      MetadataConstSharedPtr metadata_;
+      KvIds kv_ids_;
+      uint32_t weight_{};
+      Membership membership_{};
+      // The last update in which the host was in the host set.
+      uint64_t generation_{};
+      // Position of the host in each host list, or npos.
+      std::array<uint32_t, NumHostLists> positions_;
+      // Locality and position within it of the host in each per locality host list, or npos.
+      std::array<LocalityPosition, NumHostLists> locality_positions_;
+    };
+
+    void index(uint32_t slot, KvIds kv_ids);
+    void unindex(uint32_t slot);
+    void touch(const KvIds& kv_ids);
+    void updateList(HostList list, const HostVector& hosts);
+    void updateLocalities(HostList list, const HostsPerLocality& hosts_per_locality);
+    HostVector filterList(HostList list, const HostSlotSet& slots, bool sparse) const;
+    HostsPerLocalityConstSharedPtr filterLocalities(HostList list, const HostSlotSet& slots,
+                                                    bool sparse) const;
+    void releaseRemoved();
+
+    SubsetHostIndex& parent_;
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> free_slots_;
+    std::vector<uint32_t> removed_slots_;
+    absl::flat_hash_map<const Host*, uint32_t> slot_by_host_;
+    // Indexed by KvId.
+    std::vector<HostSlotSet> hosts_by_kv_;
+    std::vector<uint64_t> touched_by_kv_;
+    uint64_t generation_{};
+    bool all_touched_{};
+
+    // Slots of the hosts of each host list of the host set, in order.
+    std::array<std::vector<uint32_t>, NumHostLists> list_slots_;
+    std::array<std::vector<std::vector<uint32_t>>, NumHostLists> locality_slots_;
+    std::array<bool, NumHostLists> has_local_locality_{};
+    LocalityWeightsConstSharedPtr locality_weights_;
+    uint32_t overprovisioning_factor_{};
+    bool weighted_priority_health_{};
+  };
+
+  SubsetHostIndex();
+
+  /**
+   * @return the id of a (key, value) pair, allocating one if needed. The id remains valid for as
+   *         long as any host carries the pair.
+   */
+  KvId kvId(const std::string& key, const ProtobufWkt::Value& value);
+
+  /**
+   * @return the index of a priority, creating it if needed.
+   */
+  PriorityIndex& priorityIndex(uint32_t priority);
+
+  /**
+   * Releases the slots of the hosts removed by the last updates and the ids of the pairs no host
+   * carries anymore. Must only be called once no subset refers to those any longer.
+   */
+  void releaseUnused();
+
+private:
+  struct Kv {
+    const std::string* key_{};
+    const HashedValue* value_{};
+    // The number of hosts that carry the pair, across priorities.
+    uint64_t hosts_{};
+  };
+
+  absl::node_hash_map<std::string, absl::node_hash_map<HashedValue, KvId>> kv_ids_;
+  // Indexed by KvId.
+  std::vector<Kv> kvs_;
+  std::vector<KvId> free_kv_ids_;
+  std::vector<std::unique_ptr<PriorityIndex>> priorities_;
+};
+
+} // namespace Upstream
+} // namespace Envoy
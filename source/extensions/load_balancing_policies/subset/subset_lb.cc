@@ -1,5 +1,6 @@
 #include "source/extensions/load_balancing_policies/subset/subset_lb.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "envoy/common/optref.h"
@@ -42,8 +43,6 @@ filterCriteriaBySelectors(const std::vector<SubsetSelectorPtr>& subset_selectors
 
 } // namespace
 
-using HostPredicate = std::function<bool(const Host&)>;
-
 SubsetLoadBalancer::SubsetLoadBalancer(const SubsetLoadBalancerConfig& lb_config,
                                        const Upstream::ClusterInfo& cluster_info,
                                        const PrioritySet& priority_set,
@@ -86,12 +85,14 @@ SubsetLoadBalancer::SubsetLoadBalancer(const SubsetLoadBalancerConfig& lb_config
 
   // Create filtered default subset (if necessary) and other subsets based on current hosts.
   refreshSubsets();
+  host_index_.releaseUnused();
 
   // Configure future updates.
   original_priority_set_callback_handle_ = priority_set.addPriorityUpdateCb(
       [this](uint32_t priority, const HostVector&, const HostVector&) {
         refreshSubsets(priority);
         purgeEmptySubsets(subsets_);
+        host_index_.releaseUnused();
         return absl::OkStatus();
       });
 }
@@ -108,14 +109,14 @@ SubsetLoadBalancer::~SubsetLoadBalancer() {
 
 void SubsetLoadBalancer::refreshSubsets() {
   for (auto& host_set : original_priority_set_.hostSetsPerPriority()) {
-    update(host_set->priority(), host_set->hosts());
+    update(*host_set);
   }
 }
 
 void SubsetLoadBalancer::refreshSubsets(uint32_t priority) {
   const auto& host_sets = original_priority_set_.hostSetsPerPriority();
   ASSERT(priority < host_sets.size());
-  update(priority, host_sets[priority]->hosts());
+  update(*host_sets[priority]);
 }
 
 void SubsetLoadBalancer::initSubsetAnyOnce() {
@@ -123,6 +124,7 @@ void SubsetLoadBalancer::initSubsetAnyOnce() {
     subset_any_ = std::make_shared<LbSubsetEntry>();
     subset_any_->lb_subset_ =
         std::make_unique<PriorityLbSubset>(*this, locality_weight_aware_, scale_locality_weight_);
+    subset_any_->kv_ids_ = {SubsetHostIndex::AnyHostKvId};
   }
 }
 
@@ -131,6 +133,7 @@ void SubsetLoadBalancer::initSubsetDefaultOnce() {
     subset_default_ = std::make_shared<LbSubsetEntry>();
     subset_default_->lb_subset_ =
         std::make_unique<PriorityLbSubset>(*this, locality_weight_aware_, scale_locality_weight_);
+    subset_default_->kv_ids_ = {SubsetHostIndex::DefaultSubsetKvId};
   }
 }
 
@@ -422,37 +425,8 @@ SubsetLoadBalancer::LbSubsetEntryPtr SubsetLoadBalancer::findSubset(
   return nullptr;
 }
 
-void SubsetLoadBalancer::updateFallbackSubset(uint32_t priority, const HostVector& all_hosts) {
-  auto update_func = [priority, &all_hosts](LbSubsetPtr& subset, const HostPredicate& predicate,
-                                            uint64_t seed) {
-    for (const auto& host : all_hosts) {
-      if (predicate(*host)) {
-        subset->pushHost(priority, host);
-      }
-    }
-    subset->finalize(priority, seed);
-  };
-
-  if (subset_any_ != nullptr) {
-    update_func(subset_any_->lb_subset_, [](const Host&) { return true; }, random_.random());
-  }
-
-  if (subset_default_ != nullptr) {
-    HostPredicate predicate = std::bind(&SubsetLoadBalancer::hostMatches, this,
-                                        default_subset_metadata_, std::placeholders::_1);
-    update_func(subset_default_->lb_subset_, predicate, random_.random());
-  }
-
-  if (fallback_subset_ == nullptr) {
-    ENVOY_LOG(debug, "subset lb: fallback load balancer disabled");
-    return;
-  }
-
-  // Same thing for the panic mode subset.
-  ASSERT(panic_mode_subset_ == nullptr || panic_mode_subset_ == subset_any_);
-}
-
-void SubsetLoadBalancer::initLbSubsetEntryOnce(LbSubsetEntryPtr& entry, bool single_host_subset) {
+void SubsetLoadBalancer::initLbSubsetEntryOnce(LbSubsetEntryPtr& entry, bool single_host_subset,
+                                               const SubsetMetadata& kvs) {
   ASSERT(entry != nullptr);
   if (entry->initialized()) {
     return;
@@ -467,40 +441,74 @@ void SubsetLoadBalancer::initLbSubsetEntryOnce(LbSubsetEntryPtr& entry, bool sin
     entry->single_host_subset_ = false;
   }
 
+  entry->kv_ids_.reserve(kvs.size());
+  for (const auto& [key, value] : kvs) {
+    entry->kv_ids_.push_back(host_index_.kvId(key, value));
+  }
+
   stats_.lb_subsets_active_.inc();
   stats_.lb_subsets_created_.inc();
 }
 
-// Iterates all the hosts of specified priority, looking up an LbSubsetEntryPtr for each and add
-// hosts to related entry. Because the metadata of host can be updated inlined, we must evaluate
-// every hosts for every update.
-void SubsetLoadBalancer::processSubsets(uint32_t priority, const HostVector& all_hosts) {
-  absl::flat_hash_set<const LbSubsetEntry*> single_host_entries;
-  uint64_t collision_count_of_single_host_entries{};
+// Called by the index for each host that is new or whose metadata changed. Finds or creates the
+// subsets of the host for each selector, and returns the (key, value) pairs of those subsets,
+// which are the pairs the host is indexed by.
+SubsetHostIndex::KvIds SubsetLoadBalancer::indexHost(const Host& host) {
+  SubsetHostIndex::KvIds kv_ids{SubsetHostIndex::AnyHostKvId};
+  if (subset_default_ != nullptr && hostMatches(default_subset_metadata_, host)) {
+    kv_ids.push_back(SubsetHostIndex::DefaultSubsetKvId);
+  }
 
-  for (const auto& host : all_hosts) {
-    for (const auto& subset_selector : subset_selectors_) {
-      const auto& keys = subset_selector->selectorKeys();
-      // For each host, for each subset key, attempt to extract the metadata corresponding to the
-      // key from the host.
-      std::vector<SubsetMetadata> all_kvs = extractSubsetMetadata(keys, *host);
-      for (const auto& kvs : all_kvs) {
-        // The host has metadata for each key, find or create its subset.
-        auto entry = findOrCreateLbSubsetEntry(subsets_, kvs, 0);
-        initLbSubsetEntryOnce(entry, subset_selector->singleHostPerSubset());
-
-        if (entry->single_host_subset_) {
-          if (single_host_entries.contains(entry.get())) {
-            collision_count_of_single_host_entries++;
-            continue;
-          }
-          single_host_entries.emplace(entry.get());
-        }
+  for (const auto& subset_selector : subset_selectors_) {
+    const auto& keys = subset_selector->selectorKeys();
+    // For each subset key, attempt to extract the metadata corresponding to the key from the
+    // host.
+    std::vector<SubsetMetadata> all_kvs = extractSubsetMetadata(keys, host);
+    for (const auto& kvs : all_kvs) {
+      // The host has metadata for each key, find or create its subset.
+      auto entry = findOrCreateLbSubsetEntry(subsets_, kvs, 0);
+      initLbSubsetEntryOnce(entry, subset_selector->singleHostPerSubset(), kvs);
+      kv_ids.insert(kv_ids.end(), entry->kv_ids_.begin(), entry->kv_ids_.end());
+    }
+  }
 
-        entry->lb_subset_->pushHost(priority, host);
-      }
+  std::sort(kv_ids.begin(), kv_ids.end());
+  kv_ids.erase(std::unique(kv_ids.begin(), kv_ids.end()), kv_ids.end());
+  return kv_ids;
+}
+
+// Updates the subsets whose hosts may have changed in the last update of the index. The hosts of
+// each subset are the intersection of the hosts of its (key, value) pairs, so the cost of an
+// update is proportional to the hosts that changed and the subsets they are in, rather than to
+// the number of hosts times the number of selectors.
+void SubsetLoadBalancer::processSubsets(uint32_t priority) {
+  const SubsetHostIndex::PriorityIndex& index = host_index_.priorityIndex(priority);
+  const auto update_subset = [this, priority, &index](LbSubsetEntry& entry) {
+    if (entry.initialized() && index.touched(entry.kv_ids_)) {
+      entry.lb_subset_->update(priority, index, index.hosts(entry.kv_ids_), random_.random());
     }
+  };
+
+  if (subset_any_ != nullptr) {
+    update_subset(*subset_any_);
+  }
+  if (subset_default_ != nullptr) {
+    update_subset(*subset_default_);
+  }
+  if (fallback_subset_ == nullptr) {
+    ENVOY_LOG(debug, "subset lb: fallback load balancer disabled");
   }
+  // Same thing for the panic mode subset.
+  ASSERT(panic_mode_subset_ == nullptr || panic_mode_subset_ == subset_any_);
+
+  uint64_t collision_count_of_single_host_entries{};
+  forEachSubset(subsets_, [&](LbSubsetEntryPtr& entry) {
+    update_subset(*entry);
+    if (entry->single_host_subset_) {
+      collision_count_of_single_host_entries +=
+          static_cast<const SingleHostLbSubset&>(*entry->lb_subset_).duplicates(priority);
+    }
+  });
 
   // This stat isn't added to `ClusterTrafficStats` because it wouldn't be used for nearly all
   // clusters, and is only set during configuration updates, not in the data path, so performance
@@ -513,20 +521,14 @@ void SubsetLoadBalancer::processSubsets(uint32_t priority, const HostVector& all
         scope_, {name_storage.statName()}, Stats::Gauge::ImportMode::Accumulate);
   }
   single_duplicate_stat_->set(collision_count_of_single_host_entries);
-
-  // Finalize updates after all the hosts are evaluated.
-  forEachSubset(subsets_, [priority, this](LbSubsetEntryPtr entry) {
-    if (entry->initialized()) {
-      entry->lb_subset_->finalize(priority, random_.random());
-    }
-  });
 }
 
-// Given the latest all hosts, update all subsets for this priority level, creating new subsets as
-// necessary.
-void SubsetLoadBalancer::update(uint32_t priority, const HostVector& all_hosts) {
-  updateFallbackSubset(priority, all_hosts);
-  processSubsets(priority, all_hosts);
+// Given the latest hosts of a priority, re-index the hosts that changed and update the subsets
+// they are in, creating new subsets as necessary.
+void SubsetLoadBalancer::update(const HostSet& host_set) {
+  host_index_.priorityIndex(host_set.priority())
+      .update(host_set, [this](const Host& host) { return indexHost(host); });
+  processSubsets(host_set.priority());
 }
 
 bool SubsetLoadBalancer::hostMatches(const SubsetMetadata& kvs, const Host& host) {
@@ -730,71 +732,24 @@ SubsetLoadBalancer::PrioritySubsetImpl::PrioritySubsetImpl(const SubsetLoadBalan
 // Given all hosts that that belong in this subset, hosts_added and hosts_removed, update the
 // underlying HostSet. The hosts_added Hosts and hosts_removed Hosts have been filtered to match
 // hosts that belong in this subset.
-void SubsetLoadBalancer::HostSubsetImpl::update(const HostHashSet& matching_hosts,
+void SubsetLoadBalancer::HostSubsetImpl::update(const SubsetHostIndex::PriorityIndex& index,
+                                                const HostSlotSet& matching_hosts,
                                                 const HostVector& hosts_added,
                                                 const HostVector& hosts_removed, uint64_t seed) {
-  auto cached_predicate = [&matching_hosts](const auto& host) {
-    return matching_hosts.count(&host) == 1;
-  };
-
-  // TODO(snowp): If we had a unhealthyHosts() function we could avoid potentially traversing
-  // the list of hosts twice.
-  auto hosts = std::make_shared<HostVector>();
-  hosts->reserve(original_host_set_.hosts().size());
-  for (const auto& host : original_host_set_.hosts()) {
-    if (cached_predicate(*host)) {
-      hosts->emplace_back(host);
-    }
-  }
-
-  auto healthy_hosts = std::make_shared<HealthyHostVector>();
-  healthy_hosts->get().reserve(original_host_set_.healthyHosts().size());
-  for (const auto& host : original_host_set_.healthyHosts()) {
-    if (cached_predicate(*host)) {
-      healthy_hosts->get().emplace_back(host);
-    }
-  }
-
-  auto degraded_hosts = std::make_shared<DegradedHostVector>();
-  degraded_hosts->get().reserve(original_host_set_.degradedHosts().size());
-  for (const auto& host : original_host_set_.degradedHosts()) {
-    if (cached_predicate(*host)) {
-      degraded_hosts->get().emplace_back(host);
-    }
-  }
-
-  auto excluded_hosts = std::make_shared<ExcludedHostVector>();
-  excluded_hosts->get().reserve(original_host_set_.excludedHosts().size());
-  for (const auto& host : original_host_set_.excludedHosts()) {
-    if (cached_predicate(*host)) {
-      excluded_hosts->get().emplace_back(host);
-    }
-  }
-
-  // If we only have one locality we can avoid the first call to filter() by
-  // just creating a new HostsPerLocality from the list of all hosts.
-  HostsPerLocalityConstSharedPtr hosts_per_locality;
+  PrioritySet::UpdateHostsParams params = index.hostLists(matching_hosts);
 
+  // If we only have one locality we can avoid filtering the hosts per locality by just creating a
+  // new HostsPerLocality from the list of all hosts.
   if (original_host_set_.hostsPerLocality().get().size() == 1) {
-    hosts_per_locality = std::make_shared<HostsPerLocalityImpl>(
-        *hosts, original_host_set_.hostsPerLocality().hasLocalLocality());
-  } else {
-    hosts_per_locality = original_host_set_.hostsPerLocality().filter({cached_predicate})[0];
+    params.hosts_per_locality = std::make_shared<HostsPerLocalityImpl>(
+        *params.hosts, original_host_set_.hostsPerLocality().hasLocalLocality());
   }
 
-  auto healthy_hosts_per_locality =
-      original_host_set_.healthyHostsPerLocality().filter({cached_predicate})[0];
-  auto degraded_hosts_per_locality =
-      original_host_set_.degradedHostsPerLocality().filter({cached_predicate})[0];
-  auto excluded_hosts_per_locality =
-      original_host_set_.excludedHostsPerLocality().filter({cached_predicate})[0];
-
-  HostSetImpl::updateHosts(
-      HostSetImpl::updateHostsParams(
-          hosts, hosts_per_locality, healthy_hosts, healthy_hosts_per_locality, degraded_hosts,
-          degraded_hosts_per_locality, excluded_hosts, excluded_hosts_per_locality),
-      determineLocalityWeights(*hosts_per_locality), hosts_added, hosts_removed, seed,
-      original_host_set_.weightedPriorityHealth(), original_host_set_.overprovisioningFactor());
+  LocalityWeightsConstSharedPtr locality_weights =
+      determineLocalityWeights(*params.hosts_per_locality);
+  HostSetImpl::updateHosts(std::move(params), std::move(locality_weights), hosts_added,
+                           hosts_removed, seed, original_host_set_.weightedPriorityHealth(),
+                           original_host_set_.overprovisioningFactor());
 }
 
 LocalityWeightsConstSharedPtr SubsetLoadBalancer::HostSubsetImpl::determineLocalityWeights(
@@ -848,12 +803,13 @@ HostSetImplPtr SubsetLoadBalancer::PrioritySubsetImpl::createHostSet(
 }
 
 void SubsetLoadBalancer::PrioritySubsetImpl::update(uint32_t priority,
-                                                    const HostHashSet& matching_hosts,
+                                                    const SubsetHostIndex::PriorityIndex& index,
+                                                    const HostSlotSet& matching_hosts,
                                                     const HostVector& hosts_added,
                                                     const HostVector& hosts_removed,
                                                     uint64_t seed) {
   const auto& host_subset = getOrCreateHostSet(priority);
-  updateSubset(priority, matching_hosts, hosts_added, hosts_removed, seed);
+  updateSubset(priority, index, matching_hosts, hosts_added, hosts_removed, seed);
 
   if (host_subset.hosts().empty() != empty_) {
     empty_ = true;
@@ -870,31 +826,56 @@ void SubsetLoadBalancer::PrioritySubsetImpl::update(uint32_t priority,
   }
 }
 
-void SubsetLoadBalancer::PriorityLbSubset::finalize(uint32_t priority, uint64_t seed) {
-  while (host_sets_.size() <= priority) {
-    host_sets_.push_back({HostHashSet(), HostHashSet()});
+void SubsetLoadBalancer::PriorityLbSubset::update(uint32_t priority,
+                                                  const SubsetHostIndex::PriorityIndex& index,
+                                                  HostSlotSet hosts, uint64_t seed) {
+  if (host_sets_.size() <= priority) {
+    host_sets_.resize(priority + 1);
   }
-  auto& [old_hosts, new_hosts] = host_sets_[priority];
+  HostSlotSet& old_hosts = host_sets_[priority];
 
   HostVector added;
   HostVector removed;
+  HostSlotSet::difference(hosts, old_hosts).forEach([&](uint32_t slot) {
+    added.emplace_back(index.host(slot));
+  });
+  HostSlotSet::difference(old_hosts, hosts).forEach([&](uint32_t slot) {
+    removed.emplace_back(index.host(slot));
+  });
 
-  for (const auto& host : old_hosts) {
-    if (new_hosts.count(host) == 0) {
-      removed.emplace_back(host);
-    }
-  }
+  subset_.update(priority, index, hosts, added, removed, seed);
 
-  for (const auto& host : new_hosts) {
-    if (old_hosts.count(host) == 0) {
-      added.emplace_back(host);
+  old_hosts = std::move(hosts);
+}
+
+void SubsetLoadBalancer::SingleHostLbSubset::update(uint32_t priority,
+                                                    const SubsetHostIndex::PriorityIndex& index,
+                                                    HostSlotSet hosts, uint64_t) {
+  absl::optional<uint32_t> first;
+  uint64_t count = 0;
+  hosts.forEach([&](uint32_t slot) {
+    if (!first.has_value() || index.position(slot) < index.position(first.value())) {
+      first = slot;
     }
+    count++;
+  });
+
+  if (!first.has_value()) {
+    // No any host for current subset and priority. Try remove record in the hosts_.
+    hosts_.erase(priority);
+    duplicates_.erase(priority);
+  } else {
+    // Single host is set for current subset and priority.
+    hosts_[priority] = index.host(first.value());
+    duplicates_[priority] = count - 1;
   }
 
-  subset_.update(priority, new_hosts, added, removed, seed);
+  if (hosts_.empty()) {
+    subset_ = nullptr;
+    return;
+  }
 
-  old_hosts.swap(new_hosts);
-  new_hosts.clear();
+  subset_ = hosts_.begin()->second;
 }
 
 SubsetLoadBalancer::LoadBalancerContextWrapper::LoadBalancerContextWrapper(
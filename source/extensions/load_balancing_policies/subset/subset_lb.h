@@ -22,6 +22,7 @@
 #include "source/common/protobuf/utility.h"
 #include "source/common/upstream/load_balancer_context_base.h"
 #include "source/common/upstream/upstream_impl.h"
+#include "source/extensions/load_balancing_policies/subset/subset_host_index.h"
 #include "source/extensions/load_balancing_policies/subset/subset_lb_config.h"
 
 #include "absl/container/node_hash_map.h"
@@ -30,8 +31,6 @@
 namespace Envoy {
 namespace Upstream {
 
-using HostHashSet = absl::flat_hash_set<HostSharedPtr>;
-
 class SubsetLoadBalancer : public LoadBalancer, Logger::Loggable<Logger::Id::upstream> {
 public:
   SubsetLoadBalancer(const SubsetLoadBalancerConfig& lb_config,
@@ -85,8 +84,8 @@ private:
           original_host_set_(original_host_set), locality_weight_aware_(locality_weight_aware),
           scale_locality_weight_(scale_locality_weight) {}
 
-    void update(const HostHashSet& matching_hosts, const HostVector& hosts_added,
-                const HostVector& hosts_removed, uint64_t seed);
+    void update(const SubsetHostIndex::PriorityIndex& index, const HostSlotSet& matching_hosts,
+                const HostVector& hosts_added, const HostVector& hosts_removed, uint64_t seed);
     LocalityWeightsConstSharedPtr
     determineLocalityWeights(const HostsPerLocality& hosts_per_locality) const;
 
@@ -102,7 +101,8 @@ private:
     PrioritySubsetImpl(const SubsetLoadBalancer& subset_lb, bool locality_weight_aware,
                        bool scale_locality_weight);
 
-    void update(uint32_t priority, const HostHashSet& matching_hosts, const HostVector& hosts_added,
+    void update(uint32_t priority, const SubsetHostIndex::PriorityIndex& index,
+                const HostSlotSet& matching_hosts, const HostVector& hosts_added,
                 const HostVector& hosts_removed, uint64_t seed);
 
     bool empty() const { return empty_; }
@@ -113,11 +113,11 @@ private:
       }
     }
 
-    void updateSubset(uint32_t priority, const HostHashSet& matching_hosts,
-                      const HostVector& hosts_added, const HostVector& hosts_removed,
-                      uint64_t seed) {
+    void updateSubset(uint32_t priority, const SubsetHostIndex::PriorityIndex& index,
+                      const HostSlotSet& matching_hosts, const HostVector& hosts_added,
+                      const HostVector& hosts_removed, uint64_t seed) {
       reinterpret_cast<HostSubsetImpl*>(host_sets_[priority].get())
-          ->update(matching_hosts, hosts_added, hosts_removed, seed);
+          ->update(index, matching_hosts, hosts_added, hosts_removed, seed);
       THROW_IF_NOT_OK(runUpdateCallbacks(hosts_added, hosts_removed));
     }
 
@@ -222,8 +222,9 @@ private:
   public:
     virtual ~LbSubset() = default;
     virtual HostSelectionResponse chooseHost(LoadBalancerContext* context) const PURE;
-    virtual void pushHost(uint32_t priority, HostSharedPtr host) PURE;
-    virtual void finalize(uint32_t priority, uint64_t seed) PURE;
+    // Updates the subset with its hosts of a priority, given as slots of the index.
+    virtual void update(uint32_t priority, const SubsetHostIndex::PriorityIndex& index,
+                        HostSlotSet hosts, uint64_t seed) PURE;
     virtual bool active() const PURE;
   };
   using LbSubsetPtr = std::unique_ptr<LbSubset>;
@@ -238,54 +239,35 @@ private:
     HostSelectionResponse chooseHost(LoadBalancerContext* context) const override {
       return subset_.lb_->chooseHost(context);
     }
-    void pushHost(uint32_t priority, HostSharedPtr host) override {
-      while (host_sets_.size() <= priority) {
-        host_sets_.push_back({HostHashSet(), HostHashSet()});
-      }
-      host_sets_[priority].second.emplace(std::move(host));
-    }
-    // Called after pushHost. Update subset by the hosts that pushed in the pushHost. If no any host
-    // is pushed then subset_ will be set to empty.
-    void finalize(uint32_t priority, uint64_t seed) override;
+    void update(uint32_t priority, const SubsetHostIndex::PriorityIndex& index, HostSlotSet hosts,
+                uint64_t seed) override;
 
     bool active() const override { return !subset_.empty(); }
 
-    std::vector<std::pair<HostHashSet, HostHashSet>> host_sets_;
+    // The hosts of each priority as of the last update.
+    std::vector<HostSlotSet> host_sets_;
     PrioritySubsetImpl subset_;
   };
 
   class SingleHostLbSubset : public LbSubset {
+  public:
     // Subset
     HostSelectionResponse chooseHost(LoadBalancerContext*) const override { return subset_; }
-    // This is called at most once for every update for single host subset.
-    void pushHost(uint32_t priority, HostSharedPtr host) override {
-      new_hosts_[priority] = std::move(host);
-    }
-    // Called after pushHost. Update subset by the host that pushed in the pushHost. If no any host
-    // is pushed then subset_ will be set to nullptr.
-    void finalize(uint32_t priority, uint64_t) override {
-      if (auto iter = new_hosts_.find(priority); iter == new_hosts_.end()) {
-        // No any host for current subset and priority. Try remove record in the hosts_.
-        hosts_.erase(priority);
-      } else {
-        // Single host is set for current subset and priority.
-        hosts_[priority] = std::move(iter->second);
-        new_hosts_.erase(priority);
-      }
-
-      if (hosts_.empty()) {
-        subset_ = nullptr;
-        return;
-      }
+    // The host that comes first in the host set is used, and the others are counted as
+    // duplicates.
+    void update(uint32_t priority, const SubsetHostIndex::PriorityIndex& index, HostSlotSet hosts,
+                uint64_t) override;
+    bool active() const override { return subset_ != nullptr; }
 
-      subset_ = hosts_.begin()->second;
+    uint64_t duplicates(uint32_t priority) const {
+      const auto it = duplicates_.find(priority);
+      return it == duplicates_.end() ? 0 : it->second;
     }
-    bool active() const override { return subset_ != nullptr; }
 
     // We will update subsets for every priority separately and these simple map can help us
     // to ensure which priority has valid host quickly.
     std::map<uint32_t, HostSharedPtr> hosts_;
-    std::map<uint32_t, HostSharedPtr> new_hosts_;
+    std::map<uint32_t, uint64_t> duplicates_;
     HostConstSharedPtr subset_;
   };
 
@@ -305,19 +287,23 @@ private:
 
     // Used to quick check if entry is single host subset entry or not.
     bool single_host_subset_{};
+
+    // The (key, value) pairs of the subset. Only set if initialized.
+    SubsetHostIndex::KvIds kv_ids_;
   };
 
-  void initLbSubsetEntryOnce(LbSubsetEntryPtr& entry, bool single_host_subset);
+  void initLbSubsetEntryOnce(LbSubsetEntryPtr& entry, bool single_host_subset,
+                             const SubsetMetadata& kvs);
 
   // Create filtered default subset (if necessary) and other subsets based on current hosts.
   void refreshSubsets();
   void refreshSubsets(uint32_t priority);
 
   // Called by HostSet::MemberUpdateCb
-  void update(uint32_t priority, const HostVector& all_hosts);
+  void update(const HostSet& host_set);
 
-  void updateFallbackSubset(uint32_t priority, const HostVector& all_hosts);
-  void processSubsets(uint32_t priority, const HostVector& all_hosts);
+  SubsetHostIndex::KvIds indexHost(const Host& host);
+  void processSubsets(uint32_t priority);
 
   HostConstSharedPtr tryChooseHostFromContext(LoadBalancerContext* context, bool& host_chosen);
 
@@ -369,6 +355,8 @@ private:
 
   // Forms a trie-like structure. Requires lexically sorted Host and Route metadata.
   LbSubsetMap subsets_;
+  // Maps the (key, value) pairs of subset metadata to the hosts that carry them.
+  SubsetHostIndex host_index_;
   // Forms a trie-like structure of lexically sorted keys+fallback policy from subset
   // selectors configuration
   SubsetSelectorMapPtr selectors_;
@@ -104,6 +104,14 @@ getAlternateProtocolsCacheOptions(
   return absl::nullopt;
 }
 
+uint32_t getSharedConnectionPoolOwners(
+    const envoy::extensions::upstreams::http::v3::HttpProtocolOptions& options) {
+  if (!options.has_shared_connection_pool()) {
+    return 0;
+  }
+  return PROTOBUF_GET_WRAPPED_OR_DEFAULT(options.shared_connection_pool(), owners_per_host, 1);
+}
+
 absl::StatusOr<Envoy::Http::HeaderValidatorFactoryPtr> createHeaderValidatorFactory(
     [[maybe_unused]] const envoy::extensions::upstreams::http::v3::HttpProtocolOptions& options,
     [[maybe_unused]] Server::Configuration::ServerFactoryContext& server_context) {
@@ -194,6 +202,12 @@ ProtocolOptionsConfigImpl::createProtocolOptionsConfig(
   RETURN_IF_NOT_OK_REF(cache_options_or_error.status());
   auto validator_factory_or_error = createHeaderValidatorFactory(options, server_context);
   RETURN_IF_NOT_OK_REF(validator_factory_or_error.status());
+  if (options.has_shared_connection_pool() &&
+      (!options.has_explicit_http_config() ||
+       options.explicit_http_config().has_http_protocol_options())) {
+    return absl::InvalidArgumentError(
+        "shared_connection_pool requires an explicit_http_config of HTTP/2 or HTTP/3");
+  }
   return std::shared_ptr<ProtocolOptionsConfigImpl>(new ProtocolOptionsConfigImpl(
       options, options_or_error.value(), std::move(validator_factory_or_error.value()),
       cache_options_or_error.value(), server_context));
@@ -235,7 +249,8 @@ ProtocolOptionsConfigImpl::ProtocolOptionsConfigImpl(
       header_validator_factory_(std::move(header_validator_factory)),
       use_downstream_protocol_(options.has_use_downstream_protocol_config()),
       use_http2_(useHttp2(options)), use_http3_(useHttp3(options)),
-      use_alpn_(options.has_auto_config()) {
+      use_alpn_(options.has_auto_config()),
+      shared_connection_pool_owners_(getSharedConnectionPoolOwners(options)) {
   ASSERT(Http2::Utility::initializeAndValidateOptions(http2_options_).status().ok());
 }
 
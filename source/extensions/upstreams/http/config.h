@@ -60,6 +60,9 @@ public:
   const bool use_http2_{};
   const bool use_http3_{};
   const bool use_alpn_{};
+  // The number of worker threads owning the connections to each host, or 0 if connections are not
+  // shared across worker threads.
+  const uint32_t shared_connection_pool_owners_{};
 
 private:
   ProtocolOptionsConfigImpl(
@@ -19,7 +19,8 @@ ActiveUdpListenerBase::ActiveUdpListenerBase(uint32_t worker_index, uint32_t con
     : ActiveListenerImplBase(parent, config), worker_index_(worker_index),
       concurrency_(concurrency), parent_(parent), listen_socket_(listen_socket),
       udp_listener_(std::move(listener)),
-      udp_stats_({ALL_UDP_LISTENER_STATS(POOL_COUNTER_PREFIX(config->listenerScope(), "udp"))}),
+      udp_stats_({ALL_UDP_LISTENER_STATS(POOL_COUNTER_PREFIX(config->listenerScope(), "udp"),
+                                         POOL_HISTOGRAM_PREFIX(config->listenerScope(), "udp"))}),
       udp_listener_worker_router_(config_->udpListenerConfig()->listenerWorkerRouter(
           *listen_socket.connectionInfoProvider().localAddress())) {
   ASSERT(worker_index_ < concurrency_);
@@ -44,6 +45,13 @@ void ActiveUdpListenerBase::post(Network::UdpRecvData&& data) {
   });
 }
 
+void ActiveUdpListenerBase::onReadBatchComplete(uint32_t num_packets_read) {
+  // Spurious wakeups and reads which only hit EAGAIN are not interesting for batching efficiency.
+  if (num_packets_read > 0) {
+    udp_stats_.downstream_rx_datagrams_per_event_loop_.recordValue(num_packets_read);
+  }
+}
+
 void ActiveUdpListenerBase::onData(Network::UdpRecvData&& data) {
   uint32_t dest = worker_index_;
 
@@ -15,13 +15,15 @@
 namespace Envoy {
 namespace Server {
 
-#define ALL_UDP_LISTENER_STATS(COUNTER) COUNTER(downstream_rx_datagram_dropped)
+#define ALL_UDP_LISTENER_STATS(COUNTER, HISTOGRAM)                                                 \
+  COUNTER(downstream_rx_datagram_dropped)                                                          \
+  HISTOGRAM(downstream_rx_datagrams_per_event_loop, Unspecified)
 
 /**
  * Wrapper struct for UDP listener stats. @see stats_macros.h
  */
 struct UdpListenerStats {
-  ALL_UDP_LISTENER_STATS(GENERATE_COUNTER_STRUCT)
+  ALL_UDP_LISTENER_STATS(GENERATE_COUNTER_STRUCT, GENERATE_HISTOGRAM_STRUCT)
 };
 
 class ActiveUdpListenerBase : public ActiveListenerImplBase,
@@ -39,6 +41,7 @@ public:
   void onDatagramsDropped(uint32_t dropped) final {
     udp_stats_.downstream_rx_datagram_dropped_.add(dropped);
   }
+  void onReadBatchComplete(uint32_t num_packets_read) override;
 
   // ActiveListenerImplBase
   Network::Listener* listener() override { return udp_listener_.get(); }
@@ -223,19 +223,29 @@ AdminImpl::AdminImpl(const std::string& profile_path, Server::Instance& server,
           makeHandler("/ready", "print server state, return 200 if LIVE, otherwise return 503",
                       MAKE_ADMIN_HANDLER(server_info_handler_.handlerReady), false, false),
           stats_handler_.statsHandler(false /* not active mode */),
-          makeHandler("/stats/prometheus", "print server stats in prometheus format",
-                      MAKE_ADMIN_HANDLER(stats_handler_.handlerPrometheusStats), false, false,
-                      {{ParamDescriptor::Type::Boolean, "usedonly",
-                        "Only include stats that have been written by system since restart"},
-                       {ParamDescriptor::Type::Boolean, "text_readouts",
-                        "Render text_readouts as new gaugues with value 0 (increases Prometheus "
-                        "data size)"},
-                       {ParamDescriptor::Type::String, "filter",
-                        "Regular expression (Google re2) for filtering stats"},
-                       {ParamDescriptor::Type::Enum,
-                        "histogram_buckets",
-                        "Histogram bucket display mode",
-                        {"cumulative", "summary"}}}),
+          UrlHandler{"/stats/prometheus",
+                     "print server stats in prometheus format",
+                     [this](AdminStream& admin_stream) -> Admin::RequestPtr {
+                       return stats_handler_.makePrometheusRequest(admin_stream);
+                     },
+                     false,
+                     false,
+                     {{ParamDescriptor::Type::Boolean, "usedonly",
+                       "Only include stats that have been written by system since restart"},
+                      {ParamDescriptor::Type::Boolean, "text_readouts",
+                       "Render text_readouts as new gaugues with value 0 (increases Prometheus "
+                       "data size)"},
+                      {ParamDescriptor::Type::String, "filter",
+                       "Regular expression (Google re2) for filtering stats"},
+                      {ParamDescriptor::Type::Enum,
+                       "histogram_buckets",
+                       "Histogram bucket display mode",
+                       {"cumulative", "summary"}}}},
+          makeHandler("/stats/memory", "print memory used by stats, grouped by name",
+                      MAKE_ADMIN_HANDLER(stats_handler_.handlerStatsMemory), false, false,
+                      {{Admin::ParamDescriptor::Type::String, "depth",
+                        "Number of leading dot-separated name tokens to group by; 0 (the "
+                        "default) reports each tag-extracted name separately"}}),
           makeHandler("/stats/recentlookups", "Show recent stat-name lookups",
                       MAKE_ADMIN_HANDLER(stats_handler_.handlerStatsRecentLookups), false, false),
           makeHandler("/stats/recentlookups/clear", "clear list of stat-name lookups and counter",
@@ -1,13 +1,16 @@
 #include "source/server/admin/prometheus_stats.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include "source/common/common/empty_string.h"
 #include "source/common/common/macros.h"
 #include "source/common/common/regex.h"
+#include "source/common/http/header_map_impl.h"
 #include "source/common/stats/histogram_impl.h"
 #include "source/common/upstream/host_utility.h"
 
+#include "absl/strings/ascii.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_replace.h"
 
@@ -20,6 +23,8 @@ const Regex::CompiledGoogleReMatcher& promRegex() {
   CONSTRUCT_ON_FIRST_USE(Regex::CompiledGoogleReMatcherNoSafetyChecks, "[^a-zA-Z0-9_]");
 }
 
+bool isValidNameChar(char c) { return absl::ascii_isalnum(c) || c == '_'; }
+
 /**
  * Take a string and sanitize it according to Prometheus conventions.
  */
@@ -27,6 +32,10 @@ std::string sanitizeName(const absl::string_view name) {
   // The name must match the regex [a-zA-Z_][a-zA-Z0-9_]* as required by
   // prometheus. Refer to https://prometheus.io/docs/concepts/data_model/.
   // The initial [a-zA-Z_] constraint is always satisfied by the namespace prefix.
+  // Most tag names are already valid, so skip the regex replacement for them.
+  if (std::all_of(name.begin(), name.end(), isValidNameChar)) {
+    return std::string(name);
+  }
   return promRegex().replaceAll(name, "_");
 }
 
@@ -39,6 +48,9 @@ std::string sanitizeValue(const absl::string_view value) {
   // text serialization issues. This matches the prometheus text formatting code:
   // https://github.com/prometheus/common/blob/88f1636b699ae4fb949d292ffb904c205bf542c9/expfmt/text_create.go#L419-L420.
   // The goal is to replace '\' with "\\", newline with "\n", and '"' with "\"".
+  if (value.find_first_of("\\\n\"") == absl::string_view::npos) {
+    return std::string(value);
+  }
   return absl::StrReplaceAll(value, {
                                         {R"(\)", R"(\\)"},
                                         {"\n", R"(\n)"},
@@ -64,113 +76,37 @@ struct PrimitiveMetricSnapshotLessThan {
   }
 };
 
-std::string generateNumericOutput(uint64_t value, const Stats::TagVector& tags,
-                                  const std::string& prefixed_tag_extracted_name) {
-  const std::string formatted_tags = PrometheusStatsFormatter::formattedTags(tags);
-  return fmt::format("{0}{{{1}}} {2}\n", prefixed_tag_extracted_name, formatted_tags, value);
-}
-
-/*
- * Return the prometheus output for a numeric Stat (Counter or Gauge).
- */
-template <class StatType>
-std::string generateStatNumericOutput(const StatType& metric,
-                                      const std::string& prefixed_tag_extracted_name) {
-  return generateNumericOutput(metric.value(), metric.tags(), prefixed_tag_extracted_name);
-}
-
-/*
- * Returns the prometheus output for a TextReadout in gauge format.
- * It is a workaround of a limitation of prometheus which stores only numeric metrics.
- * The output is a gauge named the same as a given text-readout. The value of returned gauge is
- * always equal to 0. Returned gauge contains all tags of a given text-readout and one additional
- * tag {"text_value":"textReadout.value"}.
- */
-std::string generateTextReadoutOutput(const Stats::TextReadout& text_readout,
-                                      const std::string& prefixed_tag_extracted_name) {
-  auto tags = text_readout.tags();
-  tags.push_back(Stats::Tag{"text_value", text_readout.value()});
-  const std::string formattedTags = PrometheusStatsFormatter::formattedTags(tags);
-  return fmt::format("{0}{{{1}}} 0\n", prefixed_tag_extracted_name, formattedTags);
-}
-
-/*
- * Returns the prometheus output for a histogram. The output is a multi-line string (with embedded
- * newlines) that contains all the individual bucket counts and sum/count for a single histogram
- * (metric_name plus all tags).
- */
-std::string generateHistogramOutput(const Stats::ParentHistogram& histogram,
-                                    const std::string& prefixed_tag_extracted_name) {
-  const std::string tags = PrometheusStatsFormatter::formattedTags(histogram.tags());
-  const std::string hist_tags = histogram.tags().empty() ? EMPTY_STRING : (tags + ",");
-
-  const Stats::HistogramStatistics& stats = histogram.cumulativeStatistics();
-  Stats::ConstSupportedBuckets& supported_buckets = stats.supportedBuckets();
-  const std::vector<uint64_t>& computed_buckets = stats.computedBuckets();
-  std::string output;
-  for (size_t i = 0; i < supported_buckets.size(); ++i) {
-    double bucket = supported_buckets[i];
-    uint64_t value = computed_buckets[i];
-    // We want to print the bucket in a fixed point (non-scientific) format. The fmt library
-    // doesn't have a specific modifier to format as a fixed-point value only so we use the
-    // 'g' operator which prints the number in general fixed point format or scientific format
-    // with precision 50 to round the number up to 32 significant digits in fixed point format
-    // which should cover pretty much all cases
-    output.append(fmt::format("{0}_bucket{{{1}le=\"{2:.32g}\"}} {3}\n", prefixed_tag_extracted_name,
-                              hist_tags, bucket, value));
-  }
-
-  output.append(fmt::format("{0}_bucket{{{1}le=\"+Inf\"}} {2}\n", prefixed_tag_extracted_name,
-                            hist_tags, stats.sampleCount()));
-  output.append(fmt::format("{0}_sum{{{1}}} {2:.32g}\n", prefixed_tag_extracted_name, tags,
-                            stats.sampleSum()));
-  output.append(fmt::format("{0}_count{{{1}}} {2}\n", prefixed_tag_extracted_name, tags,
-                            stats.sampleCount()));
-
-  return output;
-};
-
 /**
- * Processes a stat type (counter, gauge, histogram) by generating all output lines, sorting
- * them by tag-extracted metric name, and then outputting them in the correct sorted order into
- * response.
+ * Groups the metrics of one stat type (counter, gauge, histogram) by their
+ * tag-extracted name, sorting both the groups and the metrics within each group.
+ *
+ * From
+ * https://github.com/prometheus/docs/blob/master/content/docs/instrumenting/exposition_formats.md#grouping-and-sorting:
+ *
+ * All lines for a given metric must be provided as one single group, with the optional HELP and
+ * TYPE lines first (in no particular order). Beyond that, reproducible sorting in repeated
+ * expositions is preferred but not required, i.e. do not sort if the computational cost is
+ * prohibitive.
+ *
+ * Metrics are held as dumb-pointers (no need to increment then decrement every
+ * refcount; ownership is held throughout by `metrics`) and sorted by their
+ * tags' textual representation, which will be consistent across calls.
  *
- * @param response The buffer to put the output into.
- * @param used_only Whether to only output stats that are used.
- * @param regex A filter on which stats to output.
- * @param metrics The metrics to output stats for. This must contain all stats of the given type
- *        to be included in the same output.
- * @param generate_output A function which returns the output text for this metric.
- * @param type The name of the prometheus metric type for used in TYPE annotations.
+ * @param params the stats parameters, used for filtering.
+ * @param metrics the metrics to group. This must contain all stats of the given
+ *        type to be included in the same output.
+ * @param custom_namespaces namespace mappings used for the metric names.
+ * @return the groups, named by their sanitized and prefixed metric names.
  */
 template <class StatType>
-uint64_t outputStatType(
-    Buffer::Instance& response, const StatsParams& params,
-    const std::vector<Stats::RefcountPtr<StatType>>& metrics,
-    const std::function<std::string(
-        const StatType& metric, const std::string& prefixed_tag_extracted_name)>& generate_output,
-    absl::string_view type, const Stats::CustomStatNamespaces& custom_namespaces) {
-
-  /*
-   * From
-   * https:*github.com/prometheus/docs/blob/master/content/docs/instrumenting/exposition_formats.md#grouping-and-sorting:
-   *
-   * All lines for a given metric must be provided as one single group, with the optional HELP and
-   * TYPE lines first (in no particular order). Beyond that, reproducible sorting in repeated
-   * expositions is preferred but not required, i.e. do not sort if the computational cost is
-   * prohibitive.
-   */
-
-  // This is an unsorted collection of dumb-pointers (no need to increment then decrement every
-  // refcount; ownership is held throughout by `metrics`). It is unsorted for efficiency, but will
-  // be sorted before producing the final output to satisfy the "preferred" ordering from the
-  // prometheus spec: metrics will be sorted by their tags' textual representation, which will be
-  // consistent across calls.
-  using StatTypeUnsortedCollection = std::vector<const StatType*>;
+PrometheusStatsRequest::GroupVec<StatType>
+groupStats(const StatsParams& params, const std::vector<Stats::RefcountPtr<StatType>>& metrics,
+           const Stats::CustomStatNamespaces& custom_namespaces) {
+  PrometheusStatsRequest::GroupVec<StatType> result;
 
   // Return early to avoid crashing when getting the symbol table from the first metric.
   if (metrics.empty()) {
-    return 0;
+    return result;
   }
 
   // There should only be one symbol table for all of the stats in the admin
@@ -181,7 +117,7 @@ uint64_t outputStatType(
 
   // Sorted collection of metrics sorted by their tagExtractedName, to satisfy the requirements
   // of the exposition format.
-  std::map<Stats::StatName, StatTypeUnsortedCollection, Stats::StatNameLessThan> groups(
+  std::map<Stats::StatName, std::vector<const StatType*>, Stats::StatNameLessThan> groups(
       global_symbol_table);
 
   for (const auto& metric : metrics) {
@@ -192,60 +128,28 @@ uint64_t outputStatType(
     groups[metric->tagExtractedStatName()].push_back(metric.get());
   }
 
-  auto result = groups.size();
+  result.reserve(groups.size());
   for (auto& group : groups) {
-    const absl::optional<std::string> prefixed_tag_extracted_name =
+    absl::optional<std::string> prefixed_tag_extracted_name =
         PrometheusStatsFormatter::metricName(global_symbol_table.toString(group.first),
                                              custom_namespaces);
     if (!prefixed_tag_extracted_name.has_value()) {
-      --result;
       continue;
     }
-    response.add(fmt::format("# TYPE {0} {1}\n", prefixed_tag_extracted_name.value(), type));
-
-    // Sort before producing the final output to satisfy the "preferred" ordering from the
-    // prometheus spec: metrics will be sorted by their tags' textual representation, which will
-    // be consistent across calls.
     std::sort(group.second.begin(), group.second.end(), MetricLessThan());
-
-    for (const auto& metric : group.second) {
-      response.add(generate_output(*metric, prefixed_tag_extracted_name.value()));
-    }
+    result.emplace_back(std::move(prefixed_tag_extracted_name.value()), std::move(group.second));
   }
   return result;
 }
 
+/**
+ * Groups primitive host metrics by their tag-extracted name. See groupStats.
+ */
 template <class StatType>
-uint64_t outputPrimitiveStatType(Buffer::Instance& response, const StatsParams& params,
-                                 const std::vector<StatType>& metrics, absl::string_view type,
-                                 const Stats::CustomStatNamespaces& custom_namespaces) {
-
-  /*
-   * From
-   * https:*github.com/prometheus/docs/blob/master/content/docs/instrumenting/exposition_formats.md#grouping-and-sorting:
-   *
-   * All lines for a given metric must be provided as one single group, with the optional HELP and
-   * TYPE lines first (in no particular order). Beyond that, reproducible sorting in repeated
-   * expositions is preferred but not required, i.e. do not sort if the computational cost is
-   * prohibitive.
-   */
-
-  // This is an unsorted collection of dumb-pointers (no need to increment then decrement every
-  // refcount; ownership is held throughout by `metrics`). It is unsorted for efficiency, but will
-  // be sorted before producing the final output to satisfy the "preferred" ordering from the
-  // prometheus spec: metrics will be sorted by their tags' textual representation, which will be
-  // consistent across calls.
-  using StatTypeUnsortedCollection = std::vector<const StatType*>;
-
-  // Return early to avoid crashing when getting the symbol table from the first metric.
-  if (metrics.empty()) {
-    return 0;
-  }
-
-  // Sorted collection of metrics sorted by their tagExtractedName, to satisfy the requirements
-  // of the exposition format.
-  std::map<std::string, StatTypeUnsortedCollection> groups;
-
+PrometheusStatsRequest::GroupVec<StatType>
+groupPrimitiveStats(const StatsParams& params, const std::vector<StatType>& metrics,
+                    const Stats::CustomStatNamespaces& custom_namespaces) {
+  std::map<std::string, std::vector<const StatType*>> groups;
   for (const auto& metric : metrics) {
     if (!params.shouldShowMetric(metric)) {
       continue;
@@ -253,67 +157,112 @@ uint64_t outputPrimitiveStatType(Buffer::Instance& response, const StatsParams&
     groups[metric.tagExtractedName()].push_back(&metric);
   }
 
-  auto result = groups.size();
+  PrometheusStatsRequest::GroupVec<StatType> result;
+  result.reserve(groups.size());
   for (auto& group : groups) {
-    const absl::optional<std::string> prefixed_tag_extracted_name =
+    absl::optional<std::string> prefixed_tag_extracted_name =
         PrometheusStatsFormatter::metricName(group.first, custom_namespaces);
     if (!prefixed_tag_extracted_name.has_value()) {
-      --result;
       continue;
     }
-    response.add(fmt::format("# TYPE {0} {1}\n", prefixed_tag_extracted_name.value(), type));
-
-    // Sort before producing the final output to satisfy the "preferred" ordering from the
-    // prometheus spec: metrics will be sorted by their tags' textual representation, which will
-    // be consistent across calls.
     std::sort(group.second.begin(), group.second.end(), PrimitiveMetricSnapshotLessThan());
-
-    for (const auto& metric : group.second) {
-      response.add(generateNumericOutput(metric->value(), metric->tags(),
-                                         prefixed_tag_extracted_name.value()));
-    }
+    result.emplace_back(std::move(prefixed_tag_extracted_name.value()), std::move(group.second));
   }
   return result;
 }
 
 /*
- * Returns the prometheus output for a summary. The output is a multi-line string (with embedded
- * newlines) that contains all the individual quantile values and sum/count for a single histogram
- * (metric_name plus all tags).
+ * Renders the prometheus output for a numeric Stat (Counter or Gauge).
+ */
+void renderNumeric(uint64_t value, const Stats::TagVector& tags,
+                   absl::string_view prefixed_tag_extracted_name, Buffer::Instance& response) {
+  const std::string formatted_tags = PrometheusStatsFormatter::formattedTags(tags);
+  const absl::AlphaNum formatted_value(value);
+  response.addFragments(
+      {prefixed_tag_extracted_name, "{", formatted_tags, "} ", formatted_value.Piece(), "\n"});
+}
+
+/*
+ * Renders the prometheus output for a TextReadout in gauge format.
+ * It is a workaround of a limitation of prometheus which stores only numeric metrics.
+ * The output is a gauge named the same as a given text-readout. The value of returned gauge is
+ * always equal to 0. Returned gauge contains all tags of a given text-readout and one additional
+ * tag {"text_value":"textReadout.value"}.
+ */
+void renderTextReadout(const Stats::TextReadout& text_readout,
+                       absl::string_view prefixed_tag_extracted_name, Buffer::Instance& response) {
+  auto tags = text_readout.tags();
+  tags.push_back(Stats::Tag{"text_value", text_readout.value()});
+  const std::string formatted_tags = PrometheusStatsFormatter::formattedTags(tags);
+  response.addFragments({prefixed_tag_extracted_name, "{", formatted_tags, "} 0\n"});
+}
+
+/*
+ * Renders the prometheus output for a histogram: all the individual bucket
+ * counts and sum/count for a single histogram (metric_name plus all tags).
+ */
+void renderHistogram(const Stats::ParentHistogram& histogram,
+                     absl::string_view prefixed_tag_extracted_name, Buffer::Instance& response) {
+  const std::string tags = PrometheusStatsFormatter::formattedTags(histogram.tags());
+  const std::string hist_tags = histogram.tags().empty() ? EMPTY_STRING : (tags + ",");
+
+  const Stats::HistogramStatistics& stats = histogram.cumulativeStatistics();
+  Stats::ConstSupportedBuckets& supported_buckets = stats.supportedBuckets();
+  const std::vector<uint64_t>& computed_buckets = stats.computedBuckets();
+  for (size_t i = 0; i < supported_buckets.size(); ++i) {
+    // We want to print the bucket in a fixed point (non-scientific) format. The fmt library
+    // doesn't have a specific modifier to format as a fixed-point value only so we use the
+    // 'g' operator which prints the number in general fixed point format or scientific format
+    // with precision 50 to round the number up to 32 significant digits in fixed point format
+    // which should cover pretty much all cases
+    const std::string bucket = fmt::format("{:.32g}", supported_buckets[i]);
+    const absl::AlphaNum value(computed_buckets[i]);
+    response.addFragments({prefixed_tag_extracted_name, "_bucket{", hist_tags, "le=\"", bucket,
+                           "\"} ", value.Piece(), "\n"});
+  }
+
+  const absl::AlphaNum count(stats.sampleCount());
+  const std::string sum = fmt::format("{:.32g}", stats.sampleSum());
+  response.addFragments({prefixed_tag_extracted_name, "_bucket{", hist_tags, "le=\"+Inf\"} ",
+                         count.Piece(), "\n"});
+  response.addFragments({prefixed_tag_extracted_name, "_sum{", tags, "} ", sum, "\n"});
+  response.addFragments({prefixed_tag_extracted_name, "_count{", tags, "} ", count.Piece(), "\n"});
+}
+
+/*
+ * Renders the prometheus output for a summary: all the individual quantile
+ * values and sum/count for a single histogram (metric_name plus all tags).
  */
-std::string generateSummaryOutput(const Stats::ParentHistogram& histogram,
-                                  const std::string& prefixed_tag_extracted_name) {
+void renderSummary(const Stats::ParentHistogram& histogram,
+                   absl::string_view prefixed_tag_extracted_name, Buffer::Instance& response) {
   const std::string tags = PrometheusStatsFormatter::formattedTags(histogram.tags());
   const std::string hist_tags = histogram.tags().empty() ? EMPTY_STRING : (tags + ",");
 
   const Stats::HistogramStatistics& stats = histogram.intervalStatistics();
   Stats::ConstSupportedBuckets& supported_quantiles = stats.supportedQuantiles();
   const std::vector<double>& computed_quantiles = stats.computedQuantiles();
-  std::string output;
   for (size_t i = 0; i < supported_quantiles.size(); ++i) {
-    double quantile = supported_quantiles[i];
-    double value = computed_quantiles[i];
-    output.append(fmt::format("{0}{{{1}quantile=\"{2}\"}} {3:.32g}\n", prefixed_tag_extracted_name,
-                              hist_tags, quantile, value));
+    const std::string quantile = fmt::format("{}", supported_quantiles[i]);
+    const std::string value = fmt::format("{:.32g}", computed_quantiles[i]);
+    response.addFragments({prefixed_tag_extracted_name, "{", hist_tags, "quantile=\"", quantile,
+                           "\"} ", value, "\n"});
   }
 
-  output.append(fmt::format("{0}_sum{{{1}}} {2:.32g}\n", prefixed_tag_extracted_name, tags,
-                            stats.sampleSum()));
-  output.append(fmt::format("{0}_count{{{1}}} {2}\n", prefixed_tag_extracted_name, tags,
-                            stats.sampleCount()));
-
-  return output;
-};
+  const std::string sum = fmt::format("{:.32g}", stats.sampleSum());
+  const absl::AlphaNum count(stats.sampleCount());
+  response.addFragments({prefixed_tag_extracted_name, "_sum{", tags, "} ", sum, "\n"});
+  response.addFragments({prefixed_tag_extracted_name, "_count{", tags, "} ", count.Piece(), "\n"});
+}
 
 } // namespace
 
 std::string PrometheusStatsFormatter::formattedTags(const std::vector<Stats::Tag>& tags) {
-  std::vector<std::string> buf;
-  buf.reserve(tags.size());
+  std::string result;
   for (const Stats::Tag& tag : tags) {
-    buf.push_back(fmt::format("{}=\"{}\"", sanitizeName(tag.name_), sanitizeValue(tag.value_)));
+    absl::StrAppend(&result, result.empty() ? "" : ",", sanitizeName(tag.name_), "=\"",
+                    sanitizeValue(tag.value_), "\"");
   }
-  return absl::StrJoin(buf, ",");
+  return result;
 }
 
 absl::Status PrometheusStatsFormatter::validateParams(const StatsParams& params) {
@@ -365,57 +314,192 @@ uint64_t PrometheusStatsFormatter::statsAsPrometheus(
     const std::vector<Stats::TextReadoutSharedPtr>& text_readouts,
     const Upstream::ClusterManager& cluster_manager, Buffer::Instance& response,
     const StatsParams& params, const Stats::CustomStatNamespaces& custom_namespaces) {
+  PrometheusStatsRequest request(counters, gauges, histograms, text_readouts, cluster_manager,
+                                 params, custom_namespaces);
+  Http::ResponseHeaderMapPtr response_headers = Http::ResponseHeaderMapImpl::create();
+  request.start(*response_headers);
+  while (request.nextChunk(response)) {
+  }
+  return request.metricNameCount();
+}
 
-  uint64_t metric_name_count = 0;
-  metric_name_count += outputStatType<Stats::Counter>(response, params, counters,
-                                                      generateStatNumericOutput<Stats::Counter>,
-                                                      "counter", custom_namespaces);
-
-  metric_name_count += outputStatType<Stats::Gauge>(response, params, gauges,
-                                                    generateStatNumericOutput<Stats::Gauge>,
-                                                    "gauge", custom_namespaces);
+PrometheusStatsRequest::PrometheusStatsRequest(
+    std::vector<Stats::CounterSharedPtr> counters, std::vector<Stats::GaugeSharedPtr> gauges,
+    std::vector<Stats::ParentHistogramSharedPtr> histograms,
+    std::vector<Stats::TextReadoutSharedPtr> text_readouts,
+    const Upstream::ClusterManager& cluster_manager, const StatsParams& params,
+    const Stats::CustomStatNamespaces& custom_namespaces)
+    : counters_(std::move(counters)), gauges_(std::move(gauges)),
+      histograms_(std::move(histograms)), text_readouts_(std::move(text_readouts)),
+      cluster_manager_(cluster_manager), params_(params), custom_namespaces_(custom_namespaces) {}
+
+Http::Code PrometheusStatsRequest::start(Http::ResponseHeaderMap&) {
+  phase_ = Phase::Counters;
+  startPhase();
+  return Http::Code::OK;
+}
 
-  // TextReadout stats are returned in gauge format, so "gauge" type is set intentionally.
-  metric_name_count += outputStatType<Stats::TextReadout>(
-      response, params, text_readouts, generateTextReadoutOutput, "gauge", custom_namespaces);
+bool PrometheusStatsRequest::nextChunk(Buffer::Instance& response) {
+  // As with StatsRequest, nextChunk adds roughly chunk_size_ bytes, and the
+  // caller is not required to drain the bytes after each call.
+  const uint64_t starting_response_length = response.length();
+  while (response.length() - starting_response_length < chunk_size_) {
+    while (!renderNextGroup(response)) {
+      switch (phase_) {
+      case Phase::Counters:
+        phase_ = Phase::Gauges;
+        break;
+      case Phase::Gauges:
+        phase_ = Phase::TextReadouts;
+        break;
+      case Phase::TextReadouts:
+        phase_ = Phase::Histograms;
+        break;
+      case Phase::Histograms:
+        phase_ = Phase::HostCounters;
+        break;
+      case Phase::HostCounters:
+        phase_ = Phase::HostGauges;
+        break;
+      case Phase::HostGauges:
+      case Phase::Done:
+        phase_ = Phase::Done;
+        return false;
+      }
+      startPhase();
+    }
+  }
+  return true;
+}
 
-  // validation of bucket modes is handled separately
-  switch (params.histogram_buckets_mode_) {
-  case Utility::HistogramBucketsMode::Summary:
-    metric_name_count += outputStatType<Stats::ParentHistogram>(
-        response, params, histograms, generateSummaryOutput, "summary", custom_namespaces);
+void PrometheusStatsRequest::startPhase() {
+  next_group_ = 0;
+  switch (phase_) {
+  case Phase::Counters:
+    counter_groups_ = groupStats(params_, counters_, custom_namespaces_);
+    metric_name_count_ += counter_groups_.size();
     break;
-  case Utility::HistogramBucketsMode::Unset:
-  case Utility::HistogramBucketsMode::Cumulative:
-    metric_name_count += outputStatType<Stats::ParentHistogram>(
-        response, params, histograms, generateHistogramOutput, "histogram", custom_namespaces);
+  case Phase::Gauges:
+    gauge_groups_ = groupStats(params_, gauges_, custom_namespaces_);
+    metric_name_count_ += gauge_groups_.size();
     break;
-  // "Detailed" and "Disjoint" don't make sense for prometheus histogram semantics
-  case Utility::HistogramBucketsMode::Detailed:
-  case Utility::HistogramBucketsMode::Disjoint:
-    IS_ENVOY_BUG("unsupported prometheus histogram bucket mode");
+  case Phase::TextReadouts:
+    text_readout_groups_ = groupStats(params_, text_readouts_, custom_namespaces_);
+    metric_name_count_ += text_readout_groups_.size();
+    break;
+  case Phase::Histograms:
+    // "Detailed" and "Disjoint" don't make sense for prometheus histogram semantics, and are
+    // rejected by validateParams before a request is made.
+    if (!PrometheusStatsFormatter::validateParams(params_).ok()) {
+      IS_ENVOY_BUG("unsupported prometheus histogram bucket mode");
+      break;
+    }
+    histogram_groups_ = groupStats(params_, histograms_, custom_namespaces_);
+    metric_name_count_ += histogram_groups_.size();
+    break;
+  case Phase::HostCounters:
+    // Note: This assumes that there is no overlap in stat name between per-endpoint stats and
+    // all other stats. If this is not true, then the counters/gauges for per-endpoint need to be
+    // combined with the above counter/gauge phases so that stats can be properly grouped.
+    Upstream::HostUtility::forEachHostMetric(
+        cluster_manager_,
+        [this](Stats::PrimitiveCounterSnapshot&& metric) {
+          host_counters_.emplace_back(std::move(metric));
+        },
+        [this](Stats::PrimitiveGaugeSnapshot&& metric) {
+          host_gauges_.emplace_back(std::move(metric));
+        });
+    if (heavy_hitter_store_ != nullptr) {
+      heavy_hitter_store_->forEachHeavyHitterCounter(
+          [this](Stats::PrimitiveCounterSnapshot&& metric) {
+            host_counters_.emplace_back(std::move(metric));
+          });
+    }
+    host_counter_groups_ = groupPrimitiveStats(params_, host_counters_, custom_namespaces_);
+    metric_name_count_ += host_counter_groups_.size();
+    break;
+  case Phase::HostGauges:
+    host_gauge_groups_ = groupPrimitiveStats(params_, host_gauges_, custom_namespaces_);
+    metric_name_count_ += host_gauge_groups_.size();
+    break;
+  case Phase::Done:
     break;
   }
+}
 
-  // Note: This assumes that there is no overlap in stat name between per-endpoint stats and all
-  // other stats. If this is not true, then the counters/gauges for per-endpoint need to be combined
-  // with the above counter/gauge calls so that stats can be properly grouped.
-  std::vector<Stats::PrimitiveCounterSnapshot> host_counters;
-  std::vector<Stats::PrimitiveGaugeSnapshot> host_gauges;
-  Upstream::HostUtility::forEachHostMetric(
-      cluster_manager,
-      [&](Stats::PrimitiveCounterSnapshot&& metric) {
-        host_counters.emplace_back(std::move(metric));
-      },
-      [&](Stats::PrimitiveGaugeSnapshot&& metric) { host_gauges.emplace_back(std::move(metric)); });
-
-  metric_name_count +=
-      outputPrimitiveStatType(response, params, host_counters, "counter", custom_namespaces);
-
-  metric_name_count +=
-      outputPrimitiveStatType(response, params, host_gauges, "gauge", custom_namespaces);
-
-  return metric_name_count;
+template <class StatType, class RenderFn>
+bool PrometheusStatsRequest::renderNextGroup(GroupVec<StatType>& groups, absl::string_view type,
+                                             Buffer::Instance& response, RenderFn render_fn) {
+  if (next_group_ == groups.size()) {
+    // Release the memory held by the phase before moving on to the next one.
+    groups.clear();
+    groups.shrink_to_fit();
+    return false;
+  }
+  const Group<StatType>& group = groups[next_group_++];
+  response.addFragments({"# TYPE ", group.first, " ", type, "\n"});
+  for (const StatType* metric : group.second) {
+    render_fn(*metric, group.first);
+  }
+  return true;
+}
+
+bool PrometheusStatsRequest::renderNextGroup(Buffer::Instance& response) {
+  switch (phase_) {
+  case Phase::Counters:
+    return renderNextGroup(counter_groups_, "counter", response,
+                           [&response](const Stats::Counter& counter, absl::string_view name) {
+                             renderNumeric(counter.value(), counter.tags(), name, response);
+                           });
+  case Phase::Gauges:
+    return renderNextGroup(gauge_groups_, "gauge", response,
+                           [&response](const Stats::Gauge& gauge, absl::string_view name) {
+                             renderNumeric(gauge.value(), gauge.tags(), name, response);
+                           });
+  case Phase::TextReadouts:
+    // TextReadout stats are returned in gauge format, so "gauge" type is set intentionally.
+    return renderNextGroup(
+        text_readout_groups_, "gauge", response,
+        [&response](const Stats::TextReadout& text_readout, absl::string_view name) {
+          renderTextReadout(text_readout, name, response);
+        });
+  case Phase::Histograms:
+    switch (params_.histogram_buckets_mode_) {
+    case Utility::HistogramBucketsMode::Summary:
+      return renderNextGroup(
+          histogram_groups_, "summary", response,
+          [&response](const Stats::ParentHistogram& histogram, absl::string_view name) {
+            renderSummary(histogram, name, response);
+          });
+    case Utility::HistogramBucketsMode::Unset:
+    case Utility::HistogramBucketsMode::Cumulative:
+      return renderNextGroup(
+          histogram_groups_, "histogram", response,
+          [&response](const Stats::ParentHistogram& histogram, absl::string_view name) {
+            renderHistogram(histogram, name, response);
+          });
+    case Utility::HistogramBucketsMode::Detailed:
+    case Utility::HistogramBucketsMode::Disjoint:
+      // No groups were collected for these modes; see startPhase.
+      break;
+    }
+    return false;
+  case Phase::HostCounters:
+    return renderNextGroup(
+        host_counter_groups_, "counter", response,
+        [&response](const Stats::PrimitiveCounterSnapshot& counter, absl::string_view name) {
+          renderNumeric(counter.value(), counter.tags(), name, response);
+        });
+  case Phase::HostGauges:
+    return renderNextGroup(
+        host_gauge_groups_, "gauge", response,
+        [&response](const Stats::PrimitiveGaugeSnapshot& gauge, absl::string_view name) {
+          renderNumeric(gauge.value(), gauge.tags(), name, response);
+        });
+  case Phase::Done:
+    break;
+  }
+  return false;
 }
 
 } // namespace Server
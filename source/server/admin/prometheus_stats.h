@@ -4,9 +4,12 @@
 #include <string>
 
 #include "envoy/buffer/buffer.h"
+#include "envoy/server/admin.h"
 #include "envoy/stats/custom_stat_namespaces.h"
 #include "envoy/stats/histogram.h"
+#include "envoy/stats/primitive_stats.h"
 #include "envoy/stats/stats.h"
+#include "envoy/stats/store.h"
 
 #include "source/server/admin/stats_params.h"
 
@@ -53,5 +56,80 @@ public:
              const Stats::CustomStatNamespaces& custom_namespace_factory);
 };
 
+/**
+ * Streams the Prometheus exposition of a set of stats through the admin Request
+ * interface. Metrics are grouped and sorted one stat type at a time, and each
+ * group is rendered directly into the response, so the full exposition is never
+ * held in memory at once.
+ */
+class PrometheusStatsRequest : public Admin::Request {
+public:
+  static constexpr uint64_t DefaultChunkSize = 2 * 1000 * 1000;
+
+  PrometheusStatsRequest(std::vector<Stats::CounterSharedPtr> counters,
+                         std::vector<Stats::GaugeSharedPtr> gauges,
+                         std::vector<Stats::ParentHistogramSharedPtr> histograms,
+                         std::vector<Stats::TextReadoutSharedPtr> text_readouts,
+                         const Upstream::ClusterManager& cluster_manager, const StatsParams& params,
+                         const Stats::CustomStatNamespaces& custom_namespaces);
+
+  // Admin::Request
+  Http::Code start(Http::ResponseHeaderMap& response_headers) override;
+  bool nextChunk(Buffer::Instance& response) override;
+
+  // Sets the chunk size, which is the approximate number of bytes added to the
+  // response by each call to nextChunk.
+  void setChunkSize(uint64_t chunk_size) { chunk_size_ = chunk_size; }
+
+  // Renders the counters reported by the heavy-hitter sketches of stats with the
+  // per-host counters, once those have been added to the sketches. Must be
+  // called before start().
+  void setHeavyHitterStore(Stats::Store& stats) { heavy_hitter_store_ = &stats; }
+
+  // The number of metric names rendered so far, each of which has a TYPE line.
+  uint64_t metricNameCount() const { return metric_name_count_; }
+
+  // Sorted metrics sharing one sanitized, prefixed metric name.
+  template <class StatType> using Group = std::pair<std::string, std::vector<const StatType*>>;
+  template <class StatType> using GroupVec = std::vector<Group<StatType>>;
+
+private:
+  // Stat types are rendered in this order, matching the buffered output.
+  enum class Phase { Counters, Gauges, TextReadouts, Histograms, HostCounters, HostGauges, Done };
+
+  // Groups the metrics of the current phase.
+  void startPhase();
+  // Renders the next group of the current phase, returning false once the
+  // phase has no more groups.
+  bool renderNextGroup(Buffer::Instance& response);
+  template <class StatType, class RenderFn>
+  bool renderNextGroup(GroupVec<StatType>& groups, absl::string_view type,
+                       Buffer::Instance& response, RenderFn render_fn);
+
+  const std::vector<Stats::CounterSharedPtr> counters_;
+  const std::vector<Stats::GaugeSharedPtr> gauges_;
+  const std::vector<Stats::ParentHistogramSharedPtr> histograms_;
+  const std::vector<Stats::TextReadoutSharedPtr> text_readouts_;
+  std::vector<Stats::PrimitiveCounterSnapshot> host_counters_;
+  std::vector<Stats::PrimitiveGaugeSnapshot> host_gauges_;
+  const Upstream::ClusterManager& cluster_manager_;
+  Stats::Store* heavy_hitter_store_{};
+  const StatsParams params_;
+  const Stats::CustomStatNamespaces& custom_namespaces_;
+
+  // Only the groups of the current phase are populated.
+  GroupVec<Stats::Counter> counter_groups_;
+  GroupVec<Stats::Gauge> gauge_groups_;
+  GroupVec<Stats::TextReadout> text_readout_groups_;
+  GroupVec<Stats::ParentHistogram> histogram_groups_;
+  GroupVec<Stats::PrimitiveCounterSnapshot> host_counter_groups_;
+  GroupVec<Stats::PrimitiveGaugeSnapshot> host_gauge_groups_;
+  size_t next_group_{0};
+
+  Phase phase_{Phase::Counters};
+  uint64_t metric_name_count_{0};
+  uint64_t chunk_size_{DefaultChunkSize};
+};
+
 } // namespace Server
 } // namespace Envoy
@@ -1,5 +1,6 @@
 #include "source/server/admin/stats_handler.h"
 
+#include <algorithm>
 #include <functional>
 #include <vector>
 
@@ -10,9 +11,11 @@
 #include "source/common/common/empty_string.h"
 #include "source/common/http/headers.h"
 #include "source/common/http/utility.h"
+#include "source/common/json/json_streamer.h"
 #include "source/server/admin/prometheus_stats.h"
 #include "source/server/admin/stats_request.h"
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/numbers.h"
 
 namespace Envoy {
@@ -80,16 +83,9 @@ Admin::RequestPtr StatsHandler::makeRequest(AdminStream& admin_stream) {
   }
 
   if (params.format_ == StatsFormat::Prometheus) {
-    // TODO(#16139): modify streaming algorithm to cover Prometheus.
-    //
-    // This may be easiest to accomplish by populating the set
-    // with tagExtractedName(), and allowing for vectors of
-    // stats as multiples will have the same tag-extracted names.
-    // Ideally we'd find a way to do this without slowing down
-    // the non-Prometheus implementations.
-    Buffer::OwnedImpl response;
-    Http::Code code = prometheusFlushAndRender(params, response);
-    return Admin::makeStaticTextRequest(response, code);
+    // Prometheus groups stats by their tag-extracted names, so it is streamed
+    // by its own request rather than by StatsRequest.
+    return prometheusRequest(params);
   }
 
   if (server_.statsConfig().flushOnAdmin()) {
@@ -113,40 +109,41 @@ Admin::RequestPtr StatsHandler::makeRequest(Stats::Store& stats, const StatsPara
   return std::make_unique<StatsRequest>(stats, params, cluster_manager, url_handler_fn);
 }
 
-Http::Code StatsHandler::handlerPrometheusStats(Http::ResponseHeaderMap&,
-                                                Buffer::Instance& response,
-                                                AdminStream& admin_stream) {
-  return prometheusStats(admin_stream.getRequestHeaders().getPathValue(), response);
-}
-
-Http::Code StatsHandler::prometheusStats(absl::string_view path_and_query,
-                                         Buffer::Instance& response) {
+Admin::RequestPtr StatsHandler::makePrometheusRequest(AdminStream& admin_stream) {
   StatsParams params;
-  Http::Code code = params.parse(path_and_query, response);
+  Buffer::OwnedImpl response;
+  Http::Code code = params.parse(admin_stream.getRequestHeaders().getPathValue(), response);
   if (code != Http::Code::OK) {
-    return code;
-  }
-
-  if (server_.statsConfig().flushOnAdmin()) {
-    server_.flushStats();
+    return Admin::makeStaticTextRequest(response, code);
   }
-
-  return prometheusFlushAndRender(params, response);
+  return prometheusRequest(params);
 }
 
-Http::Code StatsHandler::prometheusFlushAndRender(const StatsParams& params,
-                                                  Buffer::Instance& response) {
+Admin::RequestPtr StatsHandler::prometheusRequest(const StatsParams& params) {
   absl::Status paramsStatus = PrometheusStatsFormatter::validateParams(params);
   if (!paramsStatus.ok()) {
-    response.add(paramsStatus.message());
-    return Http::Code::BadRequest;
+    return Admin::makeStaticTextRequest(paramsStatus.message(), Http::Code::BadRequest);
   }
   if (server_.statsConfig().flushOnAdmin()) {
     server_.flushStats();
   }
-  prometheusRender(server_.stats(), server_.api().customStatNamespaces(), server_.clusterManager(),
-                   params, response);
-  return Http::Code::OK;
+  return makePrometheusRequest(server_.stats(), server_.api().customStatNamespaces(),
+                               server_.clusterManager(), params);
+}
+
+Admin::RequestPtr
+StatsHandler::makePrometheusRequest(Stats::Store& stats,
+                                    const Stats::CustomStatNamespaces& custom_namespaces,
+                                    const Upstream::ClusterManager& cm, const StatsParams& params) {
+  std::vector<Stats::TextReadoutSharedPtr> text_readouts;
+  if (params.prometheus_text_readouts_) {
+    text_readouts = stats.textReadouts();
+  }
+  auto request = std::make_unique<PrometheusStatsRequest>(
+      stats.counters(), stats.gauges(), stats.histograms(), std::move(text_readouts), cm, params,
+      custom_namespaces);
+  request->setHeavyHitterStore(stats);
+  return request;
 }
 
 void StatsHandler::prometheusRender(Stats::Store& stats,
@@ -161,6 +158,98 @@ void StatsHandler::prometheusRender(Stats::Store& stats,
                                               custom_namespaces);
 }
 
+Http::Code StatsHandler::handlerStatsMemory(Http::ResponseHeaderMap& response_headers,
+                                            Buffer::Instance& response,
+                                            AdminStream& admin_stream) {
+  uint32_t depth = 0;
+  const absl::optional<std::string> depth_param =
+      admin_stream.queryParams().getFirstValue("depth");
+  if (depth_param.has_value() && !absl::SimpleAtoi(depth_param.value(), &depth)) {
+    response.add("depth must be a non-negative integer\n");
+    return Http::Code::BadRequest;
+  }
+  response_headers.setReferenceContentType(Http::Headers::get().ContentTypeValues.Json);
+  statsMemoryRender(server_.stats(), depth, response);
+  return Http::Code::OK;
+}
+
+namespace {
+
+void addFamilyMemory(const Stats::StatFamilyMemory& src, Stats::StatFamilyMemory& dst) {
+  dst.counters_ += src.counters_;
+  dst.gauges_ += src.gauges_;
+  dst.text_readouts_ += src.text_readouts_;
+  dst.histograms_ += src.histograms_;
+  dst.bytes_ += src.bytes_;
+}
+
+void renderFamilyMemory(const Stats::StatFamilyMemory& memory, Json::BufferStreamer::Map& map) {
+  map.addEntries({{"bytes", memory.bytes_},
+                  {"counters", memory.counters_},
+                  {"gauges", memory.gauges_},
+                  {"text_readouts", memory.text_readouts_},
+                  {"histograms", memory.histograms_}});
+}
+
+// Returns the first 'depth' dot-separated tokens of name, or all of name if it
+// has fewer tokens or depth is 0.
+absl::string_view namePrefix(absl::string_view name, uint32_t depth) {
+  if (depth == 0) {
+    return name;
+  }
+  size_t pos = 0;
+  for (uint32_t i = 0; i < depth; ++i) {
+    pos = name.find('.', i == 0 ? 0 : pos + 1);
+    if (pos == absl::string_view::npos) {
+      return name;
+    }
+  }
+  return name.substr(0, pos);
+}
+
+} // namespace
+
+void StatsHandler::statsMemoryRender(const Stats::Store& stats, uint32_t depth,
+                                     Buffer::Instance& response) {
+  // The store keeps running totals per tag-extracted name, so the cost here
+  // scales with the number of stat families rather than the number of stats.
+  const Stats::SymbolTable& symbol_table = stats.constSymbolTable();
+  absl::flat_hash_map<std::string, Stats::StatFamilyMemory> groups;
+  Stats::StatFamilyMemory total;
+  stats.forEachFamilyMemory(
+      [&](Stats::StatName tag_extracted_name, const Stats::StatFamilyMemory& memory) {
+        const std::string name = symbol_table.toString(tag_extracted_name);
+        addFamilyMemory(memory, groups[namePrefix(name, depth)]);
+        addFamilyMemory(memory, total);
+      });
+
+  using Group = std::pair<absl::string_view, const Stats::StatFamilyMemory*>;
+  std::vector<Group> sorted;
+  sorted.reserve(groups.size());
+  for (const auto& [prefix, memory] : groups) {
+    sorted.emplace_back(prefix, &memory);
+  }
+  std::sort(sorted.begin(), sorted.end(), [](const Group& a, const Group& b) {
+    if (a.second->bytes_ != b.second->bytes_) {
+      return a.second->bytes_ > b.second->bytes_;
+    }
+    return a.first < b.first;
+  });
+
+  Json::BufferStreamer streamer(response);
+  Json::BufferStreamer::MapPtr root = streamer.makeRootMap();
+  root->addKey("total");
+  renderFamilyMemory(total, *root->addMap());
+  root->addEntries({{"symbols", symbol_table.numSymbols()}});
+  root->addKey("groups");
+  Json::BufferStreamer::ArrayPtr array = root->addArray();
+  for (const Group& group : sorted) {
+    Json::BufferStreamer::MapPtr map = array->addMap();
+    map->addEntries({{"name", group.first}});
+    renderFamilyMemory(*group.second, *map);
+  }
+}
+
 Http::Code StatsHandler::handlerContention(Http::ResponseHeaderMap& response_headers,
                                            Buffer::Instance& response, AdminStream&) {
 
@@ -33,27 +33,20 @@ public:
                                               Buffer::Instance& response, AdminStream&);
   Http::Code handlerStatsRecentLookupsEnable(Http::ResponseHeaderMap& response_headers,
                                              Buffer::Instance& response, AdminStream&);
-  Http::Code handlerPrometheusStats(Http::ResponseHeaderMap& response_headers,
-                                    Buffer::Instance& response, AdminStream&);
+  Http::Code handlerStatsMemory(Http::ResponseHeaderMap& response_headers,
+                                Buffer::Instance& response, AdminStream&);
 
   /**
-   * Parses and executes a prometheus stats request.
+   * Renders the memory held by stats as JSON, grouped by the leading tokens of
+   * their tag-extracted names. Groups are ordered by decreasing size.
    *
-   * @param path_and_query the URL path and query
+   * @param stats the stats store to read
+   * @param depth the number of leading dot-separated tokens to group by, or 0
+   *        to report every tag-extracted name separately.
    * @param response buffer into which to write response
-   * @return http response code
    */
-  Http::Code prometheusStats(absl::string_view path_and_query, Buffer::Instance& response);
-
-  /**
-   * Checks the server_ to see if a flush is needed, and then renders the
-   * prometheus stats request.
-   *
-   * @params params the already-parsed parameters.
-   * @param response buffer into which to write response
-   */
-  Http::Code prometheusFlushAndRender(const StatsParams& params, Buffer::Instance& response);
-
+  static void statsMemoryRender(const Stats::Store& stats, uint32_t depth,
+                                Buffer::Instance& response);
   /**
    * Renders the stats as prometheus. This is broken out as a separately
    * callable API to facilitate the benchmark
@@ -92,10 +85,35 @@ public:
                                        StatsRequest::UrlHandlerFn url_handler_fn = nullptr);
   Admin::RequestPtr makeRequest(AdminStream&);
 
+  /**
+   * Makes a streaming request for /stats/prometheus, for which the format is
+   * implied by the path rather than by the query parameters.
+   */
+  Admin::RequestPtr makePrometheusRequest(AdminStream&);
+
+  /**
+   * Makes a streaming request rendering the stats as prometheus. The params
+   * must already have been validated by PrometheusStatsFormatter::validateParams.
+   *
+   * @params stats the stats store to read
+   * @param custom_namespaces namespace mappings used for prometheus
+   * @param cm the cluster manager, used to read per-host metrics
+   * @params params the already-parsed parameters.
+   * @return the streaming request.
+   */
+  static Admin::RequestPtr
+  makePrometheusRequest(Stats::Store& stats, const Stats::CustomStatNamespaces& custom_namespaces,
+                        const Upstream::ClusterManager& cm, const StatsParams& params);
+
 private:
-  static Http::Code prometheusStats(absl::string_view path_and_query, Buffer::Instance& response,
-                                    Stats::Store& stats,
-                                    Stats::CustomStatNamespaces& custom_namespaces);
+  /**
+   * Validates the params and flushes stats if needed, then makes a streaming
+   * prometheus request for the server's stats.
+   *
+   * @params params the already-parsed parameters.
+   * @return the streaming request, or a static error response.
+   */
+  Admin::RequestPtr prometheusRequest(const StatsParams& params);
 };
 
 } // namespace Server
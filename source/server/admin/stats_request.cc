@@ -50,7 +50,7 @@ Http::Code StatsRequest::start(Http::ResponseHeaderMap& response_headers) {
   }
 #endif
   case StatsFormat::Prometheus:
-    // TODO(#16139): once Prometheus shares this algorithm here, this becomes a legitimate choice.
+    // Prometheus is streamed by PrometheusStatsRequest.
     IS_ENVOY_BUG("reached Prometheus case in switch unexpectedly");
     return Http::Code::BadRequest;
   }
@@ -225,7 +225,9 @@ void StatsRequest::renderPerHostMetrics(Buffer::Instance& response) {
   // This code does not adhere to the streaming contract, but there isn't a good way to stream
   // these. There isn't a shared pointer to hold, so there's no way to safely pause iteration here
   // without copying all of the data somewhere. But copying all of the data would be more expensive
-  // than generating it all in one batch here.
+  // than generating it all in one batch here. Counters reported by heavy-hitter sketches are
+  // rendered in the same batch, for the same reason, once the per-host counters have been added
+  // to them.
   Upstream::HostUtility::forEachHostMetric(
       cluster_manager_,
       [&](Stats::PrimitiveCounterSnapshot&& metric) {
@@ -242,6 +244,13 @@ void StatsRequest::renderPerHostMetrics(Buffer::Instance& response) {
           render_->generate(response, metric.name(), metric.value());
         }
       });
+  stats_.forEachHeavyHitterCounter([&](Stats::PrimitiveCounterSnapshot&& metric) {
+    if ((params_.type_ == StatsType::All || params_.type_ == StatsType::Counters) &&
+        params_.shouldShowMetric(metric)) {
+      ++phase_stat_count_;
+      render_->generate(response, metric.name(), metric.value());
+    }
+  });
 }
 
 template <class SharedStatType>
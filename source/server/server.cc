@@ -44,6 +44,7 @@
 #include "source/common/runtime/runtime_impl.h"
 #include "source/common/runtime/runtime_keys.h"
 #include "source/common/signal/fatal_error_handler.h"
+#include "source/common/stats/heavy_hitter_impl.h"
 #include "source/common/stats/stats_matcher_impl.h"
 #include "source/common/stats/tag_producer_impl.h"
 #include "source/common/stats/thread_local_store.h"
@@ -169,33 +170,54 @@ void InstanceBase::failHealthcheck(bool fail) {
 
 MetricSnapshotImpl::MetricSnapshotImpl(Stats::Store& store,
                                        Upstream::ClusterManager& cluster_manager,
-                                       TimeSource& time_source) {
+                                       TimeSource& time_source, bool changed_only) {
+  // When only changed metrics are snapshotted, most metrics are expected to be skipped, so the
+  // vectors are not sized for the whole store.
   store.forEachSinkedCounter(
-      [this](std::size_t size) {
-        snapped_counters_.reserve(size);
-        counters_.reserve(size);
+      [this, changed_only](std::size_t size) {
+        if (!changed_only) {
+          snapped_counters_.reserve(size);
+          counters_.reserve(size);
+        }
       },
-      [this](Stats::Counter& counter) {
+      [this, changed_only](Stats::Counter& counter) {
+        // Counters are always latched, so that deltas cover a single flush interval.
+        const uint64_t delta = counter.latch();
+        if (changed_only && delta == 0) {
+          return;
+        }
         snapped_counters_.push_back(Stats::CounterSharedPtr(&counter));
-        counters_.push_back({counter.latch(), counter});
+        counters_.push_back({delta, counter});
       });
 
   store.forEachSinkedGauge(
-      [this](std::size_t size) {
-        snapped_gauges_.reserve(size);
-        gauges_.reserve(size);
+      [this, changed_only](std::size_t size) {
+        if (!changed_only) {
+          snapped_gauges_.reserve(size);
+          gauges_.reserve(size);
+        }
       },
-      [this](Stats::Gauge& gauge) {
+      [this, changed_only](Stats::Gauge& gauge) {
+        // Latch the changed indication on full snapshots too, so that the next snapshot of only
+        // the changed metrics is relative to this one.
+        if (!gauge.latchChanged() && changed_only) {
+          return;
+        }
         snapped_gauges_.push_back(Stats::GaugeSharedPtr(&gauge));
         gauges_.push_back(gauge);
       });
 
   store.forEachSinkedHistogram(
-      [this](std::size_t size) {
-        snapped_histograms_.reserve(size);
-        histograms_.reserve(size);
+      [this, changed_only](std::size_t size) {
+        if (!changed_only) {
+          snapped_histograms_.reserve(size);
+          histograms_.reserve(size);
+        }
       },
-      [this](Stats::ParentHistogram& histogram) {
+      [this, changed_only](Stats::ParentHistogram& histogram) {
+        if (changed_only && histogram.intervalStatistics().sampleCount() == 0) {
+          return;
+        }
         snapped_histograms_.push_back(Stats::ParentHistogramSharedPtr(&histogram));
         histograms_.push_back(histogram);
       });
@@ -212,23 +234,37 @@ MetricSnapshotImpl::MetricSnapshotImpl(Stats::Store& store,
 
   Upstream::HostUtility::forEachHostMetric(
       cluster_manager,
-      [this](Stats::PrimitiveCounterSnapshot&& metric) {
+      [this, changed_only](Stats::PrimitiveCounterSnapshot&& metric) {
+        if (changed_only && metric.delta() == 0) {
+          return;
+        }
         host_counters_.emplace_back(std::move(metric));
       },
       [this](Stats::PrimitiveGaugeSnapshot&& metric) {
         host_gauges_.emplace_back(std::move(metric));
       });
 
+  // Counters reported by heavy-hitter sketches are primitive snapshots, so sinks receive them
+  // alongside the per-host counters. They are read after the per-host counters have been added
+  // to the sketches.
+  store.forEachHeavyHitterCounter([this, changed_only](Stats::PrimitiveCounterSnapshot&& metric) {
+    if (changed_only && metric.delta() == 0) {
+      return;
+    }
+    host_counters_.emplace_back(std::move(metric));
+  });
+
   snapshot_time_ = time_source.systemTime();
 }
 
 void InstanceUtil::flushMetricsToSinks(const std::list<Stats::SinkPtr>& sinks, Stats::Store& store,
-                                       Upstream::ClusterManager& cm, TimeSource& time_source) {
+                                       Upstream::ClusterManager& cm, TimeSource& time_source,
+                                       bool changed_only) {
   // Create a snapshot and flush to all sinks.
   // NOTE: Even if there are no sinks, creating the snapshot has the important property that it
   //       latches all counters on a periodic basis. The hot restart code assumes this is being
   //       done so this should not be removed.
-  MetricSnapshotImpl snapshot(store, cm, time_source);
+  MetricSnapshotImpl snapshot(store, cm, time_source, changed_only);
   for (const auto& sink : sinks) {
     sink->flush(snapshot);
   }
@@ -289,8 +325,16 @@ void InstanceBase::updateServerStats() {
 void InstanceBase::flushStatsInternal() {
   updateServerStats();
   auto& stats_config = config_.statsConfig();
+  bool changed_only = false;
+  if (bootstrap_.has_delta_stats_flush()) {
+    // The first flush, and every full_flush_every'th flush after it, hands sinks all metrics.
+    const uint32_t full_flush_every = bootstrap_.delta_stats_flush().full_flush_every();
+    changed_only = stats_flushes_ != 0 &&
+                   (full_flush_every == 0 || stats_flushes_ % full_flush_every != 0);
+    ++stats_flushes_;
+  }
   InstanceUtil::flushMetricsToSinks(stats_config.sinks(), stats_store_, clusterManager(),
-                                    timeSource());
+                                    timeSource(), changed_only);
   // TODO(ramaraochavali): consider adding different flush interval for histograms.
   if (stat_flush_timer_ != nullptr) {
     stat_flush_timer_->enableTimer(stats_config.flushInterval());
@@ -519,6 +563,8 @@ absl::Status InstanceBase::initializeOrThrow(Network::Address::InstanceConstShar
       bootstrap_.stats_config(), stats_store_.symbolTable(), server_contexts_));
   stats_store_.setHistogramSettings(
       std::make_unique<Stats::HistogramSettingsImpl>(bootstrap_.stats_config(), server_contexts_));
+  stats_store_.setHeavyHitterStats(std::make_unique<Stats::HeavyHitterStatsImpl>(
+      bootstrap_.stats_config(), stats_store_.symbolTable(), server_contexts_));
 
   const std::string server_stats_prefix = "server.";
   const std::string server_compilation_settings_stats_prefix = "server.compilation_settings";
@@ -131,9 +131,12 @@ public:
    * flush() on each sink.
    * @param sinks supplies the list of sinks.
    * @param store provides the store being flushed.
+   * @param changed_only if true, only metrics that changed since the previous flush are handed
+   *        to the sinks.
    */
   static void flushMetricsToSinks(const std::list<Stats::SinkPtr>& sinks, Stats::Store& store,
-                                  Upstream::ClusterManager& cm, TimeSource& time_source);
+                                  Upstream::ClusterManager& cm, TimeSource& time_source,
+                                  bool changed_only = false);
 
   /**
    * Load a bootstrap config and perform validation.
@@ -437,6 +440,8 @@ private:
   bool enable_reuse_port_default_{false};
   Regex::EnginePtr regex_engine_;
   bool stats_flush_in_progress_ : 1;
+  // Number of flushes to sinks, used to schedule full flushes when delta_stats_flush is set.
+  uint64_t stats_flushes_{0};
   std::unique_ptr<Memory::AllocatorManager> memory_allocator_manager_;
 
   template <class T>
@@ -461,8 +466,13 @@ private:
 //                     copying and probably be a cleaner API in general.
 class MetricSnapshotImpl : public Stats::MetricSnapshot {
 public:
+  /**
+   * @param changed_only if true, the snapshot only holds counters with a non-zero delta, gauges
+   *        written since the previous snapshot and histograms that recorded samples during the
+   *        last interval. Text readouts and host gauges are always included.
+   */
   explicit MetricSnapshotImpl(Stats::Store& store, Upstream::ClusterManager& cluster_manager,
-                              TimeSource& time_source);
+                              TimeSource& time_source, bool changed_only = false);
 
   // Stats::MetricSnapshot
   const std::vector<CounterSnapshot>& counters() override { return counters_; }
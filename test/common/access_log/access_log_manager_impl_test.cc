@@ -11,6 +11,8 @@
 #include "test/test_common/test_time.h"
 #include "test/test_common/utility.h"
 
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -443,6 +445,61 @@ TEST_F(AccessLogManagerImplTest, BigDataChunkShouldBeFlushedWithoutTimer) {
   EXPECT_CALL(*file_, close_()).WillOnce(Return(ByMove(Filesystem::resultSuccess<bool>(true))));
 }
 
+TEST_F(AccessLogManagerImplTest, ConcurrentWritesKeepPerThreadOrder) {
+  EXPECT_CALL(*file_, open_(_)).WillOnce(Return(ByMove(Filesystem::resultSuccess<bool>(true))));
+  AccessLogFileSharedPtr log_file =
+      access_log_manager_
+          .createAccessLog(Filesystem::FilePathAndType{Filesystem::DestinationType::File, "foo"})
+          .value();
+
+  absl::Mutex mutex;
+  std::string written;
+  EXPECT_CALL(*file_, write_(_))
+      .WillRepeatedly(Invoke([&](absl::string_view data) -> Api::IoCallSizeResult {
+        absl::MutexLock lock(&mutex);
+        written.append(data.data(), data.size());
+        return Filesystem::resultSuccess<ssize_t>(static_cast<ssize_t>(data.length()));
+      }));
+
+  constexpr uint32_t NumThreads = 4;
+  constexpr uint32_t NumWrites = 1000;
+  std::vector<Thread::ThreadPtr> threads;
+  for (uint32_t t = 0; t < NumThreads; ++t) {
+    threads.push_back(thread_factory_.createThread([&log_file, t]() {
+      for (uint32_t i = 0; i < NumWrites; ++i) {
+        log_file->write(absl::StrCat(t, ":", i, "\n"));
+      }
+    }));
+  }
+  for (Thread::ThreadPtr& thread : threads) {
+    thread->join();
+  }
+  log_file->flush();
+
+  EXPECT_EQ(NumThreads * NumWrites, store_.counter("filesystem.write_buffered").value());
+  EXPECT_TRUE(waitForGaugeEq("filesystem.write_total_buffered", 0));
+
+  // Writes of different threads may interleave, but each thread's writes keep their order.
+  std::vector<uint32_t> next(NumThreads, 0);
+  {
+    absl::MutexLock lock(&mutex);
+    for (absl::string_view line : absl::StrSplit(written, '\n', absl::SkipEmpty())) {
+      std::pair<absl::string_view, absl::string_view> parts = absl::StrSplit(line, ':');
+      uint32_t thread_index;
+      uint32_t write_index;
+      ASSERT_TRUE(absl::SimpleAtoi(parts.first, &thread_index));
+      ASSERT_TRUE(absl::SimpleAtoi(parts.second, &write_index));
+      ASSERT_LT(thread_index, NumThreads);
+      EXPECT_EQ(next[thread_index]++, write_index);
+    }
+  }
+  for (uint32_t t = 0; t < NumThreads; ++t) {
+    EXPECT_EQ(NumWrites, next[t]);
+  }
+
+  EXPECT_CALL(*file_, close_()).WillOnce(Return(ByMove(Filesystem::resultSuccess<bool>(true))));
+}
+
 TEST_F(AccessLogManagerImplTest, ReopenAllFiles) {
   EXPECT_CALL(dispatcher_, createTimer_(_)).WillRepeatedly(ReturnNew<NiceMock<Event::MockTimer>>());
 
@@ -0,0 +1,86 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "source/common/common/persistent_hash_map.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+
+namespace Envoy {
+namespace {
+
+std::string address(int subnet, int i) {
+  return absl::StrCat("10.", subnet, ".", i / 256, ".", i % 256, ":80");
+}
+
+// Copies a map of state.range(0) entries and replaces one entry of the copy, as done for every
+// update of the cross-priority host map.
+template <class Map> void copyAndUpdate(benchmark::State& state) {
+  const int size = state.range(0);
+  auto map = std::make_shared<const Map>();
+  {
+    Map initial;
+    for (int i = 0; i < size; ++i) {
+      initial.insert({address(0, i), std::make_shared<int>(i)});
+    }
+    map = std::make_shared<const Map>(std::move(initial));
+  }
+
+  int next = 0;
+  for (auto _ : state) { // NOLINT
+    auto updated = std::make_shared<Map>(*map);
+    // Move each host back and forth between two subnets.
+    const int i = next % size;
+    const int subnet = next / size % 2;
+    ++next;
+    updated->erase(address(subnet, i));
+    updated->insert({address(1 - subnet, i), std::make_shared<int>(i)});
+    map = std::move(updated);
+  }
+}
+
+// NOLINTNEXTLINE(readability-identifier-naming)
+static void BM_FlatHashMapCopyAndUpdate(benchmark::State& state) {
+  copyAndUpdate<absl::flat_hash_map<std::string, std::shared_ptr<int>>>(state);
+}
+BENCHMARK(BM_FlatHashMapCopyAndUpdate)->Arg(100)->Arg(5000)->Arg(50000);
+
+// NOLINTNEXTLINE(readability-identifier-naming)
+static void BM_PersistentHashMapCopyAndUpdate(benchmark::State& state) {
+  copyAndUpdate<PersistentHashMap<std::string, std::shared_ptr<int>>>(state);
+}
+BENCHMARK(BM_PersistentHashMapCopyAndUpdate)->Arg(100)->Arg(5000)->Arg(50000);
+
+// Looks up every entry of a map of state.range(0) entries.
+template <class Map> void find(benchmark::State& state) {
+  const int size = state.range(0);
+  Map map;
+  std::vector<std::string> keys;
+  for (int i = 0; i < size; ++i) {
+    keys.push_back(address(0, i));
+    map.insert({keys.back(), std::make_shared<int>(i)});
+  }
+
+  for (auto _ : state) { // NOLINT
+    for (const std::string& key : keys) {
+      benchmark::DoNotOptimize(map.find(key));
+    }
+  }
+}
+
+// NOLINTNEXTLINE(readability-identifier-naming)
+static void BM_FlatHashMapFind(benchmark::State& state) {
+  find<absl::flat_hash_map<std::string, std::shared_ptr<int>>>(state);
+}
+BENCHMARK(BM_FlatHashMapFind)->Arg(100)->Arg(50000);
+
+// NOLINTNEXTLINE(readability-identifier-naming)
+static void BM_PersistentHashMapFind(benchmark::State& state) {
+  find<PersistentHashMap<std::string, std::shared_ptr<int>>>(state);
+}
+BENCHMARK(BM_PersistentHashMapFind)->Arg(100)->Arg(50000);
+
+} // namespace
+} // namespace Envoy
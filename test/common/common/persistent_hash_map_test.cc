@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "source/common/common/persistent_hash_map.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Pair;
+using testing::UnorderedElementsAre;
+using testing::UnorderedElementsAreArray;
+
+namespace Envoy {
+namespace {
+
+using Map = PersistentHashMap<std::string, int>;
+
+// Hashes every key to one of a few values, so that keys collide at every level of the trie.
+struct CollidingHash {
+  size_t operator()(const std::string& key) const { return key.size() % 3; }
+};
+using CollidingMap = PersistentHashMap<std::string, int, CollidingHash>;
+
+template <class M> absl::flat_hash_map<std::string, int> toFlatMap(const M& map) {
+  absl::flat_hash_map<std::string, int> flat_map;
+  for (const auto& [key, value] : map) {
+    EXPECT_TRUE(flat_map.emplace(key, value).second);
+  }
+  EXPECT_EQ(map.size(), flat_map.size());
+  return flat_map;
+}
+
+TEST(PersistentHashMapTest, Empty) {
+  Map map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(0, map.size());
+  EXPECT_EQ(map.end(), map.begin());
+  EXPECT_EQ(map.end(), map.find("a"));
+  EXPECT_EQ(0, map.erase("a"));
+}
+
+TEST(PersistentHashMapTest, InsertFindErase) {
+  Map map{{"a", 1}, {"b", 2}};
+  EXPECT_EQ(2, map.size());
+  EXPECT_THAT(map, UnorderedElementsAre(Pair("a", 1), Pair("b", 2)));
+
+  // Insert does not replace an existing value.
+  auto result = map.insert({"a", 3});
+  EXPECT_FALSE(result.second);
+  EXPECT_EQ(1, result.first->second);
+
+  result = map.insert_or_assign("a", 3);
+  EXPECT_FALSE(result.second);
+  EXPECT_EQ(3, result.first->second);
+  result = map.insert_or_assign("c", 4);
+  EXPECT_TRUE(result.second);
+  EXPECT_EQ("c", result.first->first);
+  EXPECT_EQ(3, map.size());
+
+  EXPECT_EQ(1, map.erase("b"));
+  EXPECT_EQ(0, map.erase("b"));
+  EXPECT_FALSE(map.contains("b"));
+  EXPECT_EQ(1, map.count("c"));
+  EXPECT_THAT(map, UnorderedElementsAre(Pair("a", 3), Pair("c", 4)));
+
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(map.end(), map.begin());
+}
+
+TEST(PersistentHashMapTest, Inserter) {
+  const std::vector<std::pair<std::string, int>> values{{"a", 1}, {"b", 2}, {"c", 3}};
+  Map map;
+  std::copy(values.begin(), values.end(), std::inserter(map, map.end()));
+  EXPECT_THAT(map, UnorderedElementsAreArray(values));
+}
+
+// Updates to a copy do not affect the original, and vice versa.
+TEST(PersistentHashMapTest, CopiesAreIndependent) {
+  Map original;
+  for (int i = 0; i < 1000; ++i) {
+    original.insert({absl::StrCat("key", i), i});
+  }
+  const absl::flat_hash_map<std::string, int> expected = toFlatMap(original);
+
+  Map copy = original;
+  for (int i = 0; i < 1000; i += 2) {
+    EXPECT_EQ(1, copy.erase(absl::StrCat("key", i)));
+  }
+  copy.insert_or_assign("key1", -1);
+  copy.insert({"new", 0});
+  EXPECT_EQ(501, copy.size());
+  EXPECT_EQ(-1, copy.find("key1")->second);
+  EXPECT_EQ(expected, toFlatMap(original));
+
+  original.insert_or_assign("key3", -3);
+  EXPECT_EQ(3, copy.find("key3")->second);
+  EXPECT_EQ(-3, original.find("key3")->second);
+}
+
+TEST(PersistentHashMapTest, Collisions) {
+  CollidingMap map;
+  for (int i = 0; i < 30; ++i) {
+    map.insert({std::string(i + 1, 'a'), i});
+  }
+  EXPECT_EQ(30, map.size());
+  for (int i = 0; i < 30; ++i) {
+    auto it = map.find(std::string(i + 1, 'a'));
+    ASSERT_NE(map.end(), it);
+    EXPECT_EQ(i, it->second);
+  }
+
+  CollidingMap copy = map;
+  for (int i = 0; i < 30; i += 3) {
+    EXPECT_EQ(1, copy.erase(std::string(i + 1, 'a')));
+  }
+  EXPECT_EQ(20, copy.size());
+  EXPECT_EQ(20, toFlatMap(copy).size());
+  EXPECT_EQ(30, toFlatMap(map).size());
+  EXPECT_EQ(copy.end(), copy.find("a"));
+  EXPECT_NE(copy.end(), copy.find("aa"));
+}
+
+// Random updates to a map and its snapshots match the same updates to absl::flat_hash_map.
+TEST(PersistentHashMapTest, RandomUpdates) {
+  std::mt19937 random(0);
+  Map map;
+  absl::flat_hash_map<std::string, int> expected;
+  std::vector<std::pair<Map, absl::flat_hash_map<std::string, int>>> snapshots;
+  for (int i = 0; i < 20000; ++i) {
+    const std::string key = absl::StrCat(random() % 2000);
+    switch (random() % 4) {
+    case 0:
+      EXPECT_EQ(expected.erase(key), map.erase(key));
+      break;
+    case 1:
+      EXPECT_EQ(expected.insert_or_assign(key, i).second, map.insert_or_assign(key, i).second);
+      break;
+    default:
+      EXPECT_EQ(expected.insert({key, i}).second, map.insert({key, i}).second);
+      break;
+    }
+    ASSERT_EQ(expected.size(), map.size());
+
+    const auto it = map.find(key);
+    const auto expected_it = expected.find(key);
+    ASSERT_EQ(expected_it == expected.end(), it == map.end());
+    if (it != map.end()) {
+      EXPECT_EQ(expected_it->second, it->second);
+    }
+
+    if (i % 1000 == 0) {
+      snapshots.emplace_back(map, expected);
+    }
+  }
+
+  EXPECT_EQ(expected, toFlatMap(map));
+  for (const auto& [snapshot, snapshot_expected] : snapshots) {
+    EXPECT_EQ(snapshot_expected, toFlatMap(snapshot));
+  }
+}
+
+} // namespace
+} // namespace Envoy
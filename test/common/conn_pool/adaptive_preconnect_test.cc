@@ -0,0 +1,88 @@
+#include "source/common/conn_pool/adaptive_preconnect.h"
+
+#include "test/test_common/utility.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace ConnectionPool {
+namespace {
+
+class AdaptivePreconnectControllerTest : public testing::Test {
+public:
+  AdaptivePreconnectControllerTest() {
+    config_.mutable_window()->set_seconds(1);
+    config_.mutable_max_anticipated_streams()->set_value(5);
+  }
+
+  void advance(std::chrono::milliseconds duration) { now_ += duration; }
+
+  envoy::config::cluster::v3::Cluster::PreconnectPolicy::AdaptivePreconnect config_;
+  MonotonicTime now_{std::chrono::seconds(100)};
+};
+
+TEST_F(AdaptivePreconnectControllerTest, NothingAnticipatedWithoutConnectLatency) {
+  AdaptivePreconnectController controller(config_, now_);
+  for (int i = 0; i < 100; i++) {
+    controller.onStream(now_);
+  }
+  EXPECT_EQ(0, controller.anticipatedStreams(now_));
+}
+
+TEST_F(AdaptivePreconnectControllerTest, AnticipatesStreamsArrivingWhileConnecting) {
+  AdaptivePreconnectController controller(config_, now_);
+  controller.onConnected(now_, std::chrono::milliseconds(100));
+  EXPECT_EQ(0, controller.anticipatedStreams(now_));
+
+  // 20 streams per second arriving over 100ms of connection establishment is 2 streams.
+  for (int i = 0; i < 20; i++) {
+    controller.onStream(now_);
+    advance(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(2, controller.anticipatedStreams(now_));
+
+  // The average connect latency over the window is used.
+  controller.onConnected(now_, std::chrono::milliseconds(200));
+  EXPECT_EQ(3, controller.anticipatedStreams(now_));
+}
+
+TEST_F(AdaptivePreconnectControllerTest, LimitedToMaxAnticipatedStreams) {
+  AdaptivePreconnectController controller(config_, now_);
+  controller.onConnected(now_, std::chrono::milliseconds(500));
+  for (int i = 0; i < 1000; i++) {
+    controller.onStream(now_);
+  }
+  EXPECT_EQ(5, controller.anticipatedStreams(now_));
+}
+
+TEST_F(AdaptivePreconnectControllerTest, SamplesExpireWithTheWindow) {
+  AdaptivePreconnectController controller(config_, now_);
+  controller.onConnected(now_, std::chrono::milliseconds(100));
+  for (int i = 0; i < 30; i++) {
+    controller.onStream(now_);
+  }
+  EXPECT_EQ(3, controller.anticipatedStreams(now_));
+
+  // Streams that arrived half a window later are still counted with the earlier ones.
+  advance(std::chrono::milliseconds(500));
+  for (int i = 0; i < 10; i++) {
+    controller.onStream(now_);
+  }
+  EXPECT_EQ(4, controller.anticipatedStreams(now_));
+
+  // Once the first streams fall out of the window, only the later ones are counted. The connect
+  // latency is remembered even though the connection fell out of the window.
+  advance(std::chrono::milliseconds(600));
+  EXPECT_EQ(1, controller.anticipatedStreams(now_));
+
+  advance(std::chrono::seconds(10));
+  EXPECT_EQ(0, controller.anticipatedStreams(now_));
+  for (int i = 0; i < 50; i++) {
+    controller.onStream(now_);
+  }
+  EXPECT_EQ(5, controller.anticipatedStreams(now_));
+}
+
+} // namespace
+} // namespace ConnectionPool
+} // namespace Envoy
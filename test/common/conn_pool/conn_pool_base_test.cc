@@ -684,5 +684,103 @@ TEST_F(ConnPoolImplDispatcherBaseTest, PoolDrainsWithEarlyDataStreams) {
   closeStream();
 }
 
+class ConnPoolImplBaseAdaptivePreconnectTest : public testing::Test {
+public:
+  using AdaptivePreconnect =
+      envoy::config::cluster::v3::Cluster::PreconnectPolicy::AdaptivePreconnect;
+
+  ConnPoolImplBaseAdaptivePreconnectTest() {
+    cluster_->resetResourceManager(1024, 1024, 1024, 1, 1);
+    adaptive_preconnect_.mutable_window()->set_seconds(1);
+    ON_CALL(*cluster_, adaptivePreconnect())
+        .WillByDefault(Return(OptRef<const AdaptivePreconnect>(adaptive_preconnect_)));
+    ON_CALL(dispatcher_, approximateMonotonicTime()).WillByDefault(Invoke([this]() {
+      return time_system_.monotonicTime();
+    }));
+    upstream_ready_cb_ = new NiceMock<Event::MockSchedulableCallback>(&dispatcher_);
+    pool_ = std::make_unique<NiceMock<TestConnPoolImplBase>>(
+        host_, Upstream::ResourcePriority::Default, dispatcher_, nullptr, nullptr, state_);
+    ON_CALL(*pool_, instantiateActiveClient).WillByDefault(Invoke([&]() -> ActiveClientPtr {
+      auto ret = std::make_unique<NiceMock<TestActiveClient>>(*pool_, 100, 1,
+                                                              /*supports_early_data=*/false);
+      clients_.push_back(ret.get());
+      ret->real_host_description_ = descr_;
+      return ret;
+    }));
+    ON_CALL(*pool_, onPoolReady(_, _))
+        .WillByDefault(Invoke([](ActiveClient& client, AttachContext&) {
+          TestActiveClient::incrementActiveStreams(client);
+        }));
+  }
+
+  uint64_t hits() { return cluster_->trafficStats()->upstream_rq_preconnect_hit_.value(); }
+  uint64_t misses() { return cluster_->trafficStats()->upstream_rq_preconnect_miss_.value(); }
+
+  Event::SimulatedTimeSystem time_system_;
+  AdaptivePreconnect adaptive_preconnect_;
+  Upstream::ClusterConnectivityState state_;
+  std::shared_ptr<NiceMock<Upstream::MockHostDescription>> descr_{
+      new NiceMock<Upstream::MockHostDescription>()};
+  std::shared_ptr<Upstream::MockClusterInfo> cluster_{new NiceMock<Upstream::MockClusterInfo>()};
+  NiceMock<Event::MockDispatcher> dispatcher_;
+  Upstream::HostSharedPtr host_{
+      Upstream::makeTestHost(cluster_, "tcp://127.0.0.1:80", dispatcher_.timeSource())};
+  NiceMock<Event::MockSchedulableCallback>* upstream_ready_cb_;
+  std::unique_ptr<NiceMock<TestConnPoolImplBase>> pool_;
+  AttachContext context_;
+  std::vector<TestActiveClient*> clients_;
+};
+
+// Validate that connections are established ahead of the streams expected to arrive while a
+// connection is established, and that streams are counted as hits and misses.
+TEST_F(ConnPoolImplBaseAdaptivePreconnectTest, PreconnectsAheadOfArrivingStreams) {
+  // Nothing is anticipated before a connection was established.
+  EXPECT_CALL(*pool_, instantiateActiveClient);
+  pool_->newStreamImpl(context_, /*can_send_early_data=*/false);
+  EXPECT_EQ(0, hits());
+  EXPECT_EQ(1, misses());
+
+  time_system_.advanceTimeWait(std::chrono::milliseconds(100));
+  clients_[0]->onEvent(Network::ConnectionEvent::Connected);
+  EXPECT_EQ(1, clients_[0]->active_streams_);
+
+  // Establishing a connection took 100ms and a stream arrived in the last second, so one stream is
+  // anticipated in addition to the pending one.
+  EXPECT_CALL(*pool_, instantiateActiveClient).Times(2);
+  pool_->newStreamImpl(context_, /*can_send_early_data=*/false);
+  EXPECT_EQ(0, hits());
+  EXPECT_EQ(2, misses());
+  ASSERT_EQ(3, clients_.size());
+  clients_[1]->onEvent(Network::ConnectionEvent::Connected);
+  clients_[2]->onEvent(Network::ConnectionEvent::Connected);
+  EXPECT_EQ(1, clients_[1]->active_streams_);
+  EXPECT_EQ(0, clients_[2]->active_streams_);
+
+  // The next stream is served by the preconnected connection, and another one is preconnected.
+  EXPECT_CALL(*pool_, instantiateActiveClient);
+  pool_->newStreamImpl(context_, /*can_send_early_data=*/false);
+  EXPECT_EQ(1, hits());
+  EXPECT_EQ(2, misses());
+  EXPECT_EQ(1, clients_[2]->active_streams_);
+  EXPECT_EQ(4, clients_.size());
+
+  pool_->destructAllConnections();
+}
+
+// Validate that nothing is preconnected to an unhealthy upstream.
+TEST_F(ConnPoolImplBaseAdaptivePreconnectTest, NoPreconnectIfUnhealthy) {
+  EXPECT_CALL(*pool_, instantiateActiveClient);
+  pool_->newStreamImpl(context_, /*can_send_early_data=*/false);
+  time_system_.advanceTimeWait(std::chrono::milliseconds(100));
+  clients_[0]->onEvent(Network::ConnectionEvent::Connected);
+
+  host_->healthFlagSet(Upstream::Host::HealthFlag::FAILED_ACTIVE_HC);
+  EXPECT_CALL(*pool_, instantiateActiveClient);
+  pool_->newStreamImpl(context_, /*can_send_early_data=*/false);
+  EXPECT_EQ(2, clients_.size());
+
+  pool_->destructAllConnections();
+}
+
 } // namespace ConnectionPool
 } // namespace Envoy
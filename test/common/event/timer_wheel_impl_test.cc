@@ -0,0 +1,303 @@
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "envoy/common/scope_tracker.h"
+#include "envoy/event/timer.h"
+
+#include "source/common/event/dispatcher_impl.h"
+#include "source/common/event/timer_wheel_impl.h"
+
+#include "test/mocks/common.h"
+#include "test/mocks/event/wrapped_dispatcher.h"
+#include "test/test_common/simulated_time_system.h"
+#include "test/test_common/utility.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Event {
+namespace {
+
+using testing::ElementsAre;
+using testing::InSequence;
+using testing::MockFunction;
+
+class ScopeTrackingDispatcher : public WrappedDispatcher {
+public:
+  ScopeTrackingDispatcher(DispatcherPtr dispatcher)
+      : WrappedDispatcher(*dispatcher), dispatcher_(std::move(dispatcher)) {}
+
+  void pushTrackedObject(const ScopeTrackedObject* object) override {
+    scope_ = object;
+    return impl_.pushTrackedObject(object);
+  }
+
+  void popTrackedObject(const ScopeTrackedObject* expected_object) override {
+    scope_ = nullptr;
+    return impl_.popTrackedObject(expected_object);
+  }
+
+  const ScopeTrackedObject* scope_{nullptr};
+
+private:
+  DispatcherPtr dispatcher_;
+};
+
+class TimerWheelTest : public testing::Test, public TestUsingSimulatedTime {
+public:
+  TimerWheelTest()
+      : api_(Api::createApiForTest()), dispatcher_(api_->allocateDispatcher("test_thread")),
+        start_(simTime().monotonicTime()) {}
+
+  void advance(std::chrono::milliseconds duration) {
+    simTime().advanceTimeAndRun(duration, dispatcher_, Dispatcher::RunType::Block);
+  }
+
+  std::chrono::milliseconds elapsed() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(simTime().monotonicTime() -
+                                                                 start_);
+  }
+
+  Api::ApiPtr api_;
+  ScopeTrackingDispatcher dispatcher_;
+  const MonotonicTime start_;
+};
+
+// A timer that records the times at which it fired, relative to the start of the test.
+struct TrackedTimer {
+  TrackedTimer(TimerWheelImpl& wheel, TimerWheelTest& test)
+      : timer(wheel.createTimer([this, &test] { trigger_times.push_back(test.elapsed()); })) {}
+  std::vector<std::chrono::milliseconds> trigger_times;
+  TimerPtr timer;
+};
+
+TEST_F(TimerWheelTest, CreateAndDestroy) {
+  TimerWheelImpl wheel(dispatcher_, std::chrono::milliseconds(10));
+  MockFunction<TimerCb> callback;
+  auto timer = wheel.createTimer(callback.AsStdFunction());
+  EXPECT_FALSE(timer->enabled());
+}
+
+TEST_F(TimerWheelTest, SingleTimer) {
+  TimerWheelImpl wheel(dispatcher_, std::chrono::milliseconds(10));
+  MockFunction<TimerCb> callback;
+  auto timer = wheel.createTimer(callback.AsStdFunction());
+
+  timer->enableTimer(std::chrono::milliseconds(100));
+  EXPECT_TRUE(timer->enabled());
+  EXPECT_EQ(1, wheel.enabledTimers());
+
+  advance(std::chrono::milliseconds(90));
+  EXPECT_TRUE(timer->enabled());
+
+  EXPECT_CALL(callback, Call());
+  advance(std::chrono::milliseconds(10));
+  EXPECT_FALSE(timer->enabled());
+  EXPECT_EQ(0, wheel.enabledTimers());
+}
+
+TEST_F(TimerWheelTest, RoundsUpToTick) {
+  TimerWheelImpl wheel(dispatcher_, std::chrono::milliseconds(100));
+  TrackedTimer timer(wheel, *this);
+
+  timer.timer->enableTimer(std::chrono::milliseconds(1));
+  advance(std::chrono::milliseconds(50));
+  EXPECT_TRUE(timer.timer->enabled());
+
+  timer.timer->enableHRTimer(std::chrono::microseconds(1));
+  advance(std::chrono::milliseconds(50));
+  EXPECT_THAT(timer.trigger_times, ElementsAre(std::chrono::milliseconds(100)));
+}
+
+TEST_F(TimerWheelTest, EnableAndDisableTimer) {
+  TimerWheelImpl wheel(dispatcher_, std::chrono::milliseconds(10));
+  MockFunction<TimerCb> callback;
+  auto timer = wheel.createTimer(callback.AsStdFunction());
+
+  timer->enableTimer(std::chrono::seconds(30));
+  EXPECT_TRUE(timer->enabled());
+
+  timer->disableTimer();
+  EXPECT_FALSE(timer->enabled());
+  EXPECT_EQ(0, wheel.enabledTimers());
+
+  // Nothing fires, which is caught by the strict mock callback.
+  advance(std::chrono::seconds(60));
+}
+
+TEST_F(TimerWheelTest, ReenableTimer) {
+  TimerWheelImpl wheel(dispatcher_, std::chrono::milliseconds(10));
+  TrackedTimer timer(wheel, *this);
+
+  timer.timer->enableTimer(std::chrono::seconds(10));
+  advance(std::chrono::seconds(5));
+  timer.timer->enableTimer(std::chrono::seconds(1));
+  EXPECT_EQ(1, wheel.enabledTimers());
+  advance(std::chrono::milliseconds(990));
+  EXPECT_TRUE(timer.timer->enabled());
+  advance(std::chrono::milliseconds(10));
+
+  EXPECT_THAT(timer.trigger_times, ElementsAre(std::chrono::seconds(6)));
+}
+
+TEST_F(TimerWheelTest, BatchesTimersExpiringInSameTick) {
+  TimerWheelImpl wheel(dispatcher_, std::chrono::milliseconds(100));
+  MockFunction<TimerCb> callback1;
+  MockFunction<TimerCb> callback2;
+  MockFunction<TimerCb> callback3;
+  auto timer1 = wheel.createTimer(callback1.AsStdFunction());
+  auto timer2 = wheel.createTimer(callback2.AsStdFunction());
+  auto timer3 = wheel.createTimer(callback3.AsStdFunction());
+
+  timer1->enableTimer(std::chrono::milliseconds(150));
+  timer2->enableTimer(std::chrono::milliseconds(101));
+  timer3->enableTimer(std::chrono::milliseconds(250));
+
+  {
+    InSequence s;
+    EXPECT_CALL(callback1, Call());
+    EXPECT_CALL(callback2, Call());
+  }
+  advance(std::chrono::milliseconds(200));
+  EXPECT_TRUE(timer3->enabled());
+
+  EXPECT_CALL(callback3, Call());
+  advance(std::chrono::milliseconds(100));
+}
+
+TEST_F(TimerWheelTest, CascadesFromHigherLevels) {
+  TimerWheelImpl wheel(dispatcher_, std::chrono::milliseconds(1));
+  TrackedTimer level0(wheel, *this);
+  TrackedTimer level1(wheel, *this);
+  TrackedTimer level2(wheel, *this);
+  TrackedTimer level3(wheel, *this);
+  TrackedTimer overflow(wheel, *this);
+
+  level0.timer->enableTimer(std::chrono::milliseconds(200));
+  level1.timer->enableTimer(std::chrono::milliseconds(300));
+  level2.timer->enableTimer(std::chrono::milliseconds(70000));
+  level3.timer->enableTimer(std::chrono::milliseconds(17000000));
+  // Beyond the 2^32 ticks covered by the levels.
+  overflow.timer->enableTimer(std::chrono::milliseconds(5000000000));
+  EXPECT_EQ(5, wheel.enabledTimers());
+
+  // Time advances in steps, so each timer has to be seen enabled right before it is expected to
+  // fire, and then fire at the exact time.
+  advance(std::chrono::milliseconds(199));
+  EXPECT_TRUE(level0.timer->enabled());
+  advance(std::chrono::milliseconds(1));
+  EXPECT_THAT(level0.trigger_times, ElementsAre(std::chrono::milliseconds(200)));
+
+  advance(std::chrono::milliseconds(99));
+  EXPECT_TRUE(level1.timer->enabled());
+  advance(std::chrono::milliseconds(1));
+  EXPECT_THAT(level1.trigger_times, ElementsAre(std::chrono::milliseconds(300)));
+
+  advance(std::chrono::milliseconds(70000 - 300 - 1));
+  EXPECT_TRUE(level2.timer->enabled());
+  advance(std::chrono::milliseconds(1));
+  EXPECT_THAT(level2.trigger_times, ElementsAre(std::chrono::milliseconds(70000)));
+
+  advance(std::chrono::milliseconds(17000000 - 70000 - 1));
+  EXPECT_TRUE(level3.timer->enabled());
+  advance(std::chrono::milliseconds(1));
+  EXPECT_THAT(level3.trigger_times, ElementsAre(std::chrono::milliseconds(17000000)));
+
+  advance(std::chrono::milliseconds(5000000000 - 17000000 - 1));
+  EXPECT_TRUE(overflow.timer->enabled());
+  advance(std::chrono::milliseconds(1));
+  EXPECT_THAT(overflow.trigger_times, ElementsAre(std::chrono::milliseconds(5000000000)));
+  EXPECT_EQ(0, wheel.enabledTimers());
+}
+
+TEST_F(TimerWheelTest, ManyTimers) {
+  TimerWheelImpl wheel(dispatcher_, std::chrono::milliseconds(1));
+  std::vector<std::unique_ptr<TrackedTimer>> timers;
+  for (int i = 0; i < 1000; i++) {
+    timers.push_back(std::make_unique<TrackedTimer>(wheel, *this));
+    timers.back()->timer->enableTimer(std::chrono::milliseconds(i * 97 % 10000 + 1));
+  }
+  EXPECT_EQ(1000, wheel.enabledTimers());
+
+  for (int i = 0; i < 10000; i++) {
+    advance(std::chrono::milliseconds(1));
+  }
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_THAT(timers[i]->trigger_times,
+                ElementsAre(std::chrono::milliseconds(i * 97 % 10000 + 1)));
+  }
+  EXPECT_EQ(0, wheel.enabledTimers());
+}
+
+TEST_F(TimerWheelTest, InCallbackReenableTimer) {
+  TimerWheelImpl wheel(dispatcher_, std::chrono::milliseconds(10));
+  std::vector<std::chrono::milliseconds> trigger_times;
+  TimerPtr timer;
+  timer = wheel.createTimer([&] {
+    trigger_times.push_back(elapsed());
+    if (trigger_times.size() < 3) {
+      timer->enableTimer(std::chrono::seconds(1));
+    }
+  });
+
+  timer->enableTimer(std::chrono::seconds(1));
+  for (int i = 0; i < 5; i++) {
+    advance(std::chrono::seconds(1));
+  }
+
+  EXPECT_THAT(trigger_times, ElementsAre(std::chrono::seconds(1), std::chrono::seconds(2),
+                                         std::chrono::seconds(3)));
+  EXPECT_FALSE(timer->enabled());
+}
+
+TEST_F(TimerWheelTest, InCallbackDestroyExpiredTimer) {
+  TimerWheelImpl wheel(dispatcher_, std::chrono::milliseconds(10));
+  MockFunction<TimerCb> callback1;
+  MockFunction<TimerCb> callback2;
+  auto timer1 = wheel.createTimer(callback1.AsStdFunction());
+  auto timer2 = wheel.createTimer(callback2.AsStdFunction());
+
+  timer1->enableTimer(std::chrono::milliseconds(100));
+  timer2->enableTimer(std::chrono::milliseconds(100));
+
+  // timer2 expires in the same tick, but is destroyed before it runs.
+  EXPECT_CALL(callback1, Call).WillOnce(Invoke([&]() { timer2.reset(); }));
+  advance(std::chrono::milliseconds(100));
+  EXPECT_EQ(0, wheel.enabledTimers());
+}
+
+TEST_F(TimerWheelTest, InCallbackEnableOtherTimer) {
+  TimerWheelImpl wheel(dispatcher_, std::chrono::milliseconds(10));
+  TrackedTimer timer2(wheel, *this);
+  MockFunction<TimerCb> callback1;
+  auto timer1 = wheel.createTimer(callback1.AsStdFunction());
+
+  timer1->enableTimer(std::chrono::milliseconds(100));
+  EXPECT_CALL(callback1, Call).WillOnce(Invoke([&]() {
+    timer2.timer->enableTimer(std::chrono::milliseconds(0));
+  }));
+
+  advance(std::chrono::milliseconds(100));
+  EXPECT_TRUE(timer2.timer->enabled());
+
+  // A timer enabled with no delay runs in the next tick.
+  advance(std::chrono::milliseconds(10));
+  EXPECT_THAT(timer2.trigger_times, ElementsAre(std::chrono::milliseconds(110)));
+}
+
+TEST_F(TimerWheelTest, ScopeIsTrackedInCallback) {
+  TimerWheelImpl wheel(dispatcher_, std::chrono::milliseconds(10));
+  MockFunction<TimerCb> callback;
+  MockScopeTrackedObject scope;
+  auto timer = wheel.createTimer(callback.AsStdFunction());
+
+  timer->enableTimer(std::chrono::milliseconds(100), &scope);
+  EXPECT_CALL(callback, Call).WillOnce(Invoke([&]() { EXPECT_EQ(dispatcher_.scope_, &scope); }));
+  advance(std::chrono::milliseconds(100));
+  EXPECT_EQ(dispatcher_.scope_, nullptr);
+}
+
+} // namespace
+} // namespace Event
+} // namespace Envoy
@@ -29,6 +29,30 @@ std::unique_ptr<Envoy::Formatter::JsonFormatterImpl> makeJsonFormatter() {
   return std::make_unique<Envoy::Formatter::JsonFormatterImpl>(JsonLogFormat, false);
 }
 
+// A format mixing commands with constant fields, as is common for logs shipped to a collector.
+std::unique_ptr<Envoy::Formatter::JsonFormatterImpl> makeJsonFormatterWithStaticFields() {
+  ProtobufWkt::Struct JsonLogFormat;
+  const std::string format_yaml = R"EOF(
+    service: frontend
+    log_version: 2
+    sampled: '100%%'
+    source:
+      region: us-east-1
+      zone: us-east-1a
+    http:
+      method: '%REQ(:METHOD)%'
+      url: '%REQ(X-FORWARDED-PROTO)%://%REQ(:AUTHORITY)%%REQ(X-ENVOY-ORIGINAL-PATH?:PATH)%'
+      protocol: '%PROTOCOL%'
+      response_code: '%RESPONSE_CODE%'
+      user-agent: '%REQ(USER-AGENT)%'
+    remote_address: '%DOWNSTREAM_REMOTE_ADDRESS_WITHOUT_PORT%'
+    bytes_sent: '%BYTES_SENT%'
+    duration: '%DURATION%'
+  )EOF";
+  TestUtility::loadFromYaml(format_yaml, JsonLogFormat);
+  return std::make_unique<Envoy::Formatter::JsonFormatterImpl>(JsonLogFormat, false);
+}
+
 std::unique_ptr<Envoy::Formatter::StructFormatter> makeStructFormatter(bool typed) {
   ProtobufWkt::Struct StructLogFormat;
   const std::string format_yaml = R"EOF(
@@ -141,6 +165,22 @@ static void BM_JsonAccessLogFormatter(benchmark::State& state) {
 }
 BENCHMARK(BM_JsonAccessLogFormatter);
 
+// NOLINTNEXTLINE(readability-identifier-naming)
+static void BM_JsonAccessLogFormatterWithStaticFields(benchmark::State& state) {
+  testing::NiceMock<MockTimeSystem> time_system;
+
+  std::unique_ptr<Envoy::TestStreamInfo> stream_info = makeStreamInfo(time_system);
+  std::unique_ptr<Envoy::Formatter::JsonFormatterImpl> json_formatter =
+      makeJsonFormatterWithStaticFields();
+
+  size_t output_bytes = 0;
+  for (auto _ : state) { // NOLINT: Silences warning about dead store
+    output_bytes += json_formatter->formatWithContext({}, *stream_info).length();
+  }
+  benchmark::DoNotOptimize(output_bytes);
+}
+BENCHMARK(BM_JsonAccessLogFormatterWithStaticFields);
+
 // NOLINTNEXTLINE(readability-identifier-naming)
 static void BM_FormatterCommandParsing(benchmark::State& state) {
   const std::string token = "Listener:namespace:key";
@@ -4695,6 +4695,30 @@ TEST(SubstitutionFormatterTest, JsonFormatterWithOrderedPropertiesTest) {
   EXPECT_EQ(legacy_out_json, legacy_expected);
 }
 
+TEST(SubstitutionFormatterTest, JsonFormatterWithLiteralTemplatesTest) {
+  NiceMock<StreamInfo::MockStreamInfo> stream_info;
+  absl::optional<Http::Protocol> protocol = Http::Protocol::Http11;
+  EXPECT_CALL(stream_info, protocol()).WillRepeatedly(Return(protocol));
+
+  ProtobufWkt::Struct key_mapping;
+  TestUtility::loadFromYaml(R"EOF(
+    afield: '100%%'
+    bfield: '%%"quoted"%%'
+    cfield: 3
+    protocol: '%PROTOCOL%'
+    zfield: '%%'
+  )EOF",
+                            key_mapping);
+
+  // Templates without commands are rendered as constant strings.
+  const std::string expected = "{\"afield\":\"100%\",\"bfield\":\"%\\\"quoted\\\"%\",\"cfield\":3,"
+                               "\"protocol\":\"HTTP/1.1\",\"zfield\":\"%\"}\n";
+
+  JsonFormatterImpl formatter(key_mapping, false);
+  EXPECT_EQ(expected, formatter.formatWithContext({}, stream_info));
+  EXPECT_EQ(expected, formatter.formatWithContext({}, stream_info));
+}
+
 TEST(SubstitutionFormatterTest, CompositeFormatterSuccess) {
   Http::TestRequestHeaderMapImpl request_header{{"first", "GET"}, {":path", "/"}};
   Http::TestResponseHeaderMapImpl response_header{{"second", "PUT"}, {"test", "test"}};
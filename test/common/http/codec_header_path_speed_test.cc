@@ -0,0 +1,419 @@
+// Measures the end-to-end cost of moving request and response headers through Envoy's HTTP
+// codecs, as a proxy does: the downstream server codec decodes a request, the headers are copied
+// and mutated the way the router prepares an upstream request, and the upstream client codec
+// encodes them. The response takes the reverse path. Every codec is paired with a peer codec over
+// an in-memory transport, so both encode and decode run with real framing and HPACK state.
+//
+// Besides time per request, each benchmark reports `allocations_per_request`: the number of calls
+// to the global operator new made while a request and its response pass through all four codecs,
+// including memory that is freed again before the request completes. This binary replaces the
+// global allocation functions to count them, so the counter does not depend on the allocator.
+//
+// HTTP/3 is out of scope: its codecs are driven by a QUIC session and connection rather than a
+// byte stream, so they cannot be paired over an in-memory transport like the codecs here.
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "envoy/config/core/v3/protocol.pb.h"
+
+#include "source/common/buffer/buffer_impl.h"
+#include "source/common/common/assert.h"
+#include "source/common/common/random_generator.h"
+#include "source/common/http/header_map_impl.h"
+#include "source/common/http/http1/codec_impl.h"
+#include "source/common/http/http2/codec_impl.h"
+#include "source/common/http/utility.h"
+#include "source/common/stats/isolated_store_impl.h"
+
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/network/mocks.h"
+#include "test/mocks/server/overload_manager.h"
+#include "test/test_common/test_runtime.h"
+
+#include "benchmark/benchmark.h"
+
+using testing::_;
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+
+namespace {
+
+std::atomic<uint64_t> allocation_count{0};
+
+void* countedAllocate(std::size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+} // namespace
+
+// Counting replacements of the global allocation functions. The nothrow and aligned forms are
+// not replaced; the standard library implements the nothrow forms in terms of these.
+void* operator new(std::size_t size) { return countedAllocate(size); }
+void* operator new[](std::size_t size) { return countedAllocate(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace Envoy {
+namespace Http {
+namespace {
+
+using HeaderPairs = std::vector<std::pair<std::string, std::string>>;
+
+struct CapturedHeaders {
+  HeaderPairs request_;
+  HeaderPairs response_;
+};
+
+// Header sets captured from production traffic, with identifying values replaced.
+const std::vector<CapturedHeaders>& capturedHeaderSets() {
+  static const auto* sets = new std::vector<CapturedHeaders>{
+      // 0: Browser page load.
+      {{{":method", "GET"},
+        {":path", "/catalog/shoes?color=blue&size=42"},
+        {":authority", "www.example.com"},
+        {":scheme", "https"},
+        {"user-agent", "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like "
+                       "Gecko) Chrome/124.0.0.0 Safari/537.36"},
+        {"accept", "text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,"
+                   "image/webp,*/*;q=0.8"},
+        {"accept-encoding", "gzip, deflate, br"},
+        {"accept-language", "en-US,en;q=0.9"},
+        {"cookie", "session=3f9c2a7e4b1d8c6f0a5e2b9d7c4f1a8e; theme=dark; consent=1"},
+        {"referer", "https://www.example.com/catalog"},
+        {"sec-ch-ua", "\"Chromium\";v=\"124\", \"Not-A.Brand\";v=\"99\""},
+        {"sec-fetch-mode", "navigate"},
+        {"upgrade-insecure-requests", "1"}},
+       {{":status", "200"},
+        {"content-type", "text/html; charset=utf-8"},
+        {"content-length", "0"},
+        {"cache-control", "private, max-age=0"},
+        {"date", "Mon, 19 Oct 2026 07:37:00 GMT"},
+        {"server", "origin"},
+        {"set-cookie", "session=3f9c2a7e4b1d8c6f0a5e2b9d7c4f1a8e; Path=/; Secure; HttpOnly"},
+        {"strict-transport-security", "max-age=31536000; includeSubDomains"},
+        {"vary", "accept-encoding"}}},
+      // 1: gRPC unary call between services.
+      {{{":method", "POST"},
+        {":path", "/acme.inventory.v1.InventoryService/GetItem"},
+        {":authority", "inventory.prod.svc.cluster.local:8080"},
+        {":scheme", "http"},
+        {"content-type", "application/grpc"},
+        {"te", "trailers"},
+        {"grpc-timeout", "1S"},
+        {"grpc-accept-encoding", "identity,deflate,gzip"},
+        {"user-agent", "grpc-go/1.60.1"},
+        {"x-request-id", "7b1e3c52-9a4d-4f8e-b6c1-2d9f0e8a7c35"},
+        {"traceparent", "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01"}},
+       {{":status", "200"},
+        {"content-type", "application/grpc"},
+        {"content-length", "0"},
+        {"grpc-status", "0"},
+        {"grpc-message", ""},
+        {"date", "Mon, 19 Oct 2026 07:37:00 GMT"}}},
+      // 2: Authenticated JSON API call through a service mesh.
+      {{{":method", "GET"},
+        {":path", "/api/v1/users/12345/orders?limit=50&cursor=eyJpZCI6OTg3NjV9"},
+        {":authority", "orders.internal"},
+        {":scheme", "http"},
+        {"accept", "application/json"},
+        {"authorization",
+         "Bearer eyJhbGciOiJSUzI1NiIsInR5cCI6IkpXVCJ9.eyJzdWIiOiIxMjM0NSIsImF1ZCI6Im9yZGVy"
+         "cyIsImV4cCI6MTc5MjQ3NjIyMH0.c2lnbmF0dXJlLXBsYWNlaG9sZGVyLXZhbHVlLWZvci1iZW5jaG1h"},
+        {"x-forwarded-for", "203.0.113.7, 10.1.2.3"},
+        {"x-forwarded-proto", "https"},
+        {"x-request-id", "0d6a9f4e-2b7c-4e1a-9c3d-8f5b1a2e6d70"},
+        {"x-b3-traceid", "80f198ee56343ba864fe8b2a57d3eff7"},
+        {"x-b3-spanid", "e457b5a2e4d86bd1"},
+        {"x-b3-sampled", "1"},
+        {"baggage", "tenant=acme,region=us-east-1"}},
+       {{":status", "200"},
+        {"content-type", "application/json"},
+        {"content-length", "0"},
+        {"cache-control", "no-store"},
+        {"date", "Mon, 19 Oct 2026 07:37:00 GMT"},
+        {"server", "orders"},
+        {"x-ratelimit-remaining", "4987"}}},
+  };
+  return *sets;
+}
+
+template <class T> std::unique_ptr<T> buildHeaderMap(const HeaderPairs& pairs) {
+  auto headers = T::create();
+  for (const auto& [key, value] : pairs) {
+    headers->addCopy(LowerCaseString(key), value);
+  }
+  return headers;
+}
+
+// Feeds `input` to `codec` until it is consumed and the codec has nothing left to send.
+// Returns true if any work was done.
+bool driveCodec(Connection& codec, Buffer::Instance& input) {
+  bool progress = false;
+  while (input.length() > 0 || codec.wantsToWrite()) {
+    const uint64_t pending = input.length();
+    const Status status = codec.dispatch(input);
+    RELEASE_ASSERT(status.ok(), std::string(status.message()));
+    progress = true;
+    if (pending > 0 && input.length() == pending) {
+      // The codec paused reading, e.g. an HTTP/1 server waiting on a response.
+      break;
+    }
+  }
+  return progress;
+}
+
+// A client codec and a server codec connected by in-memory buffers.
+class CodecPair {
+public:
+  CodecPair() {
+    setupConnection(client_connection_, to_server_);
+    setupConnection(server_connection_, to_client_);
+  }
+
+  virtual ~CodecPair() = default;
+
+  ClientConnection& client() { return *client_; }
+
+  // Delivers bytes queued in either direction. Returns true if any work was done.
+  bool drive() {
+    const bool server_progress = driveCodec(*server_, to_server_);
+    const bool client_progress = driveCodec(*client_, to_client_);
+    return server_progress || client_progress;
+  }
+
+  void clearDeferredDeleteList() {
+    client_connection_.dispatcher_.clearDeferredDeleteList();
+    server_connection_.dispatcher_.clearDeferredDeleteList();
+  }
+
+protected:
+  static void setupConnection(NiceMock<Network::MockConnection>& connection,
+                              Buffer::Instance& peer_input) {
+    ON_CALL(connection, write(_, _))
+        .WillByDefault(
+            Invoke([&peer_input](Buffer::Instance& data, bool) -> void { peer_input.move(data); }));
+    ON_CALL(connection, bufferLimit()).WillByDefault(Return(16 * 1024));
+    ON_CALL(connection.dispatcher_, trackedObjectStackIsEmpty()).WillByDefault(Return(true));
+  }
+
+  Stats::IsolatedStoreImpl stats_store_;
+  NiceMock<Network::MockConnection> client_connection_;
+  NiceMock<Network::MockConnection> server_connection_;
+  NiceMock<MockConnectionCallbacks> client_callbacks_;
+  NiceMock<MockServerConnectionCallbacks> server_callbacks_;
+  NiceMock<Server::MockOverloadManager> overload_manager_;
+  Buffer::OwnedImpl to_server_;
+  Buffer::OwnedImpl to_client_;
+  ClientConnectionPtr client_;
+  ServerConnectionPtr server_;
+
+  friend class HeaderPathHarness;
+};
+
+class Http1CodecPair : public CodecPair {
+public:
+  Http1CodecPair() {
+    client_ = std::make_unique<Http1::ClientConnectionImpl>(
+        client_connection_, Http1::CodecStats::atomicGet(client_stats_, *stats_store_.rootScope()),
+        client_callbacks_, settings_, DEFAULT_MAX_REQUEST_HEADERS_KB, DEFAULT_MAX_HEADERS_COUNT);
+    server_ = std::make_unique<Http1::ServerConnectionImpl>(
+        server_connection_, Http1::CodecStats::atomicGet(server_stats_, *stats_store_.rootScope()),
+        server_callbacks_, settings_, DEFAULT_MAX_REQUEST_HEADERS_KB, DEFAULT_MAX_HEADERS_COUNT,
+        envoy::config::core::v3::HttpProtocolOptions::ALLOW, overload_manager_);
+  }
+
+private:
+  Http1Settings settings_;
+  Http1::CodecStats::AtomicPtr client_stats_;
+  Http1::CodecStats::AtomicPtr server_stats_;
+};
+
+class Http2CodecPair : public CodecPair {
+public:
+  Http2CodecPair()
+      : options_(::Envoy::Http2::Utility::initializeAndValidateOptions(
+                     envoy::config::core::v3::Http2ProtocolOptions())
+                     .value()) {
+    client_ = std::make_unique<Http2::ClientConnectionImpl>(
+        client_connection_, client_callbacks_,
+        Http2::CodecStats::atomicGet(client_stats_, *stats_store_.rootScope()), random_, options_,
+        DEFAULT_MAX_REQUEST_HEADERS_KB, DEFAULT_MAX_HEADERS_COUNT,
+        Http2::ProdNghttp2SessionFactory::get());
+    server_ = std::make_unique<Http2::ServerConnectionImpl>(
+        server_connection_, server_callbacks_,
+        Http2::CodecStats::atomicGet(server_stats_, *stats_store_.rootScope()), random_, options_,
+        DEFAULT_MAX_REQUEST_HEADERS_KB, DEFAULT_MAX_HEADERS_COUNT,
+        envoy::config::core::v3::HttpProtocolOptions::ALLOW, overload_manager_);
+  }
+
+private:
+  const envoy::config::core::v3::Http2ProtocolOptions options_;
+  Random::RandomGeneratorImpl random_;
+  Http2::CodecStats::AtomicPtr client_stats_;
+  Http2::CodecStats::AtomicPtr server_stats_;
+};
+
+// Wires a downstream codec pair and an upstream codec pair together the way a proxy does. The
+// downstream client and the upstream server stand in for the user agent and the origin.
+class HeaderPathHarness {
+public:
+  HeaderPathHarness(std::unique_ptr<CodecPair> downstream, std::unique_ptr<CodecPair> upstream,
+                    const CapturedHeaders& captured)
+      : downstream_(std::move(downstream)), upstream_(std::move(upstream)),
+        request_headers_(buildHeaderMap<RequestHeaderMapImpl>(captured.request_)),
+        origin_response_headers_(buildHeaderMap<ResponseHeaderMapImpl>(captured.response_)) {
+    // Proxy: downstream request -> upstream request.
+    ON_CALL(downstream_->server_callbacks_, newStream(_, _))
+        .WillByDefault(Invoke([this](ResponseEncoder& encoder, bool) -> RequestDecoder& {
+          downstream_response_encoder_ = &encoder;
+          return proxy_request_decoder_;
+        }));
+    ON_CALL(proxy_request_decoder_, decodeHeaders_(_, _))
+        .WillByDefault(Invoke([this](RequestHeaderMapSharedPtr& headers, bool end_stream) {
+          upstream_request_headers_ = createHeaderMap<RequestHeaderMapImpl>(*headers);
+          upstream_request_headers_->setForwardedProto("https");
+          upstream_request_headers_->setEnvoyExpectedRequestTimeoutMs(15000);
+          upstream_request_headers_->setEnvoyAttemptCount(1);
+          downstream_request_headers_ = headers;
+          RequestEncoder& encoder = upstream_->client().newStream(proxy_response_decoder_);
+          const Status status = encoder.encodeHeaders(*upstream_request_headers_, end_stream);
+          RELEASE_ASSERT(status.ok(), std::string(status.message()));
+        }));
+
+    // Origin: answer every request with the captured response.
+    ON_CALL(upstream_->server_callbacks_, newStream(_, _))
+        .WillByDefault(Invoke([this](ResponseEncoder& encoder, bool) -> RequestDecoder& {
+          origin_response_encoder_ = &encoder;
+          return origin_request_decoder_;
+        }));
+    ON_CALL(origin_request_decoder_, decodeHeaders_(_, _))
+        .WillByDefault(Invoke([this](RequestHeaderMapSharedPtr&, bool) {
+          origin_response_encoder_->encodeHeaders(*origin_response_headers_, true);
+        }));
+
+    // Proxy: upstream response -> downstream response.
+    ON_CALL(proxy_response_decoder_, decodeHeaders_(_, _))
+        .WillByDefault(Invoke([this](ResponseHeaderMapPtr& headers, bool end_stream) {
+          downstream_response_headers_ = std::move(headers);
+          downstream_response_headers_->setEnvoyUpstreamServiceTime(3);
+          downstream_response_headers_->removeServer();
+          downstream_response_encoder_->encodeHeaders(*downstream_response_headers_, end_stream);
+        }));
+
+    // User agent: note completion.
+    ON_CALL(client_response_decoder_, decodeHeaders_(_, _))
+        .WillByDefault(Invoke([this](ResponseHeaderMapPtr&, bool) { ++responses_; }));
+
+    // Exchange connection prefaces and SETTINGS before measuring.
+    while (downstream_->drive() || upstream_->drive()) {
+    }
+  }
+
+  void sendRequest() {
+    const uint64_t allocations_at_start = allocation_count.load(std::memory_order_relaxed);
+    RequestEncoder& encoder = downstream_->client().newStream(client_response_decoder_);
+    const Status status = encoder.encodeHeaders(*request_headers_, true);
+    RELEASE_ASSERT(status.ok(), std::string(status.message()));
+    while (downstream_->drive() || upstream_->drive()) {
+    }
+
+    downstream_request_headers_.reset();
+    upstream_request_headers_.reset();
+    downstream_response_headers_.reset();
+    downstream_->clearDeferredDeleteList();
+    upstream_->clearDeferredDeleteList();
+    allocations_ += allocation_count.load(std::memory_order_relaxed) - allocations_at_start;
+  }
+
+  uint64_t responses() const { return responses_; }
+  uint64_t allocations() const { return allocations_; }
+
+private:
+  std::unique_ptr<CodecPair> downstream_;
+  std::unique_ptr<CodecPair> upstream_;
+  const RequestHeaderMapPtr request_headers_;
+  const ResponseHeaderMapPtr origin_response_headers_;
+
+  NiceMock<MockResponseDecoder> client_response_decoder_;
+  NiceMock<MockRequestDecoder> proxy_request_decoder_;
+  NiceMock<MockResponseDecoder> proxy_response_decoder_;
+  NiceMock<MockRequestDecoder> origin_request_decoder_;
+  ResponseEncoder* downstream_response_encoder_{};
+  ResponseEncoder* origin_response_encoder_{};
+
+  RequestHeaderMapSharedPtr downstream_request_headers_;
+  RequestHeaderMapPtr upstream_request_headers_;
+  ResponseHeaderMapPtr downstream_response_headers_;
+
+  uint64_t allocations_{0};
+  uint64_t responses_{0};
+};
+
+template <class DownstreamPair, class UpstreamPair>
+void runHeaderPath(benchmark::State& state, bool header_rep_cache = false) {
+  TestScopedRuntime runtime;
+  if (header_rep_cache) {
+    runtime.mergeValues({{"envoy.reloadable_features.http2_upstream_header_rep_cache", "true"}});
+  }
+  const CapturedHeaders& captured = capturedHeaderSets()[state.range(0)];
+  HeaderPathHarness harness(std::make_unique<DownstreamPair>(), std::make_unique<UpstreamPair>(),
+                            captured);
+  // Warm up lazily allocated codec and header map state outside of the measurement.
+  harness.sendRequest();
+  const uint64_t warmup_responses = harness.responses();
+  const uint64_t warmup_allocations = harness.allocations();
+
+  for (auto _ : state) { // NOLINT
+    harness.sendRequest();
+  }
+
+  const uint64_t responses = harness.responses() - warmup_responses;
+  RELEASE_ASSERT(responses == static_cast<uint64_t>(state.iterations()),
+                 "a request did not complete");
+  state.counters["allocations_per_request"] =
+      benchmark::Counter(static_cast<double>(harness.allocations() - warmup_allocations),
+                         benchmark::Counter::kAvgIterations);
+}
+
+// HTTP/1.1 downstream, HTTP/1.1 upstream.
+static void headerPathHttp1ToHttp1(benchmark::State& state) {
+  runHeaderPath<Http1CodecPair, Http1CodecPair>(state);
+}
+BENCHMARK(headerPathHttp1ToHttp1)->DenseRange(0, 2);
+
+// HTTP/1.1 downstream, HTTP/2 upstream: the common edge proxy shape.
+static void headerPathHttp1ToHttp2(benchmark::State& state) {
+  runHeaderPath<Http1CodecPair, Http2CodecPair>(state);
+}
+BENCHMARK(headerPathHttp1ToHttp2)->DenseRange(0, 2);
+
+// HTTP/2 downstream, HTTP/2 upstream: the common sidecar shape.
+static void headerPathHttp2ToHttp2(benchmark::State& state) {
+  runHeaderPath<Http2CodecPair, Http2CodecPair>(state);
+}
+BENCHMARK(headerPathHttp2ToHttp2)->DenseRange(0, 2);
+
+// As headerPathHttp2ToHttp2, with the upstream HTTP/2 connection reusing storage for header
+// strings repeated across streams. Compare against headerPathHttp2ToHttp2 for the net gain.
+static void headerPathHttp2ToHttp2HeaderRepCache(benchmark::State& state) {
+  runHeaderPath<Http2CodecPair, Http2CodecPair>(state, true);
+}
+BENCHMARK(headerPathHttp2ToHttp2HeaderRepCache)->DenseRange(0, 2);
+
+} // namespace
+} // namespace Http
+} // namespace Envoy
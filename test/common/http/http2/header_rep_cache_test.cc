@@ -0,0 +1,141 @@
+#include <string>
+
+#include "source/common/http/http2/header_rep_cache.h"
+
+#include "test/test_common/utility.h"
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Http {
+namespace Http2 {
+namespace {
+
+HeaderString ownedString(absl::string_view value) {
+  HeaderString str;
+  str.setCopy(value);
+  return str;
+}
+
+bool isView(const http2::adapter::HeaderRep& rep) {
+  return absl::holds_alternative<absl::string_view>(rep);
+}
+
+// Long enough not to fit in the inline buffer of std::string with any standard library.
+const std::string LongValue = "application/grpc+proto; charset=utf-8";
+
+absl::string_view repValue(const http2::adapter::HeaderRep& rep) {
+  return isView(rep) ? absl::get<absl::string_view>(rep)
+                     : absl::string_view(absl::get<std::string>(rep));
+}
+
+TEST(HeaderRepCacheTest, ReferenceStringsAreNotCopied) {
+  HeaderRepCache cache(1024);
+  const LowerCaseString key("x-static");
+  HeaderString str(key);
+
+  const http2::adapter::HeaderRep rep = cache.getRep(str);
+  ASSERT_TRUE(isView(rep));
+  EXPECT_EQ(key.get().data(), absl::get<absl::string_view>(rep).data());
+  EXPECT_EQ(0, cache.size());
+}
+
+TEST(HeaderRepCacheTest, RepeatedStringIsInternedOnSecondUse) {
+  HeaderRepCache cache(1024);
+
+  const http2::adapter::HeaderRep first = cache.getRep(ownedString(LongValue));
+  EXPECT_FALSE(isView(first));
+  EXPECT_EQ(LongValue, repValue(first));
+  EXPECT_EQ(0, cache.size());
+
+  const http2::adapter::HeaderRep second = cache.getRep(ownedString(LongValue));
+  ASSERT_TRUE(isView(second));
+  EXPECT_EQ(LongValue, repValue(second));
+  EXPECT_EQ(1, cache.size());
+  EXPECT_EQ(LongValue.size(), cache.bytes());
+
+  // Subsequent uses point at the same storage, which outlives the source HeaderString.
+  const http2::adapter::HeaderRep third = cache.getRep(ownedString(LongValue));
+  ASSERT_TRUE(isView(third));
+  EXPECT_EQ(absl::get<absl::string_view>(second).data(),
+            absl::get<absl::string_view>(third).data());
+  EXPECT_EQ(1, cache.size());
+}
+
+TEST(HeaderRepCacheTest, ByteBudgetIsRespected) {
+  HeaderRepCache cache(LongValue.size());
+
+  cache.getRep(ownedString(LongValue));
+  EXPECT_TRUE(isView(cache.getRep(ownedString(LongValue))));
+  EXPECT_EQ(LongValue.size(), cache.bytes());
+
+  // No room left: strings keep being copied and are never interned.
+  const std::string other = absl::StrCat(LongValue, "-other");
+  cache.getRep(ownedString(other));
+  const http2::adapter::HeaderRep rep = cache.getRep(ownedString(other));
+  EXPECT_FALSE(isView(rep));
+  EXPECT_EQ(other, repValue(rep));
+  EXPECT_EQ(1, cache.size());
+  EXPECT_EQ(LongValue.size(), cache.bytes());
+}
+
+TEST(HeaderRepCacheTest, ShortStringsAreCopied) {
+  HeaderRepCache cache(1024);
+  const std::string value(std::string().capacity(), 'a');
+
+  for (int i = 0; i < 3; ++i) {
+    const http2::adapter::HeaderRep rep = cache.getRep(ownedString(value));
+    EXPECT_FALSE(isView(rep));
+    EXPECT_EQ(value, repValue(rep));
+  }
+  EXPECT_EQ(0, cache.size());
+}
+
+TEST(HeaderRepCacheTest, SensitiveValuesAreNotCached) {
+  HeaderRepCache cache(1024);
+  const std::string token = absl::StrCat("Bearer ", LongValue);
+
+  for (const absl::string_view name :
+       {"authorization", "proxy-authorization", "cookie", "set-cookie"}) {
+    EXPECT_TRUE(HeaderRepCache::isSensitive(name));
+    for (int i = 0; i < 3; ++i) {
+      TestRequestHeaderMapImpl headers;
+      headers.addCopy(LowerCaseString(name), token);
+      headers.iterate([&cache, &token](const HeaderEntry& header) -> HeaderMap::Iterate {
+        const http2::adapter::Header out = cache.getHeader(header);
+        EXPECT_FALSE(isView(out.second));
+        EXPECT_EQ(token, repValue(out.second));
+        return HeaderMap::Iterate::Continue;
+      });
+    }
+  }
+
+  // Other values are cached as usual.
+  EXPECT_FALSE(HeaderRepCache::isSensitive("x-tenant"));
+  const size_t cached = cache.size();
+  for (int i = 0; i < 2; ++i) {
+    TestRequestHeaderMapImpl headers{{"x-tenant", token}};
+    headers.iterate([&cache](const HeaderEntry& header) -> HeaderMap::Iterate {
+      cache.getHeader(header);
+      return HeaderMap::Iterate::Continue;
+    });
+  }
+  EXPECT_EQ(cached + 1, cache.size());
+}
+
+TEST(HeaderRepCacheTest, UniqueValuesDoNotGrowCandidatesUnbounded) {
+  HeaderRepCache cache(1024 * 1024);
+
+  for (size_t i = 0; i < 4 * HeaderRepCache::MaxCandidates; ++i) {
+    const std::string value = absl::StrCat(LongValue, "-request-", i);
+    EXPECT_EQ(value, repValue(cache.getRep(ownedString(value))));
+  }
+  EXPECT_EQ(0, cache.size());
+  EXPECT_EQ(0, cache.bytes());
+}
+
+} // namespace
+} // namespace Http2
+} // namespace Http
+} // namespace Envoy
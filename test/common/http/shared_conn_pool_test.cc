@@ -0,0 +1,299 @@
+#include <memory>
+#include <vector>
+
+#include "source/common/http/shared_conn_pool.h"
+
+#include "test/common/upstream/utility.h"
+#include "test/mocks/buffer/mocks.h"
+#include "test/mocks/common.h"
+#include "test/mocks/http/conn_pool.h"
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/stream_info/mocks.h"
+#include "test/mocks/upstream/cluster_info.h"
+#include "test/test_common/simulated_time_system.h"
+#include "test/test_common/utility.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::_;
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+
+namespace Envoy {
+namespace Http {
+namespace {
+
+class SharedConnPoolTest : public Event::TestUsingSimulatedTime, public testing::Test {
+public:
+  SharedConnPoolTest()
+      : api_(Api::createApiForTest()), worker_dispatcher_(api_->allocateDispatcher("worker")),
+        owner_dispatcher_(api_->allocateDispatcher("owner")),
+        host_(Upstream::makeTestHost(cluster_, "tcp://127.0.0.1:80", simTime())),
+        worker_(std::make_shared<SharedConnPoolThread>(*worker_dispatcher_, nullptr)),
+        owner_(std::make_shared<SharedConnPoolThread>(
+            *owner_dispatcher_, [this](const SharedConnPoolKey& key) {
+              EXPECT_EQ("fake_cluster", key.cluster_name_);
+              EXPECT_EQ(host_, key.host_);
+              return owner_pool_;
+            })),
+        pool_(std::make_unique<SharedConnPoolImpl>(
+            worker_, owner_,
+            SharedConnPoolKey{"fake_cluster", host_, Upstream::ResourcePriority::Default,
+                              Protocol::Http2})) {}
+
+  ~SharedConnPoolTest() override {
+    pool_.reset();
+    owner_->shutdown();
+    worker_->shutdown();
+    run();
+  }
+
+  void run() {
+    owner_dispatcher_->run(Event::Dispatcher::RunType::NonBlock);
+    worker_dispatcher_->run(Event::Dispatcher::RunType::NonBlock);
+  }
+
+  // Starts a stream on the pool, and captures the callbacks of the stream on the owner's pool.
+  void newStream() {
+    EXPECT_CALL(owner_pool_mock_, newStream(_, _, _))
+        .WillOnce(Invoke([this](ResponseDecoder& decoder, ConnectionPool::Callbacks& callbacks,
+                                const ConnectionPool::Instance::StreamOptions&) {
+          owner_decoder_ = &decoder;
+          owner_callbacks_ = &callbacks;
+          return &owner_cancellable_;
+        }));
+    handle_ = pool_->newStream(decoder_, callbacks_, {false, true});
+    EXPECT_NE(nullptr, handle_);
+    EXPECT_FALSE(pool_->isIdle());
+    run();
+    ASSERT_NE(nullptr, owner_callbacks_);
+  }
+
+  // Makes the stream ready, and returns the encoder of the stream on the worker thread.
+  RequestEncoder& ready() {
+    RequestEncoder* encoder{};
+    EXPECT_CALL(callbacks_, onPoolReady(_, _, _, _))
+        .WillOnce(Invoke([&](RequestEncoder& ready_encoder, Upstream::HostDescriptionConstSharedPtr,
+                             StreamInfo::StreamInfo&, absl::optional<Protocol> protocol) {
+          EXPECT_EQ(Protocol::Http2, protocol);
+          encoder = &ready_encoder;
+        }));
+    owner_callbacks_->onPoolReady(owner_encoder_, host_, stream_info_, Protocol::Http2);
+    run();
+    EXPECT_NE(nullptr, encoder);
+    return *encoder;
+  }
+
+  Api::ApiPtr api_;
+  Event::DispatcherPtr worker_dispatcher_;
+  Event::DispatcherPtr owner_dispatcher_;
+  std::shared_ptr<NiceMock<Upstream::MockClusterInfo>> cluster_{
+      new NiceMock<Upstream::MockClusterInfo>()};
+  Upstream::HostConstSharedPtr host_;
+  NiceMock<ConnectionPool::MockInstance> owner_pool_mock_;
+  ConnectionPool::Instance* owner_pool_{&owner_pool_mock_};
+  SharedConnPoolThreadSharedPtr worker_;
+  SharedConnPoolThreadSharedPtr owner_;
+  std::unique_ptr<SharedConnPoolImpl> pool_;
+
+  NiceMock<MockResponseDecoder> decoder_;
+  NiceMock<ConnectionPool::MockCallbacks> callbacks_;
+  ConnectionPool::Cancellable* handle_{};
+  ResponseDecoder* owner_decoder_{};
+  ConnectionPool::Callbacks* owner_callbacks_{};
+  NiceMock<Envoy::ConnectionPool::MockCancellable> owner_cancellable_;
+  NiceMock<MockRequestEncoder> owner_encoder_;
+  NiceMock<StreamInfo::MockStreamInfo> stream_info_;
+};
+
+TEST_F(SharedConnPoolTest, RequestAndResponse) {
+  newStream();
+  RequestEncoder& encoder = ready();
+
+  // The request is encoded on the owner thread.
+  TestRequestHeaderMapImpl request_headers{
+      {":method", "GET"}, {":path", "/"}, {":scheme", "http"}, {":authority", "host"}};
+  EXPECT_TRUE(encoder.encodeHeaders(request_headers, false).ok());
+  Buffer::OwnedImpl request_body("hello");
+  encoder.encodeData(request_body, true);
+  EXPECT_EQ(0, request_body.length());
+  EXPECT_CALL(owner_encoder_, encodeHeaders(HeaderMapEqualRef(&request_headers), false))
+      .WillOnce(Return(okStatus()));
+  EXPECT_CALL(owner_encoder_, encodeData(BufferStringEqual("hello"), true));
+  run();
+
+  // The response is decoded on the worker thread.
+  owner_decoder_->decodeHeaders(
+      ResponseHeaderMapPtr{new TestResponseHeaderMapImpl{{":status", "200"}}}, false);
+  Buffer::OwnedImpl response_body("world");
+  owner_decoder_->decodeData(response_body, true);
+  EXPECT_CALL(decoder_, decodeHeaders_(_, false));
+  EXPECT_CALL(decoder_, decodeData(BufferStringEqual("world"), true));
+  run();
+
+  // The stream is complete on both threads.
+  EXPECT_TRUE(pool_->isIdle());
+}
+
+TEST_F(SharedConnPoolTest, InvalidRequestHeaders) {
+  newStream();
+  RequestEncoder& encoder = ready();
+
+  // The headers are validated on the worker thread, as the codec would.
+  TestRequestHeaderMapImpl request_headers{{":path", "/"}};
+  EXPECT_FALSE(encoder.encodeHeaders(request_headers, true).ok());
+  EXPECT_CALL(owner_encoder_, encodeHeaders(_, _)).Times(0);
+  run();
+}
+
+TEST_F(SharedConnPoolTest, PoolFailure) {
+  newStream();
+  owner_callbacks_->onPoolFailure(ConnectionPool::PoolFailureReason::RemoteConnectionFailure,
+                                  "connection refused", host_);
+  EXPECT_CALL(callbacks_, onPoolFailure(ConnectionPool::PoolFailureReason::RemoteConnectionFailure,
+                                        "connection refused", _));
+  run();
+  EXPECT_TRUE(pool_->isIdle());
+}
+
+TEST_F(SharedConnPoolTest, NoOwnerPool) {
+  owner_pool_ = nullptr;
+  pool_->newStream(decoder_, callbacks_, {false, true});
+  EXPECT_CALL(callbacks_,
+              onPoolFailure(ConnectionPool::PoolFailureReason::LocalConnectionFailure, _, _));
+  run();
+  EXPECT_TRUE(pool_->isIdle());
+}
+
+TEST_F(SharedConnPoolTest, CancelPendingStream) {
+  newStream();
+  handle_->cancel(Envoy::ConnectionPool::CancelPolicy::Default);
+  EXPECT_TRUE(pool_->isIdle());
+  EXPECT_CALL(owner_cancellable_, cancel(Envoy::ConnectionPool::CancelPolicy::Default));
+  run();
+}
+
+TEST_F(SharedConnPoolTest, ResetFromWorker) {
+  newStream();
+  RequestEncoder& encoder = ready();
+
+  NiceMock<MockStreamCallbacks> stream_callbacks;
+  encoder.getStream().addCallbacks(stream_callbacks);
+  EXPECT_CALL(stream_callbacks, onResetStream(StreamResetReason::LocalReset, _));
+  encoder.getStream().resetStream(StreamResetReason::LocalReset);
+  EXPECT_TRUE(pool_->isIdle());
+  EXPECT_CALL(owner_encoder_.stream_, resetStream(StreamResetReason::LocalReset));
+  run();
+}
+
+TEST_F(SharedConnPoolTest, ResetFromOwner) {
+  newStream();
+  RequestEncoder& encoder = ready();
+
+  NiceMock<MockStreamCallbacks> stream_callbacks;
+  encoder.getStream().addCallbacks(stream_callbacks);
+  owner_encoder_.stream_.resetStream(StreamResetReason::RemoteReset);
+  EXPECT_CALL(stream_callbacks, onResetStream(StreamResetReason::RemoteReset, _));
+  run();
+  EXPECT_TRUE(pool_->isIdle());
+}
+
+TEST_F(SharedConnPoolTest, OwnerShutdown) {
+  newStream();
+  RequestEncoder& encoder = ready();
+
+  NiceMock<MockStreamCallbacks> stream_callbacks;
+  encoder.getStream().addCallbacks(stream_callbacks);
+  EXPECT_CALL(owner_encoder_.stream_, resetStream(_));
+  owner_->shutdown();
+  EXPECT_CALL(stream_callbacks, onResetStream(StreamResetReason::ConnectionTermination, _));
+  run();
+  EXPECT_TRUE(pool_->isIdle());
+
+  // Streams can no longer be handed off.
+  EXPECT_CALL(callbacks_,
+              onPoolFailure(ConnectionPool::PoolFailureReason::LocalConnectionFailure, _, _));
+  EXPECT_EQ(nullptr, pool_->newStream(decoder_, callbacks_, {false, true}));
+}
+
+TEST_F(SharedConnPoolTest, DestroyPoolWithActiveStream) {
+  newStream();
+  RequestEncoder& encoder = ready();
+
+  NiceMock<MockStreamCallbacks> stream_callbacks;
+  encoder.getStream().addCallbacks(stream_callbacks);
+  EXPECT_CALL(stream_callbacks, onResetStream(StreamResetReason::ConnectionTermination, _));
+  pool_.reset();
+  EXPECT_CALL(owner_encoder_.stream_, resetStream(StreamResetReason::ConnectionTermination));
+  run();
+}
+
+TEST_F(SharedConnPoolTest, DrainAndDelete) {
+  bool idle = false;
+  pool_->addIdleCallback([&idle]() { idle = true; });
+  newStream();
+  pool_->drainConnections(Envoy::ConnectionPool::DrainBehavior::DrainAndDelete);
+  EXPECT_FALSE(idle);
+  owner_callbacks_->onPoolFailure(ConnectionPool::PoolFailureReason::Timeout, "", host_);
+  run();
+  EXPECT_TRUE(idle);
+}
+
+class SharedConnPoolRegistryTest : public Event::TestUsingSimulatedTime, public testing::Test {
+public:
+  SharedConnPoolRegistryTest() : dispatcher_(api_->allocateDispatcher("test_thread")) {
+    for (uint32_t i = 0; i < 4; ++i) {
+      threads_.push_back(std::make_shared<SharedConnPoolThread>(*dispatcher_, nullptr));
+    }
+  }
+
+  Api::ApiPtr api_{Api::createApiForTest()};
+  Event::DispatcherPtr dispatcher_;
+  std::vector<SharedConnPoolThreadSharedPtr> threads_;
+  std::shared_ptr<NiceMock<Upstream::MockClusterInfo>> cluster_{
+      new NiceMock<Upstream::MockClusterInfo>()};
+};
+
+TEST_F(SharedConnPoolRegistryTest, Owners) {
+  SharedConnPoolRegistry registry(4);
+  for (uint32_t i = 0; i < 3; ++i) {
+    registry.add(*threads_[i]);
+    EXPECT_EQ(i, threads_[i]->index());
+  }
+  Upstream::HostConstSharedPtr host =
+      Upstream::makeTestHost(cluster_, "tcp://127.0.0.1:80", simTime());
+
+  // Connections are only shared once all worker threads registered.
+  EXPECT_EQ(nullptr, registry.owner(*host, 2, *threads_[0]));
+  registry.add(*threads_[3]);
+
+  // Two threads own the connections to the host, and each other thread hands off to one of them.
+  uint32_t owners = 0;
+  for (const auto& thread : threads_) {
+    SharedConnPoolThreadSharedPtr owner = registry.owner(*host, 2, *thread);
+    if (owner == nullptr) {
+      ++owners;
+      continue;
+    }
+    EXPECT_NE(thread, owner);
+    EXPECT_EQ(nullptr, registry.owner(*host, 2, *owner));
+  }
+  EXPECT_EQ(2, owners);
+
+  // More owners than threads make every thread an owner.
+  for (const auto& thread : threads_) {
+    EXPECT_EQ(nullptr, registry.owner(*host, 8, *thread));
+  }
+
+  // Connections are no longer shared once a worker thread goes away.
+  registry.remove(*threads_[1]);
+  for (const auto& thread : threads_) {
+    EXPECT_EQ(nullptr, registry.owner(*host, 1, *thread));
+  }
+}
+
+} // namespace
+} // namespace Http
+} // namespace Envoy
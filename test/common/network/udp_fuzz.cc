@@ -39,6 +39,7 @@ public:
   ~FuzzUdpListenerCallbacks() override = default;
   void onData(Network::UdpRecvData&& data) override;
   void onReadReady() override;
+  void onReadBatchComplete(uint32_t num_packets_read) override;
   void onWriteReady(const Network::Socket& socket) override;
   void onReceiveError(Api::IoError::IoErrorCode error_code) override;
   void onDataWorker(Network::UdpRecvData&& data) override;
@@ -156,6 +157,10 @@ void FuzzUdpListenerCallbacks::onData(Network::UdpRecvData&& data) {
 
 void FuzzUdpListenerCallbacks::onReadReady() {}
 
+void FuzzUdpListenerCallbacks::onReadBatchComplete(uint32_t num_packets_read) {
+  UNREFERENCED_PARAMETER(num_packets_read);
+}
+
 void FuzzUdpListenerCallbacks::onWriteReady(const Network::Socket& socket) {
   UNREFERENCED_PARAMETER(socket);
 }
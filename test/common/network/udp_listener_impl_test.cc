@@ -143,6 +143,34 @@ TEST_P(UdpListenerImplTest, UseActualDstUdp) {
   dispatcher_->run(Event::Dispatcher::RunType::Block);
 }
 
+/**
+ * Tests that each read event is closed out with the number of datagrams it delivered.
+ */
+TEST_P(UdpListenerImplTest, ReadBatchCompleteReportsPacketsRead) {
+  setup();
+
+  client_.write("first", *send_to_addr_);
+  client_.write("second", *send_to_addr_);
+
+  uint32_t packets_delivered = 0;
+  uint32_t packets_reported = 0;
+  EXPECT_CALL(listener_callbacks_, onReadReady()).Times(testing::AtLeast(1));
+  EXPECT_CALL(listener_callbacks_, onData(_))
+      .Times(2)
+      .WillRepeatedly(Invoke([&](const UdpRecvData&) -> void { ++packets_delivered; }));
+  EXPECT_CALL(listener_callbacks_, onReadBatchComplete(_))
+      .WillRepeatedly(Invoke([&](uint32_t num_packets_read) -> void {
+        packets_reported += num_packets_read;
+        EXPECT_EQ(packets_delivered, packets_reported);
+        if (packets_reported == 2) {
+          dispatcher_->exit();
+        }
+      }));
+
+  dispatcher_->run(Event::Dispatcher::RunType::Block);
+  EXPECT_EQ(2, packets_reported);
+}
+
 // Test a large datagram that gets dropped using recvmsg or recvmmsg if supported.
 TEST_P(UdpListenerImplTest, LargeDatagramRecvmmsg) {
   setup();
@@ -4933,6 +4933,80 @@ TEST_P(RouterShadowingTest, BufferingShadow) {
   EXPECT_TRUE(verifyHostUpstreamStats(1, 0));
 }
 
+// Every shadow policy must observe its own copy of the request as it was before routing, even
+// though the snapshot is taken once and handed to the last policy without another copy.
+TEST_P(RouterShadowingTest, ShadowSnapshotSharedAcrossPolicies) {
+  const std::vector<std::string> clusters{"foo", "fizz", "bar"};
+  for (const auto& cluster : clusters) {
+    callbacks_.route_->route_entry_.shadow_policies_.push_back(makeShadowPolicy(cluster));
+  }
+  ON_CALL(callbacks_, streamId()).WillByDefault(Return(43));
+
+  NiceMock<Http::MockRequestEncoder> encoder;
+  Http::ResponseDecoder* response_decoder = nullptr;
+  expectNewStreamWithImmediateEncoder(encoder, &response_decoder, Http::Protocol::Http10);
+  expectResponseTimerCreate();
+  EXPECT_CALL(runtime_.snapshot_,
+              featureEnabled(_, testing::Matcher<const envoy::type::v3::FractionalPercent&>(_), _))
+      .WillRepeatedly(Return(true));
+
+  std::vector<const Http::RequestHeaderMap*> seen_headers;
+  std::vector<const Http::RequestTrailerMap*> seen_trailers;
+  std::vector<Http::RequestHeaderMapPtr> owned_headers;
+  std::vector<Http::RequestMessagePtr> owned_requests;
+  std::vector<std::unique_ptr<NiceMock<Http::MockAsyncClient>>> clients;
+  std::vector<std::unique_ptr<NiceMock<Http::MockAsyncClientOngoingRequest>>> requests;
+  for (const auto& cluster : clusters) {
+    if (streaming_shadow_) {
+      clients.push_back(std::make_unique<NiceMock<Http::MockAsyncClient>>());
+      requests.push_back(
+          std::make_unique<NiceMock<Http::MockAsyncClientOngoingRequest>>(clients.back().get()));
+      auto* request = requests.back().get();
+      EXPECT_CALL(*shadow_writer_, streamingShadow_(cluster, _, _))
+          .WillOnce(Invoke([&, request](const std::string&, Http::RequestHeaderMapPtr& headers,
+                                        const Http::AsyncClient::RequestOptions&) {
+            EXPECT_FALSE(headers->get(Http::LowerCaseString("x-snapshot")).empty());
+            seen_headers.push_back(headers.get());
+            owned_headers.push_back(std::move(headers));
+            return request;
+          }));
+      EXPECT_CALL(*request, captureAndSendTrailers_(Http::HeaderValueOf("some", "trailer")))
+          .WillOnce(Invoke([&](Http::RequestTrailerMap& trailers) {
+            seen_trailers.push_back(&trailers);
+          }));
+    } else {
+      EXPECT_CALL(*shadow_writer_, shadow_(cluster, _, _))
+          .WillOnce(Invoke([&](const std::string&, Http::RequestMessagePtr& request,
+                               const Http::AsyncClient::RequestOptions&) -> void {
+            EXPECT_FALSE(request->headers().get(Http::LowerCaseString("x-snapshot")).empty());
+            ASSERT_NE(nullptr, request->trailers());
+            seen_headers.push_back(&request->headers());
+            seen_trailers.push_back(request->trailers());
+            owned_requests.push_back(std::move(request));
+          }));
+    }
+  }
+
+  Http::TestRequestHeaderMapImpl headers{{"x-snapshot", "1"}};
+  HttpTestUtility::addDefaultHeaders(headers);
+  router_->decodeHeaders(headers, false);
+  // Mutations after the snapshot must not leak into the shadows.
+  headers.remove(Http::LowerCaseString("x-snapshot"));
+
+  Buffer::OwnedImpl body("hello");
+  EXPECT_CALL(callbacks_, decodingBuffer()).WillRepeatedly(Return(&body));
+  router_->decodeData(body, false);
+  Http::TestRequestTrailerMapImpl trailers{{"some", "trailer"}};
+  router_->decodeTrailers(trailers);
+
+  EXPECT_EQ(clusters.size(), seen_headers.size());
+  EXPECT_EQ(clusters.size(), seen_trailers.size());
+
+  Http::ResponseHeaderMapPtr response_headers(
+      new Http::TestResponseHeaderMapImpl{{":status", "200"}});
+  response_decoder->decodeHeaders(std::move(response_headers), true);
+}
+
 TEST_P(RouterShadowingTest, NoShadowForConnect) {
   ShadowPolicyPtr policy = makeShadowPolicy("foo");
   callbacks_.route_->route_entry_.shadow_policies_.push_back(policy);
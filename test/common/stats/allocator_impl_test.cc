@@ -10,6 +10,7 @@
 #include "test/test_common/logging.h"
 #include "test/test_common/thread_factory_for_test.h"
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/synchronization/notification.h"
 #include "gmock/gmock-matchers.h"
 #include "gtest/gtest.h"
@@ -154,6 +155,27 @@ TEST_F(AllocatorImplTest, HiddenGauge) {
   EXPECT_FALSE(never_import_hidden_gauge->hidden());
 }
 
+TEST_F(AllocatorImplTest, GaugeLatchChanged) {
+  GaugeSharedPtr gauge =
+      alloc_.makeGauge(makeStat("gauge"), StatName(), {}, Gauge::ImportMode::Accumulate);
+  // New gauges are reported as changed once.
+  EXPECT_TRUE(gauge->latchChanged());
+  EXPECT_FALSE(gauge->latchChanged());
+
+  gauge->set(5);
+  EXPECT_TRUE(gauge->latchChanged());
+  EXPECT_FALSE(gauge->latchChanged());
+  gauge->sub(2);
+  EXPECT_TRUE(gauge->latchChanged());
+  gauge->inc();
+  gauge->dec();
+  EXPECT_TRUE(gauge->latchChanged());
+  gauge->setParentValue(10);
+  EXPECT_TRUE(gauge->latchChanged());
+  EXPECT_FALSE(gauge->latchChanged());
+  EXPECT_TRUE(gauge->used());
+}
+
 TEST_F(AllocatorImplTest, ForEachCounter) {
   StatNameHashSet stat_names;
   std::vector<CounterSharedPtr> counters;
@@ -626,6 +648,61 @@ TEST_F(AllocatorImplTest, ForEachSinkedTextReadout) {
   EXPECT_EQ(num_iterations, 0);
 }
 
+TEST_F(AllocatorImplTest, ForEachFamilyMemory) {
+  auto family_memory = [this]() {
+    absl::flat_hash_map<std::string, StatFamilyMemory> families;
+    alloc_.forEachFamilyMemory([this, &families](StatName name, const StatFamilyMemory& memory) {
+      families[symbol_table_.toString(name)] = memory;
+    });
+    return families;
+  };
+
+  const StatName cluster_tag = makeStat("envoy.cluster_name");
+  const StatName rq_total = makeStat("cluster.upstream_rq_total");
+  const StatName cx_active = makeStat("cluster.upstream_cx_active");
+  CounterSharedPtr c1 = alloc_.makeCounter(makeStat("cluster.c1.upstream_rq_total"), rq_total,
+                                           {{cluster_tag, makeStat("c1")}});
+  CounterSharedPtr c2 = alloc_.makeCounter(makeStat("cluster.c2.upstream_rq_total"), rq_total,
+                                           {{cluster_tag, makeStat("c2")}});
+  GaugeSharedPtr g1 =
+      alloc_.makeGauge(makeStat("cluster.c1.upstream_cx_active"), cx_active,
+                       {{cluster_tag, makeStat("c1")}}, Gauge::ImportMode::Accumulate);
+  TextReadoutSharedPtr t1 = alloc_.makeTextReadout(makeStat("version"), makeStat("version"), {});
+
+  auto families = family_memory();
+  ASSERT_EQ(3, families.size());
+  const StatFamilyMemory counters = families["cluster.upstream_rq_total"];
+  EXPECT_EQ(2, counters.counters_);
+  EXPECT_EQ(0, counters.gauges_);
+  // Each stat holds at least its object and its name, tag-extracted name and tag.
+  EXPECT_LT(2 * (sizeof(Counter) + c1->statName().size() + rq_total.size()), counters.bytes_);
+  EXPECT_EQ(1, families["cluster.upstream_cx_active"].gauges_);
+  EXPECT_EQ(1, families["version"].text_readouts_);
+
+  // Requesting an existing stat does not count it twice.
+  CounterSharedPtr c1_again = alloc_.makeCounter(c1->statName(), rq_total, {});
+  EXPECT_EQ(2, family_memory()["cluster.upstream_rq_total"].counters_);
+
+  // Families shrink as their stats are freed, and are dropped with the last one.
+  const uint64_t two_counter_bytes = counters.bytes_;
+  c2.reset();
+  families = family_memory();
+  EXPECT_EQ(1, families["cluster.upstream_rq_total"].counters_);
+  EXPECT_GT(two_counter_bytes, families["cluster.upstream_rq_total"].bytes_);
+  g1.reset();
+  t1.reset();
+  families = family_memory();
+  EXPECT_EQ(1, families.size());
+  EXPECT_EQ(1, families.count("cluster.upstream_rq_total"));
+
+  // Stats marked for deletion hold their memory until they are freed.
+  alloc_.markCounterForDeletion(c1);
+  c1.reset();
+  c1_again.reset();
+  are_stats_marked_for_deletion_ = true;
+  EXPECT_EQ(1, family_memory()["cluster.upstream_rq_total"].counters_);
+}
+
 } // namespace
 } // namespace Stats
 } // namespace Envoy
@@ -0,0 +1,171 @@
+#include "envoy/config/metrics/v3/stats.pb.h"
+
+#include "source/common/stats/heavy_hitter_impl.h"
+
+#include "test/mocks/server/server_factory_context.h"
+#include "test/test_common/utility.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::NiceMock;
+using testing::Pair;
+using testing::UnorderedElementsAre;
+
+namespace Envoy {
+namespace Stats {
+
+class HeavyHitterStatsImplTest : public testing::Test {
+public:
+  HeavyHitterStatsImplTest() : pool_(symbol_table_) {}
+
+  void initialize(uint32_t top_k, uint32_t width = 1024) {
+    envoy::config::metrics::v3::StatsConfig config;
+    auto& heavy_hitter = *config.add_heavy_hitter_stats();
+    heavy_hitter.mutable_match()->set_prefix("host.");
+    heavy_hitter.set_name("host.total");
+    heavy_hitter.mutable_top_k()->set_value(top_k);
+    heavy_hitter.mutable_count_min_width()->set_value(width);
+    stats_ = std::make_unique<HeavyHitterStatsImpl>(config, symbol_table_, context_);
+  }
+
+  Counter* findCounter(absl::string_view name) { return stats_->findCounter(pool_.add(name)); }
+
+  absl::flat_hash_map<std::string, uint64_t> reported() {
+    absl::flat_hash_map<std::string, uint64_t> counters;
+    stats_->forEachCounter([&counters](absl::string_view name, PrimitiveCounter& counter) {
+      counters[std::string(name)] = counter.value();
+    });
+    return counters;
+  }
+
+  NiceMock<Server::Configuration::MockServerFactoryContext> context_;
+  SymbolTableImpl symbol_table_;
+  StatNamePool pool_;
+  std::unique_ptr<HeavyHitterStatsImpl> stats_;
+};
+
+// Counters outside the configured families are allocated as usual.
+TEST_F(HeavyHitterStatsImplTest, NotMatching) {
+  initialize(2);
+  EXPECT_EQ(nullptr, findCounter("cluster.foo.upstream_rq"));
+  Counter* counter = findCounter("host.a.rq");
+  ASSERT_NE(nullptr, counter);
+  EXPECT_TRUE(counter->hidden());
+  // Handles are shared by the members of a bucket, so they carry the family name.
+  EXPECT_EQ("host.total", counter->name());
+  EXPECT_EQ(counter, findCounter("host.a.rq"));
+}
+
+// While there are free slots, every member is reported with its exact count.
+TEST_F(HeavyHitterStatsImplTest, FreeSlots) {
+  initialize(2);
+  Counter* a = findCounter("host.a.rq");
+  Counter* b = findCounter("host.b.rq");
+  a->add(10);
+  a->inc();
+  b->add(5);
+  EXPECT_EQ(11, a->value());
+  EXPECT_EQ(5, b->value());
+  EXPECT_TRUE(a->used());
+  EXPECT_THAT(reported(),
+              UnorderedElementsAre(Pair("host.a.rq", 11), Pair("host.b.rq", 5),
+                                   Pair("host.total", 16)));
+}
+
+// A member is admitted when it is looked up and its bucket exceeds the smallest
+// slot, and the evicted member's bucket keeps an upper bound on its count.
+TEST_F(HeavyHitterStatsImplTest, Eviction) {
+  initialize(2);
+  Counter* a = findCounter("host.a.rq");
+  Counter* b = findCounter("host.b.rq");
+  Counter* c = findCounter("host.c.rq");
+  a->add(10);
+  b->add(5);
+  c->inc();
+  EXPECT_EQ(1, c->value());
+  EXPECT_THAT(reported(),
+              UnorderedElementsAre(Pair("host.a.rq", 10), Pair("host.b.rq", 5),
+                                   Pair("host.total", 16)));
+
+  // c overtakes b, but is only admitted once its name is seen again.
+  c->add(10);
+  EXPECT_EQ(3, reported().size());
+  EXPECT_EQ(c, findCounter("host.c.rq"));
+  EXPECT_THAT(reported(),
+              UnorderedElementsAre(Pair("host.a.rq", 10), Pair("host.c.rq", 11),
+                                   Pair("host.total", 26)));
+  EXPECT_EQ(5, b->value());
+
+  // Increments to the evicted member are not lost from its bucket.
+  b->add(2);
+  EXPECT_EQ(7, b->value());
+  EXPECT_EQ(28, reported()["host.total"]);
+}
+
+// Members hashed into the same bucket share its handle, and are counted
+// together under the name of the member holding the bucket's slot.
+TEST_F(HeavyHitterStatsImplTest, SharedBucket) {
+  // With 4 buckets, host.b.rq and host.c.rq share a bucket.
+  initialize(1, 4);
+  Counter* b = findCounter("host.b.rq");
+  Counter* c = findCounter("host.c.rq");
+  EXPECT_EQ(b, c);
+  b->add(2);
+  c->add(3);
+  EXPECT_EQ(5, b->value());
+  EXPECT_THAT(reported(), UnorderedElementsAre(Pair("host.b.rq", 5), Pair("host.total", 5)));
+}
+
+// The number of handles and reported names does not grow with the family.
+TEST_F(HeavyHitterStatsImplTest, BoundedMemory) {
+  initialize(2, 16);
+  absl::flat_hash_set<Counter*> handles;
+  for (int i = 0; i < 1000; ++i) {
+    Counter* counter = findCounter(absl::StrCat("host.", i, ".rq"));
+    counter->inc();
+    handles.insert(counter);
+  }
+  EXPECT_LE(handles.size(), 16);
+  auto counters = reported();
+  EXPECT_EQ(3, counters.size());
+  EXPECT_EQ(1000, counters["host.total"]);
+}
+
+// Primitive counters, such as per-host counters, are added by name.
+TEST_F(HeavyHitterStatsImplTest, PrimitiveCounters) {
+  initialize(1);
+  EXPECT_FALSE(stats_->addPrimitiveCounter("cluster.foo.upstream_rq", 3));
+  EXPECT_TRUE(stats_->addPrimitiveCounter("host.x.rq", 3));
+  EXPECT_TRUE(stats_->addPrimitiveCounter("host.y.rq", 2));
+  EXPECT_THAT(reported(), UnorderedElementsAre(Pair("host.x.rq", 3), Pair("host.total", 5)));
+
+  // host.y.rq is admitted once its count exceeds the slot's.
+  EXPECT_TRUE(stats_->addPrimitiveCounter("host.y.rq", 5));
+  EXPECT_THAT(reported(), UnorderedElementsAre(Pair("host.y.rq", 7), Pair("host.total", 10)));
+  EXPECT_TRUE(stats_->addPrimitiveCounter("host.y.rq", 1));
+  EXPECT_THAT(reported(), UnorderedElementsAre(Pair("host.y.rq", 8), Pair("host.total", 11)));
+}
+
+// Only the increments since the previous latch are reported as deltas.
+TEST_F(HeavyHitterStatsImplTest, Latch) {
+  initialize(1);
+  Counter* a = findCounter("host.a.rq");
+  a->add(3);
+  auto latch = [this]() {
+    absl::flat_hash_map<std::string, uint64_t> deltas;
+    stats_->forEachCounter([&deltas](absl::string_view name, PrimitiveCounter& counter) {
+      deltas[std::string(name)] = counter.latch();
+    });
+    return deltas;
+  };
+  EXPECT_THAT(latch(), UnorderedElementsAre(Pair("host.a.rq", 3), Pair("host.total", 3)));
+  a->inc();
+  EXPECT_THAT(latch(), UnorderedElementsAre(Pair("host.a.rq", 1), Pair("host.total", 1)));
+}
+
+} // namespace Stats
+} // namespace Envoy
@@ -0,0 +1,90 @@
+#include <vector>
+
+#include "envoy/stats/primitive_stats.h"
+
+#include "test/test_common/thread_factory_for_test.h"
+
+#include "absl/synchronization/notification.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Stats {
+namespace {
+
+TEST(PrimitiveGaugeTest, Basic) {
+  PrimitiveGauge gauge;
+  gauge.inc();
+  gauge.add(5);
+  gauge.dec();
+  EXPECT_EQ(5, gauge.value());
+  gauge.set(2);
+  EXPECT_EQ(2, gauge.value());
+  gauge.sub(2);
+  EXPECT_EQ(0, gauge.value());
+}
+
+TEST(ShardedPrimitiveGaugeTest, NotSharded) {
+  ShardedPrimitiveGauge gauge;
+  gauge.inc();
+  gauge.add(5);
+  gauge.dec();
+  EXPECT_EQ(5, gauge.value());
+  // Without shards, the exported gauge is the gauge's own storage.
+  PrimitiveGauge& latched = gauge.latch();
+  gauge.sub(1);
+  EXPECT_EQ(4, latched.value());
+}
+
+TEST(ShardedPrimitiveGaugeTest, Sharded) {
+  ShardedPrimitiveGauge gauge;
+  gauge.add(2);
+  gauge.enableSharding();
+  EXPECT_EQ(2, gauge.value());
+  gauge.inc();
+  gauge.add(5);
+  gauge.dec();
+  gauge.sub(2);
+  EXPECT_EQ(5, gauge.value());
+  EXPECT_EQ(5, gauge.latch().value());
+  gauge.set(2);
+  EXPECT_EQ(2, gauge.value());
+  gauge.add(3);
+  EXPECT_EQ(5, gauge.value());
+  gauge.sub(5);
+  EXPECT_EQ(0, gauge.value());
+  EXPECT_EQ(0, gauge.latch().value());
+}
+
+// Threads decrement what other threads incremented, which leaves the shards of some threads
+// negative, but not the sum of the shards.
+TEST(ShardedPrimitiveGaugeTest, AcrossThreads) {
+  ShardedPrimitiveGauge gauge;
+  gauge.enableSharding();
+  Thread::ThreadFactory& thread_factory = Thread::threadFactoryForTest();
+
+  const uint32_t num_threads = 2 * ShardedPrimitiveGauge::NumShards;
+  const uint32_t iters = 10000;
+  std::vector<Thread::ThreadPtr> threads;
+  absl::Notification go;
+  for (uint32_t i = 0; i < num_threads; ++i) {
+    threads.push_back(thread_factory.createThread([&, i]() {
+      go.WaitForNotification();
+      for (uint32_t j = 0; j < iters; ++j) {
+        if (i % 2 == 0) {
+          gauge.add(2);
+        } else {
+          gauge.sub(1);
+        }
+      }
+    }));
+  }
+  go.Notify();
+  for (uint32_t i = 0; i < num_threads; ++i) {
+    threads[i]->join();
+  }
+  EXPECT_EQ(num_threads / 2 * iters, gauge.value());
+}
+
+} // namespace
+} // namespace Stats
+} // namespace Envoy
@@ -624,6 +624,31 @@ TEST_F(StatNameTest, MutexContentionOnExistingSymbols) {
   }
 }
 
+// Races encodes, which may re-reference a symbol whose count just dropped to
+// zero, against frees of the same tokens, and checks nothing is leaked.
+TEST_F(StatNameTest, RacingEncodeAndFree) {
+  Thread::ThreadFactory& thread_factory = Thread::threadFactoryForTest();
+  constexpr int num_threads = 16;
+  std::vector<Thread::ThreadPtr> threads;
+  threads.reserve(num_threads);
+  ConditionalInitializer start;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.push_back(thread_factory.createThread([this, i, &start]() {
+      start.wait();
+      for (int count = 0; count < 1000; ++count) {
+        const std::string name = absl::StrCat("shared.token", (i + count) % 4);
+        StatNameManagedStorage storage(name, table_);
+        EXPECT_EQ(name, table_.toString(storage.statName()));
+      }
+    }));
+  }
+  start.setReady();
+  for (auto& thread : threads) {
+    thread->join();
+  }
+  EXPECT_EQ(0, table_.numSymbols());
+}
+
 TEST_F(StatNameTest, SharedStatNameStorageSetInsertAndFind) {
   StatNameStorageSet set;
   const int iters = 10;
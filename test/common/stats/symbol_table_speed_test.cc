@@ -213,3 +213,49 @@ static void bmSetStrings(benchmark::State& state) {
   }
 }
 BENCHMARK(bmSetStrings);
+
+// Measures contention when many threads encode, decode and compare names whose
+// symbols already exist, which is the common case once a server has warmed up.
+// NOLINTNEXTLINE(readability-identifier-naming)
+static void bmExistingSymbolsRace(benchmark::State& state) {
+  Envoy::Thread::ThreadFactory& thread_factory = Envoy::Thread::threadFactoryForTest();
+  const int num_threads = state.range(0);
+  Envoy::Stats::SymbolTableImpl table;
+  Envoy::Stats::StatNamePool pool(table);
+  const std::vector<Envoy::Stats::StatName> names = prepareNames(pool, 64);
+  std::vector<std::string> strings;
+  strings.reserve(names.size());
+  for (Envoy::Stats::StatName name : names) {
+    strings.emplace_back(table.toString(name));
+  }
+
+  for (auto _ : state) {
+    UNREFERENCED_PARAMETER(_);
+    std::vector<Envoy::Thread::ThreadPtr> threads;
+    threads.reserve(num_threads);
+    Envoy::ConditionalInitializer access;
+    absl::BlockingCounter accesses(num_threads);
+    for (int i = 0; i < num_threads; ++i) {
+      threads.push_back(thread_factory.createThread(
+          [&access, &accesses, &table, &strings, &names, i]() {
+            access.wait();
+            for (uint32_t count = 0; count < 1000; ++count) {
+              const uint32_t index = (i + count) % strings.size();
+              // NOLINTNEXTLINE(clang-analyzer-unix.Malloc)
+              Envoy::Stats::StatNameStorage storage(strings[index], table);
+              Envoy::Stats::StatName stat_name = storage.statName();
+              benchmark::DoNotOptimize(table.toString(stat_name));
+              benchmark::DoNotOptimize(table.lessThan(stat_name, names[count % names.size()]));
+              storage.free(table);
+            }
+            accesses.DecrementCount();
+          }));
+    }
+    access.setReady();
+    accesses.Wait();
+    for (auto& thread : threads) {
+      thread->join();
+    }
+  }
+}
+BENCHMARK(bmExistingSymbolsRace)->Arg(1)->Arg(4)->Arg(16)->Arg(64)->Unit(::benchmark::kMillisecond);
@@ -46,6 +46,7 @@
 #include "source/common/config/well_known_names.h"
 #include "source/common/stats/tag_producer_impl.h"
 
+#include "absl/strings/str_cat.h"
 #include "benchmark/benchmark.h"
 
 namespace Envoy {
@@ -108,6 +109,42 @@ void BM_ExtractTags(benchmark::State& state) {
 }
 BENCHMARK(BM_ExtractTags)->DenseRange(0, 26, 1);
 
+// Extracts the tags of the stats created for a batch of new clusters, as happens when a large
+// CDS update adds clusters. Every name is distinct, so nothing can be cached across names.
+// NOLINTNEXTLINE(readability-identifier-naming)
+void BM_ExtractTagsClusterChurn(benchmark::State& state) {
+  const Stats::TagVector tags;
+  auto tag_extractors =
+      TagProducerImpl::createTagProducer(envoy::config::metrics::v3::StatsConfig(), tags).value();
+  const std::vector<absl::string_view> suffixes = {"upstream_cx_total",
+                                                   "upstream_rq_total",
+                                                   "upstream_rq_2xx",
+                                                   "upstream_rq_503",
+                                                   "upstream_rq_timeout",
+                                                   "lb_healthy_panic",
+                                                   "ssl.ciphers.AES256-SHA",
+                                                   "ssl.versions.TLSv1.3",
+                                                   "membership_healthy",
+                                                   "health_check.attempt",
+                                                   "outlier_detection.ejections_active"};
+  std::vector<std::string> names;
+  for (int64_t cluster = 0; cluster < state.range(0); ++cluster) {
+    for (absl::string_view suffix : suffixes) {
+      names.push_back(absl::StrCat("cluster.service_", cluster, ".", suffix));
+    }
+  }
+
+  for (auto _ : state) {
+    UNREFERENCED_PARAMETER(_);
+    for (const std::string& name : names) {
+      TagVector tags;
+      tag_extractors->produceTags(name, tags);
+      RELEASE_ASSERT(!tags.empty(), name);
+    }
+  }
+}
+BENCHMARK(BM_ExtractTagsClusterChurn)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
 } // namespace
 } // namespace Stats
 } // namespace Envoy
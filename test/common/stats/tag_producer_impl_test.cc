@@ -158,6 +158,31 @@ TEST_F(TagProducerTest, FixedTags) {
                     }));
 }
 
+// The default extractors are screened by a single regex set. Extractors that are not part of
+// the set still run, and tags are produced in extractor order.
+TEST_F(TagProducerTest, RegexSetKeepsExtractionOrder) {
+  addSpecifier("custom", "\\.(custom_([a-z]+)\\.)");
+  auto producer = TagProducerImpl::createTagProducer(stats_config_, {}).value();
+
+  TagVector tags;
+  EXPECT_EQ("listener.http.downstream_rq",
+            producer->produceTags(
+                "listener.127.0.0.1_3012.http.http_prefix.custom_foo.downstream_rq_503", tags));
+  checkTags(
+      TagVector{
+          {tag_name_values_.RESPONSE_CODE, "503"},
+          {"custom", "foo"},
+          {tag_name_values_.HTTP_CONN_MANAGER_PREFIX, "http_prefix"},
+          {tag_name_values_.LISTENER_ADDRESS, "127.0.0.1_3012"},
+      },
+      tags);
+
+  // No default regex matches this name, only the configured one.
+  tags.clear();
+  EXPECT_EQ("foo.bar", producer->produceTags("foo.custom_baz.bar", tags));
+  checkTags(TagVector{{"custom", "baz"}}, tags);
+}
+
 TEST(UtilityTest, createTagProducer) {
   envoy::config::bootstrap::v3::Bootstrap bootstrap;
   auto producer = TagProducerImpl::createTagProducer(bootstrap.stats_config(), {}).value();
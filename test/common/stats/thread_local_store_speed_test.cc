@@ -66,6 +66,26 @@ public:
     store_.initializeThreading(*dispatcher_, *tls_);
   }
 
+  // Records a value into the given percentage of the histograms.
+  void recordHistograms(uint32_t percent_active) {
+    Stats::Scope& scope = *store_.rootScope();
+    for (size_t i = 0; i < stat_names_.size(); ++i) {
+      Stats::Histogram& histogram = scope.histogramFromStatName(
+          stat_names_[i]->statName(), Stats::Histogram::Unit::Unspecified);
+      if (i % 100 < percent_active) {
+        histogram.recordValue(i);
+      }
+    }
+  }
+
+  void mergeHistograms() {
+    bool merged = false;
+    store_.mergeHistograms([&merged]() { merged = true; });
+    while (!merged) {
+      dispatcher_->run(Event::Dispatcher::RunType::NonBlock);
+    }
+  }
+
   void initPrefixRejections(const std::string& prefix) {
     stats_config_.mutable_stats_matcher()->mutable_exclusion_list()->add_patterns()->set_prefix(
         prefix);
@@ -140,3 +160,23 @@ BENCHMARK(BM_StatsWithTlsAndRejectionsWithoutDot);
 
 // TODO(jmarantz): add multi-threaded variant of this test, that aggressively
 // looks up stats in multiple threads to try to trigger contention issues.
+
+// Tests the cost of merging histograms on flush when only some of them have
+// recorded samples since the previous merge.
+// NOLINTNEXTLINE(readability-identifier-naming)
+static void BM_HistogramMerge(benchmark::State& state) {
+  Envoy::ThreadLocalStorePerf context;
+  context.initThreading();
+  const uint32_t percent_active = state.range(0);
+  // Record into every histogram once, so all of them have been merged before.
+  context.recordHistograms(100);
+  context.mergeHistograms();
+
+  for (auto _ : state) { // NOLINT
+    state.PauseTiming();
+    context.recordHistograms(percent_active);
+    state.ResumeTiming();
+    context.mergeHistograms();
+  }
+}
+BENCHMARK(BM_HistogramMerge)->Arg(0)->Arg(10)->Arg(100);
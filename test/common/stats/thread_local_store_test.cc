@@ -12,6 +12,7 @@
 #include "source/common/event/dispatcher_impl.h"
 #include "source/common/memory/stats.h"
 #include "source/common/runtime/runtime_impl.h"
+#include "source/common/stats/heavy_hitter_impl.h"
 #include "source/common/stats/histogram_impl.h"
 #include "source/common/stats/stats_matcher_impl.h"
 #include "source/common/stats/symbol_table.h"
@@ -29,6 +30,7 @@
 #include "test/test_common/logging.h"
 #include "test/test_common/utility.h"
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_split.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -556,6 +558,82 @@ TEST_F(StatsThreadLocalStoreTest, ForEach) {
               UnorderedElementsAreArray({"scope1.tr1", "scope1.scope2.tr2"}));
 }
 
+TEST_F(StatsThreadLocalStoreTest, ForEachFamilyMemory) {
+  // Histogram families are reported separately from the allocator's, so merge
+  // the two when collecting.
+  auto collect = [this]() {
+    absl::flat_hash_map<std::string, StatFamilyMemory> families;
+    store_->forEachFamilyMemory([this, &families](StatName name, const StatFamilyMemory& memory) {
+      StatFamilyMemory& family = families[symbol_table_.toString(name)];
+      family.counters_ += memory.counters_;
+      family.gauges_ += memory.gauges_;
+      family.histograms_ += memory.histograms_;
+      family.bytes_ += memory.bytes_;
+    });
+    return families;
+  };
+
+  ScopeSharedPtr scope = store_->createScope("scope");
+  scope->counterFromString("counter");
+  scope->gaugeFromString("gauge", Gauge::ImportMode::Accumulate);
+  scope->histogramFromString("histogram", Histogram::Unit::Unspecified);
+  auto families = collect();
+  EXPECT_EQ(1, families["scope.counter"].counters_);
+  EXPECT_EQ(1, families["scope.gauge"].gauges_);
+  EXPECT_EQ(1, families["scope.histogram"].histograms_);
+  EXPECT_LT(sizeof(ParentHistogramImpl), families["scope.histogram"].bytes_);
+
+  // Deleting the scope frees its stats, and their families go with them.
+  scope.reset();
+  EXPECT_THAT(collect(), testing::IsEmpty());
+}
+
+TEST_F(StatsThreadLocalStoreTest, HeavyHitterCounters) {
+  envoy::config::metrics::v3::StatsConfig stats_config;
+  auto& heavy_hitter = *stats_config.add_heavy_hitter_stats();
+  heavy_hitter.mutable_match()->set_prefix("vhost.");
+  heavy_hitter.set_name("vhost.total");
+  heavy_hitter.mutable_top_k()->set_value(1);
+  store_->setHeavyHitterStats(
+      std::make_unique<HeavyHitterStatsImpl>(stats_config, symbol_table_, context_));
+
+  Counter& hot = scope_.counterFromString("vhost.a.rq");
+  Counter& cold = scope_.counterFromString("vhost.b.rq");
+  Counter& other = scope_.counterFromString("other");
+  hot.add(5);
+  cold.inc();
+  other.inc();
+
+  // Sketched counters are not allocated, and are hidden from scope iteration.
+  EXPECT_EQ(nullptr, TestUtility::findCounter(*store_, "vhost.a.rq"));
+  EXPECT_NE(nullptr, TestUtility::findCounter(*store_, "other"));
+  EXPECT_TRUE(cold.hidden());
+  EXPECT_EQ(5, hot.value());
+  // Sketched counters are not cached; every lookup goes back to the sketch.
+  EXPECT_EQ(&hot, &scope_.counterFromString("vhost.a.rq"));
+  EXPECT_EQ(5, hot.value());
+
+  // Only the top counter and the family total are reported.
+  std::vector<std::pair<std::string, uint64_t>> reported;
+  store_->forEachHeavyHitterCounter([&reported](PrimitiveCounterSnapshot&& metric) {
+    reported.emplace_back(metric.name(), metric.value());
+  });
+  EXPECT_THAT(reported, UnorderedElementsAre(testing::Pair("vhost.a.rq", 5),
+                                             testing::Pair("vhost.total", 6)));
+
+  // Primitive counters, such as per-host counters, are added to the same sketches and may evict
+  // a scope counter.
+  EXPECT_FALSE(store_->addHeavyHitterCounter("other_primitive", 10));
+  EXPECT_TRUE(store_->addHeavyHitterCounter("vhost.c.rq", 10));
+  reported.clear();
+  store_->forEachHeavyHitterCounter([&reported](PrimitiveCounterSnapshot&& metric) {
+    reported.emplace_back(metric.name(), metric.value());
+  });
+  EXPECT_THAT(reported, UnorderedElementsAre(testing::Pair("vhost.c.rq", 10),
+                                             testing::Pair("vhost.total", 16)));
+  EXPECT_EQ(5, hot.value());
+}
+
 // Validate that we sanitize away bad characters in the stats prefix.
 TEST_F(StatsThreadLocalStoreTest, SanitizePrefix) {
   InSequence s;
@@ -1689,6 +1767,28 @@ TEST_F(HistogramTest, MultiHistogramMultipleMerges) {
   EXPECT_EQ(2, validateMerge());
 }
 
+TEST_F(HistogramTest, IdleHistogramMerges) {
+  Histogram& h1 = scope_.histogramFromString("h1", Histogram::Unit::Unspecified);
+  expectCallAndAccumulate(h1, 5);
+  EXPECT_EQ(1, validateMerge());
+  ParentHistogramSharedPtr parent = store_->histograms()[0];
+  EXPECT_EQ(1, parent->intervalStatistics().sampleCount());
+  EXPECT_EQ(1, parent->cumulativeStatistics().sampleCount());
+
+  // Merges without new samples empty the interval but keep the cumulative statistics.
+  EXPECT_EQ(1, validateMerge());
+  EXPECT_EQ(0, parent->intervalStatistics().sampleCount());
+  EXPECT_EQ(1, parent->cumulativeStatistics().sampleCount());
+  EXPECT_EQ(1, validateMerge());
+  EXPECT_EQ(0, parent->intervalStatistics().sampleCount());
+  EXPECT_EQ(1, parent->cumulativeStatistics().sampleCount());
+
+  expectCallAndAccumulate(h1, 7);
+  EXPECT_EQ(1, validateMerge());
+  EXPECT_EQ(1, parent->intervalStatistics().sampleCount());
+  EXPECT_EQ(2, parent->cumulativeStatistics().sampleCount());
+}
+
 TEST_F(HistogramTest, BasicScopeHistogramMerge) {
   ScopeSharedPtr scope1 = store_->createScope("scope1.");
 
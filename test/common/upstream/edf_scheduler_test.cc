@@ -9,6 +9,14 @@ namespace Upstream {
 
 class EdfSchedulerTest : public testing::Test {
 public:
+  template <typename T> static size_t queueSize(const EdfScheduler<T>& scheduler) {
+    return scheduler.queue_.size();
+  }
+
+  template <typename T> static size_t removedSize(const EdfScheduler<T>& scheduler) {
+    return scheduler.removed_.size();
+  }
+
   template <typename T>
   static void compareEdfSchedulers(EdfScheduler<T>& scheduler1, EdfScheduler<T>& scheduler2) {
     // Compares that the given EdfSchedulers internal queues are equal up
@@ -175,6 +183,109 @@ TEST_F(EdfSchedulerTest, ManyPeekahead) {
   }
 }
 
+// Validate that removed entries are no longer picked.
+TEST_F(EdfSchedulerTest, Removed) {
+  EdfScheduler<uint32_t> sched;
+  constexpr uint32_t num_entries = 4;
+  std::shared_ptr<uint32_t> entries[num_entries];
+
+  for (uint32_t i = 0; i < num_entries; ++i) {
+    entries[i] = std::make_shared<uint32_t>(i);
+    sched.add(1, entries[i]);
+  }
+  sched.remove(entries[1]);
+  sched.remove(entries[2]);
+
+  for (uint32_t rounds = 0; rounds < 4; ++rounds) {
+    EXPECT_EQ(0, *sched.pickAndAdd([](const double&) { return 1; }));
+    EXPECT_EQ(3, *sched.pickAndAdd([](const double&) { return 1; }));
+  }
+  // Removals are consumed once the removed entries are dropped from the queue.
+  EXPECT_EQ(0, removedSize(sched));
+  EXPECT_EQ(2, queueSize(sched));
+}
+
+// Validate that removed entries are not picked after being peeked.
+TEST_F(EdfSchedulerTest, RemovedPeekedIsNotPicked) {
+  EdfScheduler<uint32_t> sched;
+  auto first_entry = std::make_shared<uint32_t>(37);
+  auto second_entry = std::make_shared<uint32_t>(42);
+  sched.add(2, first_entry);
+  sched.add(1, second_entry);
+
+  EXPECT_EQ(37, *sched.peekAgain([](const double&) { return 1; }));
+  sched.remove(first_entry);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(42, *sched.pickAndAdd([](const double&) { return 1; }));
+  }
+}
+
+// Validate that adding a removed entry back cancels its removal rather than queueing it twice.
+TEST_F(EdfSchedulerTest, RemoveThenAdd) {
+  EdfScheduler<uint32_t> sched;
+  auto first_entry = std::make_shared<uint32_t>(37);
+  auto second_entry = std::make_shared<uint32_t>(42);
+  sched.add(1, first_entry);
+  sched.add(1, second_entry);
+
+  sched.remove(first_entry);
+  sched.add(1, first_entry);
+  EXPECT_EQ(0, removedSize(sched));
+  EXPECT_EQ(2, queueSize(sched));
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(37, *sched.pickAndAdd([](const double&) { return 1; }));
+    EXPECT_EQ(42, *sched.pickAndAdd([](const double&) { return 1; }));
+  }
+}
+
+// Validate that removing all entries empties the scheduler, and that new entries are scheduled
+// after the deadlines already reached.
+TEST_F(EdfSchedulerTest, RemoveAllThenAdd) {
+  EdfScheduler<uint32_t> sched;
+  auto first_entry = std::make_shared<uint32_t>(37);
+  sched.add(1, first_entry);
+  EXPECT_EQ(37, *sched.pickAndAdd([](const double&) { return 1; }));
+
+  sched.remove(first_entry);
+  EXPECT_EQ(nullptr, sched.peekAgain([](const double&) { return 1; }));
+  EXPECT_EQ(nullptr, sched.pickAndAdd([](const double&) { return 1; }));
+
+  auto second_entry = std::make_shared<uint32_t>(42);
+  sched.add(1, second_entry);
+  EXPECT_EQ(42, *sched.pickAndAdd([](const double&) { return 1; }));
+}
+
+// Validate that removals of entries that expire before being dropped are eventually purged.
+TEST_F(EdfSchedulerTest, RemovedExpired) {
+  EdfScheduler<uint32_t> sched;
+  auto entry = std::make_shared<uint32_t>(37);
+  // Allocated up front, so that it cannot reuse the address of an expired entry.
+  auto removed_entry = std::make_shared<uint32_t>(42);
+  sched.add(1, entry);
+  for (uint32_t i = 0; i < 2; ++i) {
+    auto expired_entry = std::make_shared<uint32_t>(i);
+    sched.add(1, expired_entry);
+    sched.remove(expired_entry);
+  }
+  EXPECT_EQ(2, removedSize(sched));
+
+  // Dropping the expired entries from the queue does not consume their removals.
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(37, *sched.pickAndAdd([](const double&) { return 1; }));
+  }
+  EXPECT_EQ(1, queueSize(sched));
+  EXPECT_EQ(2, removedSize(sched));
+
+  // Once the removals outnumber the queued entries, the expired ones are purged.
+  sched.add(1, removed_entry);
+  sched.remove(removed_entry);
+  EXPECT_EQ(1, removedSize(sched));
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(37, *sched.pickAndAdd([](const double&) { return 1; }));
+  }
+  EXPECT_EQ(0, removedSize(sched));
+}
+
 // Validates that creating a scheduler using the createWithPicks (with 0 picks)
 // is equal to creating an empty scheduler and adding entries one after the other.
 TEST_F(EdfSchedulerTest, SchedulerWithZeroPicksEqualToEmptyWithAddedEntries) {
@@ -4337,6 +4337,55 @@ TEST_F(TcpHealthCheckerImplTest, Success) {
   read_filter_->onData(response, false);
 }
 
+// Tests that the session timers are scheduled on the timer wheel when timer_wheel_tick is set.
+TEST_F(TcpHealthCheckerImplTest, TimerWheel) {
+  // The only timer created on the dispatcher is the one that drives the wheel.
+  auto* wheel_timer = new Event::MockTimer(&dispatcher_);
+  allocHealthChecker(R"EOF(
+    timeout: 1s
+    interval: 1s
+    no_traffic_interval: 2s
+    unhealthy_threshold: 2
+    healthy_threshold: 2
+    timer_wheel_tick: 0.1s
+    tcp_health_check:
+      send:
+        text: "01"
+      receive:
+      - text: "02"
+    )EOF");
+  cluster_->prioritySet().getMockHostSet(0)->hosts_ = {
+      makeTestHost(cluster_->info_, "tcp://127.0.0.1:80", simTime())};
+  auto enable_wheel_timer = [wheel_timer](std::chrono::microseconds, const ScopeTrackedObject*) {
+    wheel_timer->enabled_ = true;
+  };
+
+  expectClientCreate();
+  EXPECT_CALL(*connection_, write(_, _));
+  EXPECT_CALL(*wheel_timer, enableHRTimer(std::chrono::microseconds(std::chrono::seconds(1)), _))
+      .WillOnce(Invoke(enable_wheel_timer));
+  health_checker_->start();
+  connection_->raiseEvent(Network::ConnectionEvent::Connected);
+
+  // The timeout is disabled, which empties the wheel, and the interval is rounded up to the next
+  // tick of the wheel.
+  EXPECT_CALL(*wheel_timer, disableTimer());
+  EXPECT_CALL(*wheel_timer,
+              enableHRTimer(std::chrono::microseconds(std::chrono::milliseconds(2050)), _))
+      .WillOnce(Invoke(enable_wheel_timer));
+  simTime().advanceTimeWait(std::chrono::milliseconds(50));
+  Buffer::OwnedImpl response;
+  addUint8(response, 2);
+  read_filter_->onData(response, false);
+
+  // The interval fires on the wheel and starts the next check, which arms the timeout.
+  simTime().advanceTimeWait(std::chrono::milliseconds(2050));
+  EXPECT_CALL(*connection_, write(_, _));
+  EXPECT_CALL(*wheel_timer, enableHRTimer(std::chrono::microseconds(std::chrono::seconds(1)), _))
+      .WillOnce(Invoke(enable_wheel_timer));
+  wheel_timer->invokeCallback();
+}
+
 // Tests that a successful healthcheck will disconnect the client when reuse_connection is false.
 TEST_F(TcpHealthCheckerImplTest, DataWithoutReusingConnection) {
   InSequence s;
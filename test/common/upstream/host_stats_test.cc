@@ -30,6 +30,20 @@ TEST(HostStatsTest, GaugesSortedByName) {
   }
 }
 
+// Verify that a sharded rq_active is exported with the sum of its shards.
+TEST(HostStatsTest, ShardedRqActiveGauge) {
+  HostStats host_stats;
+  host_stats.rq_active_.inc();
+  host_stats.rq_active_.enableSharding();
+  host_stats.rq_active_.add(2);
+
+  for (const auto& [name, gauge] : host_stats.gauges()) {
+    if (name == "rq_active") {
+      EXPECT_EQ(3, gauge.get().value());
+    }
+  }
+}
+
 } // namespace
 } // namespace Upstream
 } // namespace Envoy
@@ -434,6 +434,24 @@ TEST_F(PerEndpointMetricsTest, FixedTags) {
               }));
 }
 
+// Counters of heavy-hitter families are added to the sketches of the store and are not reported
+// individually.
+TEST_F(PerEndpointMetricsTest, HeavyHitterCounters) {
+  auto& cluster = makeCluster("cluster1", 1);
+  EXPECT_CALL(cluster.info_->stats_store_,
+              addHeavyHitterCounter("cluster.cluster1.endpoint.127.0.0.1_80.c1", 11))
+      .WillOnce(Return(true));
+  EXPECT_CALL(cluster.info_->stats_store_,
+              addHeavyHitterCounter("cluster.cluster1.endpoint.127.0.0.1_80.c2", 12))
+      .WillOnce(Return(false));
+
+  auto [counters, gauges] = run();
+
+  EXPECT_THAT(metricNames(counters),
+              UnorderedElementsAreArray({"cluster.cluster1.endpoint.127.0.0.1_80.c2"}));
+  EXPECT_EQ(3, gauges.size());
+}
+
 // Only clusters with the setting enabled produce metrics.
 TEST_F(PerEndpointMetricsTest, Enabled) {
   auto& disabled = makeCluster("disabled", 1);
@@ -1648,6 +1648,295 @@ TEST_F(OutlierDetectorImplTest, BasicFlowFailurePercentageLocalOrigin) {
                     DetectorHostMonitor::SuccessRateMonitorType::LocalOrigin));
 }
 
+TEST_F(OutlierDetectorImplTest, BatchedFlowSuccessRateExternalOrigin) {
+  ON_CALL(runtime_.snapshot_, getInteger(MaxEjectionPercentRuntime, _)).WillByDefault(Return(100));
+  EXPECT_CALL(cluster_.prioritySet(), addMemberUpdateCb(_));
+  addHosts({
+      "tcp://127.0.0.1:80",
+      "tcp://127.0.0.1:81",
+      "tcp://127.0.0.1:82",
+      "tcp://127.0.0.1:83",
+      "tcp://127.0.0.1:84",
+  });
+
+  envoy::config::cluster::v3::OutlierDetection outlier_detection;
+  outlier_detection.set_batched_evaluation(true);
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000), _));
+  std::shared_ptr<DetectorImpl> detector(DetectorImpl::create(cluster_, outlier_detection,
+                                                              dispatcher_, runtime_, time_system_,
+                                                              event_logger_, random_)
+                                             .value());
+  detector->addChangedStateCb([&](HostSharedPtr host) -> void { checker_.check(host); });
+  ASSERT_NE(nullptr, detector->batchedResultCounters());
+
+  // Turn off 5xx detection to test SR detection in isolation.
+  ON_CALL(runtime_.snapshot_, featureEnabled(EnforcingConsecutive5xxRuntime, 100))
+      .WillByDefault(Return(false));
+  ON_CALL(runtime_.snapshot_, featureEnabled(EnforcingConsecutiveGatewayFailureRuntime, 100))
+      .WillByDefault(Return(false));
+  EXPECT_CALL(*event_logger_, logEject(std::static_pointer_cast<const HostDescription>(hosts_[4]),
+                                       _, envoy::data::cluster::v3::CONSECUTIVE_5XX, false))
+      .Times(40);
+  EXPECT_CALL(*event_logger_,
+              logEject(std::static_pointer_cast<const HostDescription>(hosts_[4]), _,
+                       envoy::data::cluster::v3::CONSECUTIVE_GATEWAY_FAILURE, false))
+      .Times(40);
+
+  // Cause a SR error on one host. First have 4 of the hosts have perfect SR.
+  loadRq(hosts_, 200, 200);
+  loadRq(hosts_[4], 200, 503);
+
+  time_system_.setMonotonicTime(std::chrono::milliseconds(10000));
+  EXPECT_CALL(checker_, check(hosts_[4]));
+  EXPECT_CALL(*event_logger_, logEject(std::static_pointer_cast<const HostDescription>(hosts_[4]),
+                                       _, envoy::data::cluster::v3::SUCCESS_RATE, true));
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000), _));
+  ON_CALL(runtime_.snapshot_, getInteger(SuccessRateStdevFactorRuntime, 1900))
+      .WillByDefault(Return(1900));
+  interval_timer_->invokeCallback();
+  EXPECT_EQ(100, hosts_[0]->outlierDetector().successRate(
+                     DetectorHostMonitor::SuccessRateMonitorType::ExternalOrigin));
+  EXPECT_EQ(50, hosts_[4]->outlierDetector().successRate(
+                    DetectorHostMonitor::SuccessRateMonitorType::ExternalOrigin));
+  EXPECT_EQ(90, detector->successRateAverage(
+                    DetectorHostMonitor::SuccessRateMonitorType::ExternalOrigin));
+  EXPECT_EQ(52, detector->successRateEjectionThreshold(
+                    DetectorHostMonitor::SuccessRateMonitorType::ExternalOrigin));
+  // Make sure that local origin success rate monitor is not affected
+  EXPECT_EQ(-1, hosts_[4]->outlierDetector().successRate(
+                    DetectorHostMonitor::SuccessRateMonitorType::LocalOrigin));
+  EXPECT_EQ(-1,
+            detector->successRateAverage(DetectorHostMonitor::SuccessRateMonitorType::LocalOrigin));
+  EXPECT_TRUE(hosts_[4]->healthFlagGet(Host::HealthFlag::FAILED_OUTLIER_CHECK));
+  EXPECT_EQ(1UL, outlier_detection_ejections_active_.value());
+
+  // The counts are flushed at each interval, and the ejected host is not evaluated.
+  loadRq(hosts_, 200, 200);
+  time_system_.setMonotonicTime(std::chrono::milliseconds(19999));
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000), _));
+  interval_timer_->invokeCallback();
+  EXPECT_TRUE(hosts_[4]->healthFlagGet(Host::HealthFlag::FAILED_OUTLIER_CHECK));
+  EXPECT_EQ(1UL, outlier_detection_ejections_active_.value());
+  EXPECT_EQ(100, hosts_[0]->outlierDetector().successRate(
+                     DetectorHostMonitor::SuccessRateMonitorType::ExternalOrigin));
+  EXPECT_EQ(-1, hosts_[4]->outlierDetector().successRate(
+                    DetectorHostMonitor::SuccessRateMonitorType::ExternalOrigin));
+  // Only 4 hosts have enough request volume.
+  EXPECT_EQ(-1, detector->successRateAverage(
+                    DetectorHostMonitor::SuccessRateMonitorType::ExternalOrigin));
+
+  // An interval without requests resets the success rates.
+  time_system_.setMonotonicTime(std::chrono::milliseconds(29999));
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000), _));
+  interval_timer_->invokeCallback();
+  EXPECT_EQ(-1, hosts_[0]->outlierDetector().successRate(
+                    DetectorHostMonitor::SuccessRateMonitorType::ExternalOrigin));
+}
+
+TEST_F(OutlierDetectorImplTest, BatchedFlowFailurePercentageLocalOrigin) {
+  ON_CALL(runtime_.snapshot_, getInteger(MaxEjectionPercentRuntime, _)).WillByDefault(Return(100));
+  EXPECT_CALL(cluster_.prioritySet(), addMemberUpdateCb(_));
+  addHosts({
+      "tcp://127.0.0.1:80",
+      "tcp://127.0.0.1:81",
+      "tcp://127.0.0.1:82",
+      "tcp://127.0.0.1:83",
+      "tcp://127.0.0.1:84",
+  });
+
+  outlier_detection_split_.set_batched_evaluation(true);
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000), _));
+  std::shared_ptr<DetectorImpl> detector(DetectorImpl::create(cluster_, outlier_detection_split_,
+                                                              dispatcher_, runtime_, time_system_,
+                                                              event_logger_, random_)
+                                             .value());
+  detector->addChangedStateCb([&](HostSharedPtr host) -> void { checker_.check(host); });
+
+  // Turn off 5xx detection and SR detection to test failure percentage detection in isolation.
+  ON_CALL(runtime_.snapshot_, featureEnabled(EnforcingConsecutiveLocalOriginFailureRuntime, 100))
+      .WillByDefault(Return(false));
+  ON_CALL(runtime_.snapshot_, featureEnabled(EnforcingLocalOriginSuccessRateRuntime, 100))
+      .WillByDefault(Return(false));
+  // Now turn on failure percentage detection.
+  ON_CALL(runtime_.snapshot_, featureEnabled(EnforcingFailurePercentageLocalOriginRuntime, 0))
+      .WillByDefault(Return(true));
+  EXPECT_CALL(*event_logger_,
+              logEject(std::static_pointer_cast<const HostDescription>(hosts_[4]), _,
+                       envoy::data::cluster::v3::CONSECUTIVE_LOCAL_ORIGIN_FAILURE, false))
+      .Times(40);
+  loadRq(hosts_, 200, Result::LocalOriginConnectSuccess);
+  loadRq(hosts_[4], 200, Result::LocalOriginConnectFailed);
+
+  time_system_.setMonotonicTime(std::chrono::milliseconds(10000));
+  EXPECT_CALL(checker_, check(hosts_[4]));
+  EXPECT_CALL(*event_logger_,
+              logEject(std::static_pointer_cast<const HostDescription>(hosts_[4]), _,
+                       envoy::data::cluster::v3::FAILURE_PERCENTAGE_LOCAL_ORIGIN, true));
+  EXPECT_CALL(*event_logger_,
+              logEject(std::static_pointer_cast<const HostDescription>(hosts_[4]), _,
+                       envoy::data::cluster::v3::SUCCESS_RATE_LOCAL_ORIGIN, false));
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000), _));
+  ON_CALL(runtime_.snapshot_, getInteger(FailurePercentageThresholdRuntime, 85))
+      .WillByDefault(Return(40));
+  interval_timer_->invokeCallback();
+  EXPECT_EQ(50, hosts_[4]->outlierDetector().successRate(
+                    DetectorHostMonitor::SuccessRateMonitorType::LocalOrigin));
+  EXPECT_EQ(90,
+            detector->successRateAverage(DetectorHostMonitor::SuccessRateMonitorType::LocalOrigin));
+  EXPECT_EQ(52, detector->successRateEjectionThreshold(
+                    DetectorHostMonitor::SuccessRateMonitorType::LocalOrigin));
+  // Make sure that external origin success rate monitor is not affected
+  EXPECT_EQ(-1, hosts_[4]->outlierDetector().successRate(
+                    DetectorHostMonitor::SuccessRateMonitorType::ExternalOrigin));
+  EXPECT_EQ(-1, detector->successRateAverage(
+                    DetectorHostMonitor::SuccessRateMonitorType::ExternalOrigin));
+  EXPECT_TRUE(hosts_[4]->healthFlagGet(Host::HealthFlag::FAILED_OUTLIER_CHECK));
+  EXPECT_EQ(1UL, outlier_detection_ejections_active_.value());
+}
+
+// Test verifies that, as with the per-host accumulators, a host ejected for success rate is still
+// evaluated for failure percentage in the same interval.
+TEST_F(OutlierDetectorImplTest, BatchedSuccessRateAndFailurePercentageDetected) {
+  ON_CALL(runtime_.snapshot_, getInteger(MaxEjectionPercentRuntime, _)).WillByDefault(Return(100));
+  EXPECT_CALL(cluster_.prioritySet(), addMemberUpdateCb(_));
+  addHosts({
+      "tcp://127.0.0.1:80",
+      "tcp://127.0.0.1:81",
+      "tcp://127.0.0.1:82",
+      "tcp://127.0.0.1:83",
+      "tcp://127.0.0.1:84",
+  });
+
+  envoy::config::cluster::v3::OutlierDetection outlier_detection;
+  outlier_detection.set_batched_evaluation(true);
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000), _));
+  std::shared_ptr<DetectorImpl> detector(DetectorImpl::create(cluster_, outlier_detection,
+                                                              dispatcher_, runtime_, time_system_,
+                                                              event_logger_, random_)
+                                             .value());
+  detector->addChangedStateCb([&](HostSharedPtr host) -> void { checker_.check(host); });
+
+  ON_CALL(runtime_.snapshot_, featureEnabled(EnforcingConsecutive5xxRuntime, 100))
+      .WillByDefault(Return(false));
+  ON_CALL(runtime_.snapshot_, featureEnabled(EnforcingConsecutiveGatewayFailureRuntime, 100))
+      .WillByDefault(Return(false));
+  EXPECT_CALL(*event_logger_, logEject(std::static_pointer_cast<const HostDescription>(hosts_[4]),
+                                       _, envoy::data::cluster::v3::CONSECUTIVE_5XX, false))
+      .Times(40);
+  EXPECT_CALL(*event_logger_,
+              logEject(std::static_pointer_cast<const HostDescription>(hosts_[4]), _,
+                       envoy::data::cluster::v3::CONSECUTIVE_GATEWAY_FAILURE, false))
+      .Times(40);
+
+  loadRq(hosts_, 200, 200);
+  loadRq(hosts_[4], 200, 503);
+
+  time_system_.setMonotonicTime(std::chrono::milliseconds(10000));
+  EXPECT_CALL(checker_, check(hosts_[4]));
+  EXPECT_CALL(*event_logger_, logEject(std::static_pointer_cast<const HostDescription>(hosts_[4]),
+                                       _, envoy::data::cluster::v3::SUCCESS_RATE, true));
+  // Failure percentage ejection is detected but not enforced by default.
+  EXPECT_CALL(*event_logger_, logEject(std::static_pointer_cast<const HostDescription>(hosts_[4]),
+                                       _, envoy::data::cluster::v3::FAILURE_PERCENTAGE, false));
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000), _));
+  interval_timer_->invokeCallback();
+  EXPECT_TRUE(hosts_[4]->healthFlagGet(Host::HealthFlag::FAILED_OUTLIER_CHECK));
+  EXPECT_EQ(1UL, outlier_detection_ejections_active_.value());
+  EXPECT_EQ(1UL, cluster_.info_->stats_store_
+                     .counter("outlier_detection.ejections_detected_success_rate")
+                     .value());
+  EXPECT_EQ(1UL, cluster_.info_->stats_store_
+                     .counter("outlier_detection.ejections_detected_failure_percentage")
+                     .value());
+}
+
+// Test verifies that the slot of a removed host is only reused after an interval, and that the
+// results still reported for the removed host are not counted.
+TEST_F(OutlierDetectorImplTest, BatchedRemoveAndAddHost) {
+  EXPECT_CALL(cluster_.prioritySet(), addMemberUpdateCb(_));
+  addHosts({"tcp://127.0.0.1:80", "tcp://127.0.0.1:81"});
+  envoy::config::cluster::v3::OutlierDetection outlier_detection;
+  outlier_detection.set_batched_evaluation(true);
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000), _));
+  std::shared_ptr<DetectorImpl> detector(DetectorImpl::create(cluster_, outlier_detection,
+                                                              dispatcher_, runtime_, time_system_,
+                                                              event_logger_, random_)
+                                             .value());
+  const uint32_t removed_slot = detector->getHostMonitors().find(hosts_[1])->second->batchedSlot();
+
+  HostSharedPtr removed_host = hosts_[1];
+  hosts_.pop_back();
+  cluster_.prioritySet().getMockHostSet(0)->runCallbacks({}, {removed_host});
+  EXPECT_EQ(-1, removed_host->outlierDetector().successRate(
+                    DetectorHostMonitor::SuccessRateMonitorType::ExternalOrigin));
+  loadRq(removed_host, 100, 200);
+
+  // The slot is not reused before the next interval.
+  addHosts({"tcp://127.0.0.1:82"});
+  cluster_.prioritySet().getMockHostSet(0)->runCallbacks({hosts_[1]}, {});
+  EXPECT_NE(removed_slot, detector->getHostMonitors().find(hosts_[1])->second->batchedSlot());
+
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000), _));
+  interval_timer_->invokeCallback();
+
+  addHosts({"tcp://127.0.0.1:83"});
+  cluster_.prioritySet().getMockHostSet(0)->runCallbacks({hosts_[2]}, {});
+  EXPECT_EQ(removed_slot, detector->getHostMonitors().find(hosts_[2])->second->batchedSlot());
+
+  loadRq(removed_host, 100, 200);
+  loadRq(hosts_[2], 10, 200);
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000), _));
+  interval_timer_->invokeCallback();
+  const BatchedResultCounters& results = *detector->batchedResultCounters();
+  EXPECT_EQ(10UL, results.success(DetectorHostMonitor::SuccessRateMonitorType::ExternalOrigin)
+                      [removed_slot]);
+}
+
+TEST(BatchedResultCountersTest, FlushAcrossBlocksAndShards) {
+  auto cluster_info = std::make_shared<NiceMock<MockClusterInfo>>();
+  Event::SimulatedTimeSystem time_system;
+  BatchedResultCounters results;
+  HostVector hosts;
+  for (uint32_t i = 0; i < BatchedResultCounters::SlotsPerBlock + 1; i++) {
+    hosts.push_back(
+        makeTestHost(cluster_info, "tcp://127.0.0.1:" + std::to_string(1000 + i), time_system));
+    EXPECT_EQ(i, results.addHost(hosts.back()));
+  }
+  EXPECT_EQ(2 * BatchedResultCounters::SlotsPerBlock, results.slots());
+  EXPECT_NE(results.block(0), results.block(BatchedResultCounters::SlotsPerBlock));
+
+  const auto external = DetectorHostMonitor::SuccessRateMonitorType::ExternalOrigin;
+  const uint32_t last_slot = BatchedResultCounters::SlotsPerBlock;
+  // Count in every shard, as different threads would.
+  for (BatchedResultCounters::Shard& shard : results.block(last_slot)->shards_) {
+    shard.slots_[0].total_request_counter_[0] += 2;
+    shard.slots_[0].success_request_counter_[0] += 1;
+  }
+  BatchedResultCounters::threadCounters(*results.block(0), 1).total_request_counter_[0]++;
+  hosts[2]->healthFlagSet(Host::HealthFlag::FAILED_OUTLIER_CHECK);
+
+  results.flush();
+  EXPECT_EQ(2 * BatchedResultCounters::NumShards, results.total(external)[last_slot]);
+  EXPECT_EQ(BatchedResultCounters::NumShards, results.success(external)[last_slot]);
+  EXPECT_EQ(1UL, results.total(external)[1]);
+  EXPECT_EQ(0UL, results.success(external)[1]);
+  EXPECT_EQ(1, results.eligible()[1]);
+  EXPECT_EQ(0, results.eligible()[2]);
+  EXPECT_EQ(0, results.eligible()[last_slot + 1]);
+  EXPECT_EQ(-1, results.successRate(external, 1));
+
+  // The counts were moved into the per-slot arrays.
+  results.flush();
+  EXPECT_EQ(0UL, results.total(external)[last_slot]);
+
+  // Released slots are reused after the next flush.
+  results.removeHost(1);
+  EXPECT_EQ(0, results.eligible()[1]);
+  EXPECT_EQ(last_slot + 1, results.addHost(hosts[1]));
+  results.flush();
+  EXPECT_EQ(1, results.addHost(hosts[1]));
+}
+
 TEST_F(OutlierDetectorImplTest, RemoveWhileEjected) {
   ON_CALL(runtime_.snapshot_, getInteger(MaxEjectionPercentRuntime, _)).WillByDefault(Return(100));
   EXPECT_CALL(cluster_.prioritySet(), addMemberUpdateCb(_));
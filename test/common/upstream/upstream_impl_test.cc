@@ -1822,6 +1822,29 @@ TEST_F(HostImplTest, HostCluster) {
   EXPECT_EQ("", host->locality().zone());
 }
 
+// rq_active is only sharded when the runtime guard is enabled.
+TEST_F(HostImplTest, ShardedRqActive) {
+  MockClusterMockPrioritySet cluster;
+  HostSharedPtr host = makeTestHost(cluster.info_, "tcp://10.0.0.1:1234", simTime(), 1);
+  // Without shards, the exported gauge is updated directly.
+  Stats::PrimitiveGauge& exported = host->stats().rq_active_.latch();
+  host->stats().rq_active_.inc();
+  EXPECT_EQ(1, exported.value());
+
+  TestScopedRuntime scoped_runtime;
+  scoped_runtime.mergeValues({{"envoy.reloadable_features.shard_host_rq_active", "true"}});
+  HostSharedPtr sharded_host = makeTestHost(cluster.info_, "tcp://10.0.0.1:1235", simTime(), 1);
+  sharded_host->stats().rq_active_.inc();
+  sharded_host->stats().rq_active_.inc();
+  sharded_host->stats().rq_active_.dec();
+  EXPECT_EQ(1, sharded_host->stats().rq_active_.value());
+  // With shards, the exported gauge holds the value at the time it was latched.
+  Stats::PrimitiveGauge& latched = sharded_host->stats().rq_active_.latch();
+  sharded_host->stats().rq_active_.inc();
+  EXPECT_EQ(1, latched.value());
+  EXPECT_EQ(2, sharded_host->stats().rq_active_.value());
+}
+
 TEST_F(HostImplTest, Weight) {
   MockClusterMockPrioritySet cluster;
 
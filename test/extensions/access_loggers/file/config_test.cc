@@ -6,6 +6,7 @@
 #include "source/common/protobuf/protobuf.h"
 #include "source/extensions/access_loggers/common/file_access_log_impl.h"
 #include "source/extensions/access_loggers/file/config.h"
+#include "source/extensions/access_loggers/file/proto_formatter.h"
 
 #include "test/mocks/server/factory_context.h"
 #include "test/test_common/utility.h"
@@ -225,6 +226,52 @@ TEST_F(FileAccessLogTest, LogFormatJsonWithCustomCommands) {
   }
 }
 
+TEST_F(FileAccessLogTest, ProtoFormat) {
+  envoy::extensions::access_loggers::file::v3::FileAccessLog fal_config;
+  TestUtility::loadFromYaml(R"(
+  path: "/foo"
+  proto_format:
+    additional_request_headers_to_log: ["x-custom"]
+)",
+                            fal_config);
+  envoy::config::accesslog::v3::AccessLog config;
+  config.mutable_typed_config()->PackFrom(fal_config);
+
+  auto file = std::make_shared<AccessLog::MockAccessLogFile>();
+  EXPECT_CALL(context_.server_factory_context_.access_log_manager_, createAccessLog(_))
+      .WillOnce(Return(file));
+  AccessLog::InstanceSharedPtr logger = AccessLog::AccessLogFactory::fromProto(config, context_);
+
+  std::string written;
+  EXPECT_CALL(*file, write(_)).Times(2).WillRepeatedly(Invoke([&written](absl::string_view got) {
+    written.append(got.data(), got.size());
+  }));
+  request_headers_.addCopy(Http::LowerCaseString("x-custom"), "value");
+  stream_info_.setResponseCode(200);
+  logger->log({&request_headers_, &response_headers_, &response_trailers_}, stream_info_);
+  stream_info_.setResponseCode(503);
+  logger->log({&request_headers_, &response_headers_, &response_trailers_}, stream_info_);
+
+  std::vector<envoy::data::accesslog::v3::HTTPAccessLogEntry> entries;
+  EXPECT_TRUE(ProtoFormatter::decode(written,
+                                     [&entries](const auto& entry) { entries.push_back(entry); })
+                  .ok());
+  ASSERT_EQ(2U, entries.size());
+  EXPECT_EQ("/bar/foo", entries[0].request().path());
+  EXPECT_EQ(envoy::config::core::v3::GET, entries[0].request().request_method());
+  EXPECT_EQ("value", entries[0].request().request_headers().at("x-custom"));
+  EXPECT_EQ(200, entries[0].response().response_code().value());
+  EXPECT_EQ(503, entries[1].response().response_code().value());
+
+  // Cutting the file in the middle of an entry keeps the entries before it.
+  entries.clear();
+  const absl::Status status = ProtoFormatter::decode(
+      absl::string_view(written).substr(0, written.size() - 1),
+      [&entries](const auto& entry) { entries.push_back(entry); });
+  EXPECT_EQ(absl::StatusCode::kInvalidArgument, status.code());
+  EXPECT_EQ(1U, entries.size());
+}
+
 } // namespace
 } // namespace File
 } // namespace AccessLoggers
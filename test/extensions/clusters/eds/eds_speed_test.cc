@@ -33,6 +33,7 @@
 #include "test/test_common/test_runtime.h"
 #include "test/test_common/utility.h"
 
+#include "absl/synchronization/mutex.h"
 #include "benchmark/benchmark.h"
 
 using ::benchmark::State;
@@ -43,8 +44,9 @@ namespace Upstream {
 
 class EdsSpeedTest {
 public:
-  EdsSpeedTest(State& state, bool use_unified_mux)
+  EdsSpeedTest(State& state, bool use_unified_mux, bool prepare_off_main_thread = false)
       : state_(state), use_unified_mux_(use_unified_mux),
+        prepare_off_main_thread_(prepare_off_main_thread),
         type_url_("type.googleapis.com/envoy.config.endpoint.v3.ClusterLoadAssignment"),
         subscription_stats_(Config::Utility::generateStats(scope_)),
         async_client_(new Grpc::MockAsyncClient()),
@@ -73,6 +75,16 @@ public:
     } else {
       grpc_mux_ = std::make_shared<Config::GrpcMuxImpl>(grpc_mux_context, true);
     }
+    if (prepare_off_main_thread_) {
+      runtime_.mergeValues(
+          {{"envoy.restart_features.eds_prepare_updates_off_main_thread", "true"}});
+      ON_CALL(server_context_.api_, threadFactory())
+          .WillByDefault(testing::ReturnRef(Thread::threadFactoryForTest()));
+      ON_CALL(server_context_.dispatcher_, post(_)).WillByDefault([this](Event::PostCb cb) {
+        absl::MutexLock lock(&mutex_);
+        posted_.push_back(std::move(cb));
+      });
+    }
     resetCluster(R"EOF(
       name: name
       connect_timeout: 0.25s
@@ -163,15 +175,35 @@ public:
           .grpcStreamForTest()
           .onReceiveMessage(std::move(response));
     }
+    if (prepare_off_main_thread_) {
+      // Only the time spent on the main thread is measured.
+      state_.PauseTiming();
+      std::vector<Event::PostCb> posted;
+      {
+        absl::MutexLock lock(&mutex_);
+        mutex_.Await(absl::Condition(this, &EdsSpeedTest::hasPosted));
+        posted.swap(posted_);
+      }
+      state_.ResumeTiming();
+      for (auto& cb : posted) {
+        cb();
+      }
+    }
     ASSERT(cluster_->prioritySet().hostSetsPerPriority()[1]->hostsPerLocality().get()[0].size() ==
            num_hosts);
   }
 
+  bool hasPosted() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) { return !posted_.empty(); }
+
   NiceMock<Server::Configuration::MockServerFactoryContext> server_context_;
   Stats::TestUtil::TestStore& stats_ = server_context_.store_;
+  TestScopedRuntime runtime_;
 
   State& state_;
   bool use_unified_mux_;
+  bool prepare_off_main_thread_;
+  absl::Mutex mutex_;
+  std::vector<Event::PostCb> posted_ ABSL_GUARDED_BY(mutex_);
   const std::string type_url_;
   uint64_t version_{};
   bool initialized_{};
@@ -245,3 +277,23 @@ static void healthOnlyUpdate(State& state) {
 }
 
 BENCHMARK(healthOnlyUpdate)->Ranges({{1, 100000}, {false, true}})->Unit(benchmark::kMillisecond);
+
+// Measures the time spent on the main thread by a duplicate update that is prepared off the main
+// thread.
+static void duplicateUpdatePreparedOffMainThread(State& state) {
+  Envoy::Thread::MutexBasicLockable lock;
+  Envoy::Logger::Context logging_state(spdlog::level::warn,
+                                       Envoy::Logger::Logger::DEFAULT_LOG_FORMAT, lock, false);
+
+  for (auto _ : state) { // NOLINT: Silences warning about dead store
+    Envoy::Upstream::EdsSpeedTest speed_test(state, state.range(1), true);
+    uint32_t endpoints = skipExpensiveBenchmarks() ? 1 : state.range(0);
+
+    speed_test.priorityAndLocalityWeightedHelper(true, endpoints, true);
+    speed_test.priorityAndLocalityWeightedHelper(true, endpoints, true);
+  }
+}
+
+BENCHMARK(duplicateUpdatePreparedOffMainThread)
+    ->Ranges({{1, 100000}, {false, true}})
+    ->Unit(benchmark::kMillisecond);
@@ -27,12 +27,14 @@
 #include "test/test_common/test_runtime.h"
 #include "test/test_common/utility.h"
 
+#include "absl/synchronization/mutex.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 using testing::_;
 using testing::DoAll;
 using testing::Return;
+using testing::ReturnRef;
 using testing::SaveArg;
 
 namespace Envoy {
@@ -3316,6 +3318,159 @@ TEST_F(EdsCachedAssignmentTest, CachedAssignmentRemovedOnTimeout) {
   EXPECT_CALL(eds_resources_cache_, removeCallback("fare", _));
 }
 
+class EdsPreparedUpdateTest : public EdsTest {
+public:
+  EdsPreparedUpdateTest() {
+    runtime_.mergeValues(
+        {{"envoy.restart_features.eds_prepare_updates_off_main_thread", "true"}});
+    ON_CALL(server_context_.api_, threadFactory())
+        .WillByDefault(ReturnRef(Thread::threadFactoryForTest()));
+    // The pipeline posts the prepared updates back to the main thread. Queue them so that the
+    // test applies them on its own thread.
+    ON_CALL(server_context_.dispatcher_, post(_)).WillByDefault([this](Event::PostCb cb) {
+      absl::MutexLock lock(&mutex_);
+      posted_.push_back(std::move(cb));
+    });
+    resetCluster();
+  }
+
+  // Waits for the given number of prepared updates and applies them.
+  void applyPreparedUpdates(size_t updates) {
+    std::vector<Event::PostCb> posted;
+    {
+      absl::MutexLock lock(&mutex_);
+      expected_posted_ = updates;
+      mutex_.Await(absl::Condition(this, &EdsPreparedUpdateTest::hasExpectedPosted));
+      posted.swap(posted_);
+    }
+    for (auto& cb : posted) {
+      cb();
+    }
+  }
+
+  envoy::config::endpoint::v3::ClusterLoadAssignment
+  makeAssignment(const std::vector<std::string>& addresses) {
+    envoy::config::endpoint::v3::ClusterLoadAssignment cluster_load_assignment;
+    cluster_load_assignment.set_cluster_name("fare");
+    auto* endpoints = cluster_load_assignment.add_endpoints();
+    for (const auto& address : addresses) {
+      auto* socket_address = endpoints->add_lb_endpoints()
+                                 ->mutable_endpoint()
+                                 ->mutable_address()
+                                 ->mutable_socket_address();
+      socket_address->set_address(address);
+      socket_address->set_port_value(80);
+    }
+    return cluster_load_assignment;
+  }
+
+  const HostVector& hosts() { return cluster_->prioritySet().hostSetsPerPriority()[0]->hosts(); }
+
+  TestScopedRuntime runtime_;
+
+private:
+  bool hasExpectedPosted() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return posted_.size() >= expected_posted_;
+  }
+
+  absl::Mutex mutex_;
+  std::vector<Event::PostCb> posted_ ABSL_GUARDED_BY(mutex_);
+  size_t expected_posted_ ABSL_GUARDED_BY(mutex_){};
+};
+
+// Validate that an update is applied once it is prepared, and that unchanged hosts are kept.
+TEST_F(EdsPreparedUpdateTest, UpdateAppliedOncePrepared) {
+  initialize();
+  doOnConfigUpdateVerifyNoThrow(makeAssignment({"1.2.3.4", "1.2.3.5"}));
+  EXPECT_FALSE(initialized_);
+  EXPECT_EQ(0, hosts().size());
+
+  applyPreparedUpdates(1);
+  EXPECT_TRUE(initialized_);
+  ASSERT_EQ(2, hosts().size());
+  const HostSharedPtr first_host = hosts()[0];
+  const HostSharedPtr second_host = hosts()[1];
+
+  auto cluster_load_assignment = makeAssignment({"1.2.3.4", "1.2.3.5", "1.2.3.6"});
+  cluster_load_assignment.mutable_endpoints(0)
+      ->mutable_lb_endpoints(1)
+      ->mutable_load_balancing_weight()
+      ->set_value(5);
+  doOnConfigUpdateVerifyNoThrow(cluster_load_assignment);
+  applyPreparedUpdates(1);
+  ASSERT_EQ(3, hosts().size());
+  EXPECT_EQ(first_host, hosts()[0]);
+  EXPECT_EQ(second_host, hosts()[1]);
+  EXPECT_EQ(5, hosts()[1]->weight());
+  EXPECT_EQ("1.2.3.6:80", hosts()[2]->address()->asString());
+  EXPECT_EQ(0UL,
+            stats_.findCounterByString("cluster.name.assignment_rejected").value().get().value());
+}
+
+// Validate that updates that arrive back to back while one is prepared converge on the latest
+// one: the update being prepared is applied, and only the latest of the others is prepared next.
+TEST_F(EdsPreparedUpdateTest, BackToBackUpdatesConverge) {
+  initialize();
+  doOnConfigUpdateVerifyNoThrow(makeAssignment({"1.2.3.4"}));
+  doOnConfigUpdateVerifyNoThrow(makeAssignment({"1.2.3.5"}));
+  doOnConfigUpdateVerifyNoThrow(makeAssignment({"1.2.3.6", "1.2.3.7"}));
+
+  applyPreparedUpdates(1);
+  EXPECT_TRUE(initialized_);
+  ASSERT_EQ(1, hosts().size());
+  EXPECT_EQ("1.2.3.4:80", hosts()[0]->address()->asString());
+
+  // Keep pushing while the next update is prepared.
+  doOnConfigUpdateVerifyNoThrow(makeAssignment({"1.2.3.8"}));
+  doOnConfigUpdateVerifyNoThrow(makeAssignment({"1.2.3.9", "1.2.3.10"}));
+
+  applyPreparedUpdates(1);
+  ASSERT_EQ(2, hosts().size());
+  EXPECT_EQ("1.2.3.6:80", hosts()[0]->address()->asString());
+  EXPECT_EQ("1.2.3.7:80", hosts()[1]->address()->asString());
+
+  applyPreparedUpdates(1);
+  ASSERT_EQ(2, hosts().size());
+  EXPECT_EQ("1.2.3.9:80", hosts()[0]->address()->asString());
+  EXPECT_EQ("1.2.3.10:80", hosts()[1]->address()->asString());
+  EXPECT_EQ(0UL,
+            stats_.findCounterByString("cluster.name.assignment_rejected").value().get().value());
+}
+
+// Validate that an update with an invalid address is rejected before it is prepared, as it is
+// when it is not prepared off the main thread.
+TEST_F(EdsPreparedUpdateTest, InvalidAddressRejected) {
+  initialize();
+  const auto decoded_resources = TestUtility::decodeResources(
+      {makeAssignment({"1.2.3.4", "not an address"})}, "cluster_name");
+  EXPECT_EQ("malformed IP address: not an address. Consider setting resolver_name or setting "
+            "cluster type to 'STRICT_DNS' or 'LOGICAL_DNS'",
+            eds_callbacks_->onConfigUpdate(decoded_resources.refvec_, "").message());
+
+  // Health check addresses are resolved too.
+  auto cluster_load_assignment = makeAssignment({"1.2.3.4"});
+  cluster_load_assignment.mutable_endpoints(0)
+      ->mutable_lb_endpoints(0)
+      ->mutable_endpoint()
+      ->mutable_health_check_config()
+      ->mutable_address()
+      ->mutable_socket_address()
+      ->set_address("not an address");
+  const auto health_check_resources =
+      TestUtility::decodeResources({cluster_load_assignment}, "cluster_name");
+  EXPECT_FALSE(eds_callbacks_->onConfigUpdate(health_check_resources.refvec_, "").ok());
+
+  EXPECT_FALSE(initialized_);
+  EXPECT_EQ(0UL,
+            stats_.findCounterByString("cluster.name.assignment_rejected").value().get().value());
+
+  // A valid update is still prepared and applied.
+  doOnConfigUpdateVerifyNoThrow(makeAssignment({"1.2.3.4"}));
+  applyPreparedUpdates(1);
+  EXPECT_TRUE(initialized_);
+  EXPECT_EQ(1, hosts().size());
+}
+
 } // namespace
 } // namespace Upstream
 } // namespace Envoy
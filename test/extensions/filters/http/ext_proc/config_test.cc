@@ -175,6 +175,52 @@ TEST(HttpExtProcConfigTest, InvalidServiceConfig) {
       "Proto constraint validation failed \\(ExternalProcessorValidationError.GrpcService.*");
 }
 
+TEST(HttpExtProcConfigTest, MultiplexedProcessorStreamsRequireGrpcService) {
+  std::string yaml = R"EOF(
+  http_service:
+    http_service:
+      http_uri:
+        uri: "ext_proc_server_0:9000"
+        cluster: "ext_proc_server_0"
+        timeout:
+          seconds: 500
+  multiplexed_processor_streams: 2
+  )EOF";
+
+  ExternalProcessingFilterConfig factory;
+  ProtobufTypes::MessagePtr proto_config = factory.createEmptyConfigProto();
+  TestUtility::loadFromYaml(yaml, *proto_config);
+
+  testing::NiceMock<Server::Configuration::MockFactoryContext> context;
+  auto result = factory.createFilterFactoryFromProto(*proto_config, "stats", context);
+  EXPECT_FALSE(result.ok());
+  EXPECT_EQ(result.status().code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(result.status().message(),
+            "multiplexed_processor_streams can only be used with grpc_service");
+}
+
+TEST(HttpExtProcConfigTest, MultiplexedProcessorStreamsRejectRetryPolicy) {
+  std::string yaml = R"EOF(
+  grpc_service:
+    envoy_grpc:
+      cluster_name: ext_proc_server
+    retry_policy:
+      num_retries: 2
+  multiplexed_processor_streams: 2
+  )EOF";
+
+  ExternalProcessingFilterConfig factory;
+  ProtobufTypes::MessagePtr proto_config = factory.createEmptyConfigProto();
+  TestUtility::loadFromYaml(yaml, *proto_config);
+
+  testing::NiceMock<Server::Configuration::MockFactoryContext> context;
+  auto result = factory.createFilterFactoryFromProto(*proto_config, "stats", context);
+  EXPECT_FALSE(result.ok());
+  EXPECT_EQ(result.status().code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(result.status().message(),
+            "multiplexed_processor_streams can not be used with a grpc_service retry_policy");
+}
+
 TEST(HttpExtProcConfigTest, InvalidHttpServiceProcessingMode) {
   std::string yaml = R"EOF(
   http_service:
@@ -740,6 +740,61 @@ TEST_F(HttpFilterTest, SimplestPost) {
   expectFilterState(filter_metadata);
 }
 
+// With multiplexed_processor_streams set, messages carry the HTTP stream's id, responses are
+// routed back by that id, and finishing the HTTP stream leaves the shared gRPC stream open.
+TEST_F(HttpFilterTest, MultiplexedProcessorStream) {
+  initialize(R"EOF(
+  grpc_service:
+    envoy_grpc:
+      cluster_name: "ext_proc_server"
+  multiplexed_processor_streams: 1
+  )EOF");
+
+  // The HTTP stream's use of the shared gRPC stream is traced in a child of its own span.
+  auto* child_span = new NiceMock<Tracing::MockSpan>();
+  EXPECT_CALL(decoder_callbacks_.active_span_, spawnChild_(_, _, _)).WillOnce(Return(child_span));
+  EXPECT_CALL(*child_span, finishSpan());
+
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, filter_->decodeHeaders(request_headers_, false));
+  const uint64_t stream_id = last_request_.multiplexed_stream_id();
+  EXPECT_NE(0, stream_id);
+  // A response for another HTTP stream is not delivered to this filter.
+  auto stray_response = std::make_unique<ProcessingResponse>();
+  stray_response->mutable_request_headers();
+  stray_response->set_multiplexed_stream_id(stream_id + 1);
+  stream_callbacks_->onReceiveMessage(std::move(stray_response));
+  EXPECT_EQ(1, config_->stats().multiplexed_msgs_dropped_.value());
+
+  processRequestHeaders(false, [stream_id](const HttpHeaders&, ProcessingResponse& response,
+                                           HeadersResponse&) {
+    response.set_multiplexed_stream_id(stream_id);
+  });
+
+  Buffer::OwnedImpl req_data("foo");
+  EXPECT_EQ(FilterDataStatus::Continue, filter_->decodeData(req_data, true));
+
+  response_headers_.addCopy(LowerCaseString(":status"), "200");
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, filter_->encodeHeaders(response_headers_, false));
+  EXPECT_EQ(stream_id, last_request_.multiplexed_stream_id());
+  processResponseHeaders(false, [stream_id](const HttpHeaders&, ProcessingResponse& response,
+                                            HeadersResponse&) {
+    response.set_multiplexed_stream_id(stream_id);
+  });
+
+  Buffer::OwnedImpl resp_data("foo");
+  EXPECT_EQ(FilterDataStatus::Continue, filter_->encodeData(resp_data, true));
+  filter_->onDestroy();
+
+  EXPECT_EQ(1, config_->stats().streams_started_.value());
+  EXPECT_EQ(1, config_->stats().multiplexed_streams_started_.value());
+  EXPECT_EQ(2, config_->stats().stream_msgs_sent_.value());
+  EXPECT_EQ(2, config_->stats().stream_msgs_received_.value());
+  EXPECT_EQ(1, config_->stats().streams_closed_.value());
+
+  // The shared gRPC stream is only closed once the processor closes it.
+  stream_callbacks_->onGrpcClose();
+}
+
 // Using the default configuration, test the filter with a processor that
 // replies to the request_headers message with a message that modifies the request
 // headers.
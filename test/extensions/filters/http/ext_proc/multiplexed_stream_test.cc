@@ -0,0 +1,299 @@
+#include "source/common/grpc/codec.h"
+#include "source/common/stats/isolated_store_impl.h"
+#include "source/common/tracing/common_values.h"
+#include "source/extensions/filters/http/ext_proc/multiplexed_stream.h"
+
+#include "test/extensions/filters/http/ext_proc/mock_server.h"
+#include "test/mocks/tracing/mocks.h"
+#include "test/test_common/simulated_time_system.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace ExternalProcessing {
+namespace {
+
+using testing::_;
+using testing::ByMove;
+using testing::Eq;
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+
+class MockProcessorCallbacks : public ExternalProcessorCallbacks {
+public:
+  MOCK_METHOD(void, onReceiveMessage, (std::unique_ptr<ProcessingResponse> && response));
+  MOCK_METHOD(void, onGrpcError, (Grpc::Status::GrpcStatus error, const std::string& message));
+  MOCK_METHOD(void, onGrpcClose, ());
+  MOCK_METHOD(void, logStreamInfo, ());
+  MOCK_METHOD(void, onComplete, (ProcessingResponse & response));
+  MOCK_METHOD(void, onError, ());
+};
+
+class MultiplexedStreamPoolTest : public testing::Test {
+protected:
+  MultiplexedStreamPoolTest() {
+    envoy::config::core::v3::GrpcService grpc_service;
+    grpc_service.mutable_envoy_grpc()->set_cluster_name("ext_proc_server");
+    config_with_hash_key_.setConfig(grpc_service);
+    ON_CALL(client_, start(_, _, _, _))
+        .WillByDefault(Invoke([this](ExternalProcessorCallbacks& callbacks,
+                                     const Grpc::GrpcServiceConfigWithHashKey&,
+                                     Http::AsyncClient::StreamOptions&,
+                                     Http::StreamFilterSidestreamWatermarkCallbacks&) {
+          auto stream = std::make_unique<NiceMock<MockStream>>();
+          grpc_streams_.push_back(stream.get());
+          shared_callbacks_.push_back(&callbacks);
+          return stream;
+        }));
+    ON_CALL(parent_span_, spawnChild_(_, _, _))
+        .WillByDefault(Invoke([](const Tracing::Config&, const std::string&, SystemTime) {
+          return new NiceMock<Tracing::MockSpan>();
+        }));
+  }
+
+  std::unique_ptr<MultiplexedStreamPool> createPool(uint32_t max_streams) {
+    return std::make_unique<MultiplexedStreamPool>(max_streams, streams_started_, msgs_dropped_,
+                                                   send_buffer_overflows_);
+  }
+
+  ExternalProcessorStreamPtr attach(MultiplexedStreamPool& pool,
+                                    ExternalProcessorCallbacks& callbacks) {
+    return pool.attach(client_, callbacks, config_with_hash_key_, std::chrono::milliseconds(100),
+                       parent_span_, time_system_);
+  }
+
+  // The shared stream reports its own send buffer watermarks to itself.
+  Http::SidestreamWatermarkCallbacks& watermarkCallbacks(size_t index) {
+    return dynamic_cast<Http::SidestreamWatermarkCallbacks&>(*shared_callbacks_[index]);
+  }
+
+  static std::unique_ptr<ProcessingResponse> responseFor(uint64_t stream_id) {
+    auto response = std::make_unique<ProcessingResponse>();
+    response->mutable_request_headers();
+    response->set_multiplexed_stream_id(stream_id);
+    return response;
+  }
+
+  Stats::IsolatedStoreImpl stats_store_;
+  Stats::Counter& streams_started_{stats_store_.counterFromString("multiplexed_streams_started")};
+  Stats::Counter& msgs_dropped_{stats_store_.counterFromString("multiplexed_msgs_dropped")};
+  Stats::Counter& send_buffer_overflows_{
+      stats_store_.counterFromString("multiplexed_send_buffer_overflows")};
+  Event::SimulatedTimeSystem time_system_;
+  NiceMock<Tracing::MockSpan> parent_span_;
+  Grpc::GrpcServiceConfigWithHashKey config_with_hash_key_;
+  NiceMock<MockClient> client_;
+  std::vector<MockStream*> grpc_streams_;
+  std::vector<ExternalProcessorCallbacks*> shared_callbacks_;
+};
+
+TEST_F(MultiplexedStreamPoolTest, TagsRequestsAndRoutesResponses) {
+  auto pool = createPool(1);
+  NiceMock<MockProcessorCallbacks> callbacks_a;
+  NiceMock<MockProcessorCallbacks> callbacks_b;
+  auto stream_a = attach(*pool, callbacks_a);
+  auto stream_b = attach(*pool, callbacks_b);
+  ASSERT_EQ(1U, grpc_streams_.size());
+  EXPECT_EQ(1U, streams_started_.value());
+
+  const uint64_t id_a = dynamic_cast<MultiplexedProcessorStream&>(*stream_a).streamId();
+  const uint64_t id_b = dynamic_cast<MultiplexedProcessorStream&>(*stream_b).streamId();
+  EXPECT_NE(0U, id_a);
+  EXPECT_NE(id_a, id_b);
+
+  // The shared stream is never half-closed by an HTTP stream.
+  EXPECT_CALL(*grpc_streams_[0], send(_, false))
+      .WillOnce(Invoke([id_b](ProcessingRequest&& request, bool) {
+        EXPECT_EQ(id_b, request.multiplexed_stream_id());
+      }));
+  ProcessingRequest request;
+  request.mutable_request_headers();
+  stream_b->send(std::move(request), true);
+
+  EXPECT_CALL(callbacks_a, onReceiveMessage(_)).Times(0);
+  EXPECT_CALL(callbacks_b, onReceiveMessage(_));
+  shared_callbacks_[0]->onReceiveMessage(responseFor(id_b));
+}
+
+TEST_F(MultiplexedStreamPoolTest, GrowsToMaxThenReusesLeastLoaded) {
+  auto pool = createPool(2);
+  NiceMock<MockProcessorCallbacks> callbacks;
+  auto first = attach(*pool, callbacks);
+  auto second = attach(*pool, callbacks);
+  EXPECT_EQ(2U, pool->size());
+  EXPECT_EQ(2U, streams_started_.value());
+
+  EXPECT_TRUE(first->close());
+  EXPECT_FALSE(first->close());
+  // The now idle first shared stream is picked rather than starting a new one.
+  auto third = attach(*pool, callbacks);
+  EXPECT_EQ(2U, pool->size());
+  EXPECT_EQ(2U, grpc_streams_.size());
+  EXPECT_CALL(*grpc_streams_[0], send(_, _));
+  EXPECT_CALL(*grpc_streams_[1], send(_, _)).Times(0);
+  third->send(ProcessingRequest(), false);
+}
+
+TEST_F(MultiplexedStreamPoolTest, DropsResponsesForDetachedStreams) {
+  auto pool = createPool(1);
+  NiceMock<MockProcessorCallbacks> callbacks;
+  auto stream = attach(*pool, callbacks);
+  const uint64_t id = dynamic_cast<MultiplexedProcessorStream&>(*stream).streamId();
+  stream->notifyFilterDestroy();
+
+  EXPECT_CALL(callbacks, onReceiveMessage(_)).Times(0);
+  EXPECT_CALL(*grpc_streams_[0], send(_, _)).Times(0);
+  shared_callbacks_[0]->onReceiveMessage(responseFor(id));
+  stream->send(ProcessingRequest(), false);
+  EXPECT_EQ(1U, msgs_dropped_.value());
+}
+
+TEST_F(MultiplexedStreamPoolTest, ErrorIsDeliveredToEveryAttachedStream) {
+  auto pool = createPool(1);
+  NiceMock<MockProcessorCallbacks> callbacks_a;
+  NiceMock<MockProcessorCallbacks> callbacks_b;
+  auto stream_a = attach(*pool, callbacks_a);
+  auto stream_b = attach(*pool, callbacks_b);
+
+  EXPECT_CALL(callbacks_a, onGrpcError(Grpc::Status::Internal, "boom"))
+      .WillOnce(Invoke([&](Grpc::Status::GrpcStatus, const std::string&) {
+        // The filter closes its stream from within the error callback.
+        EXPECT_TRUE(stream_a->close());
+        stream_a.reset();
+      }));
+  EXPECT_CALL(callbacks_b, onGrpcError(Grpc::Status::Internal, "boom"));
+  shared_callbacks_[0]->onGrpcError(Grpc::Status::Internal, "boom");
+  EXPECT_EQ(0U, pool->size());
+
+  // New HTTP streams get a fresh shared stream.
+  NiceMock<MockProcessorCallbacks> callbacks_c;
+  auto stream_c = attach(*pool, callbacks_c);
+  EXPECT_EQ(2U, grpc_streams_.size());
+  EXPECT_EQ(1U, pool->size());
+}
+
+TEST_F(MultiplexedStreamPoolTest, CountsBytesPerStream) {
+  auto pool = createPool(1);
+  NiceMock<MockProcessorCallbacks> callbacks_a;
+  NiceMock<MockProcessorCallbacks> callbacks_b;
+  auto stream_a = attach(*pool, callbacks_a);
+  auto stream_b = attach(*pool, callbacks_b);
+  auto& multiplexed_a = dynamic_cast<MultiplexedProcessorStream&>(*stream_a);
+  auto& multiplexed_b = dynamic_cast<MultiplexedProcessorStream&>(*stream_b);
+
+  ProcessingRequest request;
+  request.mutable_request_headers()->set_end_of_stream(true);
+  request.set_multiplexed_stream_id(multiplexed_a.streamId());
+  const uint64_t request_size = Grpc::GRPC_FRAME_HEADER_SIZE + request.ByteSizeLong();
+  stream_a->send(std::move(request), false);
+
+  auto response = responseFor(multiplexed_a.streamId());
+  const uint64_t response_size = Grpc::GRPC_FRAME_HEADER_SIZE + response->ByteSizeLong();
+  shared_callbacks_[0]->onReceiveMessage(std::move(response));
+
+  EXPECT_EQ(request_size, multiplexed_a.bytesSent());
+  EXPECT_EQ(response_size, multiplexed_a.bytesReceived());
+  EXPECT_EQ(0U, multiplexed_b.bytesSent());
+  EXPECT_EQ(0U, multiplexed_b.bytesReceived());
+}
+
+TEST_F(MultiplexedStreamPoolTest, SendBufferOverflowDetachesStream) {
+  auto pool = createPool(1);
+  NiceMock<MockProcessorCallbacks> callbacks;
+  auto* span = new NiceMock<Tracing::MockSpan>();
+  EXPECT_CALL(parent_span_, spawnChild_(_, _, _)).WillOnce(Return(span));
+  auto stream = attach(*pool, callbacks);
+  const uint64_t id = dynamic_cast<MultiplexedProcessorStream&>(*stream).streamId();
+
+  watermarkCallbacks(0).onSidestreamAboveHighWatermark();
+  EXPECT_CALL(*grpc_streams_[0], send(_, _)).Times(0);
+  EXPECT_CALL(*span, setTag(_, _)).Times(testing::AnyNumber());
+  EXPECT_CALL(*span, setTag(Eq(Tracing::Tags::get().Error), Eq(Tracing::Tags::get().True)));
+  EXPECT_CALL(*span, setTag(Eq(Tracing::Tags::get().ErrorReason), Eq("send buffer overflow")));
+  EXPECT_CALL(*span, finishSpan());
+  stream->send(ProcessingRequest(), false);
+  EXPECT_EQ(1U, send_buffer_overflows_.value());
+
+  // The stream is detached, so a late response is dropped and close reports nothing to do.
+  EXPECT_CALL(callbacks, onReceiveMessage(_)).Times(0);
+  shared_callbacks_[0]->onReceiveMessage(responseFor(id));
+  EXPECT_FALSE(stream->close());
+}
+
+TEST_F(MultiplexedStreamPoolTest, SkipsStreamsAboveHighWatermark) {
+  auto pool = createPool(2);
+  NiceMock<MockProcessorCallbacks> callbacks;
+  auto first = attach(*pool, callbacks);
+  watermarkCallbacks(0).onSidestreamAboveHighWatermark();
+
+  // The saturated stream is skipped, so a second one is started.
+  auto second = attach(*pool, callbacks);
+  EXPECT_EQ(2U, grpc_streams_.size());
+  watermarkCallbacks(1).onSidestreamAboveHighWatermark();
+
+  // Once every stream is saturated no more HTTP streams are attached.
+  EXPECT_EQ(nullptr, attach(*pool, callbacks));
+  EXPECT_EQ(2U, grpc_streams_.size());
+
+  // Draining the first stream makes it usable again.
+  watermarkCallbacks(0).onSidestreamBelowLowWatermark();
+  auto third = attach(*pool, callbacks);
+  ASSERT_NE(nullptr, third);
+  EXPECT_CALL(*grpc_streams_[0], send(_, _));
+  third->send(ProcessingRequest(), false);
+}
+
+TEST_F(MultiplexedStreamPoolTest, TracesEachStreamInItsOwnSpan) {
+  auto pool = createPool(1);
+  NiceMock<MockProcessorCallbacks> callbacks;
+  auto* span = new NiceMock<Tracing::MockSpan>();
+  EXPECT_CALL(parent_span_,
+              spawnChild_(_,
+                          Eq("async envoy.service.ext_proc.v3.ExternalProcessor.Process "
+                             "multiplexed"),
+                          _))
+      .WillOnce(Return(span));
+  EXPECT_CALL(*span, setTag(_, _)).Times(testing::AnyNumber());
+  EXPECT_CALL(*span, setTag(Eq(Tracing::Tags::get().UpstreamCluster), Eq("ext_proc_server")));
+  EXPECT_CALL(*span, setTag(Eq(Tracing::Tags::get().Component), Eq(Tracing::Tags::get().Proxy)));
+  auto stream = attach(*pool, callbacks);
+
+  EXPECT_CALL(*span, setTag(Eq(Tracing::Tags::get().GrpcStatusCode), Eq("13")));
+  EXPECT_CALL(*span, setTag(Eq(Tracing::Tags::get().Error), Eq(Tracing::Tags::get().True)));
+  shared_callbacks_[0]->onGrpcError(Grpc::Status::Internal, "boom");
+
+  EXPECT_CALL(*span, finishSpan());
+  EXPECT_TRUE(stream->close());
+}
+
+TEST_F(MultiplexedStreamPoolTest, StartFailureReturnsNull) {
+  auto pool = createPool(1);
+  EXPECT_CALL(client_, start(_, _, _, _))
+      .WillOnce(Return(ByMove(ExternalProcessorStreamPtr())));
+  NiceMock<MockProcessorCallbacks> callbacks;
+  EXPECT_EQ(nullptr, attach(*pool, callbacks));
+  EXPECT_EQ(0U, pool->size());
+  EXPECT_EQ(0U, streams_started_.value());
+}
+
+TEST_F(MultiplexedStreamPoolTest, PoolDestructionClosesSharedStreams) {
+  auto pool = createPool(1);
+  NiceMock<MockProcessorCallbacks> callbacks;
+  auto stream = attach(*pool, callbacks);
+  EXPECT_CALL(*grpc_streams_[0], close());
+  pool.reset();
+  // Handles outliving the pool are still safe to use and close.
+  EXPECT_CALL(*grpc_streams_[0], send(_, _)).Times(0);
+  stream->send(ProcessingRequest(), false);
+  EXPECT_TRUE(stream->close());
+}
+
+} // namespace
+} // namespace ExternalProcessing
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
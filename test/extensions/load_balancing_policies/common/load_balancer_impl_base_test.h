@@ -47,6 +47,10 @@ public:
   static double slowStartMinWeightPercent(const EdfLoadBalancerBase& edf_lb) {
     return edf_lb.slow_start_min_weight_percent_;
   }
+  static const EdfScheduler<Host>* scheduler(EdfLoadBalancerBase& edf_lb,
+                                             const HostsSource& source) {
+    return edf_lb.scheduler_[source].edf_.get();
+  }
 };
 
 class TestZoneAwareLoadBalancer : public ZoneAwareLoadBalancerBase {
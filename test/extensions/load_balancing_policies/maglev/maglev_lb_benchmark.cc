@@ -16,7 +16,7 @@ public:
         config_.has_value()
             ? makeOptRef<const envoy::config::cluster::v3::Cluster::MaglevLbConfig>(config_.value())
             : absl::nullopt,
-        common_config_);
+        common_config_, simTime());
   }
 
   absl::optional<envoy::config::cluster::v3::Cluster::MaglevLbConfig> config_;
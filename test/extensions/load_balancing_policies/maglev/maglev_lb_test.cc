@@ -56,7 +56,7 @@ public:
         config_.has_value()
             ? makeOptRef<const envoy::config::cluster::v3::Cluster::MaglevLbConfig>(config_.value())
             : absl::nullopt,
-        common_config_);
+        common_config_, simTime());
   }
 
   void init(uint64_t table_size, bool locality_weighted_balancing = false) {
@@ -323,6 +323,56 @@ TEST_F(MaglevLoadBalancerTest, BasicStability) {
   }
 }
 
+// The entries that change between builds are counted, and a refresh that does not change the
+// hosts reuses the current table.
+TEST_F(MaglevLoadBalancerTest, EntriesChanged) {
+  host_set_.hosts_ = {makeTestHost(info_, "tcp://127.0.0.1:90", simTime()),
+                      makeTestHost(info_, "tcp://127.0.0.1:91", simTime()),
+                      makeTestHost(info_, "tcp://127.0.0.1:92", simTime()),
+                      makeTestHost(info_, "tcp://127.0.0.1:93", simTime()),
+                      makeTestHost(info_, "tcp://127.0.0.1:94", simTime()),
+                      makeTestHost(info_, "tcp://127.0.0.1:95", simTime())};
+  host_set_.healthy_hosts_ = host_set_.hosts_;
+  host_set_.runCallbacks({}, {});
+  init(7);
+  EXPECT_EQ("maglev_lb.entries_changed", lb_->stats().entries_changed_.name());
+  EXPECT_EQ(0, lb_->stats().entries_changed_.value());
+
+  auto assignments = [this]() {
+    LoadBalancerPtr lb = lb_->factory()->create(lb_params_);
+    std::vector<HostConstSharedPtr> hosts;
+    for (uint32_t i = 0; i < 7; ++i) {
+      TestLoadBalancerContext context(i);
+      hosts.push_back(lb->chooseHost(&context).host);
+    }
+    return hosts;
+  };
+  const std::vector<HostConstSharedPtr> before = assignments();
+
+  // Only the entries of the removed host, and any displaced by them, are counted.
+  host_set_.healthy_hosts_.pop_back();
+  host_set_.runCallbacks({}, {});
+  const std::vector<HostConstSharedPtr> after = assignments();
+  uint64_t changed = 0;
+  for (uint32_t i = 0; i < 7; ++i) {
+    EXPECT_NE(host_set_.hosts_[5], after[i]);
+    changed += before[i] != after[i] ? 1 : 0;
+  }
+  EXPECT_GE(changed, 1);
+  EXPECT_EQ(changed, lb_->stats().entries_changed_.value());
+
+  // Reordering the hosts rebuilds the same table.
+  std::reverse(host_set_.healthy_hosts_.begin(), host_set_.healthy_hosts_.end());
+  host_set_.runCallbacks({}, {});
+  EXPECT_EQ(after, assignments());
+  EXPECT_EQ(changed, lb_->stats().entries_changed_.value());
+
+  // A refresh that changes nothing reuses the table.
+  host_set_.runCallbacks({}, {});
+  EXPECT_EQ(after, assignments());
+  EXPECT_EQ(changed, lb_->stats().entries_changed_.value());
+}
+
 // Weighted sanity test.
 TEST_F(MaglevLoadBalancerTest, Weighted) {
   host_set_.hosts_ = {makeTestHost(info_, "tcp://127.0.0.1:90", simTime(), 1),
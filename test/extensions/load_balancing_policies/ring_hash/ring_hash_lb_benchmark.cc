@@ -18,7 +18,7 @@ public:
             ? makeOptRef<const envoy::config::cluster::v3::Cluster::RingHashLbConfig>(
                   config_.value())
             : absl::nullopt,
-        common_config_);
+        common_config_, simTime());
   }
 
   absl::optional<envoy::config::cluster::v3::Cluster::RingHashLbConfig> config_;
@@ -53,6 +53,45 @@ BENCHMARK(benchmarkRingHashLoadBalancerBuildRing)
     ->Args({500, 256000})
     ->Unit(::benchmark::kMillisecond);
 
+void benchmarkRingHashLoadBalancerUpdate(::benchmark::State& state) {
+  const uint64_t num_hosts = state.range(0);
+  const uint64_t min_ring_size = state.range(1);
+  const uint64_t hosts_changed = state.range(2);
+
+  RingHashTester tester(num_hosts, min_ring_size);
+  ASSERT_TRUE(tester.ring_hash_lb_->initialize().ok());
+  HostVector hosts = tester.priority_set_.hostSetsPerPriority()[0]->hosts();
+  uint64_t next_host = 0;
+  for (auto _ : state) { // NOLINT: Silences warning about dead store
+    state.PauseTiming();
+    // Replace the oldest hosts with new hosts.
+    HostVector hosts_removed(hosts.begin(), hosts.begin() + hosts_changed);
+    HostVector hosts_added;
+    for (uint64_t i = 0; i < hosts_changed; ++i) {
+      const std::string url = fmt::format("tcp://10.{}.{}.{}:6379", 1 + next_host / 65536 % 250,
+                                          next_host / 256 % 256, next_host % 256);
+      ++next_host;
+      hosts_added.push_back(makeTestHost(tester.info_, url, tester.simTime()));
+    }
+    hosts.erase(hosts.begin(), hosts.begin() + hosts_changed);
+    hosts.insert(hosts.end(), hosts_added.begin(), hosts_added.end());
+    HostVectorConstSharedPtr updated_hosts = std::make_shared<HostVector>(hosts);
+    HostsPerLocalityConstSharedPtr hosts_per_locality = makeHostsPerLocality({hosts});
+    auto update_hosts_params = HostSetImpl::partitionHosts(updated_hosts, hosts_per_locality);
+
+    // We are only interested in timing the update, which rebuilds the ring.
+    state.ResumeTiming();
+    tester.priority_set_.updateHosts(0, std::move(update_hosts_params), {}, hosts_added,
+                                     hosts_removed, tester.random_.random(), absl::nullopt);
+  }
+}
+BENCHMARK(benchmarkRingHashLoadBalancerUpdate)
+    ->Args({100, 65536, 1})
+    ->Args({100, 65536, 10})
+    ->Args({500, 65536, 1})
+    ->Args({500, 65536, 50})
+    ->Unit(::benchmark::kMillisecond);
+
 void benchmarkRingHashLoadBalancerChooseHost(::benchmark::State& state) {
   for (auto _ : state) { // NOLINT: Silences warning about dead store
     // Do not time the creation of the ring.
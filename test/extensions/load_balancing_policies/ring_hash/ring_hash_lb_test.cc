@@ -21,6 +21,7 @@
 #include "test/test_common/simulated_time_system.h"
 
 #include "absl/container/node_hash_map.h"
+#include "absl/strings/str_cat.h"
 #include "absl/types/optional.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -72,7 +73,7 @@ public:
             ? makeOptRef<const envoy::config::cluster::v3::Cluster::RingHashLbConfig>(
                   config_.value())
             : absl::nullopt,
-        common_config_);
+        common_config_, simTime());
     EXPECT_TRUE(lb_->initialize().ok());
   }
 
@@ -112,7 +113,7 @@ TEST_P(RingHashLoadBalancerTest, ChooseHostBeforeInit) {
       config_.has_value()
           ? makeOptRef<const envoy::config::cluster::v3::Cluster::RingHashLbConfig>(config_.value())
           : absl::nullopt,
-      common_config_);
+      common_config_, simTime());
   EXPECT_EQ(nullptr, lb_->factory()->create(lb_params_)->chooseHost(nullptr).host);
 }
 
@@ -957,6 +958,55 @@ TEST_P(RingHashLoadBalancerTest, LopsidedWeightSmallScale) {
   }
 }
 
+// Given hosts that are added, removed and reweighted, expect the ring built from the previous ring
+// to match a ring built from scratch.
+TEST_P(RingHashLoadBalancerTest, IncrementalRebuild) {
+  for (uint32_t port = 90; port < 100; ++port) {
+    hostSet().hosts_.push_back(
+        makeTestHost(info_, absl::StrCat("tcp://127.0.0.1:", port), simTime()));
+  }
+  hostSet().healthy_hosts_ = hostSet().hosts_;
+  hostSet().runCallbacks({}, {});
+  init();
+  EXPECT_EQ("ring_hash_lb.hashes_changed", lb_->stats().hashes_changed_.name());
+  EXPECT_EQ(0, lb_->stats().hashes_changed_.value());
+
+  auto expect_same_as_fresh_ring = [this]() {
+    LoadBalancerPtr lb = lb_->factory()->create(lb_params_);
+    RingHashLoadBalancer fresh_lb(priority_set_, stats_, *stats_store_.rootScope(), runtime_,
+                                  random_, absl::nullopt, common_config_, simTime());
+    ASSERT_TRUE(fresh_lb.initialize().ok());
+    LoadBalancerPtr fresh = fresh_lb.factory()->create(lb_params_);
+    for (uint32_t i = 0; i < 6000; ++i) {
+      TestLoadBalancerContext context(i * (std::numeric_limits<uint64_t>::max() / 6000));
+      EXPECT_EQ(fresh->chooseHost(&context).host, lb->chooseHost(&context).host);
+    }
+  };
+
+  // Remove a host.
+  hostSet().healthy_hosts_.erase(hostSet().healthy_hosts_.begin() + 3);
+  hostSet().runCallbacks({}, {});
+  expect_same_as_fresh_ring();
+  const uint64_t hashes_changed = lb_->stats().hashes_changed_.value();
+  EXPECT_GT(hashes_changed, 0);
+  EXPECT_LT(hashes_changed, lb_->stats().size_.value());
+
+  // Add a host with a larger weight.
+  hostSet().healthy_hosts_.push_back(makeTestHost(info_, "tcp://127.0.0.1:100", simTime(), 2));
+  hostSet().runCallbacks({}, {});
+  expect_same_as_fresh_ring();
+  EXPECT_GT(lb_->stats().hashes_changed_.value(), hashes_changed);
+
+  // Replace most of the hosts, which rebuilds the ring from scratch.
+  hostSet().healthy_hosts_.resize(2);
+  for (uint32_t port = 101; port < 110; ++port) {
+    hostSet().healthy_hosts_.push_back(
+        makeTestHost(info_, absl::StrCat("tcp://127.0.0.1:", port), simTime()));
+  }
+  hostSet().runCallbacks({}, {});
+  expect_same_as_fresh_ring();
+}
+
 } // namespace
 } // namespace Upstream
 } // namespace Envoy
@@ -1,3 +1,4 @@
+#include "source/common/runtime/runtime_features.h"
 #include "source/extensions/load_balancing_policies/round_robin/round_robin_lb.h"
 
 #include "test/benchmark/main.h"
@@ -68,6 +69,63 @@ BENCHMARK(benchmarkRoundRobinLoadBalancerBuild)
     ->Args({50000, 100, 50})
     ->Unit(::benchmark::kMillisecond);
 
+void benchmarkRoundRobinLoadBalancerUpdate(::benchmark::State& state) {
+  const uint64_t num_hosts = state.range(0);
+  const uint64_t hosts_changed = state.range(1);
+  const bool incremental_refresh = state.range(2) != 0;
+
+  if (benchmark::skipExpensiveBenchmarks() && num_hosts > 10000) {
+    state.SkipWithError("Skipping expensive benchmark");
+    return;
+  }
+
+  Runtime::maybeSetRuntimeGuard("envoy.reloadable_features.edf_lb_incremental_refresh",
+                                incremental_refresh);
+  RoundRobinTester tester(num_hosts, 50, 50);
+  tester.initialize();
+  HostVector hosts = tester.priority_set_.hostSetsPerPriority()[0]->hosts();
+  uint64_t next_host = 0;
+  for (auto _ : state) { // NOLINT: Silences warning about dead store
+    state.PauseTiming();
+    // Replace the oldest hosts with new hosts of the same weight.
+    HostVector hosts_removed(hosts.begin(), hosts.begin() + hosts_changed);
+    HostVector hosts_added;
+    for (const auto& host : hosts_removed) {
+      const std::string url = fmt::format("tcp://10.{}.{}.{}:6379", 1 + next_host / 65536 % 250,
+                                          next_host / 256 % 256, next_host % 256);
+      ++next_host;
+      hosts_added.push_back(makeTestHost(tester.info_, url, tester.simTime(), host->weight()));
+    }
+    hosts.erase(hosts.begin(), hosts.begin() + hosts_changed);
+    hosts.insert(hosts.end(), hosts_added.begin(), hosts_added.end());
+    HostVectorConstSharedPtr updated_hosts = std::make_shared<HostVector>(hosts);
+    HostsPerLocalityConstSharedPtr hosts_per_locality = makeHostsPerLocality({hosts});
+    auto update_hosts_params = HostSetImpl::partitionHosts(updated_hosts, hosts_per_locality);
+
+    // We are only interested in timing the update, which refreshes the schedulers.
+    state.ResumeTiming();
+    tester.priority_set_.updateHosts(0, std::move(update_hosts_params), {}, hosts_added,
+                                     hosts_removed, tester.random_.random(), absl::nullopt);
+    // Pick once, which also drops the removed hosts at the front of the schedule.
+    tester.lb_->chooseHost(nullptr);
+  }
+  Runtime::maybeSetRuntimeGuard("envoy.reloadable_features.edf_lb_incremental_refresh", false);
+}
+BENCHMARK(benchmarkRoundRobinLoadBalancerUpdate)
+    ->Args({500, 1, 0})
+    ->Args({500, 1, 1})
+    ->Args({500, 50, 0})
+    ->Args({500, 50, 1})
+    ->Args({10000, 1, 0})
+    ->Args({10000, 1, 1})
+    ->Args({10000, 100, 0})
+    ->Args({10000, 100, 1})
+    ->Args({50000, 1, 0})
+    ->Args({50000, 1, 1})
+    ->Args({50000, 500, 0})
+    ->Args({50000, 500, 1})
+    ->Unit(::benchmark::kMicrosecond);
+
 } // namespace
 } // namespace Upstream
 } // namespace Envoy
@@ -470,6 +470,68 @@ TEST_P(RoundRobinLoadBalancerTest, WeightedSeed) {
   EXPECT_EQ(hostSet().healthy_hosts_[1], lb_->chooseHost(nullptr).host);
 }
 
+// Validate that small membership changes are applied to the existing weighted schedule.
+TEST_P(RoundRobinLoadBalancerTest, WeightedIncrementalRefresh) {
+  TestScopedRuntime scoped_runtime;
+  scoped_runtime.mergeValues({{"envoy.reloadable_features.edf_lb_incremental_refresh", "true"}});
+  hostSet().healthy_hosts_ = {makeTestHost(info_, "tcp://127.0.0.1:80", simTime(), 1),
+                              makeTestHost(info_, "tcp://127.0.0.1:81", simTime(), 1),
+                              makeTestHost(info_, "tcp://127.0.0.1:82", simTime(), 1),
+                              makeTestHost(info_, "tcp://127.0.0.1:83", simTime(), 2)};
+  hostSet().hosts_ = hostSet().healthy_hosts_;
+  init(false);
+  const HostsSource source(hostSet().priority(), HostsSource::SourceType::HealthyHosts);
+  const EdfScheduler<Host>* scheduler =
+      EdfLoadBalancerBasePeer::scheduler(static_cast<EdfLoadBalancerBase&>(*lb_), source);
+  ASSERT_NE(nullptr, scheduler);
+  for (int i = 0; i < 3; ++i) {
+    lb_->chooseHost(nullptr);
+  }
+
+  const auto count_picks = [this](uint32_t picks) {
+    absl::flat_hash_map<HostConstSharedPtr, uint32_t> counts;
+    for (uint32_t i = 0; i < picks; ++i) {
+      counts[lb_->chooseHost(nullptr).host]++;
+    }
+    return counts;
+  };
+
+  // Remove a host. It is no longer picked, and the remaining weights are respected.
+  HostVector removed_hosts = {hostSet().hosts_[1]};
+  hostSet().healthy_hosts_.erase(hostSet().healthy_hosts_.begin() + 1);
+  hostSet().hosts_ = hostSet().healthy_hosts_;
+  hostSet().runCallbacks({}, removed_hosts);
+  EXPECT_EQ(scheduler,
+            EdfLoadBalancerBasePeer::scheduler(static_cast<EdfLoadBalancerBase&>(*lb_), source));
+  auto counts = count_picks(40);
+  EXPECT_EQ(0, counts[removed_hosts[0]]);
+  EXPECT_NEAR(10, counts[hostSet().healthy_hosts_[0]], 1);
+  EXPECT_NEAR(10, counts[hostSet().healthy_hosts_[1]], 1);
+  EXPECT_NEAR(20, counts[hostSet().healthy_hosts_[2]], 1);
+
+  // Add a host. It participates in the next round of scheduling with its own weight.
+  hostSet().healthy_hosts_.push_back(makeTestHost(info_, "tcp://127.0.0.1:84", simTime(), 4));
+  hostSet().hosts_.push_back(hostSet().healthy_hosts_.back());
+  hostSet().runCallbacks({hostSet().healthy_hosts_.back()}, {});
+  EXPECT_EQ(scheduler,
+            EdfLoadBalancerBasePeer::scheduler(static_cast<EdfLoadBalancerBase&>(*lb_), source));
+  counts = count_picks(80);
+  EXPECT_NEAR(10, counts[hostSet().healthy_hosts_[0]], 1);
+  EXPECT_NEAR(10, counts[hostSet().healthy_hosts_[1]], 1);
+  EXPECT_NEAR(20, counts[hostSet().healthy_hosts_[2]], 1);
+  EXPECT_NEAR(40, counts[hostSet().healthy_hosts_[3]], 1);
+
+  // Replacing most of the hosts rebuilds the schedule.
+  removed_hosts = {hostSet().hosts_[0], hostSet().hosts_[1], hostSet().hosts_[2]};
+  hostSet().healthy_hosts_ = {hostSet().healthy_hosts_[3],
+                              makeTestHost(info_, "tcp://127.0.0.1:85", simTime(), 1)};
+  hostSet().hosts_ = hostSet().healthy_hosts_;
+  hostSet().runCallbacks({hostSet().healthy_hosts_[1]}, removed_hosts);
+  counts = count_picks(50);
+  EXPECT_NEAR(40, counts[hostSet().healthy_hosts_[0]], 1);
+  EXPECT_NEAR(10, counts[hostSet().healthy_hosts_[1]], 1);
+}
+
 // Validate that low weighted hosts will be chosen when the LB is created.
 TEST_P(RoundRobinLoadBalancerTest, WeightedInitializationPicksAllHosts) {
   TestScopedRuntime scoped_runtime;
@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <vector>
+
+#include "envoy/config/core/v3/base.pb.h"
+
+#include "source/common/config/metadata.h"
+#include "source/common/upstream/upstream_impl.h"
+#include "source/extensions/load_balancing_policies/subset/subset_host_index.h"
+
+#include "test/common/upstream/utility.h"
+#include "test/mocks/upstream/cluster_info.h"
+#include "test/test_common/simulated_time_system.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::ElementsAre;
+using testing::NiceMock;
+
+namespace Envoy {
+namespace Upstream {
+namespace {
+
+std::vector<uint32_t> slots(const HostSlotSet& set) {
+  std::vector<uint32_t> slots;
+  set.forEach([&slots](uint32_t slot) { slots.push_back(slot); });
+  return slots;
+}
+
+TEST(HostSlotSetTest, InsertErase) {
+  HostSlotSet set;
+  EXPECT_TRUE(set.empty());
+  set.insert(130);
+  set.insert(3);
+  set.insert(64);
+  set.insert(3);
+  EXPECT_EQ(3, set.size());
+  EXPECT_TRUE(set.contains(64));
+  EXPECT_FALSE(set.contains(65));
+  EXPECT_THAT(slots(set), ElementsAre(3, 64, 130));
+
+  set.erase(64);
+  set.erase(1000);
+  EXPECT_THAT(slots(set), ElementsAre(3, 130));
+  set.erase(3);
+  set.erase(130);
+  EXPECT_TRUE(set.empty());
+  EXPECT_EQ(HostSlotSet(), set);
+}
+
+TEST(HostSlotSetTest, IntersectionDifference) {
+  HostSlotSet a;
+  HostSlotSet b;
+  HostSlotSet c;
+  for (uint32_t slot = 0; slot < 300; ++slot) {
+    a.insert(slot);
+    if (slot % 2 == 0) {
+      b.insert(slot);
+    }
+    if (slot % 100 == 0) {
+      c.insert(slot);
+    }
+  }
+  c.insert(301);
+
+  EXPECT_THAT(slots(HostSlotSet::intersection({&a, &b, &c})), ElementsAre(0, 100, 200));
+  EXPECT_EQ(b, HostSlotSet::intersection({&a, &b}));
+  EXPECT_EQ(a, HostSlotSet::intersection({&a}));
+  const HostSlotSet empty;
+  EXPECT_TRUE(HostSlotSet::intersection({&a, &empty}).empty());
+
+  EXPECT_EQ(150, HostSlotSet::difference(a, b).size());
+  EXPECT_THAT(slots(HostSlotSet::difference(c, b)), ElementsAre(301));
+  EXPECT_TRUE(HostSlotSet::difference(b, a).empty());
+}
+
+class SubsetHostIndexTest : public Event::TestUsingSimulatedTime, public testing::Test {
+public:
+  SubsetHostIndexTest() : index_(host_index_.priorityIndex(0)) {}
+
+  MetadataConstSharedPtr makeMetadata(const std::string& version) {
+    auto metadata = std::make_shared<envoy::config::core::v3::Metadata>();
+    Config::Metadata::mutableMetadataValue(*metadata, Config::MetadataFilters::get().ENVOY_LB,
+                                           "version")
+        .set_string_value(version);
+    return metadata;
+  }
+
+  HostSharedPtr makeHost(const std::string& url, const std::string& version) {
+    return makeTestHost(info_, url, *makeMetadata(version), simTime());
+  }
+
+  SubsetHostIndex::KvId kvId(const std::string& version) {
+    ProtobufWkt::Value value;
+    value.set_string_value(version);
+    return host_index_.kvId("version", value);
+  }
+
+  // Indexes each host by its version.
+  void update() {
+    host_set_.updateHosts(HostSetImpl::partitionHosts(std::make_shared<HostVector>(hosts_),
+                                                      makeHostsPerLocality({hosts_})),
+                          {}, {}, {}, 0);
+    index_.update(host_set_, [this](const Host& host) {
+      ++indexed_;
+      const MetadataConstSharedPtr metadata = host.metadata();
+      const auto& value = Config::Metadata::metadataValue(
+          metadata.get(), Config::MetadataFilters::get().ENVOY_LB, "version");
+      SubsetHostIndex::KvIds kv_ids{SubsetHostIndex::AnyHostKvId, kvId(value.string_value())};
+      std::sort(kv_ids.begin(), kv_ids.end());
+      return kv_ids;
+    });
+  }
+
+  HostVector subsetHosts(const SubsetHostIndex::KvIds& kv_ids) {
+    return *index_.hostLists(index_.hosts(kv_ids)).hosts;
+  }
+
+  std::shared_ptr<NiceMock<MockClusterInfo>> info_{new NiceMock<MockClusterInfo>()};
+  HostSetImpl host_set_{0, absl::nullopt, absl::nullopt};
+  SubsetHostIndex host_index_;
+  SubsetHostIndex::PriorityIndex& index_;
+  HostVector hosts_;
+  uint32_t indexed_{};
+};
+
+TEST_F(SubsetHostIndexTest, IncrementalUpdates) {
+  hosts_ = {makeHost("tcp://127.0.0.1:80", "1.0"), makeHost("tcp://127.0.0.1:81", "1.1"),
+            makeHost("tcp://127.0.0.1:82", "1.0"), makeHost("tcp://127.0.0.1:83", "1.1")};
+  update();
+  EXPECT_EQ(4, indexed_);
+  const SubsetHostIndex::KvIds v10{kvId("1.0")};
+  const SubsetHostIndex::KvIds v11{kvId("1.1")};
+  EXPECT_TRUE(index_.touched(v10));
+  EXPECT_TRUE(index_.touched(v11));
+  EXPECT_THAT(subsetHosts(v10), ElementsAre(hosts_[0], hosts_[2]));
+  EXPECT_THAT(subsetHosts(v11), ElementsAre(hosts_[1], hosts_[3]));
+  EXPECT_THAT(subsetHosts({SubsetHostIndex::AnyHostKvId}), ElementsAre(hosts_[0], hosts_[1],
+                                                                       hosts_[2], hosts_[3]));
+
+  // Nothing changed.
+  update();
+  EXPECT_EQ(4, indexed_);
+  EXPECT_FALSE(index_.touched(v10));
+  EXPECT_FALSE(index_.touched(v11));
+  EXPECT_FALSE(index_.touched({SubsetHostIndex::AnyHostKvId}));
+
+  // A change of health only touches the subsets of the host.
+  hosts_[1]->healthFlagSet(Host::HealthFlag::FAILED_ACTIVE_HC);
+  update();
+  EXPECT_EQ(4, indexed_);
+  EXPECT_FALSE(index_.touched(v10));
+  EXPECT_TRUE(index_.touched(v11));
+  EXPECT_THAT(*index_.hostLists(index_.hosts(v11)).healthy_hosts, ElementsAre(hosts_[3]));
+
+  // A change of metadata re-indexes the host.
+  hosts_[2]->metadata(makeMetadata("1.1"));
+  update();
+  EXPECT_EQ(5, indexed_);
+  EXPECT_TRUE(index_.touched(v10));
+  EXPECT_TRUE(index_.touched(v11));
+  EXPECT_THAT(subsetHosts(v10), ElementsAre(hosts_[0]));
+  EXPECT_THAT(subsetHosts(v11), ElementsAre(hosts_[1], hosts_[2], hosts_[3]));
+
+  // The slot of a removed host remains valid until it is released.
+  const HostSlotSet v10_hosts = index_.hosts(v10);
+  const HostSharedPtr removed = hosts_[0];
+  hosts_.erase(hosts_.begin());
+  update();
+  EXPECT_TRUE(index_.touched(v10));
+  EXPECT_FALSE(index_.touched(v11));
+  EXPECT_TRUE(index_.hosts(v10).empty());
+  v10_hosts.forEach([&](uint32_t slot) { EXPECT_EQ(removed, index_.host(slot)); });
+
+  // Once released, the slot and the id of the pair no host carries anymore are reused.
+  host_index_.releaseUnused();
+  hosts_.push_back(makeHost("tcp://127.0.0.1:84", "1.2"));
+  update();
+  EXPECT_EQ(v10, SubsetHostIndex::KvIds{kvId("1.2")});
+  EXPECT_EQ(v10_hosts, index_.hosts(v10));
+  EXPECT_THAT(subsetHosts(v10), ElementsAre(hosts_[3]));
+}
+
+TEST_F(SubsetHostIndexTest, OrderOfLists) {
+  for (uint32_t i = 0; i < 40; ++i) {
+    hosts_.push_back(makeHost(fmt::format("tcp://127.0.0.1:{}", 80 + i), i < 2 ? "a" : "b"));
+  }
+  update();
+
+  // Both the few hosts of a small subset and the many hosts of a large one are listed in the order
+  // of the host set, regardless of their slots.
+  std::reverse(hosts_.begin(), hosts_.end());
+  update();
+  EXPECT_THAT(subsetHosts({kvId("a")}), ElementsAre(hosts_[38], hosts_[39]));
+  const HostVector b_hosts = subsetHosts({kvId("b")});
+  EXPECT_EQ(HostVector(hosts_.begin(), hosts_.begin() + 38), b_hosts);
+  EXPECT_EQ(hosts_, subsetHosts({SubsetHostIndex::AnyHostKvId}));
+}
+
+} // namespace
+} // namespace Upstream
+} // namespace Envoy
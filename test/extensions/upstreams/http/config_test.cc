@@ -91,6 +91,30 @@ TEST_F(ConfigTest, AutoHttp3NoCache) {
             "alternate protocols cache must be configured when HTTP/3 is enabled with auto_config");
 }
 
+TEST_F(ConfigTest, SharedConnectionPool) {
+  EXPECT_EQ(0, ProtocolOptionsConfigImpl::createProtocolOptionsConfig(options_, server_context_)
+                   .value()
+                   ->shared_connection_pool_owners_);
+
+  options_.mutable_shared_connection_pool();
+  EXPECT_EQ(ProtocolOptionsConfigImpl::createProtocolOptionsConfig(options_, server_context_)
+                .status()
+                .message(),
+            "shared_connection_pool requires an explicit_http_config of HTTP/2 or HTTP/3");
+  options_.mutable_explicit_http_config()->mutable_http_protocol_options();
+  EXPECT_FALSE(
+      ProtocolOptionsConfigImpl::createProtocolOptionsConfig(options_, server_context_).ok());
+
+  options_.mutable_explicit_http_config()->mutable_http2_protocol_options();
+  EXPECT_EQ(1, ProtocolOptionsConfigImpl::createProtocolOptionsConfig(options_, server_context_)
+                   .value()
+                   ->shared_connection_pool_owners_);
+  options_.mutable_shared_connection_pool()->mutable_owners_per_host()->set_value(3);
+  EXPECT_EQ(3, ProtocolOptionsConfigImpl::createProtocolOptionsConfig(options_, server_context_)
+                   .value()
+                   ->shared_connection_pool_owners_);
+}
+
 TEST_F(ConfigTest, KvStoreConcurrencyFail) {
   options_.mutable_auto_config();
   options_.mutable_auto_config()->mutable_http3_protocol_options();
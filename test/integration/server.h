@@ -299,6 +299,19 @@ public:
     Thread::LockGuard lock(lock_);
     store_.forEachScope(f_size, f_scope);
   }
+  void forEachFamilyMemory(const StatFamilyMemoryFn& fn) const override {
+    Thread::LockGuard lock(lock_);
+    store_.forEachFamilyMemory(fn);
+  }
+  void forEachHeavyHitterCounter(
+      const std::function<void(PrimitiveCounterSnapshot&&)>& fn) override {
+    Thread::LockGuard lock(lock_);
+    store_.forEachHeavyHitterCounter(fn);
+  }
+  bool addHeavyHitterCounter(absl::string_view name, uint64_t delta) override {
+    Thread::LockGuard lock(lock_);
+    return store_.addHeavyHitterCounter(name, delta);
+  }
   void forEachSinkedCounter(Stats::SizeFn f_size, StatFn<Counter> f_stat) const override {
     Thread::LockGuard lock(lock_);
     store_.forEachSinkedCounter(f_size, f_stat);
@@ -370,6 +383,7 @@ public:
   void setTagProducer(TagProducerPtr&&) override {}
   void setStatsMatcher(StatsMatcherPtr&&) override {}
   void setHistogramSettings(HistogramSettingsConstPtr&&) override {}
+  void setHeavyHitterStats(HeavyHitterStatsPtr&&) override {}
   void initializeThreading(Event::Dispatcher&, ThreadLocal::Instance&) override {}
   void shutdownThreading() override {}
   void mergeHistograms(PostMergeCb cb) override { merge_cb_ = cb; }
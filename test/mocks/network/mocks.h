@@ -183,6 +183,7 @@ public:
   MOCK_METHOD(void, onData, (UdpRecvData && data));
   MOCK_METHOD(void, onDatagramsDropped, (uint32_t dropped));
   MOCK_METHOD(void, onReadReady, ());
+  MOCK_METHOD(void, onReadBatchComplete, (uint32_t num_packets_read));
   MOCK_METHOD(void, onWriteReady, (const Socket& socket));
   MOCK_METHOD(void, onReceiveError, (Api::IoError::IoErrorCode err));
   MOCK_METHOD(Network::UdpPacketWriter&, udpPacketWriter, ());
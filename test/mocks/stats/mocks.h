@@ -163,6 +163,7 @@ public:
   MOCK_METHOD(void, setParentValue, (uint64_t parent_value));
   MOCK_METHOD(void, sub, (uint64_t amount));
   MOCK_METHOD(void, mergeImportMode, (ImportMode));
+  MOCK_METHOD(bool, latchChanged, ());
   MOCK_METHOD(bool, used, (), (const));
   MOCK_METHOD(bool, hidden, (), (const));
   MOCK_METHOD(uint64_t, value, (), (const));
@@ -361,6 +362,7 @@ public:
 
   MOCK_METHOD(void, deliverHistogramToSinks, (const Histogram& histogram, uint64_t value));
   MOCK_METHOD(const TagVector&, fixedTags, ());
+  MOCK_METHOD(bool, addHeavyHitterCounter, (absl::string_view name, uint64_t delta));
 };
 
 class MockStatsMatcher : public StatsMatcher {
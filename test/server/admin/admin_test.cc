@@ -186,6 +186,8 @@ TEST_P(AdminInstanceTest, Help) {
       format: Format to use; One of (html, active-html, text, json)
       type: Stat types to include.; One of (All, Counters, Histograms, Gauges, TextReadouts)
       histogram_buckets: Histogram bucket display mode; One of (cumulative, disjoint, detailed, summary)
+  /stats/memory: print memory used by stats, grouped by name
+      depth: Number of leading dot-separated name tokens to group by; 0 (the default) reports each tag-extracted name separately
   /stats/prometheus: print server stats in prometheus format
       usedonly: Only include stats that have been written by system since restart
       text_readouts: Render text_readouts as new gaugues with value 0 (increases Prometheus data size)
@@ -585,6 +585,48 @@ envoy_cluster_endpoint_healthy{another_tag_name="another_tag-value",envoy_cluste
   EXPECT_EQ(expected_output, response.toString());
 }
 
+TEST_F(PrometheusStatsFormatterTest, StreamedInChunks) {
+  Stats::CustomStatNamespacesImpl custom_namespaces;
+  addCounter("cluster.test_1.upstream_cx_total",
+             {{makeStat("a.tag-name"), makeStat("a.tag-value")}});
+  addCounter("cluster.test_2.upstream_cx_total",
+             {{makeStat("another_tag_name"), makeStat("another_tag-value")}});
+  addGauge("cluster.test_3.upstream_cx_total",
+           {{makeStat("another_tag_name_3"), makeStat("another_tag_3-value")}});
+  addTextReadout("cluster.test_4.upstream_cx_total", "text\"value",
+                 {{makeStat("tag_name"), makeStat("tag-value")}});
+  addClusterEndpoints("cluster1", 2, {{"a.tag-name", "a.tag-value"}});
+
+  StatsParams params;
+  Buffer::OwnedImpl buffered;
+  const uint64_t size = PrometheusStatsFormatter::statsAsPrometheus(
+      counters_, gauges_, histograms_, textReadouts_, endpoints_helper_->cm_, buffered, params,
+      custom_namespaces);
+
+  // With a one byte chunk size every group is streamed in a chunk of its own.
+  PrometheusStatsRequest request(counters_, gauges_, histograms_, textReadouts_,
+                                 endpoints_helper_->cm_, params, custom_namespaces);
+  request.setChunkSize(1);
+  Http::TestResponseHeaderMapImpl response_headers;
+  EXPECT_EQ(Http::Code::OK, request.start(response_headers));
+  std::string streamed;
+  uint32_t num_chunks = 0;
+  bool more = true;
+  while (more) {
+    Buffer::OwnedImpl chunk;
+    more = request.nextChunk(chunk);
+    if (chunk.length() > 0) {
+      ++num_chunks;
+      EXPECT_TRUE(absl::StartsWith(chunk.toString(), "# TYPE "));
+    }
+    streamed += chunk.toString();
+  }
+  EXPECT_EQ(size, request.metricNameCount());
+  EXPECT_EQ(size, num_chunks);
+  EXPECT_EQ(buffered.toString(), streamed);
+  EXPECT_THAT(streamed, testing::HasSubstr(R"EOF(text_value="text\"value")EOF"));
+}
+
 TEST_F(PrometheusStatsFormatterTest, OutputWithTextReadoutsInGaugeFormat) {
   Stats::CustomStatNamespacesImpl custom_namespaces;
 
@@ -2,6 +2,7 @@
 #include <string>
 
 #include "source/common/common/regex.h"
+#include "source/common/json/json_loader.h"
 #include "source/common/stats/custom_stat_namespaces_impl.h"
 #include "source/common/stats/thread_local_store.h"
 #include "source/server/admin/stats_handler.h"
@@ -1358,6 +1359,52 @@ TEST_P(AdminInstanceTest, RecentLookups) {
   EXPECT_THAT(body, HasSubstr("       1 gamma\n       2 beta\n       3 alpha\n"));
 }
 
+TEST_P(AdminInstanceTest, StatsMemoryInvalidDepth) {
+  Http::TestResponseHeaderMapImpl response_headers;
+  std::string body;
+  EXPECT_EQ(Http::Code::BadRequest,
+            admin_.request("/stats/memory?depth=-1", "GET", response_headers, body));
+  EXPECT_EQ("depth must be a non-negative integer\n", body);
+  EXPECT_EQ(Http::Code::OK, admin_.request("/stats/memory", "GET", response_headers, body));
+  EXPECT_THAT(std::string(response_headers.getContentTypeValue()), HasSubstr("application/json"));
+}
+
+TEST_F(AdminStatsTest, StatsMemory) {
+  store_->counterFromString("cluster.a.upstream_rq");
+  store_->counterFromString("cluster.b.upstream_rq");
+  store_->histogramFromString("cluster.a.upstream_rq_time", Stats::Histogram::Unit::Milliseconds);
+  store_->gaugeFromString("server.live", Stats::Gauge::ImportMode::NeverImport);
+
+  auto render = [this](uint32_t depth) {
+    Buffer::OwnedImpl response;
+    StatsHandler::statsMemoryRender(*store_, depth, response);
+    return Json::Factory::loadFromString(response.toString()).value();
+  };
+
+  Json::ObjectSharedPtr json = render(1);
+  Json::ObjectSharedPtr total = json->getObject("total").value();
+  EXPECT_EQ(2, total->getInteger("counters").value());
+  EXPECT_EQ(1, total->getInteger("gauges").value());
+  EXPECT_EQ(1, total->getInteger("histograms").value());
+  EXPECT_LT(0, json->getInteger("symbols").value());
+
+  // Histograms and the other stat types are merged into the same group, and
+  // the largest group comes first.
+  std::vector<Json::ObjectSharedPtr> groups = json->getObjectArray("groups").value();
+  ASSERT_EQ(2, groups.size());
+  EXPECT_EQ("cluster", groups[0]->getString("name").value());
+  EXPECT_EQ(2, groups[0]->getInteger("counters").value());
+  EXPECT_EQ(1, groups[0]->getInteger("histograms").value());
+  EXPECT_EQ("server", groups[1]->getString("name").value());
+  EXPECT_EQ(1, groups[1]->getInteger("gauges").value());
+  EXPECT_EQ(total->getInteger("bytes").value(), groups[0]->getInteger("bytes").value() +
+                                                    groups[1]->getInteger("bytes").value());
+
+  // Without a depth, every name is reported separately.
+  EXPECT_EQ(4, render(0)->getObjectArray("groups").value().size());
+  EXPECT_EQ(3, render(2)->getObjectArray("groups").value().size());
+}
+
 class StatsHandlerPrometheusTest : public StatsHandlerTest {
 public:
   void createTestStats() {
@@ -49,6 +49,7 @@ using testing::InSequence;
 using testing::Invoke;
 using testing::InvokeWithoutArgs;
 using testing::Return;
+using testing::ReturnRef;
 using testing::SaveArg;
 using testing::StrictMock;
 
@@ -160,6 +161,76 @@ TEST(ServerInstanceUtil, flushImportModeUninitializedGauges) {
   InstanceUtil::flushMetricsToSinks(sinks, store, cm, time_system);
 }
 
+TEST(ServerInstanceUtil, flushChangedOnly) {
+  InSequence s;
+
+  NiceMock<Upstream::MockClusterManager> cm;
+  Stats::TestUtil::TestStore store;
+  Event::SimulatedTimeSystem time_system;
+  Stats::Counter& active = store.counter("active");
+  store.counter("idle").inc();
+  Stats::Gauge& written = store.gauge("written", Stats::Gauge::ImportMode::Accumulate);
+  store.gauge("untouched", Stats::Gauge::ImportMode::Accumulate).set(3);
+
+  std::list<Stats::SinkPtr> sinks;
+  Stats::MockSink* sink = new StrictMock<Stats::MockSink>();
+  sinks.emplace_back(sink);
+
+  // A full flush hands the sinks everything, and latches counters and gauges.
+  EXPECT_CALL(*sink, flush(_)).WillOnce(Invoke([](Stats::MetricSnapshot& snapshot) {
+    EXPECT_EQ(snapshot.counters().size(), 2);
+    EXPECT_EQ(snapshot.gauges().size(), 2);
+  }));
+  InstanceUtil::flushMetricsToSinks(sinks, store, cm, time_system);
+
+  active.inc();
+  written.set(7);
+  EXPECT_CALL(*sink, flush(_)).WillOnce(Invoke([](Stats::MetricSnapshot& snapshot) {
+    ASSERT_EQ(snapshot.counters().size(), 1);
+    EXPECT_EQ(snapshot.counters()[0].counter_.get().name(), "active");
+    EXPECT_EQ(snapshot.counters()[0].delta_, 1);
+
+    ASSERT_EQ(snapshot.gauges().size(), 1);
+    EXPECT_EQ(snapshot.gauges()[0].get().name(), "written");
+    EXPECT_EQ(snapshot.gauges()[0].get().value(), 7);
+  }));
+  InstanceUtil::flushMetricsToSinks(sinks, store, cm, time_system, true);
+
+  EXPECT_CALL(*sink, flush(_)).WillOnce(Invoke([](Stats::MetricSnapshot& snapshot) {
+    EXPECT_TRUE(snapshot.counters().empty());
+    EXPECT_TRUE(snapshot.gauges().empty());
+  }));
+  InstanceUtil::flushMetricsToSinks(sinks, store, cm, time_system, true);
+
+  // Only histograms that recorded samples in the last interval are handed to the sinks.
+  NiceMock<Stats::MockStore> mock_store;
+  auto* idle_histogram = new NiceMock<Stats::MockParentHistogram>();
+  auto* busy_histogram = new NiceMock<Stats::MockParentHistogram>();
+  std::vector<Stats::ParentHistogramSharedPtr> parent_histograms = {
+      Stats::ParentHistogramSharedPtr(idle_histogram),
+      Stats::ParentHistogramSharedPtr(busy_histogram)};
+  histogram_t* samples = hist_alloc();
+  hist_insert_intscale(samples, 1, 0, 1);
+  Stats::HistogramStatisticsImpl busy_stats(samples);
+  hist_free(samples);
+  ON_CALL(*busy_histogram, intervalStatistics()).WillByDefault(ReturnRef(busy_stats));
+  ON_CALL(mock_store, forEachSinkedHistogram)
+      .WillByDefault([&](std::function<void(std::size_t)> f_size,
+                         std::function<void(Stats::ParentHistogram&)> f_stat) {
+        if (f_size != nullptr) {
+          f_size(parent_histograms.size());
+        }
+        for (auto& histogram : parent_histograms) {
+          f_stat(*histogram);
+        }
+      });
+  EXPECT_CALL(*sink, flush(_)).WillOnce(Invoke([&](Stats::MetricSnapshot& snapshot) {
+    ASSERT_EQ(snapshot.histograms().size(), 1);
+    EXPECT_EQ(&snapshot.histograms()[0].get(), busy_histogram);
+  }));
+  InstanceUtil::flushMetricsToSinks(sinks, mock_store, cm, time_system, true);
+}
+
 class RunHelperTest : public testing::Test {
 public:
   RunHelperTest() {
@@ -0,0 +1,52 @@
+/**
+ * Utility to convert a file access log written with proto_format to JSON or text proto.
+ *
+ * Usage:
+ *
+ * access_log_decode [--text] <access log path>
+ *
+ * Each entry is written to stdout as one line of JSON, or as a text proto followed by a blank
+ * line when --text is given.
+ */
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "source/common/protobuf/utility.h"
+#include "source/extensions/access_loggers/file/proto_formatter.h"
+
+#include "absl/strings/string_view.h"
+
+// NOLINT(namespace-envoy)
+int main(int argc, char** argv) {
+  const bool text = argc == 3 && absl::string_view(argv[1]) == "--text";
+  if (argc != 2 && !text) {
+    std::cerr << "Usage: " << argv[0] << " [--text] <access log path>" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::ifstream input(argv[argc - 1], std::ios_base::binary);
+  if (!input) {
+    std::cerr << "Unable to open " << argv[argc - 1] << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::stringstream contents;
+  contents << input.rdbuf();
+
+  const absl::Status status = Envoy::Extensions::AccessLoggers::File::ProtoFormatter::decode(
+      contents.str(), [text](const envoy::data::accesslog::v3::HTTPAccessLogEntry& entry) {
+        if (text) {
+          std::cout << Envoy::MessageUtil::toTextProto(entry) << std::endl;
+        } else {
+          std::cout << Envoy::MessageUtil::getJsonStringFromMessageOrError(entry, false, true)
+                    << std::endl;
+        }
+      });
+  if (!status.ok()) {
+    // Entries before the error have been written, which keeps files cut by rotation useful.
+    std::cerr << status.message() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}